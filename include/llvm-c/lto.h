@@ -27,7 +27,7 @@
  * @{
  */
 
-#define LTO_API_VERSION 4
+#define LTO_API_VERSION 5
 
 typedef enum {
     LTO_SYMBOL_ALIGNMENT_MASK              = 0x0000001F, /* log2 of alignment */
@@ -236,6 +236,17 @@ extern void
 lto_codegen_set_cpu(lto_code_gen_t cg, const char *cpu);
 
 
+/**
+ * Sets the number of partitions lto_codegen_compile_to_files() splits the
+ * merged module into after optimization. Each partition is compiled on its
+ * own thread. The default, 1, generates a single object file. The partitions
+ * only depend on the merged module and this number, not on how the threads
+ * are scheduled.
+ */
+extern void
+lto_codegen_set_parallelism(lto_code_gen_t cg, unsigned parallelism);
+
+
 /**
  * Sets the location of the assembler tool to run. If not set, libLTO
  * will use gcc to invoke the assembler.
@@ -285,6 +296,18 @@ extern bool
 lto_codegen_compile_to_file(lto_code_gen_t cg, const char** name);
 
 
+/**
+ * Generates code for all added modules into one native object file per
+ * partition (see lto_codegen_set_parallelism()). On success the names of the
+ * files are written to names and their number to count. The array is owned
+ * by the lto_code_gen_t and stays valid until lto_codegen_dispose() is called,
+ * or code is generated again. Returns true on error.
+ */
+extern bool
+lto_codegen_compile_to_files(lto_code_gen_t cg, const char* const** names,
+                             unsigned* count);
+
+
 /**
  * Sets options to help debug codegen bugs.
  */
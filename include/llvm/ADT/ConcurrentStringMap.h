@@ -0,0 +1,171 @@
+//===--- ConcurrentStringMap.h - Thread-safe string map ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the ConcurrentStringMap class, a StringMap that can be
+// used from several threads at once.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_CONCURRENTSTRINGMAP_H
+#define LLVM_ADT_CONCURRENTSTRINGMAP_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Mutex.h"
+#include <cassert>
+#include <utility>
+
+namespace llvm {
+
+/// ConcurrentStringMap - A map from strings to values that may be read and
+/// modified by several threads at once.
+///
+/// The keys are spread over a fixed number of shards by hash, and each shard
+/// is an ordinary StringMap protected by its own lock, so threads only contend
+/// when they touch keys of the same shard. The entries are the usual
+/// StringMapEntry objects and, like those of a StringMap, never move, so a
+/// pointer to one stays valid until its key is erased or the map is cleared.
+///
+/// The map synchronizes access to its own structure only. Clients that modify
+/// the value of an entry while other threads may read it have to synchronize
+/// that themselves.
+template<typename ValueTy, typename AllocatorTy = MallocAllocator>
+class ConcurrentStringMap {
+public:
+  typedef StringMapEntry<ValueTy> MapEntryTy;
+  typedef StringMap<ValueTy, AllocatorTy> ShardMapTy;
+
+  enum { DefaultNumShards = 64 };
+
+private:
+  struct Shard {
+    sys::Mutex Lock;
+    ShardMapTy Map;
+    // Keep the locks of neighbouring shards on separate cache lines.
+    char Padding[64];
+
+    // The map never calls out to client code with a lock held, so the locks
+    // don't need to be recursive.
+    Shard() : Lock(false) {}
+  };
+
+  Shard *Shards;
+  unsigned ShardBits;
+
+  ConcurrentStringMap(const ConcurrentStringMap &) LLVM_DELETED_FUNCTION;
+  void operator=(const ConcurrentStringMap &) LLVM_DELETED_FUNCTION;
+
+  /// getShard - Return the shard that holds Key. StringMap picks buckets with
+  /// the low bits of the hash, so use the scrambled high bits here.
+  Shard &getShard(StringRef Key) const {
+    if (ShardBits == 0)
+      return Shards[0];
+    unsigned Hash = StringMapImpl::hashKey(Key) * 0x9E3779B1U;
+    return Shards[Hash >> (32 - ShardBits)];
+  }
+
+public:
+  /// Create a map with \p NumShards shards, rounded up to a power of two.
+  explicit ConcurrentStringMap(unsigned NumShards = DefaultNumShards)
+    : ShardBits(0) {
+    assert(NumShards <= (1U << 16) && "Too many shards!");
+    while ((1U << ShardBits) < NumShards)
+      ++ShardBits;
+    Shards = new Shard[1U << ShardBits];
+  }
+
+  ~ConcurrentStringMap() { delete[] Shards; }
+
+  unsigned getNumShards() const { return 1U << ShardBits; }
+
+  /// insert - Insert Key with the value Val unless the map already contains
+  /// Key. Return the entry for Key and whether it was inserted.
+  std::pair<MapEntryTy*, bool> insert(StringRef Key, const ValueTy &Val) {
+    Shard &S = getShard(Key);
+    sys::ScopedLock Guard(S.Lock);
+    unsigned Size = S.Map.size();
+    MapEntryTy &Entry = S.Map.GetOrCreateValue(Key, Val);
+    return std::make_pair(&Entry, S.Map.size() != Size);
+  }
+
+  /// GetOrCreateValue - Look up Key, and create a default constructed entry
+  /// for it if it is not in the map.
+  MapEntryTy &GetOrCreateValue(StringRef Key) {
+    Shard &S = getShard(Key);
+    sys::ScopedLock Guard(S.Lock);
+    return S.Map.GetOrCreateValue(Key);
+  }
+
+  /// find - Return the entry for Key, or null if the map does not contain it.
+  MapEntryTy *find(StringRef Key) const {
+    Shard &S = getShard(Key);
+    sys::ScopedLock Guard(S.Lock);
+    typename ShardMapTy::iterator I = S.Map.find(Key);
+    if (I == S.Map.end())
+      return 0;
+    return &*I;
+  }
+
+  /// lookup - Return a copy of the value for Key, or a default constructed
+  /// value if the map does not contain it.
+  ValueTy lookup(StringRef Key) const {
+    Shard &S = getShard(Key);
+    sys::ScopedLock Guard(S.Lock);
+    return S.Map.lookup(Key);
+  }
+
+  size_t count(StringRef Key) const {
+    Shard &S = getShard(Key);
+    sys::ScopedLock Guard(S.Lock);
+    return S.Map.count(Key);
+  }
+
+  /// erase - Remove Key from the map, destroying its entry. Return false if
+  /// the map does not contain Key.
+  bool erase(StringRef Key) {
+    Shard &S = getShard(Key);
+    sys::ScopedLock Guard(S.Lock);
+    return S.Map.erase(Key);
+  }
+
+  /// size - Return the number of entries. When other threads modify the map
+  /// at the same time, this is only a snapshot of each shard in turn.
+  unsigned size() const {
+    unsigned Size = 0;
+    for (unsigned I = 0, E = getNumShards(); I != E; ++I) {
+      sys::ScopedLock Guard(Shards[I].Lock);
+      Size += Shards[I].Map.size();
+    }
+    return Size;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  void clear() {
+    for (unsigned I = 0, E = getNumShards(); I != E; ++I) {
+      sys::ScopedLock Guard(Shards[I].Lock);
+      Shards[I].Map.clear();
+    }
+  }
+
+  /// getShardMap - Return the map of shard \p I. This is meant for iterating
+  /// over the entries, and must not be used while other threads may modify
+  /// the map.
+  ShardMapTy &getShardMap(unsigned I) {
+    assert(I < getNumShards() && "Shard index out of range!");
+    return Shards[I].Map;
+  }
+  const ShardMapTy &getShardMap(unsigned I) const {
+    assert(I < getNumShards() && "Shard index out of range!");
+    return Shards[I].Map;
+  }
+};
+
+}
+
+#endif
@@ -180,12 +180,29 @@ public:
   /// empty - Returns true if there are no nodes in the folding set.
   bool empty() const { return NumNodes == 0; }
 
+  /// getNumBuckets - Returns the length of the bucket array.
+  unsigned getNumBuckets() const { return NumBuckets; }
+
+  /// getMemorySize - Returns the size in bytes of the bucket array, not
+  /// counting the nodes.
+  size_t getMemorySize() const { return (NumBuckets + 1) * sizeof(void*); }
+
+  /// ShrinkHashTable - Rehash everything into the smallest table, of at least
+  /// MinNumBuckets buckets, that the current nodes fit into without growing.
+  /// The table only grows on insertion, so this lets a set that has lost most
+  /// of its nodes give back the memory.
+  void ShrinkHashTable(unsigned MinNumBuckets = 64);
+
 private:
 
   /// GrowHashTable - Double the size of the hash table and rehash everything.
   ///
   void GrowHashTable();
 
+  /// RehashTo - Rehash everything into a new table of NewNumBuckets buckets.
+  ///
+  void RehashTo(unsigned NewNumBuckets);
+
 protected:
 
   /// GetNodeProfile - Instantiations of the FoldingSet template implement
@@ -102,6 +102,11 @@ public:
 
   bool empty() const { return NumItems == 0; }
   unsigned size() const { return NumItems; }
+
+  /// hashKey - Return the hash value the map uses for Key. This reads the key
+  /// a word at a time, and is the same on every host so that the iteration
+  /// order of a map doesn't depend on the host.
+  static unsigned hashKey(StringRef Key);
 };
 
 /// StringMapEntry - This is used to represent one value that is inserted into
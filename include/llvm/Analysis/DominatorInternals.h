@@ -10,8 +10,10 @@
 #ifndef LLVM_ANALYSIS_DOMINATOR_INTERNALS_H
 #define LLVM_ANALYSIS_DOMINATOR_INTERNALS_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/Dominators.h"
+#include <cstdlib>
 
 //===----------------------------------------------------------------------===//
 //
@@ -284,6 +286,281 @@ void Calculate(DominatorTreeBase<typename GraphTraits<NodeT>::NodeType>& DT,
   DT.updateDFSNumbers();
 }
 
+//===----------------------------------------------------------------------===//
+//
+// Incremental updates - applyUpdates() recalculates the dominator tree below
+// the nearest common dominator Top of the endpoints of all changed edges.
+//
+// Top still dominates its old subtree after the change, and nothing outside
+// of the subtree can enter it without passing through Top. The dominators in
+// the subtree are therefore those of the subgraph reachable from Top through
+// the subtree, and the dominators outside of it don't change, except when a
+// block in the subtree became unreachable and has an edge leaving it. In that
+// case Top moves up to dominate the target of the edge as well.
+//
+// The subtree is recalculated with the iterative algorithm of Cooper, Harvey
+// and Kennedy, which is fast on the small subgraphs typically involved. The
+// children of a node are created in depth-first order, like Calculate() does.
+//
+//===----------------------------------------------------------------------===//
+
+/// CommonDominatorFinder - Keeps track of the nearest common dominator of a
+/// growing set of tree nodes, visiting each node of the tree at most once.
+template<class NodeT>
+class CommonDominatorFinder {
+  /// PathIndex - The distance of the ancestors of the first node from it.
+  DenseMap<DomTreeNodeBase<NodeT>*, unsigned> PathIndex;
+  /// Walked - Nodes off the path that are known to be below Top.
+  SmallPtrSet<DomTreeNodeBase<NodeT>*, 32> Walked;
+  DomTreeNodeBase<NodeT> *Top;
+public:
+  CommonDominatorFinder() : Top(0) {}
+
+  DomTreeNodeBase<NodeT> *getTop() const { return Top; }
+
+  void add(DomTreeNodeBase<NodeT> *N) {
+    if (!Top) {
+      Top = N;
+      for (unsigned Index = 0; N; N = N->getIDom())
+        PathIndex[N] = Index++;
+      return;
+    }
+
+    // Walk up to the path. A node that was walked before leads to a node on
+    // the path that is not above Top.
+    while (!PathIndex.count(N)) {
+      if (!Walked.insert(N))
+        return;
+      N = N->getIDom();
+    }
+    if (PathIndex[N] > PathIndex[Top])
+      Top = N;
+  }
+};
+
+template<class NodeT>
+void DominatorTreeBase<NodeT>::applyUpdates(
+                                   const DomTreeUpdatesBase<NodeT> &Updates) {
+  assert(!this->isPostDominator() &&
+         "Incremental updates of post dominators are not supported!");
+  typedef DomTreeNodeBase<NodeT> TreeNode;
+  typedef GraphTraits<NodeT*> GraphT;
+  typedef GraphTraits<Inverse<NodeT*> > InvTraits;
+  typedef typename GraphT::ChildIteratorType SuccIterator;
+  typedef typename DomTreeUpdatesBase<NodeT>::EdgeT EdgeT;
+
+  if (!RootNode || Updates.empty())
+    return;
+  NodeT *Entry = RootNode->getBlock();
+  CommonDominatorFinder<NodeT> Top;
+
+  for (typename SmallVectorImpl<EdgeT>::const_iterator
+       I = Updates.Deleted.begin(), E = Updates.Deleted.end(); I != E; ++I) {
+    TreeNode *From = getNode(I->first);
+    TreeNode *To = getNode(I->second);
+    if (From && To) {
+      Top.add(From);
+      Top.add(To);
+    }
+  }
+
+  // The reachable predecessors of an erased block are dominated by its idom.
+  // Its node is unmapped right away, because a new block may have been
+  // allocated at the same address.
+  SmallPtrSet<TreeNode*, 4> ErasedNodes;
+  for (unsigned i = 0, e = Updates.DeletedBlocks.size(); i != e; ++i) {
+    NodeT *BB = Updates.DeletedBlocks[i];
+    if (TreeNode *Node = getNode(BB)) {
+      assert(Node != RootNode && "Cannot erase the entry block!");
+      Top.add(Node->getIDom());
+      ErasedNodes.insert(Node);
+      DomTreeNodes.erase(BB);
+    }
+  }
+
+  // An edge from an unreachable block changes nothing. An edge to one makes
+  // a region of new blocks reachable, and the edges from that region into the
+  // tree count as inserted as well. The region is found through the current
+  // successors of the source rather than through the recorded target, which
+  // may be an erased block or a new block at its address.
+  SmallPtrSet<NodeT*, 16> NewBlocks;
+  SmallVector<NodeT*, 16> Worklist;
+  for (typename SmallVectorImpl<EdgeT>::const_iterator
+       I = Updates.Inserted.begin(), E = Updates.Inserted.end(); I != E; ++I) {
+    TreeNode *From = getNode(I->first);
+    if (!From)
+      continue;
+    Top.add(From);
+    if (TreeNode *To = getNode(I->second))
+      Top.add(To);
+    NodeT *FromBB = I->first;
+    for (SuccIterator SI = GraphT::child_begin(FromBB),
+         SE = GraphT::child_end(FromBB); SI != SE; ++SI)
+      if (!getNode(*SI) && NewBlocks.insert(*SI))
+        Worklist.push_back(*SI);
+    while (!Worklist.empty()) {
+      NodeT *BB = Worklist.pop_back_val();
+      for (SuccIterator SI = GraphT::child_begin(BB),
+           SE = GraphT::child_end(BB); SI != SE; ++SI) {
+        if (TreeNode *Succ = getNode(*SI))
+          Top.add(Succ);
+        else if (NewBlocks.insert(*SI))
+          Worklist.push_back(*SI);
+      }
+    }
+  }
+
+  if (!Top.getTop())
+    return;
+  DFSInfoValid = false;
+
+  // Number the blocks reachable from Top through its subtree, or through
+  // blocks that are not in the tree yet, in depth-first order.
+  SmallPtrSet<TreeNode*, 32> Subtree;
+  DenseMap<NodeT*, unsigned> Number;
+  SmallVector<NodeT*, 32> PreOrder, PostOrder;
+  SmallVector<std::pair<NodeT*, SuccIterator>, 32> Stack;
+  SmallVector<TreeNode*, 32> NodeWorklist;
+  bool Recalculated = false;
+  for (;;) {
+    TreeNode *TopNode = Top.getTop();
+    if (!TopNode->getIDom()) {
+      for (typename SmallPtrSet<TreeNode*, 4>::iterator
+           I = ErasedNodes.begin(), E = ErasedNodes.end(); I != E; ++I)
+        delete *I;
+      recalculate(*Entry->getParent());
+      Recalculated = true;
+      break;
+    }
+
+    Subtree.clear();
+    NodeWorklist.push_back(TopNode);
+    while (!NodeWorklist.empty()) {
+      TreeNode *Node = NodeWorklist.pop_back_val();
+      Subtree.insert(Node);
+      NodeWorklist.append(Node->begin(), Node->end());
+    }
+
+    Number.clear();
+    PreOrder.clear();
+    PostOrder.clear();
+    NodeT *TopBB = TopNode->getBlock();
+    Number[TopBB] = ~0U;
+    PreOrder.push_back(TopBB);
+    Stack.push_back(std::make_pair(TopBB, GraphT::child_begin(TopBB)));
+    while (!Stack.empty()) {
+      NodeT *BB = Stack.back().first;
+      if (Stack.back().second == GraphT::child_end(BB)) {
+        Number[BB] = PostOrder.size();
+        PostOrder.push_back(BB);
+        Stack.pop_back();
+        continue;
+      }
+      NodeT *Succ = *Stack.back().second++;
+      if (Number.count(Succ))
+        continue;
+      TreeNode *SuccNode = getNode(Succ);
+      if (SuccNode && !Subtree.count(SuccNode))
+        continue;
+      Number[Succ] = ~0U;
+      PreOrder.push_back(Succ);
+      Stack.push_back(std::make_pair(Succ, GraphT::child_begin(Succ)));
+    }
+
+    // The blocks that became unreachable may have edges leaving the subtree.
+    for (typename SmallPtrSet<TreeNode*, 32>::iterator I = Subtree.begin(),
+         E = Subtree.end(); I != E; ++I) {
+      TreeNode *Node = *I;
+      if (ErasedNodes.count(Node) || Number.count(Node->getBlock()))
+        continue;
+      NodeT *BB = Node->getBlock();
+      for (SuccIterator SI = GraphT::child_begin(BB),
+           SE = GraphT::child_end(BB); SI != SE; ++SI) {
+        TreeNode *SuccNode = getNode(*SI);
+        if (SuccNode && !Subtree.count(SuccNode))
+          Top.add(SuccNode);
+      }
+    }
+    if (Top.getTop() == TopNode)
+      break;
+  }
+
+  if (!Recalculated) {
+    // Calculate the immediate dominators, indexed by postorder number. Top
+    // comes last and is its own immediate dominator.
+    unsigned TopNum = PostOrder.size() - 1;
+    SmallVector<unsigned, 32> IDom(PostOrder.size(), ~0U);
+    IDom[TopNum] = TopNum;
+    for (bool Changed = true; Changed; ) {
+      Changed = false;
+      for (unsigned i = TopNum; i-- != 0; ) {
+        NodeT *BB = PostOrder[i];
+        unsigned NewIDom = ~0U;
+        for (typename InvTraits::ChildIteratorType
+             PI = InvTraits::child_begin(BB),
+             PE = InvTraits::child_end(BB); PI != PE; ++PI) {
+          typename DenseMap<NodeT*, unsigned>::iterator NI = Number.find(*PI);
+          if (NI == Number.end() || IDom[NI->second] == ~0U)
+            continue;
+          unsigned Pred = NI->second;
+          if (NewIDom == ~0U) {
+            NewIDom = Pred;
+            continue;
+          }
+          while (Pred != NewIDom) {
+            while (Pred < NewIDom)
+              Pred = IDom[Pred];
+            while (NewIDom < Pred)
+              NewIDom = IDom[NewIDom];
+          }
+        }
+        if (IDom[i] != NewIDom) {
+          IDom[i] = NewIDom;
+          Changed = true;
+        }
+      }
+    }
+
+    // Drop the nodes of the blocks that became unreachable, and relink the
+    // rest in depth-first order.
+    for (typename SmallPtrSet<TreeNode*, 32>::iterator I = Subtree.begin(),
+         E = Subtree.end(); I != E; ++I) {
+      TreeNode *Node = *I;
+      if (ErasedNodes.count(Node)) {
+        delete Node;
+      } else if (!Number.count(Node->getBlock())) {
+        DomTreeNodes.erase(Node->getBlock());
+        delete Node;
+      } else {
+        Node->Children.clear();
+      }
+    }
+    for (unsigned i = 1, e = PreOrder.size(); i != e; ++i) {
+      NodeT *BB = PreOrder[i];
+      TreeNode *IDomNode = getNode(PostOrder[IDom[Number[BB]]]);
+      TreeNode *&Node = DomTreeNodes[BB];
+      if (Node)
+        Node->IDom = IDomNode;
+      else
+        Node = new TreeNode(BB, IDomNode);
+      IDomNode->Children.push_back(Node);
+    }
+  }
+
+  if (VerifyDomTreeUpdates) {
+    DominatorTreeBase<NodeT> Fresh(false);
+    Fresh.recalculate(*Entry->getParent());
+    if (compare(Fresh)) {
+      errs() << "DominatorTree is not up to date after an update!\n"
+             << "Updated:\n";
+      print(errs());
+      errs() << "\nRecalculated:\n";
+      Fresh.print(errs());
+      abort();
+    }
+  }
+}
+
 }
 
 #endif
@@ -29,6 +29,11 @@
 
 namespace llvm {
 
+/// VerifyDomTreeUpdates - If set, DominatorTreeBase::applyUpdates checks the
+/// updated tree against one calculated from scratch and aborts if they differ.
+/// It is set with -verify-dom-updates.
+extern bool VerifyDomTreeUpdates;
+
 //===----------------------------------------------------------------------===//
 /// DominatorBase - Base class that other, more interesting dominator analyses
 /// inherit from.
@@ -175,6 +180,54 @@ inline void PrintDomTree(const DomTreeNodeBase<NodeT> *N, raw_ostream &o,
 
 typedef DomTreeNodeBase<BasicBlock> DomTreeNode;
 
+//===----------------------------------------------------------------------===//
+/// DomTreeUpdatesBase - A batch of changes to the edges of a CFG. A pass that
+/// changes the CFG records the edges it inserts and deletes, and then brings
+/// the dominator tree up to date with DominatorTreeBase::applyUpdates instead
+/// of recalculating it.
+///
+template <class NodeT>
+class DomTreeUpdatesBase {
+  typedef std::pair<NodeT*, NodeT*> EdgeT;
+  SmallVector<EdgeT, 8> Inserted;
+  SmallVector<EdgeT, 8> Deleted;
+  SmallVector<NodeT*, 4> DeletedBlocks;
+
+  template<class N> friend class DominatorTreeBase;
+public:
+  /// insertEdge - Record that an edge from From to To was added. To may be a
+  /// new block, or one that was unreachable before.
+  void insertEdge(NodeT *From, NodeT *To) {
+    Inserted.push_back(EdgeT(From, To));
+  }
+
+  /// deleteEdge - Record that the edge from From to To was removed. It is
+  /// fine to record an edge that still exists, such as one of several edges
+  /// between the same blocks.
+  void deleteEdge(NodeT *From, NodeT *To) {
+    Deleted.push_back(EdgeT(From, To));
+  }
+
+  /// deleteBlock - Record that BB was erased. The edges out of BB have to be
+  /// recorded with deleteEdge, the edges into it don't. BB is never
+  /// dereferenced, so this can be called after it is gone.
+  void deleteBlock(NodeT *BB) {
+    DeletedBlocks.push_back(BB);
+  }
+
+  bool empty() const {
+    return Inserted.empty() && Deleted.empty() && DeletedBlocks.empty();
+  }
+
+  void clear() {
+    Inserted.clear();
+    Deleted.clear();
+    DeletedBlocks.clear();
+  }
+};
+
+typedef DomTreeUpdatesBase<BasicBlock> DomTreeUpdates;
+
 //===----------------------------------------------------------------------===//
 /// DominatorTree - Calculate the immediate dominator tree for a function.
 ///
@@ -541,6 +594,27 @@ public:
       this->Split<NodeT*, GraphTraits<NodeT*> >(*this, NewBB);
   }
 
+  /// applyUpdates - Bring the tree up to date after the CFG changes recorded
+  /// in Updates, which the CFG must already reflect. Only the subtree of the
+  /// nearest common dominator of the changed edges is recalculated, and the
+  /// blocks that became unreachable are removed from the tree. This is only
+  /// implemented for forward dominators.
+  void applyUpdates(const DomTreeUpdatesBase<NodeT> &Updates);
+
+  /// insertEdge - Update the tree after an edge from From to To was added.
+  void insertEdge(NodeT *From, NodeT *To) {
+    DomTreeUpdatesBase<NodeT> Updates;
+    Updates.insertEdge(From, To);
+    applyUpdates(Updates);
+  }
+
+  /// deleteEdge - Update the tree after the edge from From to To was removed.
+  void deleteEdge(NodeT *From, NodeT *To) {
+    DomTreeUpdatesBase<NodeT> Updates;
+    Updates.deleteEdge(From, To);
+    applyUpdates(Updates);
+  }
+
   /// print - Convert to human readable form
   ///
   void print(raw_ostream &o) const {
@@ -779,6 +853,8 @@ public:
     AU.setPreservesAll();
   }
 
+  virtual Pass *createReplica() const { return new DominatorTree(); }
+
   inline bool dominates(const DomTreeNode* A, const DomTreeNode* B) const {
     return DT->dominates(A, B);
   }
@@ -857,6 +933,22 @@ public:
     DT->splitBlock(NewBB);
   }
 
+  /// applyUpdates - Bring the tree up to date after the CFG changes recorded
+  /// in Updates, which the CFG must already reflect.
+  inline void applyUpdates(const DomTreeUpdates &Updates) {
+    DT->applyUpdates(Updates);
+  }
+
+  /// insertEdge - Update the tree after an edge from From to To was added.
+  inline void insertEdge(BasicBlock *From, BasicBlock *To) {
+    DT->insertEdge(From, To);
+  }
+
+  /// deleteEdge - Update the tree after the edge from From to To was removed.
+  inline void deleteEdge(BasicBlock *From, BasicBlock *To) {
+    DT->deleteEdge(From, To);
+  }
+
   bool isReachableFromEntry(const BasicBlock* A) const {
     return DT->isReachableFromEntry(A);
   }
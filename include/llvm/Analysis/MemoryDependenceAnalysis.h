@@ -285,8 +285,12 @@ namespace llvm {
       /// TBAATag - The TBAA tag associated with dereferences of the
       /// pointer. May be null if there are no tags or conflicting tags.
       const MDNode *TBAATag;
+      /// LastUse - The number of the last non-local pointer query that used
+      /// this entry.  Eviction drops the least recently used entries first.
+      unsigned LastUse;
 
-      NonLocalPointerInfo() : Size(AliasAnalysis::UnknownSize), TBAATag(0) {}
+      NonLocalPointerInfo()
+        : Size(AliasAnalysis::UnknownSize), TBAATag(0), LastUse(0) {}
     };
 
     /// CachedNonLocalPointerInfo - This map stores the cached results of doing
@@ -321,6 +325,27 @@ namespace llvm {
     // A reverse mapping from dependencies to the non-local dependees.
     ReverseDepMapType ReverseNonLocalDeps;
     
+    /// NumNonLocalPtrQueries - The number of non-local pointer queries so
+    /// far, used to stamp NonLocalPointerInfo::LastUse.
+    unsigned NumNonLocalPtrQueries;
+
+    /// BlockScanLimit - The maximum number of instructions that a single scan
+    /// of a block looks at.
+    unsigned BlockScanLimit;
+
+    /// BlockMemInstIndex - The instructions that dependence scans have to look
+    /// at in a block, in order.  Built for blocks that are expensive to scan.
+    struct BlockMemInstIndex;
+    typedef DenseMap<BasicBlock*, BlockMemInstIndex*> BlockMemInstIndexMap;
+    BlockMemInstIndexMap BlockMemInstIndices;
+
+    /// MemInstOrdinals - The position of every indexed instruction in the
+    /// index of its block.
+    DenseMap<Instruction*, unsigned> MemInstOrdinals;
+
+    class MemInstScanner;
+    friend class MemInstScanner;
+
     /// Current AA implementation, just a cache.
     AliasAnalysis *AA;
     DataLayout *TD;
@@ -387,6 +412,19 @@ namespace llvm {
     /// This needs to be done when the CFG changes, e.g., due to splitting
     /// critical edges.
     void invalidateCachedPredecessors();
+
+    /// setBlockScanLimit - Set the maximum number of instructions that a
+    /// single scan of a block looks at before giving up with an unknown
+    /// dependence, and return the previous limit.  Clients
+    /// that want a different limit than -memdep-block-scan-limit set it for
+    /// the duration of their run.  Results cached under another limit are
+    /// still used.
+    unsigned setBlockScanLimit(unsigned Limit) {
+      unsigned Old = BlockScanLimit;
+      BlockScanLimit = Limit;
+      return Old;
+    }
+    unsigned getBlockScanLimit() const { return BlockScanLimit; }
     
     /// getPointerDependencyFrom - Return the instruction on which a memory
     /// location depends.  If isLoad is true, this routine ignores may-aliases
@@ -430,6 +468,9 @@ namespace llvm {
                                          unsigned NumSortedEntries);
 
     void RemoveCachedNonLocalPointerDependencies(ValueIsLoadPair P);
+    void evictNonLocalPointerDependencies();
+
+    void buildMemInstIndex(BasicBlock *BB);
     
     /// verifyRemoved - Verify that the specified instruction does not occur
     /// in our internal data structures.
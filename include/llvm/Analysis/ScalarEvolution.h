@@ -21,8 +21,10 @@
 #ifndef LLVM_ANALYSIS_SCALAREVOLUTION_H
 #define LLVM_ANALYSIS_SCALAREVOLUTION_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Operator.h"
@@ -48,19 +50,12 @@ namespace llvm {
   class Operator;
   class SCEVUnknown;
   class SCEV;
-  template<> struct FoldingSetTrait<SCEV>;
 
   /// SCEV - This class represents an analyzed expression in the program.  These
   /// are opaque objects that the client is not allowed to do much with
   /// directly.
   ///
   class SCEV : public FoldingSetNode {
-    friend struct FoldingSetTrait<SCEV>;
-
-    /// FastID - A reference to an Interned FoldingSetNodeID for this node.
-    /// The ScalarEvolution's BumpPtrAllocator holds the data.
-    FoldingSetNodeIDRef FastID;
-
     // The SCEV baseclass this node corresponds to
     const unsigned short SCEVType;
 
@@ -97,11 +92,16 @@ namespace llvm {
                        FlagNSW     = (1 << 2),   // No signed wrap.
                        NoWrapMask  = (1 << 3) -1 };
 
-    explicit SCEV(const FoldingSetNodeIDRef ID, unsigned SCEVTy) :
-      FastID(ID), SCEVType(SCEVTy), SubclassData(0) {}
+    explicit SCEV(unsigned SCEVTy) :
+      SCEVType(SCEVTy), SubclassData(0) {}
 
     unsigned getSCEVType() const { return SCEVType; }
 
+    /// Profile - Add the uniquing key of this expression to ID. The key is
+    /// recomputed from the operands on demand rather than interned with the
+    /// node, which keeps SCEV nodes small.
+    void Profile(FoldingSetNodeID &ID) const;
+
     /// getType - Return the LLVM type of this SCEV expression.
     ///
     Type *getType() const;
@@ -133,21 +133,6 @@ namespace llvm {
     void dump() const;
   };
 
-  // Specialize FoldingSetTrait for SCEV to avoid needing to compute
-  // temporary FoldingSetNodeID values.
-  template<> struct FoldingSetTrait<SCEV> : DefaultFoldingSetTrait<SCEV> {
-    static void Profile(const SCEV &X, FoldingSetNodeID& ID) {
-      ID = X.FastID;
-    }
-    static bool Equals(const SCEV &X, const FoldingSetNodeID &ID,
-                       unsigned IDHash, FoldingSetNodeID &TempID) {
-      return ID == X.FastID;
-    }
-    static unsigned ComputeHash(const SCEV &X, FoldingSetNodeID &TempID) {
-      return X.FastID.ComputeHash();
-    }
-  };
-
   inline raw_ostream &operator<<(raw_ostream &OS, const SCEV &S) {
     S.print(OS);
     return OS;
@@ -355,20 +340,28 @@ namespace llvm {
 
     /// ValuesAtScopes - This map contains entries for all the expressions
     /// that we attempt to compute getSCEVAtScope information for, which can
-    /// be expensive in extreme cases.
+    /// be expensive in extreme cases. Most expressions are only evaluated in
+    /// one or two scopes, so the scopes are kept in a short vector rather
+    /// than a node-based map.
     DenseMap<const SCEV *,
-             std::map<const Loop *, const SCEV *> > ValuesAtScopes;
+             SmallVector<std::pair<const Loop *, const SCEV *>, 2> >
+      ValuesAtScopes;
 
     /// LoopDispositions - Memoized computeLoopDisposition results.
     DenseMap<const SCEV *,
-             std::map<const Loop *, LoopDisposition> > LoopDispositions;
+             SmallVector<std::pair<const Loop *, LoopDisposition>, 2> >
+      LoopDispositions;
 
     /// computeLoopDisposition - Compute a LoopDisposition value.
     LoopDisposition computeLoopDisposition(const SCEV *S, const Loop *L);
 
-    /// BlockDispositions - Memoized computeBlockDisposition results.
+    /// BlockDispositions - Memoized computeBlockDisposition results.  An
+    /// expression can be queried against many blocks, so these are kept in a
+    /// small map, which turns into a hash table once it outgrows its inline
+    /// storage.
     DenseMap<const SCEV *,
-             std::map<const BasicBlock *, BlockDisposition> > BlockDispositions;
+             SmallDenseMap<const BasicBlock *, BlockDisposition, 4> >
+      BlockDispositions;
 
     /// computeBlockDisposition - Compute a BlockDisposition value.
     BlockDisposition computeBlockDisposition(const SCEV *S, const BasicBlock *BB);
@@ -785,6 +778,13 @@ namespace llvm {
     /// disconnect it from a def-use chain linking it to a loop.
     void forgetValue(Value *V);
 
+    /// releaseLoopMemory - This method may be called by the client when it
+    /// is done with a loop nest, to drop the trip counts, expressions and
+    /// other cached results for the loop and its subloops. Unlike forgetLoop
+    /// this does not mean that anything changed; dropped results are simply
+    /// recomputed if they are needed again.
+    void releaseLoopMemory(const Loop *L);
+
     /// GetMinTrailingZeros - Determine the minimum number of zero bits that S
     /// is guaranteed to end in (at every loop iteration).  It is, at the same
     /// time, the minimum number of times S is divisible by 2.  For example,
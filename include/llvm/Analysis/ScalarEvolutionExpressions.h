@@ -38,8 +38,8 @@ namespace llvm {
     friend class ScalarEvolution;
 
     ConstantInt *V;
-    SCEVConstant(const FoldingSetNodeIDRef ID, ConstantInt *v) :
-      SCEV(ID, scConstant), V(v) {}
+    explicit SCEVConstant(ConstantInt *v) :
+      SCEV(scConstant), V(v) {}
   public:
     ConstantInt *getValue() const { return V; }
 
@@ -59,8 +59,7 @@ namespace llvm {
     const SCEV *Op;
     Type *Ty;
 
-    SCEVCastExpr(const FoldingSetNodeIDRef ID,
-                 unsigned SCEVTy, const SCEV *op, Type *ty);
+    SCEVCastExpr(unsigned SCEVTy, const SCEV *op, Type *ty);
 
   public:
     const SCEV *getOperand() const { return Op; }
@@ -81,8 +80,7 @@ namespace llvm {
   class SCEVTruncateExpr : public SCEVCastExpr {
     friend class ScalarEvolution;
 
-    SCEVTruncateExpr(const FoldingSetNodeIDRef ID,
-                     const SCEV *op, Type *ty);
+    SCEVTruncateExpr(const SCEV *op, Type *ty);
 
   public:
     /// Methods for support type inquiry through isa, cast, and dyn_cast:
@@ -98,8 +96,7 @@ namespace llvm {
   class SCEVZeroExtendExpr : public SCEVCastExpr {
     friend class ScalarEvolution;
 
-    SCEVZeroExtendExpr(const FoldingSetNodeIDRef ID,
-                       const SCEV *op, Type *ty);
+    SCEVZeroExtendExpr(const SCEV *op, Type *ty);
 
   public:
     /// Methods for support type inquiry through isa, cast, and dyn_cast:
@@ -115,8 +112,7 @@ namespace llvm {
   class SCEVSignExtendExpr : public SCEVCastExpr {
     friend class ScalarEvolution;
 
-    SCEVSignExtendExpr(const FoldingSetNodeIDRef ID,
-                       const SCEV *op, Type *ty);
+    SCEVSignExtendExpr(const SCEV *op, Type *ty);
 
   public:
     /// Methods for support type inquiry through isa, cast, and dyn_cast:
@@ -136,12 +132,13 @@ namespace llvm {
     // arrays with its SCEVAllocator, so this class just needs a simple
     // pointer rather than a more elaborate vector-like data structure.
     // This also avoids the need for a non-trivial destructor.
+    // NumOperands comes first so that it fits in the tail padding of the
+    // SCEV base.
+    unsigned NumOperands;
     const SCEV *const *Operands;
-    size_t NumOperands;
 
-    SCEVNAryExpr(const FoldingSetNodeIDRef ID,
-                 enum SCEVTypes T, const SCEV *const *O, size_t N)
-      : SCEV(ID, T), Operands(O), NumOperands(N) {}
+    SCEVNAryExpr(enum SCEVTypes T, const SCEV *const *O, size_t N)
+      : SCEV(T), NumOperands(N), Operands(O) {}
 
   public:
     size_t getNumOperands() const { return NumOperands; }
@@ -176,9 +173,8 @@ namespace llvm {
   ///
   class SCEVCommutativeExpr : public SCEVNAryExpr {
   protected:
-    SCEVCommutativeExpr(const FoldingSetNodeIDRef ID,
-                        enum SCEVTypes T, const SCEV *const *O, size_t N)
-      : SCEVNAryExpr(ID, T, O, N) {}
+    SCEVCommutativeExpr(enum SCEVTypes T, const SCEV *const *O, size_t N)
+      : SCEVNAryExpr(T, O, N) {}
 
   public:
     /// Methods for support type inquiry through isa, cast, and dyn_cast:
@@ -202,9 +198,8 @@ namespace llvm {
   class SCEVAddExpr : public SCEVCommutativeExpr {
     friend class ScalarEvolution;
 
-    SCEVAddExpr(const FoldingSetNodeIDRef ID,
-                const SCEV *const *O, size_t N)
-      : SCEVCommutativeExpr(ID, scAddExpr, O, N) {
+    SCEVAddExpr(const SCEV *const *O, size_t N)
+      : SCEVCommutativeExpr(scAddExpr, O, N) {
     }
 
   public:
@@ -227,9 +222,8 @@ namespace llvm {
   class SCEVMulExpr : public SCEVCommutativeExpr {
     friend class ScalarEvolution;
 
-    SCEVMulExpr(const FoldingSetNodeIDRef ID,
-                const SCEV *const *O, size_t N)
-      : SCEVCommutativeExpr(ID, scMulExpr, O, N) {
+    SCEVMulExpr(const SCEV *const *O, size_t N)
+      : SCEVCommutativeExpr(scMulExpr, O, N) {
     }
 
   public:
@@ -248,8 +242,8 @@ namespace llvm {
 
     const SCEV *LHS;
     const SCEV *RHS;
-    SCEVUDivExpr(const FoldingSetNodeIDRef ID, const SCEV *lhs, const SCEV *rhs)
-      : SCEV(ID, scUDivExpr), LHS(lhs), RHS(rhs) {}
+    SCEVUDivExpr(const SCEV *lhs, const SCEV *rhs)
+      : SCEV(scUDivExpr), LHS(lhs), RHS(rhs) {}
 
   public:
     const SCEV *getLHS() const { return LHS; }
@@ -285,9 +279,8 @@ namespace llvm {
 
     const Loop *L;
 
-    SCEVAddRecExpr(const FoldingSetNodeIDRef ID,
-                   const SCEV *const *O, size_t N, const Loop *l)
-      : SCEVNAryExpr(ID, scAddRecExpr, O, N), L(l) {}
+    SCEVAddRecExpr(const SCEV *const *O, size_t N, const Loop *l)
+      : SCEVNAryExpr(scAddRecExpr, O, N), L(l) {}
 
   public:
     const SCEV *getStart() const { return Operands[0]; }
@@ -360,9 +353,8 @@ namespace llvm {
   class SCEVSMaxExpr : public SCEVCommutativeExpr {
     friend class ScalarEvolution;
 
-    SCEVSMaxExpr(const FoldingSetNodeIDRef ID,
-                 const SCEV *const *O, size_t N)
-      : SCEVCommutativeExpr(ID, scSMaxExpr, O, N) {
+    SCEVSMaxExpr(const SCEV *const *O, size_t N)
+      : SCEVCommutativeExpr(scSMaxExpr, O, N) {
       // Max never overflows.
       setNoWrapFlags((NoWrapFlags)(FlagNUW | FlagNSW));
     }
@@ -381,9 +373,8 @@ namespace llvm {
   class SCEVUMaxExpr : public SCEVCommutativeExpr {
     friend class ScalarEvolution;
 
-    SCEVUMaxExpr(const FoldingSetNodeIDRef ID,
-                 const SCEV *const *O, size_t N)
-      : SCEVCommutativeExpr(ID, scUMaxExpr, O, N) {
+    SCEVUMaxExpr(const SCEV *const *O, size_t N)
+      : SCEVCommutativeExpr(scUMaxExpr, O, N) {
       // Max never overflows.
       setNoWrapFlags((NoWrapFlags)(FlagNUW | FlagNSW));
     }
@@ -416,9 +407,8 @@ namespace llvm {
     /// SCEVUnknown instances owned by a ScalarEvolution.
     SCEVUnknown *Next;
 
-    SCEVUnknown(const FoldingSetNodeIDRef ID, Value *V,
-                ScalarEvolution *se, SCEVUnknown *next) :
-      SCEV(ID, scUnknown), CallbackVH(V), SE(se), Next(next) {}
+    SCEVUnknown(Value *V, ScalarEvolution *se, SCEVUnknown *next) :
+      SCEV(scUnknown), CallbackVH(V), SE(se), Next(next) {}
 
   public:
     Value *getValue() const { return getValPtr(); }
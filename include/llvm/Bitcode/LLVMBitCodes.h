@@ -72,7 +72,15 @@ namespace bitc {
     /// MODULE_CODE_PURGEVALS: [numvals]
     MODULE_CODE_PURGEVALS   = 10,
 
-    MODULE_CODE_GCNAME      = 11   // GCNAME: [strchr x N]
+    MODULE_CODE_GCNAME      = 11,  // GCNAME: [strchr x N]
+
+    // FNINDEX: [blob of 64-bit little-endian bit offsets: end of the function
+    //           bodies, body of each function]
+    // The offsets are relative to the start of the bitcode and point at the
+    // ENTER_SUBBLOCK of the block, or at the END_BLOCK of the module for the
+    // end of the function bodies.  The bodies are listed in the order of the
+    // FUNCTION records and must be the last thing in the module block.
+    MODULE_CODE_FNINDEX     = 12
   };
 
   /// PARAMATTR blocks have code for defining a parameter attribute set.
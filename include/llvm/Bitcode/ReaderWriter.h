@@ -58,6 +58,15 @@ namespace llvm {
   Module *ParseBitcodeFile(MemoryBuffer *Buffer, LLVMContext &Context,
                            std::string *ErrMsg = 0);
 
+  /// ParseMappedBitcodeFile - Read the specified bitcode file like
+  /// ParseBitcodeFile, but transfer ownership of Buffer to the context, even
+  /// if an error occurs.  Metadata strings and string constants of the module
+  /// refer to the buffer instead of copying it, which saves time and memory
+  /// when the same memory mapped file (see MemoryBuffer::getFile) is loaded
+  /// into many contexts.
+  Module *ParseMappedBitcodeFile(MemoryBuffer *Buffer, LLVMContext &Context,
+                                 std::string *ErrMsg = 0);
+
   /// WriteBitcodeToFile - Write the specified module to the specified
   /// raw output stream.  For streams where it matters, the given stream
   /// should be in "binary" mode.
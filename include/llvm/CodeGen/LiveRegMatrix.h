@@ -26,6 +26,7 @@
 
 #include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/CodeGen/LiveIntervalUnion.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
 
@@ -58,6 +59,17 @@ class LiveRegMatrix : public MachineFunctionPass {
   unsigned RegMaskVirtReg;
   BitVector RegMaskUsable;
 
+  // AssignTag changes whenever a virtual register is assigned or unassigned.
+  unsigned AssignTag;
+
+  // Per-block interference summary. BlockTags[RegUnit][MBBNum] is the value of
+  // AssignTag at the last change to RegUnit's virtual register interference in
+  // block MBBNum. The vector for a RegUnit is empty until the first change.
+  SmallVector<SmallVector<unsigned, 0>, 0> BlockTags;
+
+  // Record a change to PhysReg's interference in the blocks covered by VirtReg.
+  void tagBlocks(LiveInterval &VirtReg, unsigned PhysReg);
+
   // MachineFunctionPass boilerplate.
   virtual void getAnalysisUsage(AnalysisUsage&) const;
   virtual bool runOnMachineFunction(MachineFunction&);
@@ -141,6 +153,19 @@ public:
   /// Directly access the live interval unions per regunit.
   /// This returns an array indexed by the regunit number.
   LiveIntervalUnion *getLiveUnions() { return &Matrix[0]; }
+
+  /// Return a tag that changes whenever a virtual register is assigned or
+  /// unassigned.
+  unsigned getAssignTag() const { return AssignTag; }
+
+  /// Return the value of getAssignTag() at the last assignment that changed
+  /// the virtual register interference of RegUnit in basic block MBBNum, or 0
+  /// if it never changed. Interference information computed for a block stays
+  /// valid as long as this doesn't exceed the assign tag at the time.
+  unsigned getBlockTag(unsigned RegUnit, unsigned MBBNum) const {
+    const SmallVector<unsigned, 0> &Tags = BlockTags[RegUnit];
+    return Tags.empty() ? 0 : Tags[MBBNum];
+  }
 };
 
 } // end namespace llvm
@@ -162,6 +162,11 @@ class SelectionDAG {
   /// OperandAllocator - Pool allocation for machine-opcode SDNode operands.
   BumpPtrAllocator OperandAllocator;
 
+  /// ArenaOperands - If true, the operand lists of generic nodes with more
+  /// than three operands are also allocated from OperandAllocator instead of
+  /// the heap, so they are released all at once when the DAG is cleared.
+  bool ArenaOperands;
+
   /// Allocator - Pool allocation for misc. objects that are created once per
   /// SelectionDAG.
   BumpPtrAllocator Allocator;
@@ -235,6 +240,11 @@ public:
   ///
   void clear();
 
+  /// setArenaOperands - Allocate the operand lists of all new nodes from the
+  /// DAG's operand pool, which is reused from one block to the next.
+  void setArenaOperands(bool V) { ArenaOperands = V; }
+  bool hasArenaOperands() const { return ArenaOperands; }
+
   MachineFunction &getMachineFunction() const { return *MF; }
   const TargetMachine &getTarget() const { return TM; }
   const TargetLowering &getTargetLoweringInfo() const { return TLI; }
@@ -1063,6 +1073,8 @@ private:
 
   void DeleteNodeNotInCSEMaps(SDNode *N);
   void DeallocateNode(SDNode *N);
+  SDNode *newSDNode(unsigned Opcode, DebugLoc DL, SDVTList VTs,
+                    const SDValue *Ops, unsigned NumOps);
 
   unsigned getEVTAlignment(EVT MemoryVT) const;
 
@@ -19,6 +19,8 @@
 #include "llvm/CodeGen/SelectionDAG.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/Pass.h"
+#include <map>
+#include <string>
 
 namespace llvm {
   class FastISel;
@@ -66,6 +68,8 @@ public:
 
   virtual bool runOnMachineFunction(MachineFunction &MF);
 
+  virtual bool doFinalization(Module &M);
+
   virtual void EmitFunctionEntryCode() {}
 
   /// PreprocessISelDAG - This hook allows targets to hack on the graph before
@@ -252,6 +256,7 @@ private:
   void SelectAllBasicBlocks(const Function &Fn);
   bool TryToFoldFastISelLoad(const LoadInst *LI, const Instruction *FoldInst,
                              FastISel *FastIS);
+  void recordFastISelMiss(const Instruction *I);
   void FinishBasicBlock();
 
   void SelectBasicBlock(BasicBlock::const_iterator Begin,
@@ -268,6 +273,15 @@ private:
   ///
   ScheduleDAGSDNodes *CreateScheduler();
 
+  /// FunctionScheduler - The scheduler kept for all blocks of the current
+  /// function if -isel-reuse-dag-storage is given, or null.
+  ScheduleDAGSDNodes *FunctionScheduler;
+
+  /// FastISelFallbacks - The number of instructions FastISel left to
+  /// SelectionDAG, keyed by their opcode, type and callee separated by nuls,
+  /// for -fast-isel-report-fallbacks.
+  std::map<std::string, unsigned> FastISelFallbacks;
+
   /// OpcodeOffset - This is a cache used to dispatch efficiently into isel
   /// state machines that start with a OPC_SwitchOpcode node.
   std::vector<unsigned> OpcodeOffset;
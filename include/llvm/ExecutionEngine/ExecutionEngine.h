@@ -42,6 +42,7 @@ class JITMemoryManager;
 class MachineCodeInfo;
 class Module;
 class MutexGuard;
+class ObjectCache;
 class DataLayout;
 class Triple;
 class Type;
@@ -371,6 +372,12 @@ public:
   virtual void RegisterJITEventListener(JITEventListener *) {}
   virtual void UnregisterJITEventListener(JITEventListener *) {}
 
+  /// setObjectCache - Sets the cache MCJIT uses to look up the object code of
+  /// a module before compiling it, and to store the objects it compiles.  Does
+  /// not take ownership of the argument, which may be NULL to disable caching.
+  /// Other execution engines ignore the cache.
+  virtual void setObjectCache(ObjectCache *) {}
+
   /// DisableLazyCompilation - When lazy compilation is off (the default), the
   /// JIT will eagerly compile every function reachable from the argument to
   /// getPointerToFunction.  If lazy compilation is turned on, the JIT will only
@@ -396,6 +403,26 @@ public:
     return !CompilingLazily;
   }
 
+  /// EnableTieredCompilation - When tiered compilation is on, the JIT compiles
+  /// every function with the -O0 code generator first, so that the caller can
+  /// run it right away, and queues it to be recompiled with the full code
+  /// generator on a background thread.  Once the optimized code is ready, the
+  /// entry of the quickly compiled code is patched to jump to it.  At most
+  /// \p MaxQueued functions wait for recompilation; functions compiled while
+  /// the queue is full keep their quickly compiled code.  Turning tiered
+  /// compilation off drops the queued recompilations and waits for the one in
+  /// progress.  Recompilation doesn't hold the lock while generating code, so
+  /// the IR must not be changed nor machine code freed other than by the JIT
+  /// until waitForTieredCompilation returns.  This has no effect on execution
+  /// engines other than the JIT, nor if LLVM is built without threads or the
+  /// target can't patch running code.
+  virtual void EnableTieredCompilation(bool Enabled = true,
+                                       unsigned MaxQueued = 64) {}
+
+  /// waitForTieredCompilation - Wait until every queued recompilation is
+  /// done.  Must not race with EnableTieredCompilation.
+  virtual void waitForTieredCompilation() {}
+
   /// DisableGVCompilation - If called, the JIT will abort if it's asked to
   /// allocate space and populate a GlobalVariable that is not internal to
   /// the module.
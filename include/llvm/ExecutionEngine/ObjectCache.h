@@ -0,0 +1,82 @@
+//===-- ObjectCache.h - Cache for JIT-compiled objects ----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the ObjectCache interface, which lets MCJIT reuse object
+// code compiled earlier, and FileObjectCache, which keeps the objects in a
+// directory so that they survive the process.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_OBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_OBJECTCACHE_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/Mutex.h"
+#include <string>
+
+namespace llvm {
+
+class LockFileManager;
+class MemoryBuffer;
+
+/// ObjectCache - Stores the object code that MCJIT generates for a module
+/// under a key that identifies everything the code depends on: the module
+/// itself, the target and the code generation options.  Keys consist of
+/// lowercase hex digits only, so they can be used as file names.
+class ObjectCache {
+  virtual void anchor();
+public:
+  ObjectCache() {}
+  virtual ~ObjectCache() {}
+
+  /// getObject - Return a new buffer holding the object cached under \p Key,
+  /// which the caller takes ownership of, or null if there is none.
+  virtual MemoryBuffer *getObject(StringRef Key) = 0;
+
+  /// notifyObjectCompiled - Called after an object has been generated because
+  /// getObject returned null for \p Key.  The cache must copy \p Obj if it
+  /// wants to keep it.
+  virtual void notifyObjectCompiled(StringRef Key, const MemoryBuffer *Obj) = 0;
+};
+
+/// FileObjectCache - An ObjectCache that keeps every object in a file named
+/// after its key in a directory, which may be shared by several processes.
+///
+/// While one process compiles an object, it holds a lock file for it (see
+/// LockFileManager), and the other processes looking for the same object wait
+/// for it instead of compiling the object again.  Objects are written to a
+/// temporary file and renamed into place, so readers never see a partial
+/// object.
+class FileObjectCache : public ObjectCache {
+  std::string Directory;
+
+  /// PendingLocks - The locks held for objects that are being compiled.
+  StringMap<LockFileManager*> PendingLocks;
+  sys::Mutex Lock;
+
+  FileObjectCache(const FileObjectCache &) LLVM_DELETED_FUNCTION;
+  void operator=(const FileObjectCache &) LLVM_DELETED_FUNCTION;
+
+  std::string getObjectPath(StringRef Key) const;
+
+public:
+  /// Create a cache storing its objects in \p Directory, which is created on
+  /// demand.
+  explicit FileObjectCache(StringRef Directory);
+  virtual ~FileObjectCache();
+
+  virtual MemoryBuffer *getObject(StringRef Key);
+  virtual void notifyObjectCompiled(StringRef Key, const MemoryBuffer *Obj);
+};
+
+} // End llvm namespace
+
+#endif
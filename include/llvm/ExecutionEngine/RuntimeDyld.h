@@ -66,6 +66,13 @@ public:
   ///
   /// Returns true if an error occurred, false otherwise.
   virtual bool applyPermissions(std::string *ErrMsg = 0) = 0;
+
+  /// This method is called when an object is unloaded, once for each of its
+  /// sections that were allocated through allocateCodeSection or
+  /// allocateDataSection.  The memory manager may reuse the memory afterwards.
+  /// The default implementation keeps the memory around.
+  virtual void deallocateSection(uint8_t *Addr, uintptr_t Size,
+                                 unsigned SectionID) {}
 };
 
 class RuntimeDyld {
@@ -99,9 +106,22 @@ public:
   /// used for relocation.
   uint64_t getSymbolLoadAddress(StringRef Name);
 
+  /// Unload an object previously returned by loadObject.  Its symbols are
+  /// removed from the symbol table and its sections are handed back to the
+  /// memory manager.  Objects referring to the symbols of \p Obj must have
+  /// been unloaded before.  \p Obj itself is not deleted.
+  void unloadObject(ObjectImage *Obj);
+
   /// Resolve the relocations for all symbols we currently know about.
   void resolveRelocations();
 
+  /// Forget about the relocations resolved so far.  After this call the
+  /// sections of the objects loaded so far must not be remapped anymore, and
+  /// resolveRelocations only touches the objects loaded afterwards.  This is
+  /// used when the loaded code is finalized, so that adding more objects
+  /// later doesn't write to pages that have been made read-only.
+  void discardResolvedRelocations();
+
   /// Map a section to its target address space value.
   /// Map the address of a JIT section as returned from the memory manager
   /// to the address in the target process as the running code will see it.
@@ -22,6 +22,8 @@
 
 namespace llvm {
 
+class raw_ostream;
+
 /// This is a simple memory manager which implements the methods called by
 /// the RuntimeDyld class to allocate memory for section-based loading of
 /// objects, usually those generated by the MCJIT execution engine.
@@ -30,6 +32,13 @@ namespace llvm {
 /// RuntimeDyld will copy JITed section memory into these allocated blocks
 /// and perform any necessary linking and relocations.
 ///
+/// Code, read-only data and read-write data sections are each carved out of
+/// their own slabs of mapped memory, so that small sections of many objects
+/// share pages.  When permissions are applied, the pages filled since the last
+/// time are protected with one call per run of adjacent slabs, and later
+/// sections start on the next page of the slab.  A slab is returned to the
+/// system once all of its sections have been deallocated.
+///
 /// Any client using this memory manager MUST ensure that section-specific
 /// page permissions have been applied before attempting to execute functions
 /// in the JITed object.  Permissions can be applied either by calling
@@ -40,9 +49,34 @@ class SectionMemoryManager : public JITMemoryManager {
   void operator=(const SectionMemoryManager&) LLVM_DELETED_FUNCTION;
 
 public:
-  SectionMemoryManager() { }
+  /// The default size of the slabs sections are allocated from.
+  static const uintptr_t DefaultSlabSize = 256 * 1024;
+
+  /// Create a memory manager that maps memory in slabs of \p SlabSize bytes.
+  /// Sections that don't fit into a slab get a slab of their own.
+  explicit SectionMemoryManager(uintptr_t SlabSize = DefaultSlabSize);
   virtual ~SectionMemoryManager();
 
+  /// MemoryStats - Memory usage of one kind of section.
+  struct MemoryStats {
+    /// NumSlabs - The number of slabs currently mapped.
+    unsigned NumSlabs;
+    /// SlabBytes - The size of these slabs.
+    uint64_t SlabBytes;
+    /// UsedBytes - The bytes handed out so far, including the space lost to
+    /// alignment, to page rounding and to deallocated sections.
+    uint64_t UsedBytes;
+    /// SectionBytes - The bytes in live sections.
+    uint64_t SectionBytes;
+  };
+
+  MemoryStats getCodeStats() const { return getStats(CodeMem); }
+  MemoryStats getRODataStats() const { return getStats(RODataMem); }
+  MemoryStats getRWDataStats() const { return getStats(RWDataMem); }
+
+  /// \brief Print the memory usage and fragmentation of each kind of section.
+  void printStats(raw_ostream &OS) const;
+
   /// \brief Allocates a memory block of (at least) the given size suitable for
   /// executable code.
   ///
@@ -72,6 +106,15 @@ public:
   /// \returns true if an error occurred, false otherwise.
   virtual bool applyPermissions(std::string *ErrMsg = 0);
 
+  /// \brief Releases the memory of a section that is no longer used.
+  ///
+  /// A slab is returned to the system once all the sections in it have been
+  /// deallocated.  Until then, the space of read-write data sections is reused
+  /// for later allocations, and so is the space of the most recent section of
+  /// a slab if its pages haven't been protected yet.
+  virtual void deallocateSection(uint8_t *Addr, uintptr_t Size,
+                                 unsigned SectionID);
+
   /// This method returns the address of the specified function. As such it is
   /// only useful for resolving library symbols, not code generated symbols.
   ///
@@ -93,8 +136,33 @@ public:
   virtual void invalidateInstructionCache();
 
 private:
+  /// Slab - A block of mapped memory sections are allocated from.
+  struct Slab {
+    sys::MemoryBlock Block;
+    /// Used - The number of bytes handed out from the start of the block.
+    uintptr_t Used;
+    /// Protected - The number of bytes at the start of the block that have
+    /// their final permissions.  This is always a multiple of the page size.
+    uintptr_t Protected;
+    /// NumSections, SectionBytes - The number and size of the live sections.
+    unsigned NumSections;
+    uintptr_t SectionBytes;
+
+    explicit Slab(sys::MemoryBlock Block)
+      : Block(Block), Used(0), Protected(0), NumSections(0), SectionBytes(0) {}
+
+    uint8_t *base() const { return (uint8_t*)Block.base(); }
+    bool contains(const void *Addr) const {
+      return (const uint8_t*)Addr >= base() &&
+             (const uint8_t*)Addr < base() + Block.size();
+    }
+  };
+
   struct MemoryGroup {
-      SmallVector<sys::MemoryBlock, 16> AllocatedMem;
+      /// Slabs - The mapped slabs.  New sections are carved from the last one.
+      SmallVector<Slab, 4> Slabs;
+      /// FreeMem - Deallocated sections that may be reused.  This is only
+      /// used for read-write data, the other pages may be protected already.
       SmallVector<sys::MemoryBlock, 16> FreeMem;
       sys::MemoryBlock Near;
   };
@@ -102,9 +170,15 @@ private:
   uint8_t *allocateSection(MemoryGroup &MemGroup, uintptr_t Size,
                            unsigned Alignment);
 
+  bool deallocateFromGroup(MemoryGroup &MemGroup, uint8_t *Addr,
+                           uintptr_t Size);
+
   error_code applyMemoryGroupPermissions(MemoryGroup &MemGroup,
                                          unsigned Permissions);
 
+  static MemoryStats getStats(const MemoryGroup &MemGroup);
+
+  uintptr_t SlabSize;
   MemoryGroup CodeMem;
   MemoryGroup RWDataMem;
   MemoryGroup RODataMem;
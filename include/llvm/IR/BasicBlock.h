@@ -49,6 +49,12 @@ template<> struct ilist_traits<Instruction>
   Instruction *provideInitialHead() const { return createSentinel(); }
   Instruction *ensureHead(Instruction*) const { return createSentinel(); }
   static void noteHead(Instruction*, Instruction*) {}
+
+  // These bump the insertion epoch of the owning block.
+  void addNodeToList(Instruction *I);
+  void transferNodesFromList(ilist_traits<Instruction> &L2,
+                             ilist_iterator<Instruction> first,
+                             ilist_iterator<Instruction> last);
 private:
   mutable ilist_half_node<Instruction> Sentinel;
 };
@@ -75,9 +81,11 @@ public:
 private:
   InstListType InstList;
   Function *Parent;
+  unsigned InsertionEpoch;
 
   void setParent(Function *parent);
   friend class SymbolTableListTraits<BasicBlock, Function>;
+  friend struct ilist_traits<Instruction>;
 
   BasicBlock(const BasicBlock &) LLVM_DELETED_FUNCTION;
   void operator=(const BasicBlock &) LLVM_DELETED_FUNCTION;
@@ -112,6 +120,12 @@ public:
   const Function *getParent() const { return Parent; }
         Function *getParent()       { return Parent; }
 
+  /// getInsertionEpoch - Return a counter that changes whenever an
+  /// instruction is inserted into this block or moved within it.  Removing
+  /// instructions leaves it alone, so analyses that remember the order of
+  /// the instructions can stay valid across the deletions they are told about.
+  unsigned getInsertionEpoch() const { return InsertionEpoch; }
+
   /// getTerminator() - If this is a well formed basic block, then this returns
   /// a pointer to the terminator instruction.  If it is not, then you get a
   /// null pointer back.
@@ -0,0 +1,108 @@
+//===-- llvm/IR/IRArena.h - Arena allocation of instructions ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares IRArena and IRArenaScope, which let clients allocate the
+// instructions of short-lived functions from a recycling slab allocator
+// instead of the heap.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_IRARENA_H
+#define LLVM_IR_IRARENA_H
+
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/DataTypes.h"
+#include <cstddef>
+
+namespace llvm {
+
+class IRArenaImpl;
+
+/// IRArena - Memory for instructions and their operand lists.
+///
+/// While an IRArenaScope for an arena is active on a thread, the instructions
+/// created on that thread, including their operand lists, are carved out of
+/// the arena's slabs instead of being allocated with operator new. Deleting
+/// such an instruction, on any thread, returns its memory to a free list of
+/// the arena for reuse. Destroying the arena releases all of its slabs at
+/// once.
+///
+/// Constants, globals, metadata and other context-owned objects are never
+/// allocated from an arena, so only the instructions need to go away before
+/// the arena does. The typical use is one arena per function: build the
+/// function inside a scope, and destroy the arena right after the function.
+///
+/// An arena is not synchronized. Like the LLVMContext it belongs to, it must
+/// only be used by one thread at a time.
+class IRArena {
+  IRArenaImpl *Impl;
+
+  IRArena(const IRArena &) LLVM_DELETED_FUNCTION;
+  void operator=(const IRArena &) LLVM_DELETED_FUNCTION;
+
+  friend class IRArenaScope;
+  // This is zero whenever no thread uses arenas, which keeps the common case
+  // down to a load and a branch.
+  static volatile sys::cas_flag NumActiveScopes;
+
+  static IRArena *getCurrentImpl();
+public:
+  IRArena();
+
+  /// Release the memory of the arena. No object allocated from it may be used
+  /// afterwards.
+  ~IRArena();
+
+  /// getCurrent - Return the arena of the innermost IRArenaScope on this
+  /// thread, or null if there is none.
+  static IRArena *getCurrent() {
+    return NumActiveScopes ? getCurrentImpl() : 0;
+  }
+
+  /// getOwner - Return the arena that Ptr, which Allocate() returned, came
+  /// from. This only looks at a header in front of the memory and takes no
+  /// locks.
+  static IRArena *getOwner(const void *Ptr);
+
+  /// Allocate - Allocate Size bytes from this arena.
+  void *Allocate(size_t Size);
+
+  /// Deallocate - Return memory allocated from this arena to it.
+  void Deallocate(void *Ptr);
+
+  /// getNumAllocations - Return the number of allocations made from the arena.
+  uint64_t getNumAllocations() const;
+
+  /// getNumReused - Return the number of allocations that were satisfied with
+  /// memory freed earlier.
+  uint64_t getNumReused() const;
+
+  /// getNumLiveObjects - Return the number of allocations not freed yet.
+  uint64_t getNumLiveObjects() const;
+
+  /// getBytesReserved - Return the size of the slabs owned by the arena.
+  uint64_t getBytesReserved() const;
+};
+
+/// IRArenaScope - Allocate the instructions created on this thread from an
+/// arena for the lifetime of the scope. Scopes may be nested.
+class IRArenaScope {
+  IRArena *Prev;
+
+  IRArenaScope(const IRArenaScope &) LLVM_DELETED_FUNCTION;
+  void operator=(const IRArenaScope &) LLVM_DELETED_FUNCTION;
+public:
+  explicit IRArenaScope(IRArena &Arena);
+  ~IRArenaScope();
+};
+
+} // End llvm namespace
+
+#endif
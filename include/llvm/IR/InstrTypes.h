@@ -102,7 +102,7 @@ protected:
 public:
   // allocate space for exactly one operand
   void *operator new(size_t s) {
-    return User::operator new(s, 1);
+    return Instruction::operator new(s, 1);
   }
 
   // Out of line virtual method, so the vtable, etc has a home.
@@ -147,7 +147,7 @@ protected:
 public:
   // allocate space for exactly two operands
   void *operator new(size_t s) {
-    return User::operator new(s, 2);
+    return Instruction::operator new(s, 2);
   }
 
   /// Transparently provide more efficient getOperand methods.
@@ -680,7 +680,7 @@ public:
 
   // allocate space for exactly two operands
   void *operator new(size_t s) {
-    return User::operator new(s, 2);
+    return Instruction::operator new(s, 2);
   }
   /// Construct a compare instruction, given the opcode, the predicate and
   /// the two operands.  Optionally (if InstBefore is specified) insert the
@@ -31,6 +31,7 @@ template<typename ValueSubClass, typename ItemParentClass>
 class Instruction : public User, public ilist_node<Instruction> {
   void operator=(const Instruction &) LLVM_DELETED_FUNCTION;
   Instruction(const Instruction &) LLVM_DELETED_FUNCTION;
+  void *operator new(size_t) LLVM_DELETED_FUNCTION;
 
   BasicBlock *Parent;
   DebugLoc DbgLoc;                         // 'dbg' Metadata cache.
@@ -442,6 +443,9 @@ protected:
               BasicBlock *InsertAtEnd);
   virtual Instruction *clone_impl() const = 0;
 
+  /// operator new - Allocate an instruction followed by its Us operands, from
+  /// the current IRArena if there is one.
+  void *operator new(size_t s, unsigned Us);
 };
 
 // Instruction* is only 4-byte aligned.
@@ -262,7 +262,7 @@ protected:
 public:
   // allocate space for exactly two operands
   void *operator new(size_t s) {
-    return User::operator new(s, 2);
+    return Instruction::operator new(s, 2);
   }
   StoreInst(Value *Val, Value *Ptr, Instruction *InsertBefore);
   StoreInst(Value *Val, Value *Ptr, BasicBlock *InsertAtEnd);
@@ -389,7 +389,7 @@ protected:
 public:
   // allocate space for exactly zero operands
   void *operator new(size_t s) {
-    return User::operator new(s, 0);
+    return Instruction::operator new(s, 0);
   }
 
   // Ordering may only be Acquire, Release, AcquireRelease, or
@@ -457,7 +457,7 @@ protected:
 public:
   // allocate space for exactly three operands
   void *operator new(size_t s) {
-    return User::operator new(s, 3);
+    return Instruction::operator new(s, 3);
   }
   AtomicCmpXchgInst(Value *Ptr, Value *Cmp, Value *NewVal,
                     AtomicOrdering Ordering, SynchronizationScope SynchScope,
@@ -595,7 +595,7 @@ public:
 
   // allocate space for exactly two operands
   void *operator new(size_t s) {
-    return User::operator new(s, 2);
+    return Instruction::operator new(s, 2);
   }
   AtomicRMWInst(BinOp Operation, Value *Ptr, Value *Val,
                 AtomicOrdering Ordering, SynchronizationScope SynchScope,
@@ -1665,7 +1665,7 @@ protected:
 public:
   // allocate space for exactly three operands
   void *operator new(size_t s) {
-    return User::operator new(s, 3);
+    return Instruction::operator new(s, 3);
   }
   ShuffleVectorInst(Value *V1, Value *V2, Value *Mask,
                     const Twine &NameStr = "",
@@ -1758,7 +1758,7 @@ class ExtractValueInst : public UnaryInstruction {
 
   // allocate space for exactly one operand
   void *operator new(size_t s) {
-    return User::operator new(s, 1);
+    return Instruction::operator new(s, 1);
   }
 protected:
   virtual ExtractValueInst *clone_impl() const;
@@ -1876,7 +1876,7 @@ protected:
 public:
   // allocate space for exactly two operands
   void *operator new(size_t s) {
-    return User::operator new(s, 2);
+    return Instruction::operator new(s, 2);
   }
 
   static InsertValueInst *Create(Value *Agg, Value *Val,
@@ -1984,7 +1984,7 @@ class PHINode : public Instruction {
   PHINode(const PHINode &PN);
   // allocate space for exactly zero operands
   void *operator new(size_t s) {
-    return User::operator new(s, 0);
+    return Instruction::operator new(s, 0);
   }
   explicit PHINode(Type *Ty, unsigned NumReservedValues,
                    const Twine &NameStr = "", Instruction *InsertBefore = 0)
@@ -2187,7 +2187,7 @@ private:
   void *operator new(size_t, unsigned) LLVM_DELETED_FUNCTION;
   // Allocate space for exactly zero operands.
   void *operator new(size_t s) {
-    return User::operator new(s, 0);
+    return Instruction::operator new(s, 0);
   }
   void growOperands(unsigned Size);
   void init(Value *PersFn, unsigned NumReservedValues, const Twine &NameStr);
@@ -2480,7 +2480,7 @@ class SwitchInst : public TerminatorInst {
   void growOperands();
   // allocate space for exactly zero operands
   void *operator new(size_t s) {
-    return User::operator new(s, 0);
+    return Instruction::operator new(s, 0);
   }
   /// SwitchInst ctor - Create a new switch instruction, specifying a value to
   /// switch on and a default destination.  The number of additional cases can
@@ -2870,7 +2870,7 @@ class IndirectBrInst : public TerminatorInst {
   void growOperands();
   // allocate space for exactly zero operands
   void *operator new(size_t s) {
-    return User::operator new(s, 0);
+    return Instruction::operator new(s, 0);
   }
   /// IndirectBrInst ctor - Create a new indirectbr instruction, specifying an
   /// Address to jump to.  The number of expected destinations can be specified
@@ -3255,7 +3255,7 @@ protected:
 public:
   // allocate space for exactly zero operands
   void *operator new(size_t s) {
-    return User::operator new(s, 0);
+    return Instruction::operator new(s, 0);
   }
   explicit UnreachableInst(LLVMContext &C, Instruction *InsertBefore = 0);
   explicit UnreachableInst(LLVMContext &C, BasicBlock *InsertAtEnd);
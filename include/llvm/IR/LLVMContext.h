@@ -16,6 +16,7 @@
 #define LLVM_LLVMCONTEXT_H
 
 #include "llvm/Support/Compiler.h"
+#include <cstddef>
 
 namespace llvm {
 
@@ -23,8 +24,10 @@ class LLVMContextImpl;
 class StringRef;
 class Twine;
 class Instruction;
+class MemoryBuffer;
 class Module;
 class SMDiagnostic;
+class raw_ostream;
 template <typename T> class SmallVectorImpl;
 
 /// This is an important class for using LLVM in a threaded context.  It
@@ -107,6 +110,41 @@ public:
   void emitWarning(const Instruction *I, const Twine &ErrorStr);
   void emitWarning(const Twine &ErrorStr);
 
+  /// adoptMemoryBuffer - Transfer ownership of \p Buffer to this context. The
+  /// buffer is destroyed together with the context.  Metadata strings and
+  /// constant data whose bytes lie within an adopted buffer refer to the
+  /// buffer directly instead of copying the bytes.
+  void adoptMemoryBuffer(MemoryBuffer *Buffer);
+
+  /// UniquingTableInfo - Describes one of the tables this context uses to
+  /// unique constants, metadata, attributes and types.
+  struct UniquingTableInfo {
+    const char *Name;
+    unsigned NumEntries;
+    /// NumBuckets - Zero for tables that are not hash tables.
+    unsigned NumBuckets;
+    /// MemorySize - The bytes held by the table itself, not counting the
+    /// objects in it.
+    size_t MemorySize;
+  };
+
+  /// getUniquingTableInfo - Append a description of each uniquing table of
+  /// this context to \p Tables.
+  void getUniquingTableInfo(SmallVectorImpl<UniquingTableInfo> &Tables) const;
+
+  /// printUniquingTableInfo - Print the occupancy and size of the uniquing
+  /// tables.
+  void printUniquingTableInfo(raw_ostream &OS) const;
+
+  /// compactUniquingTables - Delete the uniqued constants that nothing uses,
+  /// and rehash the uniquing tables down to what is left. Return the number
+  /// of constants deleted.
+  ///
+  /// A constant is deleted if it has neither uses nor value handles. Clients
+  /// must not keep plain pointers to such constants across this call. It is
+  /// meant to be called by long-lived contexts after deleting a module.
+  unsigned compactUniquingTables();
+
 private:
   LLVMContext(LLVMContext&) LLVM_DELETED_FUNCTION;
   void operator=(LLVMContext&) LLVM_DELETED_FUNCTION;
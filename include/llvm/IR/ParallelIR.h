@@ -0,0 +1,135 @@
+//===-- llvm/IR/ParallelIR.h - Sharing IR between threads -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares ParallelIR, which synchronizes the parts of the IR that
+// are shared between functions while function passes run on several functions
+// of a module at once.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_PARALLELIR_H
+#define LLVM_IR_PARALLELIR_H
+
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/Compiler.h"
+
+namespace llvm {
+
+class TaskSequencer;
+
+/// ParallelIR - Synchronization of the IR state that is shared between the
+/// functions of a module.
+///
+/// The instructions, arguments and basic blocks of a function only reference
+/// each other, but they share constants, types, metadata, attributes and the
+/// module with every other function. While a parallel run is active:
+///
+///   * The uniquing tables of the LLVMContext, the value handle lists and the
+///     struct layout cache of DataLayout are protected by the context lock, a
+///     single recursive lock. Code that touches them takes a ContextGuard.
+///   * The use lists of values that don't belong to a function, such as
+///     constants, globals and metadata, are protected by a separate lock that
+///     is never held while calling out to other code.
+///   * The module itself, its global lists and its symbol table, is accessed
+///     in function order. The first time the code working on a function
+///     touches the module, it calls waitForModuleAccess(), which blocks until
+///     all functions before it are done. The function therefore sees and
+///     leaves the module in the same state as a serial run would.
+///
+/// Outside of a parallel run all of this is a test of a global counter. The
+/// locks are global rather than per context, so a parallel run on one context
+/// slows down, but doesn't break, other threads using other contexts.
+///
+/// Reading the use list of a shared value is not synchronized. Passes that can
+/// run in parallel must not depend on the users of a constant or global.
+class ParallelIR {
+  static volatile sys::cas_flag NumActiveRuns;
+
+  static void waitForModuleAccessSlow();
+
+public:
+  class Run;
+  class FunctionScope;
+
+  /// isActive - Return true if some thread runs function passes in parallel.
+  static bool isActive() { return NumActiveRuns != 0; }
+
+  static void lockContext();
+  static void unlockContext();
+
+  /// lockUseLists/unlockUseLists - Guard the use list of a shared value. This
+  /// is only meant for Use and Value.
+  static void lockUseLists();
+  static void unlockUseLists();
+
+  /// waitForModuleAccess - Called before the module is inspected or changed.
+  /// On a thread working on the function with index I of a parallel run, the
+  /// first call blocks until functions 0 to I-1 are done. The context lock
+  /// must not be held.
+  static void waitForModuleAccess() {
+    if (LLVM_UNLIKELY(isActive()))
+      waitForModuleAccessSlow();
+  }
+
+  /// ContextGuard - Hold the context lock for the lifetime of the object, if
+  /// a parallel run is active.
+  class ContextGuard {
+    bool Locked;
+
+    ContextGuard(const ContextGuard &) LLVM_DELETED_FUNCTION;
+    void operator=(const ContextGuard &) LLVM_DELETED_FUNCTION;
+  public:
+    ContextGuard() : Locked(isActive()) {
+      if (LLVM_UNLIKELY(Locked))
+        lockContext();
+    }
+    ~ContextGuard() {
+      if (LLVM_UNLIKELY(Locked))
+        unlockContext();
+    }
+  };
+};
+
+/// ParallelIR::Run - Make ParallelIR active for the lifetime of the object,
+/// for processing \p NumFunctions functions with indices 0 to N-1. It must be
+/// created before the worker threads touch the IR, and destroyed after they
+/// are done.
+class ParallelIR::Run {
+  TaskSequencer *Sequencer;
+
+  friend class ParallelIR;
+  friend class FunctionScope;
+
+  Run(const Run &) LLVM_DELETED_FUNCTION;
+  void operator=(const Run &) LLVM_DELETED_FUNCTION;
+public:
+  explicit Run(unsigned NumFunctions);
+  ~Run();
+};
+
+/// ParallelIR::FunctionScope - Declare that the current thread works on the
+/// function with index \p Index of \p R until the scope ends. Function
+/// indices have to be handed out to threads in increasing order.
+class ParallelIR::FunctionScope {
+  Run &R;
+  unsigned Index;
+  bool HasModuleAccess;
+
+  friend class ParallelIR;
+
+  FunctionScope(const FunctionScope &) LLVM_DELETED_FUNCTION;
+  void operator=(const FunctionScope &) LLVM_DELETED_FUNCTION;
+public:
+  FunctionScope(Run &R, unsigned Index);
+  ~FunctionScope();
+};
+
+} // End llvm namespace
+
+#endif
@@ -137,12 +137,19 @@ private:
     setPrev(List);
     *List = this;
   }
-  void removeFromList() {
+  /// removeFromList - Out of line because it has to lock the use list during
+  /// a parallel run.
+  void removeFromList();
+  void unlinkFromList() {
     Use **StrippedPrev = Prev.getPointer();
     *StrippedPrev = Next;
     if (Next) Next->setPrev(StrippedPrev);
   }
 
+  /// isSharedValue - Return true if V may be used by more than one function,
+  /// so that its use list needs the use list lock during a parallel run.
+  static bool isSharedValue(const Value *V);
+
   friend class Value;
 };
 
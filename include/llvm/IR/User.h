@@ -48,12 +48,26 @@ protected:
   ///
   unsigned NumOperands;
 
+  /// IsArenaAllocated - Whether the User and its operands were allocated from
+  /// an IRArena rather than with ::operator new.  operator new sets this, and
+  /// no constructor touches it.
+  bool IsArenaAllocated;
+
   void *operator new(size_t s, unsigned Us);
+  /// placeOperands - Lay out Us operands at the start of Storage and return
+  /// the address of the User that follows them.
+  static void *placeOperands(void *Storage, unsigned Us, bool InArena);
   User(Type *ty, unsigned vty, Use *OpList, unsigned NumOps)
     : Value(ty, vty), OperandList(OpList), NumOperands(NumOps) {}
   Use *allocHungoffUses(unsigned) const;
+  /// allocHungoffStorage - Allocate Size bytes for hung-off uses, from the
+  /// same place as the User itself.
+  void *allocHungoffStorage(size_t Size) const;
+  /// zapHungoffUses - Destroy the Uses in [Start, Stop) and free the array
+  /// that Start points to, which allocHungoffUses returned.
+  void zapHungoffUses(Use *Start, const Use *Stop) const;
   void dropHungoffUses() {
-    Use::zap(OperandList, OperandList + NumOperands, true);
+    zapHungoffUses(OperandList, OperandList + NumOperands);
     OperandList = 0;
     // Reset NumOperands so User::operator delete() does the right thing.
     NumOperands = 0;
@@ -175,9 +175,10 @@ public:
   /// to check for specific values.
   unsigned getNumUses() const;
 
-  /// addUse - This method should only be used by the Use class.
+  /// addUse - This method should only be used by the Use class.  It is out of
+  /// line because it has to lock the use list during a parallel run.
   ///
-  void addUse(Use &U) { U.addToList(&UseList); }
+  void addUse(Use &U);
 
   /// An enumeration for keeping track of the concrete subclass of Value that
   /// is actually instantiated. Values of this enumeration are kept in the 
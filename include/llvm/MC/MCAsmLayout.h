@@ -10,7 +10,6 @@
 #ifndef LLVM_MC_MCASMLAYOUT_H
 #define LLVM_MC_MCASMLAYOUT_H
 
-#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 
 namespace llvm {
@@ -37,10 +36,12 @@ private:
   /// List of sections in layout order.
   llvm::SmallVector<MCSectionData*, 16> SectionOrder;
 
-  /// The last fragment which was laid out, or 0 if nothing has been laid
-  /// out. Fragments are always laid out in order, so all fragments with a
-  /// lower ordinal will be valid.
-  mutable DenseMap<const MCSectionData*, MCFragment*> LastValidFragment;
+  /// The last fragment which was laid out in each section, indexed by the
+  /// section's layout order, or 0 if nothing has been laid out. Fragments are
+  /// always laid out in order, so all fragments with a lower ordinal will be
+  /// valid. When a fragment changes size, only the fragments after it are
+  /// laid out again.
+  mutable llvm::SmallVector<MCFragment*, 16> LastValidFragment;
 
   /// \brief Make sure that the layout for the given fragment is valid, lazily
   /// computing it if necessary.
@@ -809,9 +809,15 @@ private:
   /// were adjusted.
   bool layoutOnce(MCAsmLayout &Layout);
 
-  /// \brief Perform one layout iteration of the given section and return true
-  /// if any offsets were adjusted.
-  bool layoutSectionOnce(MCAsmLayout &Layout, MCSectionData &SD);
+  /// \brief Relax the fragments of the given section until their sizes don't
+  /// change anymore, and return true if any offsets were adjusted.
+  /// HasExternalDeps is set if the size of a fragment may depend on the
+  /// layout of other sections.
+  bool layoutSection(MCAsmLayout &Layout, MCSectionData &SD,
+                     bool &HasExternalDeps);
+
+  /// \brief Relax a single fragment and return true if its size changed.
+  bool relaxFragment(MCAsmLayout &Layout, MCFragment &F);
 
   bool relaxInstruction(MCAsmLayout &Layout, MCInstFragment &IF);
 
@@ -175,6 +175,20 @@ public:
   /// check state of analysis information.
   virtual void verifyAnalysis() const;
 
+  /// createReplica - Return a new, uninitialized instance of this pass that
+  /// is configured like this one, or null if the pass doesn't support it.
+  /// Function passes and immutable passes that provide replicas can run on
+  /// several functions at once, each replica on a different thread. Such a
+  /// pass must not keep state between functions, and it must only touch IR
+  /// outside of the current function through the synchronized APIs described
+  /// in llvm/IR/ParallelIR.h. In particular it must not look at the users of
+  /// constants, globals or other values shared between functions, directly
+  /// or through the analyses it calls, since other threads change them
+  /// meanwhile. Every replica is initialized and finalized on its own, so
+  /// doInitialization and doFinalization run once per replica for each
+  /// module, besides once for the original pass.
+  virtual Pass *createReplica() const;
+
   // dumpPassStructure - Implement the -debug-passes=PassStructure option
   virtual void dumpPassStructure(unsigned Offset = 0);
 
@@ -58,6 +58,12 @@ public:
   /// whether any of the passes modifies the module, and if so, return true.
   bool run(Module &M);
 
+  /// setNumFunctionThreads - Run the function passes on up to N functions of
+  /// the module at once. This only has an effect if llvm_start_multithreaded()
+  /// was called and the passes support it, see Pass::createReplica(). The
+  /// result is the same as with a single thread, which is the default.
+  void setNumFunctionThreads(unsigned N);
+
 private:
   /// PassManagerImpl_New is the actual class. PassManager is just the
   /// wraper to publish simple pass manager interface
@@ -92,6 +92,7 @@
 #include "llvm/Support/PrettyStackTrace.h"
 
 namespace llvm {
+  class BasicBlock;
   class Module;
   class Pass;
   class StringRef;
@@ -198,6 +199,10 @@ public:
   /// Find analysis usage information for the pass P.
   AnalysisUsage *findAnalysisUsage(Pass *P);
 
+  /// Forget the analysis usage information of P, which is about to be
+  /// deleted while this manager lives on.
+  void removeAnalysisUsage(Pass *P);
+
   virtual ~PMTopLevelManager();
 
   /// Add immutable pass and initialize it.
@@ -220,6 +225,11 @@ public:
     IndirectPassManagers.push_back(Manager);
   }
 
+  /// Run function passes on up to N functions at once. Only function pass
+  /// managers whose passes all provide replicas use more than one thread.
+  void setNumFunctionThreads(unsigned N) { NumFunctionThreads = N; }
+  unsigned getNumFunctionThreads() const { return NumFunctionThreads; }
+
   // Print passes managed by this top level manager.
   void dumpPasses() const;
   void dumpArguments() const;
@@ -251,6 +261,8 @@ private:
   SmallVector<ImmutablePass *, 8> ImmutablePasses;
 
   DenseMap<Pass *, AnalysisUsage *> AnUsageMap;
+
+  unsigned NumFunctionThreads;
 };
 
 
@@ -288,6 +300,10 @@ public:
   void freePass(Pass *P, StringRef Msg,
                 enum PassDebuggingString);
 
+  /// Remove P, and the interfaces it is the available implementation of,
+  /// from the available analyses without releasing its memory.
+  void removeAvailableAnalysis(Pass *P);
+
   /// Add pass P into the PassVector. Update
   /// AvailableAnalysis appropriately if ProcessAnalysis is true.
   void add(Pass *P, bool ProcessAnalysis = true);
@@ -410,7 +426,7 @@ class FPPassManager : public ModulePass, public PMDataManager {
 public:
   static char ID;
   explicit FPPassManager()
-  : ModulePass(ID), PMDataManager() { }
+  : ModulePass(ID), PMDataManager(), Original(0) { }
 
   /// run - Execute all of the passes scheduled for execution.  Keep track of
   /// whether any of the passes modifies the module, and if so, return true.
@@ -462,10 +478,65 @@ public:
   virtual PassManagerType getPassManagerType() const {
     return PMT_FunctionPassManager;
   }
+
+private:
+  /// runOnModuleInParallel - Run the passes on the functions of M using up to
+  /// NumThreads threads, each with a replica of this manager. Return false
+  /// without doing anything if the passes can't be replicated.
+  bool runOnModuleInParallel(Module &M, unsigned NumThreads, bool &Changed);
+
+  /// createReplicaManager - Return a manager with replicas of the passes of
+  /// this one, and of the stateful immutable passes, or null if some pass
+  /// can't be replicated.
+  FPPassManager *createReplicaManager();
+  void destroyReplicaManager(FPPassManager *Rep);
+
+  /// removeDeadReplicas - Free the replicas of the passes whose last user is
+  /// the original of replica P.
+  void removeDeadReplicas(Pass *P, StringRef Msg);
+
+  // The manager this one is a replica of, or null.
+  FPPassManager *Original;
+
+  // For replicas, the mapping between the passes of the original manager and
+  // their replicas, and the replicas of immutable passes.
+  DenseMap<Pass *, Pass *> OriginalOf;
+  DenseMap<Pass *, Pass *> ReplicaOf;
+  SmallVector<ImmutablePass *, 4> ImmutableReplicas;
 };
 
 Timer *getPassTimer(Pass *);
 
+/// PassProfileRegion - Record one run of a pass in the -pass-profile report:
+/// the time it took, the number of instructions in the unit it ran on, and
+/// the bytes it requested from MallocAllocator and BumpPtrAllocator.  This is
+/// a no-op unless -pass-profile is given.  Pass managers are not recorded, so
+/// the time of a nested pass is only attributed to the pass itself.
+class PassProfileRegion {
+  Pass *RecordedPass;         // Null if this run is not being recorded.
+  std::string Unit;           // Name of the function the pass ran on.
+  unsigned NumInstructions;
+  double StartWallTime, StartUserTime;
+  uint64_t StartMallocBytes, StartBumpPtrBytes;
+
+  void start(Pass *P, StringRef UnitName, unsigned NumInsts);
+
+  PassProfileRegion(const PassProfileRegion &) LLVM_DELETED_FUNCTION;
+  void operator=(const PassProfileRegion &) LLVM_DELETED_FUNCTION;
+public:
+  PassProfileRegion(Pass *P, Function &F);
+  PassProfileRegion(Pass *P, BasicBlock &BB);
+  PassProfileRegion(Pass *P, Module &M);
+  /// Record a run over part of a function, e.g. a loop or basic block, that
+  /// contains NumInsts instructions.
+  PassProfileRegion(Pass *P, StringRef UnitName, unsigned NumInsts);
+  ~PassProfileRegion();
+
+  /// isEnabled - Return true if pass runs are being recorded.  Callers use
+  /// this to avoid counting instructions for nothing.
+  static bool isEnabled();
+};
+
 }
 
 #endif
@@ -26,6 +26,24 @@ namespace llvm {
 template <typename T> struct ReferenceAdder { typedef T& result; };
 template <typename T> struct ReferenceAdder<T&> { typedef T result; };
 
+/// CountAllocatorBytes - Whether the AllocatorByteCounts are kept up to date.
+/// The pass profiler turns this on before running any pass; allocations only
+/// test it otherwise.
+extern bool CountAllocatorBytes;
+
+/// AllocatorByteCounts - Running totals of the bytes one thread requested
+/// from MallocAllocators and BumpPtrAllocators while CountAllocatorBytes is
+/// set.  The pass profiler samples them around each pass to attribute
+/// allocations to it.
+struct AllocatorByteCounts {
+  uint64_t MallocBytes;
+  uint64_t BumpPtrBytes;
+};
+
+/// getAllocatorByteCounts - Return the counts of the calling thread, creating
+/// them on its first call.
+AllocatorByteCounts &getAllocatorByteCounts();
+
 class MallocAllocator {
 public:
   MallocAllocator() {}
@@ -33,13 +51,23 @@ public:
 
   void Reset() {}
 
-  void *Allocate(size_t Size, size_t /*Alignment*/) { return malloc(Size); }
+  void *Allocate(size_t Size, size_t /*Alignment*/) {
+    if (CountAllocatorBytes)
+      getAllocatorByteCounts().MallocBytes += Size;
+    return malloc(Size);
+  }
 
   template <typename T>
-  T *Allocate() { return static_cast<T*>(malloc(sizeof(T))); }
+  T *Allocate() {
+    if (CountAllocatorBytes)
+      getAllocatorByteCounts().MallocBytes += sizeof(T);
+    return static_cast<T*>(malloc(sizeof(T)));
+  }
 
   template <typename T>
   T *Allocate(size_t Num) {
+    if (CountAllocatorBytes)
+      getAllocatorByteCounts().MallocBytes += sizeof(T)*Num;
     return static_cast<T*>(malloc(sizeof(T)*Num));
   }
 
@@ -0,0 +1,57 @@
+//===-- llvm/Support/MD5.h - MD5 message digest -----------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the MD5 class, which computes the MD5 message digest as
+// described in RFC 1321.  MD5 is not suitable for cryptographic purposes, but
+// it is a good choice for content-based cache keys that must be stable across
+// processes and hosts.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_MD5_H
+#define LLVM_SUPPORT_MD5_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+
+namespace llvm {
+
+class MD5 {
+  // Any 32-bit or wider unsigned integer data type will do.
+  typedef uint32_t MD5_u32plus;
+
+  MD5_u32plus a, b, c, d;
+  MD5_u32plus hi, lo;
+  uint8_t buffer[64];
+  MD5_u32plus block[16];
+
+  const uint8_t *body(ArrayRef<uint8_t> Data);
+
+public:
+  typedef uint8_t MD5Result[16];
+
+  MD5();
+
+  /// update - Add the bytes in \p Data to the digest.
+  void update(ArrayRef<uint8_t> Data);
+  void update(StringRef Str);
+
+  /// final - Finish the digest and store it in \p Result.  The MD5 object
+  /// must not be updated afterwards.
+  void final(MD5Result &Result);
+
+  /// stringifyResult - Translate \p Result into 32 lowercase hex digits.
+  static void stringifyResult(MD5Result &Result, SmallString<32> &Str);
+};
+
+}
+
+#endif
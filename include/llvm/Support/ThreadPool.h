@@ -0,0 +1,197 @@
+//===-- llvm/Support/ThreadPool.h - Work-stealing thread pool ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the ThreadPool, TaskGroup and TaskSequencer classes and
+// the parallel_for_each algorithm built on top of them.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_THREADPOOL_H
+#define LLVM_SUPPORT_THREADPOOL_H
+
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/Compiler.h"
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace llvm {
+
+class TaskGroup;
+class TaskSequencerImpl;
+class ThreadPoolImpl;
+
+/// ThreadPool - A fixed set of worker threads executing tasks.
+///
+/// Every worker owns a task deque. A task spawned by a worker is pushed onto
+/// the back of that worker's deque, and workers take their own tasks from the
+/// back, so nested work stays on the thread that created it. Workers that run
+/// out of work steal from the front of the other deques. Tasks spawned from
+/// outside of the pool are handed to the workers round-robin.
+///
+/// Threads that wait for tasks, through wait() or TaskGroup::wait(), execute
+/// queued tasks while they wait, so nested waits can't deadlock the pool.
+///
+/// The pool itself is thread-safe. If the tasks use LLVM APIs that touch
+/// global state, the client is responsible for calling
+/// llvm_start_multithreaded() first. If LLVM is built without thread support,
+/// tasks are executed immediately on the thread spawning them.
+class ThreadPool {
+  ThreadPoolImpl *Impl;
+
+  ThreadPool(const ThreadPool &) LLVM_DELETED_FUNCTION;
+  void operator=(const ThreadPool &) LLVM_DELETED_FUNCTION;
+
+public:
+  typedef void (*TaskFn)(void *);
+
+  /// Create a pool with \p NumThreads workers. If \p NumThreads is zero, the
+  /// number of workers is getDefaultNumThreads().
+  explicit ThreadPool(unsigned NumThreads = 0);
+
+  /// Wait for all outstanding tasks, then shut down the workers.
+  ~ThreadPool();
+
+  /// getNumThreads - Return the number of worker threads. This is zero if
+  /// LLVM is built without thread support.
+  unsigned getNumThreads() const;
+
+  /// async - Queue a call of \p Fn with \p Arg. It is executed on one of the
+  /// workers at some point before the next wait() returns.
+  void async(TaskFn Fn, void *Arg);
+
+  /// wait - Block until every task queued on this pool, including tasks
+  /// queued by other tasks, has finished. This must not be called from one of
+  /// the tasks, use a TaskGroup instead.
+  void wait();
+
+  /// getDefaultNumThreads - Return the value of the -threads option, or the
+  /// number of hardware threads if it isn't given.
+  static unsigned getDefaultNumThreads();
+
+  /// getGlobal - Return a process-wide pool with getDefaultNumThreads()
+  /// workers. It is created on first use and shut down by llvm_shutdown().
+  static ThreadPool &getGlobal();
+
+private:
+  friend class TaskGroup;
+  void async(TaskFn Fn, void *Arg, TaskGroup *Group);
+};
+
+/// TaskGroup - A set of tasks running on a ThreadPool that can be waited for
+/// independently of the other tasks in the pool.
+class TaskGroup {
+  ThreadPool &Pool;
+  volatile sys::cas_flag Pending;
+
+  friend class ThreadPoolImpl;
+
+  TaskGroup(const TaskGroup &) LLVM_DELETED_FUNCTION;
+  void operator=(const TaskGroup &) LLVM_DELETED_FUNCTION;
+
+public:
+  explicit TaskGroup(ThreadPool &Pool = ThreadPool::getGlobal())
+    : Pool(Pool), Pending(0) {}
+
+  /// Wait for the tasks of the group before destroying it.
+  ~TaskGroup() { wait(); }
+
+  /// spawn - Queue a call of \p Fn with \p Arg as part of this group.
+  void spawn(ThreadPool::TaskFn Fn, void *Arg) { Pool.async(Fn, Arg, this); }
+
+  /// wait - Block until every task of this group has finished. The calling
+  /// thread executes queued tasks of the pool in the meantime.
+  void wait();
+};
+
+/// TaskSequencer - Puts concurrently running tasks, numbered from 0 to N-1,
+/// in order where it matters. A task that calls waitForPredecessors() blocks
+/// until all tasks with lower numbers have called finish(), so whatever it does
+/// afterwards happens as if the tasks had run one after the other.
+///
+/// For this not to deadlock, every task with a lower number must already run,
+/// or be guaranteed to start, without waiting for a higher numbered task. That
+/// is the case when tasks are claimed in increasing order by a fixed set of
+/// threads.
+class TaskSequencer {
+  TaskSequencerImpl *Impl;
+
+  TaskSequencer(const TaskSequencer &) LLVM_DELETED_FUNCTION;
+  void operator=(const TaskSequencer &) LLVM_DELETED_FUNCTION;
+
+public:
+  explicit TaskSequencer(unsigned NumTasks);
+  ~TaskSequencer();
+
+  /// finish - Mark task \p Task finished.
+  void finish(unsigned Task);
+
+  /// waitForPredecessors - Block until tasks 0 to \p Task - 1 have finished.
+  void waitForPredecessors(unsigned Task);
+
+  /// getNumFinishedInOrder - Return the number of tasks at the start of the
+  /// sequence that have finished.
+  unsigned getNumFinishedInOrder() const;
+};
+
+namespace detail {
+/// ForEachChunk - A contiguous piece of the range handed to
+/// parallel_for_each, processed by a single task.
+template <typename IterTy, typename FuncTy>
+struct ForEachChunk {
+  IterTy Begin, End;
+  FuncTy *Fn;
+
+  static void run(void *Arg) {
+    ForEachChunk *Chunk = static_cast<ForEachChunk *>(Arg);
+    for (IterTy I = Chunk->Begin; I != Chunk->End; ++I)
+      (*Chunk->Fn)(*I);
+  }
+};
+} // end namespace detail
+
+/// parallel_for_each - Call \p Fn on every element of [\p Begin, \p End) using
+/// the workers of \p Pool, and return once all the calls have finished. Calls
+/// on different elements may run concurrently, in any order.
+template <typename IterTy, typename FuncTy>
+void parallel_for_each(ThreadPool &Pool, IterTy Begin, IterTy End,
+                       FuncTy Fn) {
+  typedef detail::ForEachChunk<IterTy, FuncTy> ChunkTy;
+
+  size_t Size = std::distance(Begin, End);
+  if (Size == 0)
+    return;
+
+  // Use a few chunks per worker so that stealing can even out the load.
+  size_t NumChunks = std::max<size_t>(1, Pool.getNumThreads() * 4);
+  NumChunks = std::min(NumChunks, Size);
+
+  std::vector<ChunkTy> Chunks(NumChunks);
+  TaskGroup Group(Pool);
+  for (size_t i = 0; i != NumChunks; ++i) {
+    ChunkTy &Chunk = Chunks[i];
+    Chunk.Begin = Begin;
+    std::advance(Begin, Size / NumChunks + (i < Size % NumChunks));
+    Chunk.End = Begin;
+    Chunk.Fn = &Fn;
+    Group.spawn(&ChunkTy::run, &Chunk);
+  }
+  Group.wait();
+}
+
+/// parallel_for_each - Call \p Fn on every element of [\p Begin, \p End) using
+/// the global thread pool.
+template <typename IterTy, typename FuncTy>
+void parallel_for_each(IterTy Begin, IterTy End, FuncTy Fn) {
+  parallel_for_each(ThreadPool::getGlobal(), Begin, End, Fn);
+}
+
+} // end namespace llvm
+
+#endif
@@ -54,6 +54,24 @@ namespace llvm {
   /// the thread stack.
   void llvm_execute_on_thread(void (*UserFn)(void*), void *UserData,
                               unsigned RequestedStackSize = 0);
+
+  /// llvm_execute_on_threads - Execute the given \p UserFn concurrently on
+  /// \p NumThreads separate threads, passing the i'th thread UserData[i], and
+  /// wait for all of them to finish.
+  ///
+  /// As with llvm_execute_on_thread, this does not guarantee that the calls
+  /// actually run on separate threads.  If a thread cannot be created, the
+  /// corresponding call is made on the calling thread instead, so every
+  /// element of \p UserData is always processed exactly once.
+  ///
+  /// \param UserFn - The callback to execute.
+  /// \param UserData - An array of \p NumThreads arguments for the callback.
+  /// \param NumThreads - The number of invocations of \p UserFn.
+  /// \param RequestedStackSize - If non-zero, a requested size (in bytes) for
+  /// each thread stack.
+  void llvm_execute_on_threads(void (*UserFn)(void*), void **UserData,
+                               unsigned NumThreads,
+                               unsigned RequestedStackSize = 0);
 }
 
 #endif
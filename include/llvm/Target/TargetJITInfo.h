@@ -41,6 +41,17 @@ namespace llvm {
     ///
     virtual void replaceMachineCodeForFunction(void *Old, void *New) = 0;
 
+    /// supportsPatchableEntry - Returns true if emitPatchableEntry is
+    /// implemented for this target.
+    virtual bool supportsPatchableEntry() const { return false; }
+
+    /// emitPatchableEntry - Emit a single instruction at the start of a
+    /// function that replaceMachineCodeForFunction overwrites atomically, so
+    /// that the function can be replaced while other threads are running it.
+    virtual void emitPatchableEntry(JITCodeEmitter &JCE) {
+      llvm_unreachable("This target doesn't implement emitPatchableEntry!");
+    }
+
     /// emitGlobalValueIndirectSym - Use the specified JITCodeEmitter object
     /// to emit an indirect symbol which contains the address of the specified
     /// ptr.
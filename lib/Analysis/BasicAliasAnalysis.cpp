@@ -13,9 +13,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "basicaa"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/ValueMap.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/CaptureTracking.h"
 #include "llvm/Analysis/InstructionSimplify.h"
@@ -32,12 +35,30 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Operator.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/GetElementPtrTypeIterator.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include <algorithm>
 using namespace llvm;
 
+STATISTIC(NumDecompositionHits, "Number of GEP decompositions reused");
+STATISTIC(NumStaleDecompositions,
+          "Number of cached GEP decompositions that were out of date");
+STATISTIC(NumQueriesOverBudget,
+          "Number of alias queries answered MayAlias over the budget");
+
+static cl::opt<bool>
+CacheDecompositions("basicaa-cache-decompositions", cl::init(true),
+                    cl::Hidden,
+                    cl::desc("Keep the GEP decompositions and underlying "
+                             "objects of a function between alias queries"));
+
+static cl::opt<unsigned>
+QueryBudget("basicaa-query-budget", cl::init(0), cl::Hidden,
+            cl::desc("Answer MayAlias to the alias queries about a function "
+                     "after this many (0 = no limit)"));
+
 //===----------------------------------------------------------------------===//
 // Useful predicates
 //===----------------------------------------------------------------------===//
@@ -138,6 +159,47 @@ namespace {
       return !operator==(Other);
     }
   };
+
+  /// DecomposedGEP - The result of DecomposeGEPExpression for a pointer, and
+  /// what it was derived from: the users that were looked through, in the
+  /// order they were visited, and their operands at the time.  The result is
+  /// still correct as long as none of these operands changed.
+  struct DecomposedGEP {
+    const Value *Base;
+    int64_t Offset;
+    SmallVector<VariableGEPIndex, 4> VarIndices;
+    SmallVector<std::pair<const User*, unsigned>, 4> Users;
+    SmallVector<const Value*, 8> Operands;
+    /// Cacheable - False if the result also depends on something that isn't
+    /// recorded above, like InstructionSimplify or known bits.
+    bool Cacheable;
+
+    DecomposedGEP() : Base(0), Offset(0), Cacheable(true) {}
+
+    void recordUser(const User *U) {
+      Users.push_back(std::make_pair(U, U->getNumOperands()));
+      for (User::const_op_iterator I = U->op_begin(), E = U->op_end();
+           I != E; ++I)
+        Operands.push_back(*I);
+    }
+
+    /// isUpToDate - Return true if the users still have the same operands.
+    /// Every user but the first is an operand of an earlier one, so it is
+    /// known to be alive by the time it is checked.
+    bool isUpToDate() const {
+      const Value *const *Op = Operands.begin();
+      for (unsigned i = 0, e = Users.size(); i != e; ++i) {
+        const User *U = Users[i].first;
+        if (U->getNumOperands() != Users[i].second)
+          return false;
+        for (User::const_op_iterator I = U->op_begin(), E = U->op_end();
+             I != E; ++I, ++Op)
+          if (*I != *Op)
+            return false;
+      }
+      return true;
+    }
+  };
 }
 
 
@@ -148,10 +210,12 @@ namespace {
 /// IntegerType and it may already be sign or zero extended.
 ///
 /// Note that this looks through extends, so the high bits may not be
-/// represented in the result.
+/// represented in the result.  If Record is non-null, the instructions looked
+/// through are recorded in it.
 static Value *GetLinearExpression(Value *V, APInt &Scale, APInt &Offset,
                                   ExtensionKind &Extension,
-                                  const DataLayout &TD, unsigned Depth) {
+                                  const DataLayout &TD, unsigned Depth,
+                                  DecomposedGEP *Record) {
   assert(V->getType()->isIntegerTy() && "Not an integer value");
 
   // Limit our recursion depth.
@@ -170,21 +234,30 @@ static Value *GetLinearExpression(Value *V, APInt &Scale, APInt &Offset,
         // analyze it.
         if (!MaskedValueIsZero(BOp->getOperand(0), RHSC->getValue(), &TD))
           break;
+        // The known bits of X depend on more than its operands.
+        if (Record)
+          Record->Cacheable = false;
         // FALL THROUGH.
       case Instruction::Add:
+        if (Record)
+          Record->recordUser(BOp);
         V = GetLinearExpression(BOp->getOperand(0), Scale, Offset, Extension,
-                                TD, Depth+1);
+                                TD, Depth+1, Record);
         Offset += RHSC->getValue();
         return V;
       case Instruction::Mul:
+        if (Record)
+          Record->recordUser(BOp);
         V = GetLinearExpression(BOp->getOperand(0), Scale, Offset, Extension,
-                                TD, Depth+1);
+                                TD, Depth+1, Record);
         Offset *= RHSC->getValue();
         Scale *= RHSC->getValue();
         return V;
       case Instruction::Shl:
+        if (Record)
+          Record->recordUser(BOp);
         V = GetLinearExpression(BOp->getOperand(0), Scale, Offset, Extension,
-                                TD, Depth+1);
+                                TD, Depth+1, Record);
         Offset <<= RHSC->getValue().getLimitedValue();
         Scale <<= RHSC->getValue().getLimitedValue();
         return V;
@@ -204,8 +277,10 @@ static Value *GetLinearExpression(Value *V, APInt &Scale, APInt &Offset,
     Offset = Offset.trunc(SmallWidth);
     Extension = isa<SExtInst>(V) ? EK_SignExt : EK_ZeroExt;
 
+    if (Record)
+      Record->recordUser(cast<CastInst>(V));
     Value *Result = GetLinearExpression(CastOp, Scale, Offset, Extension,
-                                        TD, Depth+1);
+                                        TD, Depth+1, Record);
     Scale = Scale.zext(OldWidth);
     Offset = Offset.zext(OldWidth);
     
@@ -230,10 +305,13 @@ static Value *GetLinearExpression(Value *V, APInt &Scale, APInt &Offset,
 /// that GetUnderlyingObject can look through.  When not, it just looks
 /// through pointer casts.
 ///
+/// If Record is non-null, the users looked through are recorded in it, so
+/// the result can be cached.
+///
 static const Value *
 DecomposeGEPExpression(const Value *V, int64_t &BaseOffs,
                        SmallVectorImpl<VariableGEPIndex> &VarIndices,
-                       const DataLayout *TD) {
+                       const DataLayout *TD, DecomposedGEP *Record = 0) {
   // Limit recursion depth to limit compile time in crazy cases.
   unsigned MaxLookup = 6;
   
@@ -245,6 +323,9 @@ DecomposeGEPExpression(const Value *V, int64_t &BaseOffs,
       // The only non-operator case we can handle are GlobalAliases.
       if (const GlobalAlias *GA = dyn_cast<GlobalAlias>(V)) {
         if (!GA->mayBeOverridden()) {
+          // The linkage of the alias may change.
+          if (Record)
+            Record->Cacheable = false;
           V = GA->getAliasee();
           continue;
         }
@@ -253,6 +334,8 @@ DecomposeGEPExpression(const Value *V, int64_t &BaseOffs,
     }
     
     if (Op->getOpcode() == Instruction::BitCast) {
+      if (Record)
+        Record->recordUser(Op);
       V = Op->getOperand(0);
       continue;
     }
@@ -265,6 +348,8 @@ DecomposeGEPExpression(const Value *V, int64_t &BaseOffs,
         // TODO: Get a DominatorTree and use it here.
         if (const Value *Simplified =
               SimplifyInstruction(const_cast<Instruction *>(I), TD)) {
+          if (Record)
+            Record->Cacheable = false;
           V = Simplified;
           continue;
         }
@@ -283,10 +368,15 @@ DecomposeGEPExpression(const Value *V, int64_t &BaseOffs,
     if (TD == 0) {
       if (!GEPOp->hasAllZeroIndices())
         return V;
+      if (Record)
+        Record->recordUser(GEPOp);
       V = GEPOp->getOperand(0);
       continue;
     }
     
+    if (Record)
+      Record->recordUser(GEPOp);
+
     // Walk the indices of the GEP, accumulating them into BaseOff/VarIndices.
     gep_type_iterator GTI = gep_type_begin(GEPOp);
     for (User::const_op_iterator I = GEPOp->op_begin()+1,
@@ -321,7 +411,7 @@ DecomposeGEPExpression(const Value *V, int64_t &BaseOffs,
       // Use GetLinearExpression to decompose the index into a C1*V+C2 form.
       APInt IndexScale(Width, 0), IndexOffset(Width, 0);
       Index = GetLinearExpression(Index, IndexScale, IndexOffset, Extension,
-                                  *TD, 0);
+                                  *TD, 0, Record);
       
       // The GEP index scale ("Scale") scales C1*V+C2, yielding (C1*V+C2)*Scale.
       // This gives us an aggregate computation of (C1*Scale)*V + C2*Scale.
@@ -404,10 +494,9 @@ static void GetIndexDifference(SmallVectorImpl<VariableGEPIndex> &Dest,
 // BasicAliasAnalysis Pass
 //===----------------------------------------------------------------------===//
 
-#ifndef NDEBUG
 static const Function *getParent(const Value *V) {
   if (const Instruction *inst = dyn_cast<Instruction>(V))
-    return inst->getParent()->getParent();
+    return inst->getParent() ? inst->getParent()->getParent() : NULL;
 
   if (const Argument *arg = dyn_cast<Argument>(V))
     return arg->getParent();
@@ -415,6 +504,7 @@ static const Function *getParent(const Value *V) {
   return NULL;
 }
 
+#ifndef NDEBUG
 static bool notDifferentParent(const Value *O1, const Value *O2) {
 
   const Function *F1 = getParent(O1);
@@ -425,10 +515,17 @@ static bool notDifferentParent(const Value *O1, const Value *O2) {
 #endif
 
 namespace {
+  /// DecompositionCacheConfig - A cached decomposition stays with its
+  /// pointer when the pointer is replaced, and goes away when it is deleted.
+  struct DecompositionCacheConfig : ValueMapConfig<const Value*> {
+    enum { FollowRAUW = false };
+  };
+
   /// BasicAliasAnalysis - This is the primary alias analysis implementation.
   struct BasicAliasAnalysis : public ImmutablePass, public AliasAnalysis {
     static char ID; // Class identification, replacement for typeinfo
-    BasicAliasAnalysis() : ImmutablePass(ID) {
+    BasicAliasAnalysis()
+      : ImmutablePass(ID) {
       initializeBasicAliasAnalysisPass(*PassRegistry::getPassRegistry());
     }
 
@@ -441,11 +538,18 @@ namespace {
       AU.addRequired<TargetLibraryInfo>();
     }
 
+    // The caches are per instance, so each thread needs its own.
+    virtual Pass *createReplica() const { return new BasicAliasAnalysis(); }
+
     virtual AliasResult alias(const Location &LocA,
                               const Location &LocB) {
       assert(AliasCache.empty() && "AliasCache must be cleared after use!");
       assert(notDifferentParent(LocA.Ptr, LocB.Ptr) &&
              "BasicAliasAnalysis doesn't support interprocedural queries.");
+      if (!startQuery(LocA.Ptr, LocB.Ptr)) {
+        ++NumQueriesOverBudget;
+        return MayAlias;
+      }
       AliasResult Alias = aliasCheck(LocA.Ptr, LocA.Size, LocA.TBAATag,
                                      LocB.Ptr, LocB.Size, LocB.TBAATag);
       // AliasCache rarely has more than 1 or 2 elements, always use
@@ -496,6 +600,30 @@ namespace {
     // Visited - Track instructions visited by pointsToConstantMemory.
     SmallPtrSet<const Value*, 16> Visited;
 
+    // DecompositionCache - The decompositions of pointer instructions, kept
+    // across queries and passes.  An entry is checked against the operands it
+    // was derived from before it is used, and goes away with its instruction.
+    typedef ValueMap<const Value*, DecomposedGEP, DecompositionCacheConfig>
+      DecompositionCacheTy;
+    DecompositionCacheTy DecompositionCache;
+
+    // NumQueries - The number of queries answered about each function.  An
+    // entry goes away with its function.
+    ValueMap<const Function*, unsigned> NumQueries;
+
+    /// startQuery - Start a top-level query about V1 and V2.  Return false if
+    /// the budget of their function is used up.
+    bool startQuery(const Value *V1, const Value *V2);
+
+    /// decomposeGEP - Like DecomposeGEPExpression, but use and update the
+    /// cache.
+    const Value *decomposeGEP(const Value *V, int64_t &BaseOffs,
+                              SmallVectorImpl<VariableGEPIndex> &VarIndices);
+
+    /// getUnderlyingObject - Like GetUnderlyingObject, but use and update the
+    /// cache.
+    const Value *getUnderlyingObject(const Value *V);
+
     // aliasGEP - Provide a bunch of ad-hoc rules to disambiguate a GEP
     // instruction against another.
     AliasResult aliasGEP(const GEPOperator *V1, uint64_t V1Size,
@@ -539,6 +667,66 @@ ImmutablePass *llvm::createBasicAliasAnalysisPass() {
   return new BasicAliasAnalysis();
 }
 
+bool BasicAliasAnalysis::startQuery(const Value *V1, const Value *V2) {
+  if (QueryBudget == 0)
+    return true;
+
+  // Queries about globals and constants alone are not charged to any
+  // function.
+  const Function *F = getParent(V1);
+  if (!F)
+    F = getParent(V2);
+  if (!F)
+    return true;
+  unsigned &N = NumQueries[F];
+  if (N == QueryBudget)
+    return false;
+  ++N;
+  return true;
+}
+
+const Value *
+BasicAliasAnalysis::decomposeGEP(const Value *V, int64_t &BaseOffs,
+                               SmallVectorImpl<VariableGEPIndex> &VarIndices) {
+  // Without DataLayout, the decomposition stops short of the underlying
+  // object, and the two can't share an entry.  Constants are shared between
+  // functions, so only instructions are cached.
+  if (!CacheDecompositions || !TD || !isa<Instruction>(V))
+    return DecomposeGEPExpression(V, BaseOffs, VarIndices, TD);
+
+  DecompositionCacheTy::iterator I = DecompositionCache.find(V);
+  if (I != DecompositionCache.end()) {
+    if (I->second.isUpToDate()) {
+      ++NumDecompositionHits;
+      BaseOffs = I->second.Offset;
+      VarIndices.clear();
+      VarIndices.append(I->second.VarIndices.begin(),
+                        I->second.VarIndices.end());
+      return I->second.Base;
+    }
+    ++NumStaleDecompositions;
+    DecompositionCache.erase(I);
+  }
+
+  DecomposedGEP D;
+  D.Base = DecomposeGEPExpression(V, D.Offset, D.VarIndices, TD, &D);
+  BaseOffs = D.Offset;
+  VarIndices.clear();
+  VarIndices.append(D.VarIndices.begin(), D.VarIndices.end());
+  if (D.Cacheable)
+    DecompositionCache.insert(std::make_pair(V, D));
+  return D.Base;
+}
+
+const Value *BasicAliasAnalysis::getUnderlyingObject(const Value *V) {
+  // With DataLayout, the base of the decomposition is the underlying object.
+  if (!CacheDecompositions || !TD || !isa<Instruction>(V))
+    return GetUnderlyingObject(V, TD);
+  int64_t BaseOffs;
+  SmallVector<VariableGEPIndex, 4> VarIndices;
+  return decomposeGEP(V, BaseOffs, VarIndices);
+}
+
 /// pointsToConstantMemory - Returns whether the given pointer value
 /// points to memory that is local to the function, with global constants being
 /// considered local to all functions.
@@ -550,7 +738,7 @@ BasicAliasAnalysis::pointsToConstantMemory(const Location &Loc, bool OrLocal) {
   SmallVector<const Value *, 16> Worklist;
   Worklist.push_back(Loc.Ptr);
   do {
-    const Value *V = GetUnderlyingObject(Worklist.pop_back_val(), TD);
+    const Value *V = getUnderlyingObject(Worklist.pop_back_val());
     if (!Visited.insert(V)) {
       Visited.clear();
       return AliasAnalysis::pointsToConstantMemory(Loc, OrLocal);
@@ -655,7 +843,7 @@ BasicAliasAnalysis::getModRefInfo(ImmutableCallSite CS,
   assert(notDifferentParent(CS.getInstruction(), Loc.Ptr) &&
          "AliasAnalysis query involving multiple functions!");
 
-  const Value *Object = GetUnderlyingObject(Loc.Ptr, TD);
+  const Value *Object = getUnderlyingObject(Loc.Ptr);
   
   // If this is a tail call and Loc.Ptr points to a stack location, we know that
   // the tail call cannot access or modify the local stack.
@@ -864,9 +1052,9 @@ BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
         int64_t GEP2BaseOffset;
         SmallVector<VariableGEPIndex, 4> GEP2VariableIndices;
         const Value *GEP2BasePtr =
-          DecomposeGEPExpression(GEP2, GEP2BaseOffset, GEP2VariableIndices, TD);
+          decomposeGEP(GEP2, GEP2BaseOffset, GEP2VariableIndices);
         const Value *GEP1BasePtr =
-          DecomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices, TD);
+          decomposeGEP(GEP1, GEP1BaseOffset, GEP1VariableIndices);
         // DecomposeGEPExpression and GetUnderlyingObject should return the
         // same result except when DecomposeGEPExpression has no DataLayout.
         if (GEP1BasePtr != UnderlyingV1 || GEP2BasePtr != UnderlyingV2) {
@@ -894,12 +1082,12 @@ BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
     // exactly, see if the computed offset from the common pointer tells us
     // about the relation of the resulting pointer.
     const Value *GEP1BasePtr =
-      DecomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices, TD);
+      decomposeGEP(GEP1, GEP1BaseOffset, GEP1VariableIndices);
     
     int64_t GEP2BaseOffset;
     SmallVector<VariableGEPIndex, 4> GEP2VariableIndices;
     const Value *GEP2BasePtr =
-      DecomposeGEPExpression(GEP2, GEP2BaseOffset, GEP2VariableIndices, TD);
+      decomposeGEP(GEP2, GEP2BaseOffset, GEP2VariableIndices);
     
     // DecomposeGEPExpression and GetUnderlyingObject should return the
     // same result except when DecomposeGEPExpression has no DataLayout.
@@ -934,7 +1122,7 @@ BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
       return R;
 
     const Value *GEP1BasePtr =
-      DecomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices, TD);
+      decomposeGEP(GEP1, GEP1BaseOffset, GEP1VariableIndices);
     
     // DecomposeGEPExpression and GetUnderlyingObject should return the
     // same result except when DecomposeGEPExpression has no DataLayout.
@@ -1154,8 +1342,8 @@ BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
     return NoAlias;  // Scalars cannot alias each other
 
   // Figure out what objects these things are pointing to if we can.
-  const Value *O1 = GetUnderlyingObject(V1, TD);
-  const Value *O2 = GetUnderlyingObject(V2, TD);
+  const Value *O1 = getUnderlyingObject(V1);
+  const Value *O2 = getUnderlyingObject(V2);
 
   // Null values in the default address space don't point to any object, so they
   // don't alias any other pointer.
@@ -103,6 +103,21 @@ private:
 
 } // end anonymous namespace.
 
+/// describeSCC - Name an SCC after its first defined function and count its
+/// instructions, for the -pass-profile report.
+static void describeSCC(CallGraphSCC &SCC, StringRef &Name,
+                        unsigned &NumInsts) {
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I) {
+    Function *F = (*I)->getFunction();
+    if (!F || F->isDeclaration())
+      continue;
+    if (Name.empty())
+      Name = F->getName();
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+      NumInsts += BB->size();
+  }
+}
+
 char CGPassManager::ID = 0;
 
 
@@ -121,6 +136,11 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
 
     {
       TimeRegion PassTimer(getPassTimer(CGSP));
+      StringRef UnitName;
+      unsigned NumInsts = 0;
+      if (PassProfileRegion::isEnabled())
+        describeSCC(CurSCC, UnitName, NumInsts);
+      PassProfileRegion Profile(CGSP, UnitName, NumInsts);
       Changed = CGSP->runOnSCC(CurSCC);
     }
     
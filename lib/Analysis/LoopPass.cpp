@@ -14,11 +14,18 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Analysis/LoopPass.h"
+#include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/Assembly/PrintModulePass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Timer.h"
 using namespace llvm;
 
+static cl::opt<bool>
+ReleaseSCEVLoops("scev-release-loops", cl::Hidden, cl::init(true),
+                 cl::desc("Drop ScalarEvolution's cached results for a loop "
+                          "nest once all loop passes have run on it"));
+
 namespace {
 
 /// PrintLoopPass - Print a Function corresponding to a Loop.
@@ -166,6 +173,16 @@ static void addLoopIntoQueue(Loop *L, std::deque<Loop *> &LQ) {
     addLoopIntoQueue(*I, LQ);
 }
 
+/// countLoopInstructions - Return the number of instructions in the blocks of
+/// L, which is what a loop pass is charged with in the -pass-profile report.
+static unsigned countLoopInstructions(Loop *L) {
+  unsigned NumInsts = 0;
+  for (Loop::block_iterator I = L->block_begin(), E = L->block_end();
+       I != E; ++I)
+    NumInsts += (*I)->size();
+  return NumInsts;
+}
+
 /// Pass Manager itself does not invalidate any analysis info.
 void LPPassManager::getAnalysisUsage(AnalysisUsage &Info) const {
   // LPPassManager needs LoopInfo. In the long term LoopInfo class will
@@ -224,6 +241,9 @@ bool LPPassManager::runOnFunction(Function &F) {
       {
         PassManagerPrettyStackEntry X(P, *CurrentLoop->getHeader());
         TimeRegion PassTimer(getPassTimer(P));
+        PassProfileRegion Profile(P, F.getName(),
+                                  PassProfileRegion::isEnabled() ?
+                                  countLoopInstructions(CurrentLoop) : 0);
 
         Changed |= P->runOnLoop(CurrentLoop, *this);
       }
@@ -275,6 +295,13 @@ bool LPPassManager::runOnFunction(Function &F) {
 
     if (redoThisLoop)
       LQ.push_back(CurrentLoop);
+    else if (!skipThisLoop && !CurrentLoop->getParentLoop() &&
+             ReleaseSCEVLoops) {
+      // Subloops are visited before their parents, so all loop passes are
+      // done with this nest. Release what ScalarEvolution cached for it.
+      if (ScalarEvolution *SE = getAnalysisIfAvailable<ScalarEvolution>())
+        SE->releaseLoopMemory(CurrentLoop);
+    }
   }
 
   // Finalization
@@ -29,6 +29,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/PredIteratorCache.h"
 using namespace llvm;
@@ -45,11 +46,30 @@ STATISTIC(NumUncacheNonLocalPtr,
           "Number of uncached non-local ptr responses");
 STATISTIC(NumCacheCompleteNonLocalPtr,
           "Number of block queries that were completely cached");
+STATISTIC(NumEvictedNonLocalPtr,
+          "Number of non-local ptr responses evicted from the cache");
+
+STATISTIC(NumMemInstIndexBuilt, "Number of memory instruction indexes built");
+STATISTIC(NumIndexedScans, "Number of block scans using the index");
 
 // Limit for the number of instructions to scan in a block.
 // FIXME: Figure out what a sane value is for this.
 //        (500 is relatively insane.)
-static const int BlockScanLimit = 500;
+static cl::opt<unsigned>
+BlockScanLimitOpt("memdep-block-scan-limit", cl::Hidden, cl::init(500),
+  cl::desc("The maximum number of instructions that a dependence scan of a "
+           "block looks at (0 = no limit)"));
+
+static cl::opt<unsigned>
+MemInstIndexThreshold("memdep-block-index-threshold", cl::Hidden,
+  cl::init(256),
+  cl::desc("Index the memory instructions of a block once a scan of it "
+           "walks more than this many instructions (0 = never)"));
+
+static cl::opt<unsigned>
+NonLocalCacheLimit("memdep-nonlocal-cache-limit", cl::Hidden, cl::init(0),
+  cl::desc("The maximum number of pointers to keep non-local dependencies "
+           "for (0 = unlimited)"));
 
 char MemoryDependenceAnalysis::ID = 0;
   
@@ -60,11 +80,189 @@ INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
 INITIALIZE_PASS_END(MemoryDependenceAnalysis, "memdep",
                       "Memory Dependence Analysis", false, true)
 
+namespace {
+/// MemInstVH - An entry of a block's memory instruction index.  It becomes
+/// null when the instruction is deleted, and ignores RAUW, which would put
+/// another value at the wrong position.
+class MemInstVH : public CallbackVH {
+public:
+  explicit MemInstVH(Instruction *I) : CallbackVH(I) {}
+  MemInstVH(const MemInstVH &RHS) : CallbackVH(RHS) {}
+  MemInstVH &operator=(const MemInstVH &RHS) {
+    setValPtr(RHS);
+    return *this;
+  }
+};
+}
+
+/// BlockMemInstIndex - The instructions that dependence scans have to look at
+/// in a block, in order.  The index is valid as long as the insertion epoch of
+/// the block is Epoch.  Instructions that were deleted since show up as null,
+/// and instructions that were removed from the block have another parent.
+struct MemoryDependenceAnalysis::BlockMemInstIndex {
+  unsigned Epoch;
+  std::vector<MemInstVH> Insts;
+  /// Positions - The position of each entry of Insts in the block when it was
+  /// indexed.  Instructions may have been removed since, so the difference
+  /// of two positions is an upper bound of the instructions between them.
+  std::vector<unsigned> Positions;
+  /// NumBlockInsts - The size of the block when it was indexed, which is
+  /// what rebuilding the index costs.
+  unsigned NumBlockInsts;
+  /// NumWalkedWhileStale - The instructions walked by scans since the index
+  /// went out of date.
+  unsigned NumWalkedWhileStale;
+};
+
+/// isScannedInst - Return true if the dependence scans have to look at I,
+/// because it may touch memory or is an allocation or a call.
+static bool isScannedInst(const Instruction *I) {
+  return I->mayReadOrWriteMemory() || isa<AllocaInst>(I) ||
+         isa<CallInst>(I) || isa<InvokeInst>(I);
+}
+
+/// MemInstScanner - Walks a block backwards from a position, returning the
+/// instructions that the dependence scans have to look at, until Limit
+/// instructions of any kind have been passed.  If the block has a valid index,
+/// only its entries are visited as long as their recorded positions show that
+/// the limit is out of reach.  Otherwise, and once the limit is close, the
+/// instruction list is walked, and a long walk indexes the block for the next
+/// scan.  Either way, the same instructions are returned.
+class MemoryDependenceAnalysis::MemInstScanner {
+  MemoryDependenceAnalysis &MD;
+  BasicBlock *BB;
+  BasicBlock::iterator Start;
+  BasicBlock::iterator ScanIt;
+  unsigned Limit;
+  BlockMemInstIndex *Index;
+  BlockMemInstIndex *StaleIndex;
+  bool UsedIndex;
+  bool HitLimit;
+  unsigned Pos;
+  /// StartPos - An upper bound of the indexed position of Start.
+  unsigned StartPos;
+  Instruction *LastInst;
+  unsigned NumWalked;
+
+  /// stopUsingIndex - Continue with walking the instruction list after the
+  /// last instruction returned, counting the instructions before it exactly.
+  void stopUsingIndex() {
+    Index = 0;
+    if (!LastInst)
+      return;
+    while (ScanIt != BasicBlock::iterator(LastInst)) {
+      --ScanIt;
+      ++NumWalked;
+    }
+  }
+
+public:
+  MemInstScanner(MemoryDependenceAnalysis &MD, BasicBlock::iterator ScanIt,
+                 BasicBlock *BB, unsigned Limit)
+    : MD(MD), BB(BB), Start(ScanIt), ScanIt(ScanIt), Limit(Limit), Index(0),
+      StaleIndex(0), UsedIndex(false), HitLimit(false), Pos(0), StartPos(0),
+      LastInst(0), NumWalked(0) {
+    BlockMemInstIndexMap::iterator I = MD.BlockMemInstIndices.find(BB);
+    if (I == MD.BlockMemInstIndices.end())
+      return;
+    if (I->second->Epoch != BB->getInsertionEpoch()) {
+      StaleIndex = I->second;
+      return;
+    }
+    Index = I->second;
+    UsedIndex = true;
+    ++NumIndexedScans;
+
+    // Find the last indexed instruction before ScanIt.  ScanIt itself may not
+    // be in the index, if it does not touch memory.
+    if (ScanIt == BB->end()) {
+      Pos = Index->Insts.size();
+      StartPos = Index->NumBlockInsts;
+      return;
+    }
+    unsigned Skip = 0;
+    BasicBlock::iterator It = ScanIt;
+    while (true) {
+      if (isScannedInst(It)) {
+        DenseMap<Instruction*, unsigned>::iterator O =
+          MD.MemInstOrdinals.find(It);
+        assert(O != MD.MemInstOrdinals.end() &&
+               O->second < Index->Insts.size() &&
+               Index->Insts[O->second] == It && "Index out of date!");
+        Pos = O->second + (Skip != 0);
+        StartPos = Index->Positions[O->second] + Skip;
+        return;
+      }
+      if (It == BB->begin()) {
+        StartPos = Skip;
+        return;
+      }
+      --It;
+      ++Skip;
+    }
+  }
+
+  ~MemInstScanner() {
+    if (UsedIndex || !MemInstIndexThreshold)
+      return;
+    if (!StaleIndex) {
+      if (NumWalked > MemInstIndexThreshold)
+        MD.buildMemInstIndex(BB);
+      return;
+    }
+
+    // Passes like GVN insert instructions between scans, and each insertion
+    // invalidates the index.  Rebuilding it walks the whole block, so only do
+    // that once the scans have walked as much since the index went stale.
+    StaleIndex->NumWalkedWhileStale += NumWalked;
+    if (StaleIndex->NumWalkedWhileStale >= StaleIndex->NumBlockInsts)
+      MD.buildMemInstIndex(BB);
+  }
+
+  /// hitLimit - Return true if getPrev stopped short of the start of the
+  /// block because Limit instructions were passed.
+  bool hitLimit() const { return HitLimit; }
+
+  /// getPrev - Return the previous instruction to look at, or null at the
+  /// start of the block or when the limit is hit.
+  Instruction *getPrev() {
+    if (Index) {
+      while (Pos) {
+        // Walk the list once the limit may be near, to count exactly.
+        if (Limit && StartPos - Index->Positions[Pos - 1] >= Limit)
+          break;
+        Value *V = Index->Insts[--Pos];
+        Instruction *I = cast_or_null<Instruction>(V);
+        if (I && I->getParent() == BB)
+          return LastInst = I;
+      }
+      if (!Pos && (!Limit || StartPos < Limit))
+        return 0;
+      stopUsingIndex();
+    }
+    while (ScanIt != BB->begin()) {
+      // Limit the amount of scanning we do so we don't end up with quadratic
+      // running time on extreme testcases.
+      if (Limit && NumWalked + 1 >= Limit) {
+        HitLimit = true;
+        return 0;
+      }
+      Instruction *I = --ScanIt;
+      ++NumWalked;
+      if (isScannedInst(I))
+        return LastInst = I;
+    }
+    return 0;
+  }
+};
+
 MemoryDependenceAnalysis::MemoryDependenceAnalysis()
-: FunctionPass(ID), PredCache(0) {
+: FunctionPass(ID), NumNonLocalPtrQueries(0), BlockScanLimit(BlockScanLimitOpt),
+  PredCache(0) {
   initializeMemoryDependenceAnalysisPass(*PassRegistry::getPassRegistry());
 }
 MemoryDependenceAnalysis::~MemoryDependenceAnalysis() {
+  DeleteContainerSeconds(BlockMemInstIndices);
 }
 
 /// Clean up memory in between runs
@@ -75,9 +273,44 @@ void MemoryDependenceAnalysis::releaseMemory() {
   ReverseLocalDeps.clear();
   ReverseNonLocalDeps.clear();
   ReverseNonLocalPtrDeps.clear();
+  DeleteContainerSeconds(BlockMemInstIndices);
+  MemInstOrdinals.clear();
+  NumNonLocalPtrQueries = 0;
   PredCache->clear();
 }
 
+/// buildMemInstIndex - Index the instructions of BB that dependence scans
+/// have to look at.
+void MemoryDependenceAnalysis::buildMemInstIndex(BasicBlock *BB) {
+  BlockMemInstIndex *&Index = BlockMemInstIndices[BB];
+  if (Index == 0)
+    Index = new BlockMemInstIndex();
+  Index->Epoch = BB->getInsertionEpoch();
+  Index->Insts.clear();
+  Index->Positions.clear();
+  Index->NumBlockInsts = 0;
+  Index->NumWalkedWhileStale = 0;
+
+  unsigned NumInsts = 0;
+  for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I) {
+    ++Index->NumBlockInsts;
+    if (isScannedInst(I))
+      ++NumInsts;
+  }
+  // Copying the value handles around is not free, so reserve up front.
+  Index->Insts.reserve(NumInsts);
+  Index->Positions.reserve(NumInsts);
+  unsigned Position = 0;
+  for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E;
+       ++I, ++Position)
+    if (isScannedInst(I)) {
+      MemInstOrdinals[I] = Index->Insts.size();
+      Index->Insts.push_back(MemInstVH(I));
+      Index->Positions.push_back(Position);
+    }
+  ++NumMemInstIndexBuilt;
+}
+
 
 
 /// getAnalysisUsage - Does not modify anything.  It uses Alias Analysis.
@@ -191,18 +424,10 @@ AliasAnalysis::ModRefResult GetLocation(const Instruction *Inst,
 MemDepResult MemoryDependenceAnalysis::
 getCallSiteDependencyFrom(CallSite CS, bool isReadOnlyCall,
                           BasicBlock::iterator ScanIt, BasicBlock *BB) {
-  unsigned Limit = BlockScanLimit;
+  MemInstScanner Scanner(*this, ScanIt, BB, BlockScanLimit);
 
   // Walk backwards through the block, looking for dependencies
-  while (ScanIt != BB->begin()) {
-    // Limit the amount of scanning we do so we don't end up with quadratic
-    // running time on extreme testcases. 
-    --Limit;
-    if (!Limit)
-      return MemDepResult::getUnknown();
-
-    Instruction *Inst = --ScanIt;
-    
+  while (Instruction *Inst = Scanner.getPrev()) {
     // If this inst is a memory op, get the pointer it accessed
     AliasAnalysis::Location Loc;
     AliasAnalysis::ModRefResult MR = GetLocation(Inst, Loc, AA);
@@ -239,6 +464,10 @@ getCallSiteDependencyFrom(CallSite CS, bool isReadOnlyCall,
       return MemDepResult::getClobber(Inst);
   }
 
+  // The scan gave up before the start of the block.
+  if (Scanner.hitLimit())
+    return MemDepResult::getUnknown();
+
   // No dependence found.  If this is the entry block of the function, it is
   // unknown, otherwise it is non-local.
   if (BB != &BB->getParent()->getEntryBlock())
@@ -353,18 +582,10 @@ getPointerDependencyFrom(const AliasAnalysis::Location &MemLoc, bool isLoad,
   const Value *MemLocBase = 0;
   int64_t MemLocOffset = 0;
 
-  unsigned Limit = BlockScanLimit;
+  MemInstScanner Scanner(*this, ScanIt, BB, BlockScanLimit);
 
   // Walk backwards through the basic block, looking for dependencies.
-  while (ScanIt != BB->begin()) {
-    // Limit the amount of scanning we do so we don't end up with quadratic
-    // running time on extreme testcases.
-    --Limit;
-    if (!Limit)
-      return MemDepResult::getUnknown();
-
-    Instruction *Inst = --ScanIt;
-
+  while (Instruction *Inst = Scanner.getPrev()) {
     if (IntrinsicInst *II = dyn_cast<IntrinsicInst>(Inst)) {
       // Debug intrinsics don't (and can't) cause dependences.
       if (isa<DbgInfoIntrinsic>(II)) continue;
@@ -517,6 +738,10 @@ getPointerDependencyFrom(const AliasAnalysis::Location &MemLoc, bool isLoad,
     }
   }
   
+  // The scan gave up before the start of the block.
+  if (Scanner.hitLimit())
+    return MemDepResult::getUnknown();
+
   // No dependence found.  If this is the entry block of the function, it is
   // unknown, otherwise it is non-local.
   if (BB != &BB->getParent()->getEntryBlock())
@@ -761,13 +986,46 @@ getNonLocalPointerDependency(const AliasAnalysis::Location &Loc, bool isLoad,
   // a block with multiple different pointers.  This can happen during PHI
   // translation.
   DenseMap<BasicBlock*, Value*> Visited;
-  if (!getNonLocalPointerDepFromBB(Address, Loc, isLoad, FromBB,
-                                   Result, Visited, true))
-    return;
-  Result.clear();
-  Result.push_back(NonLocalDepResult(FromBB,
-                                     MemDepResult::getUnknown(),
-                                     const_cast<Value *>(Loc.Ptr)));
+  ++NumNonLocalPtrQueries;
+  if (getNonLocalPointerDepFromBB(Address, Loc, isLoad, FromBB,
+                                  Result, Visited, true)) {
+    Result.clear();
+    Result.push_back(NonLocalDepResult(FromBB,
+                                       MemDepResult::getUnknown(),
+                                       const_cast<Value *>(Loc.Ptr)));
+  }
+
+  // Result is a copy, so the cache can shrink now.
+  if (NonLocalCacheLimit && NonLocalPointerDeps.size() > NonLocalCacheLimit)
+    evictNonLocalPointerDependencies();
+}
+
+namespace {
+typedef std::pair<unsigned, PointerIntPair<const Value*, 1, bool> > LastUseKey;
+struct LastUseLess {
+  bool operator()(const LastUseKey &LHS, const LastUseKey &RHS) const {
+    return LHS.first < RHS.first;
+  }
+};
+}
+
+/// evictNonLocalPointerDependencies - Shrink the non-local pointer cache to
+/// half of -memdep-nonlocal-cache-limit, dropping the pointers that were
+/// queried least recently.  Halving it makes the cost of the eviction
+/// amortized constant per query.
+void MemoryDependenceAnalysis::evictNonLocalPointerDependencies() {
+  std::vector<LastUseKey> Uses;
+  Uses.reserve(NonLocalPointerDeps.size());
+  for (CachedNonLocalPointerInfo::iterator I = NonLocalPointerDeps.begin(),
+       E = NonLocalPointerDeps.end(); I != E; ++I)
+    Uses.push_back(std::make_pair(I->second.LastUse, I->first));
+
+  unsigned NumToEvict = Uses.size() - NonLocalCacheLimit / 2;
+  std::nth_element(Uses.begin(), Uses.begin() + NumToEvict, Uses.end(),
+                   LastUseLess());
+  for (unsigned i = 0; i != NumToEvict; ++i)
+    RemoveCachedNonLocalPointerDependencies(Uses[i].second);
+  NumEvictedNonLocalPtr += NumToEvict;
 }
 
 /// GetNonLocalInfoForBlock - Compute the memdep value for BB with
@@ -912,6 +1170,7 @@ getNonLocalPointerDepFromBB(const PHITransAddr &Pointer,
   std::pair<CachedNonLocalPointerInfo::iterator, bool> Pair = 
     NonLocalPointerDeps.insert(std::make_pair(CacheKey, InitialNLPI));
   NonLocalPointerInfo *CacheInfo = &Pair.first->second;
+  CacheInfo->LastUse = NumNonLocalPtrQueries;
 
   // If we already have a cache entry for this CacheKey, we may need to do some
   // work to reconcile the cache entry and the current query.
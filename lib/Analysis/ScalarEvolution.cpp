@@ -98,6 +98,24 @@ STATISTIC(NumTripCountsNotComputed,
           "Number of loops without predictable loop counts");
 STATISTIC(NumBruteForceTripCountsComputed,
           "Number of loops with trip counts computed by force");
+STATISTIC(NumValueExprHits, "Number of getSCEV queries answered from cache");
+STATISTIC(NumValueExprMisses, "Number of getSCEV queries not in cache");
+STATISTIC(NumBackedgeTakenHits,
+          "Number of backedge-taken count queries answered from cache");
+STATISTIC(NumBackedgeTakenMisses,
+          "Number of backedge-taken count queries not in cache");
+STATISTIC(NumValuesAtScopeHits,
+          "Number of getSCEVAtScope queries answered from cache");
+STATISTIC(NumValuesAtScopeMisses,
+          "Number of getSCEVAtScope queries not in cache");
+STATISTIC(NumRangeHits, "Number of range queries answered from cache");
+STATISTIC(NumRangeMisses, "Number of range queries not in cache");
+STATISTIC(NumDispositionHits,
+          "Number of loop and block disposition queries answered from cache");
+STATISTIC(NumDispositionMisses,
+          "Number of loop and block disposition queries not in cache");
+STATISTIC(NumLoopsReleased,
+          "Number of loops whose cached results were released");
 
 static cl::opt<unsigned>
 MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
@@ -272,6 +290,51 @@ Type *SCEV::getType() const {
   }
 }
 
+void SCEV::Profile(FoldingSetNodeID &ID) const {
+  // This must match the IDs built by the ScalarEvolution::get* methods which
+  // look up and create the nodes.
+  ID.AddInteger(getSCEVType());
+  switch (getSCEVType()) {
+  case scConstant:
+    ID.AddPointer(cast<SCEVConstant>(this)->getValue());
+    return;
+  case scTruncate:
+  case scZeroExtend:
+  case scSignExtend: {
+    const SCEVCastExpr *Cast = cast<SCEVCastExpr>(this);
+    ID.AddPointer(Cast->getOperand());
+    ID.AddPointer(Cast->getType());
+    return;
+  }
+  case scAddExpr:
+  case scMulExpr:
+  case scUMaxExpr:
+  case scSMaxExpr:
+  case scAddRecExpr: {
+    const SCEVNAryExpr *NAry = cast<SCEVNAryExpr>(this);
+    for (SCEVNAryExpr::op_iterator I = NAry->op_begin(), E = NAry->op_end();
+         I != E; ++I)
+      ID.AddPointer(*I);
+    if (const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(this))
+      ID.AddPointer(AR->getLoop());
+    return;
+  }
+  case scUDivExpr: {
+    const SCEVUDivExpr *UDiv = cast<SCEVUDivExpr>(this);
+    ID.AddPointer(UDiv->getLHS());
+    ID.AddPointer(UDiv->getRHS());
+    return;
+  }
+  case scUnknown:
+    ID.AddPointer(cast<SCEVUnknown>(this)->getValue());
+    return;
+  case scCouldNotCompute:
+    llvm_unreachable("Attempt to use a SCEVCouldNotCompute object!");
+  default:
+    llvm_unreachable("Unknown SCEV kind!");
+  }
+}
+
 bool SCEV::isZero() const {
   if (const SCEVConstant *SC = dyn_cast<SCEVConstant>(this))
     return SC->getValue()->isZero();
@@ -305,7 +368,7 @@ bool SCEV::isNonConstantNegative() const {
 }
 
 SCEVCouldNotCompute::SCEVCouldNotCompute() :
-  SCEV(FoldingSetNodeIDRef(), scCouldNotCompute) {}
+  SCEV(scCouldNotCompute) {}
 
 bool SCEVCouldNotCompute::classof(const SCEV *S) {
   return S->getSCEVType() == scCouldNotCompute;
@@ -317,7 +380,7 @@ const SCEV *ScalarEvolution::getConstant(ConstantInt *V) {
   ID.AddPointer(V);
   void *IP = 0;
   if (const SCEV *S = UniqueSCEVs.FindNodeOrInsertPos(ID, IP)) return S;
-  SCEV *S = new (SCEVAllocator) SCEVConstant(ID.Intern(SCEVAllocator), V);
+  SCEV *S = new (SCEVAllocator) SCEVConstant(V);
   UniqueSCEVs.InsertNode(S, IP);
   return S;
 }
@@ -332,29 +395,25 @@ ScalarEvolution::getConstant(Type *Ty, uint64_t V, bool isSigned) {
   return getConstant(ConstantInt::get(ITy, V, isSigned));
 }
 
-SCEVCastExpr::SCEVCastExpr(const FoldingSetNodeIDRef ID,
-                           unsigned SCEVTy, const SCEV *op, Type *ty)
-  : SCEV(ID, SCEVTy), Op(op), Ty(ty) {}
+SCEVCastExpr::SCEVCastExpr(unsigned SCEVTy, const SCEV *op, Type *ty)
+  : SCEV(SCEVTy), Op(op), Ty(ty) {}
 
-SCEVTruncateExpr::SCEVTruncateExpr(const FoldingSetNodeIDRef ID,
-                                   const SCEV *op, Type *ty)
-  : SCEVCastExpr(ID, scTruncate, op, ty) {
+SCEVTruncateExpr::SCEVTruncateExpr(const SCEV *op, Type *ty)
+  : SCEVCastExpr(scTruncate, op, ty) {
   assert((Op->getType()->isIntegerTy() || Op->getType()->isPointerTy()) &&
          (Ty->isIntegerTy() || Ty->isPointerTy()) &&
          "Cannot truncate non-integer value!");
 }
 
-SCEVZeroExtendExpr::SCEVZeroExtendExpr(const FoldingSetNodeIDRef ID,
-                                       const SCEV *op, Type *ty)
-  : SCEVCastExpr(ID, scZeroExtend, op, ty) {
+SCEVZeroExtendExpr::SCEVZeroExtendExpr(const SCEV *op, Type *ty)
+  : SCEVCastExpr(scZeroExtend, op, ty) {
   assert((Op->getType()->isIntegerTy() || Op->getType()->isPointerTy()) &&
          (Ty->isIntegerTy() || Ty->isPointerTy()) &&
          "Cannot zero extend non-integer value!");
 }
 
-SCEVSignExtendExpr::SCEVSignExtendExpr(const FoldingSetNodeIDRef ID,
-                                       const SCEV *op, Type *ty)
-  : SCEVCastExpr(ID, scSignExtend, op, ty) {
+SCEVSignExtendExpr::SCEVSignExtendExpr(const SCEV *op, Type *ty)
+  : SCEVCastExpr(scSignExtend, op, ty) {
   assert((Op->getType()->isIntegerTy() || Op->getType()->isPointerTy()) &&
          (Ty->isIntegerTy() || Ty->isPointerTy()) &&
          "Cannot sign extend non-integer value!");
@@ -889,8 +948,7 @@ const SCEV *ScalarEvolution::getTruncateExpr(const SCEV *Op,
   // The cast wasn't folded; create an explicit cast node. We can reuse
   // the existing insert position since if we get here, we won't have
   // made any changes which would invalidate it.
-  SCEV *S = new (SCEVAllocator) SCEVTruncateExpr(ID.Intern(SCEVAllocator),
-                                                 Op, Ty);
+  SCEV *S = new (SCEVAllocator) SCEVTruncateExpr(Op, Ty);
   UniqueSCEVs.InsertNode(S, IP);
   return S;
 }
@@ -1048,8 +1106,7 @@ const SCEV *ScalarEvolution::getZeroExtendExpr(const SCEV *Op,
   // The cast wasn't folded; create an explicit cast node.
   // Recompute the insert position, as it may have been invalidated.
   if (const SCEV *S = UniqueSCEVs.FindNodeOrInsertPos(ID, IP)) return S;
-  SCEV *S = new (SCEVAllocator) SCEVZeroExtendExpr(ID.Intern(SCEVAllocator),
-                                                   Op, Ty);
+  SCEV *S = new (SCEVAllocator) SCEVZeroExtendExpr(Op, Ty);
   UniqueSCEVs.InsertNode(S, IP);
   return S;
 }
@@ -1296,8 +1353,7 @@ const SCEV *ScalarEvolution::getSignExtendExpr(const SCEV *Op,
   // The cast wasn't folded; create an explicit cast node.
   // Recompute the insert position, as it may have been invalidated.
   if (const SCEV *S = UniqueSCEVs.FindNodeOrInsertPos(ID, IP)) return S;
-  SCEV *S = new (SCEVAllocator) SCEVSignExtendExpr(ID.Intern(SCEVAllocator),
-                                                   Op, Ty);
+  SCEV *S = new (SCEVAllocator) SCEVSignExtendExpr(Op, Ty);
   UniqueSCEVs.InsertNode(S, IP);
   return S;
 }
@@ -1816,8 +1872,7 @@ const SCEV *ScalarEvolution::getAddExpr(SmallVectorImpl<const SCEV *> &Ops,
   if (!S) {
     const SCEV **O = SCEVAllocator.Allocate<const SCEV *>(Ops.size());
     std::uninitialized_copy(Ops.begin(), Ops.end(), O);
-    S = new (SCEVAllocator) SCEVAddExpr(ID.Intern(SCEVAllocator),
-                                        O, Ops.size());
+    S = new (SCEVAllocator) SCEVAddExpr(O, Ops.size());
     UniqueSCEVs.InsertNode(S, IP);
   }
   S->setNoWrapFlags(Flags);
@@ -2110,8 +2165,7 @@ const SCEV *ScalarEvolution::getMulExpr(SmallVectorImpl<const SCEV *> &Ops,
   if (!S) {
     const SCEV **O = SCEVAllocator.Allocate<const SCEV *>(Ops.size());
     std::uninitialized_copy(Ops.begin(), Ops.end(), O);
-    S = new (SCEVAllocator) SCEVMulExpr(ID.Intern(SCEVAllocator),
-                                        O, Ops.size());
+    S = new (SCEVAllocator) SCEVMulExpr(O, Ops.size());
     UniqueSCEVs.InsertNode(S, IP);
   }
   S->setNoWrapFlags(Flags);
@@ -2231,8 +2285,7 @@ const SCEV *ScalarEvolution::getUDivExpr(const SCEV *LHS,
   ID.AddPointer(RHS);
   void *IP = 0;
   if (const SCEV *S = UniqueSCEVs.FindNodeOrInsertPos(ID, IP)) return S;
-  SCEV *S = new (SCEVAllocator) SCEVUDivExpr(ID.Intern(SCEVAllocator),
-                                             LHS, RHS);
+  SCEV *S = new (SCEVAllocator) SCEVUDivExpr(LHS, RHS);
   UniqueSCEVs.InsertNode(S, IP);
   return S;
 }
@@ -2359,8 +2412,7 @@ ScalarEvolution::getAddRecExpr(SmallVectorImpl<const SCEV *> &Operands,
   if (!S) {
     const SCEV **O = SCEVAllocator.Allocate<const SCEV *>(Operands.size());
     std::uninitialized_copy(Operands.begin(), Operands.end(), O);
-    S = new (SCEVAllocator) SCEVAddRecExpr(ID.Intern(SCEVAllocator),
-                                           O, Operands.size(), L);
+    S = new (SCEVAllocator) SCEVAddRecExpr(O, Operands.size(), L);
     UniqueSCEVs.InsertNode(S, IP);
   }
   S->setNoWrapFlags(Flags);
@@ -2465,8 +2517,7 @@ ScalarEvolution::getSMaxExpr(SmallVectorImpl<const SCEV *> &Ops) {
   if (const SCEV *S = UniqueSCEVs.FindNodeOrInsertPos(ID, IP)) return S;
   const SCEV **O = SCEVAllocator.Allocate<const SCEV *>(Ops.size());
   std::uninitialized_copy(Ops.begin(), Ops.end(), O);
-  SCEV *S = new (SCEVAllocator) SCEVSMaxExpr(ID.Intern(SCEVAllocator),
-                                             O, Ops.size());
+  SCEV *S = new (SCEVAllocator) SCEVSMaxExpr(O, Ops.size());
   UniqueSCEVs.InsertNode(S, IP);
   return S;
 }
@@ -2569,8 +2620,7 @@ ScalarEvolution::getUMaxExpr(SmallVectorImpl<const SCEV *> &Ops) {
   if (const SCEV *S = UniqueSCEVs.FindNodeOrInsertPos(ID, IP)) return S;
   const SCEV **O = SCEVAllocator.Allocate<const SCEV *>(Ops.size());
   std::uninitialized_copy(Ops.begin(), Ops.end(), O);
-  SCEV *S = new (SCEVAllocator) SCEVUMaxExpr(ID.Intern(SCEVAllocator),
-                                             O, Ops.size());
+  SCEV *S = new (SCEVAllocator) SCEVUMaxExpr(O, Ops.size());
   UniqueSCEVs.InsertNode(S, IP);
   return S;
 }
@@ -2654,8 +2704,7 @@ const SCEV *ScalarEvolution::getUnknown(Value *V) {
            "Stale SCEVUnknown in uniquing map!");
     return S;
   }
-  SCEV *S = new (SCEVAllocator) SCEVUnknown(ID.Intern(SCEVAllocator), V, this,
-                                            FirstUnknown);
+  SCEV *S = new (SCEVAllocator) SCEVUnknown(V, this, FirstUnknown);
   FirstUnknown = cast<SCEVUnknown>(S);
   UniqueSCEVs.InsertNode(S, IP);
   return S;
@@ -2721,7 +2770,11 @@ const SCEV *ScalarEvolution::getSCEV(Value *V) {
   assert(isSCEVable(V->getType()) && "Value is not SCEVable!");
 
   ValueExprMapType::const_iterator I = ValueExprMap.find_as(V);
-  if (I != ValueExprMap.end()) return I->second;
+  if (I != ValueExprMap.end()) {
+    ++NumValueExprHits;
+    return I->second;
+  }
+  ++NumValueExprMisses;
   const SCEV *S = createSCEV(V);
 
   // The process of creating a SCEV for V may have caused other SCEVs
@@ -3273,8 +3326,11 @@ ConstantRange
 ScalarEvolution::getUnsignedRange(const SCEV *S) {
   // See if we've computed this range already.
   DenseMap<const SCEV *, ConstantRange>::iterator I = UnsignedRanges.find(S);
-  if (I != UnsignedRanges.end())
+  if (I != UnsignedRanges.end()) {
+    ++NumRangeHits;
     return I->second;
+  }
+  ++NumRangeMisses;
 
   if (const SCEVConstant *C = dyn_cast<SCEVConstant>(S))
     return setUnsignedRange(C, ConstantRange(C->getValue()->getValue()));
@@ -3414,8 +3470,11 @@ ConstantRange
 ScalarEvolution::getSignedRange(const SCEV *S) {
   // See if we've computed this range already.
   DenseMap<const SCEV *, ConstantRange>::iterator I = SignedRanges.find(S);
-  if (I != SignedRanges.end())
+  if (I != SignedRanges.end()) {
+    ++NumRangeHits;
     return I->second;
+  }
+  ++NumRangeMisses;
 
   if (const SCEVConstant *C = dyn_cast<SCEVConstant>(S))
     return setSignedRange(C, ConstantRange(C->getValue()->getValue()));
@@ -4046,8 +4105,11 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
   // backedge-taken count, which could result in infinite recursion.
   std::pair<DenseMap<const Loop *, BackedgeTakenInfo>::iterator, bool> Pair =
     BackedgeTakenCounts.insert(std::make_pair(L, BackedgeTakenInfo()));
-  if (!Pair.second)
+  if (!Pair.second) {
+    ++NumBackedgeTakenHits;
     return Pair.first->second;
+  }
+  ++NumBackedgeTakenMisses;
 
   // ComputeBackedgeTakenCount may allocate memory for its result. Inserting it
   // into the BackedgeTakenCounts map transfers ownership. Otherwise, the result
@@ -4179,6 +4241,160 @@ void ScalarEvolution::forgetValue(Value *V) {
   }
 }
 
+namespace {
+/// LoopNestRefs - Answers whether expressions and scopes refer to a given
+/// loop nest, memoizing the answer for each expression it was asked about.
+/// The memoized results may mention loops which have been deleted since, so
+/// loops are only compared by address.
+class LoopNestRefs {
+  SmallPtrSet<const Loop *, 8> Loops;
+  SmallPtrSet<const BasicBlock *, 32> Blocks;
+  DenseMap<const SCEV *, bool> Mentions;
+
+  /// FindNestUse - Search an expression for an addrec of a loop in the nest
+  /// or for a value defined inside it. Implements SCEVTraversal::Visitor.
+  struct FindNestUse {
+    const LoopNestRefs &Refs;
+    bool Found;
+
+    FindNestUse(const LoopNestRefs &R) : Refs(R), Found(false) {}
+
+    bool follow(const SCEV *S) {
+      if (const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(S))
+        Found |= Refs.contains(AR->getLoop());
+      else if (const SCEVUnknown *U = dyn_cast<SCEVUnknown>(S))
+        if (Instruction *I = dyn_cast_or_null<Instruction>(U->getValue()))
+          Found |= Refs.contains(I->getParent());
+      return !Found;
+    }
+    bool isDone() const { return Found; }
+  };
+
+public:
+  explicit LoopNestRefs(const Loop *L)
+    : Blocks(L->block_begin(), L->block_end()) {
+    SmallVector<const Loop *, 8> Worklist;
+    Worklist.push_back(L);
+    while (!Worklist.empty()) {
+      const Loop *CurL = Worklist.pop_back_val();
+      Loops.insert(CurL);
+      Worklist.append(CurL->begin(), CurL->end());
+    }
+  }
+
+  bool contains(const BasicBlock *BB) const { return Blocks.count(BB); }
+  bool contains(const Loop *L) const { return Loops.count(L); }
+
+  typedef SmallPtrSet<const Loop *, 8>::const_iterator loop_iterator;
+  loop_iterator loop_begin() const { return Loops.begin(); }
+  loop_iterator loop_end() const { return Loops.end(); }
+
+  /// mentions - Test whether S refers to the loop nest.
+  bool mentions(const SCEV *S) {
+    if (isa<SCEVCouldNotCompute>(S))
+      return false;
+    std::pair<DenseMap<const SCEV *, bool>::iterator, bool> Pair =
+      Mentions.insert(std::make_pair(S, false));
+    if (!Pair.second)
+      return Pair.first->second;
+    FindNestUse Search(*this);
+    visitAll(S, Search);
+    return Mentions[S] = Search.Found;
+  }
+};
+}
+
+/// releaseScopes - Drop the memoized results of one expression which were
+/// computed for a scope in the loop nest.
+template<typename ScopeT, typename ResultT>
+static void releaseScopes(SmallVectorImpl<std::pair<ScopeT, ResultT> > &Values,
+                          LoopNestRefs &Refs) {
+  for (unsigned i = 0; i != Values.size(); )
+    if (Refs.contains(Values[i].first)) {
+      Values[i] = Values.back();
+      Values.pop_back();
+    } else {
+      ++i;
+    }
+}
+
+template<typename ScopeT, typename ResultT, unsigned N>
+static void releaseScopes(SmallDenseMap<ScopeT, ResultT, N> &Values,
+                          LoopNestRefs &Refs) {
+  typedef SmallDenseMap<ScopeT, ResultT, N> MapType;
+  for (typename MapType::iterator I = Values.begin(), E = Values.end(); I != E;
+       ++I)
+    if (Refs.contains(I->first))
+      Values.erase(I);
+}
+
+/// releaseScopedResults - Drop the entries of one of the per-expression maps
+/// of memoized results which refer to the loop nest, either through their
+/// expression or through the scope they were computed for.
+template<typename MapType>
+static void releaseScopedResults(MapType &Map, LoopNestRefs &Refs) {
+  for (typename MapType::iterator I = Map.begin(), E = Map.end(); I != E; ++I) {
+    if (!Refs.mentions(I->first)) {
+      releaseScopes(I->second, Refs);
+      if (!I->second.empty())
+        continue;
+    }
+    Map.erase(I);
+  }
+}
+
+/// releaseRanges - Drop the memoized ranges of expressions which refer to
+/// the loop nest.
+static void releaseRanges(DenseMap<const SCEV *, ConstantRange> &Map,
+                          LoopNestRefs &Refs) {
+  for (DenseMap<const SCEV *, ConstantRange>::iterator I = Map.begin(),
+       E = Map.end(); I != E; ++I)
+    if (Refs.mentions(I->first))
+      Map.erase(I);
+}
+
+/// releaseLoopMemory - This method may be called by the client when it is
+/// done with a loop nest, to drop the trip counts, expressions and other
+/// cached results for the loop and its subloops. Unlike forgetLoop this does
+/// not mean that anything changed; dropped results are simply recomputed if
+/// they are needed again.
+void ScalarEvolution::releaseLoopMemory(const Loop *L) {
+  LoopNestRefs Refs(L);
+
+  // Drop the trip counts of the loops in the nest.
+  for (LoopNestRefs::loop_iterator I = Refs.loop_begin(), E = Refs.loop_end();
+       I != E; ++I) {
+    DenseMap<const Loop*, BackedgeTakenInfo>::iterator BTCPos =
+      BackedgeTakenCounts.find(*I);
+    if (BTCPos != BackedgeTakenCounts.end()) {
+      BTCPos->second.clear();
+      BackedgeTakenCounts.erase(BTCPos);
+    }
+    ++NumLoopsReleased;
+  }
+
+  // Drop the expressions of the values defined inside the nest. The nodes
+  // themselves stay in UniqueSCEVs, since other expressions may use them.
+  for (Loop::block_iterator BI = L->block_begin(), BE = L->block_end();
+       BI != BE; ++BI)
+    for (BasicBlock::iterator I = (*BI)->begin(), E = (*BI)->end();
+         I != E; ++I) {
+      ValueExprMapType::iterator It =
+        ValueExprMap.find_as(static_cast<Value *>(I));
+      if (It != ValueExprMap.end())
+        ValueExprMap.erase(It);
+      if (PHINode *PN = dyn_cast<PHINode>(I))
+        ConstantEvolutionLoopExitValue.erase(PN);
+    }
+
+  // Drop everything that was computed for, or in terms of, the nest.
+  releaseScopedResults(ValuesAtScopes, Refs);
+  releaseScopedResults(LoopDispositions, Refs);
+  releaseScopedResults(BlockDispositions, Refs);
+  releaseRanges(UnsignedRanges, Refs);
+  releaseRanges(SignedRanges, Refs);
+}
+
 /// getExact - Get the exact loop backedge taken count considering all loop
 /// exits. A computable result can only be return for loops with a single exit.
 /// Returning the minimum taken count among all exits is incorrect because one
@@ -4977,6 +5193,22 @@ const SCEV *ScalarEvolution::ComputeExitCountExhaustively(const Loop *L,
   return getCouldNotCompute();
 }
 
+/// setMemoizedResult - Store Result for Key in one of the per-expression
+/// vectors of memoized results, replacing the placeholder entry which was
+/// added before the result was computed.
+template<typename KeyT, typename ResultT>
+static void
+setMemoizedResult(SmallVectorImpl<std::pair<KeyT, ResultT> > &Values,
+                  KeyT Key, ResultT Result) {
+  for (unsigned i = Values.size(); i != 0; --i)
+    if (Values[i - 1].first == Key) {
+      Values[i - 1].second = Result;
+      return;
+    }
+  // The placeholder was dropped by forgetMemoizedResults in the meantime.
+  Values.push_back(std::make_pair(Key, Result));
+}
+
 /// getSCEVAtScope - Return a SCEV expression for the specified value
 /// at the specified scope in the program.  The L value specifies a loop
 /// nest to evaluate the expression at, where null is the top-level or a
@@ -4989,15 +5221,20 @@ const SCEV *ScalarEvolution::ComputeExitCountExhaustively(const Loop *L,
 /// original value V is returned.
 const SCEV *ScalarEvolution::getSCEVAtScope(const SCEV *V, const Loop *L) {
   // Check to see if we've folded this expression at this loop before.
-  std::map<const Loop *, const SCEV *> &Values = ValuesAtScopes[V];
-  std::pair<std::map<const Loop *, const SCEV *>::iterator, bool> Pair =
-    Values.insert(std::make_pair(L, static_cast<const SCEV *>(0)));
-  if (!Pair.second)
-    return Pair.first->second ? Pair.first->second : V;
+  SmallVectorImpl<std::pair<const Loop *, const SCEV *> > &Values =
+    ValuesAtScopes[V];
+  for (unsigned i = 0, e = Values.size(); i != e; ++i)
+    if (Values[i].first == L) {
+      ++NumValuesAtScopeHits;
+      return Values[i].second ? Values[i].second : V;
+    }
+  ++NumValuesAtScopeMisses;
+  Values.push_back(std::make_pair(L, static_cast<const SCEV *>(0)));
 
-  // Otherwise compute it.
+  // Otherwise compute it. This may have added entries to ValuesAtScopes, so
+  // look the placeholder up again.
   const SCEV *C = computeSCEVAtScope(V, L);
-  ValuesAtScopes[V][L] = C;
+  setMemoizedResult(ValuesAtScopes[V], L, C);
   return C;
 }
 
@@ -6730,14 +6967,19 @@ void ScalarEvolution::print(raw_ostream &OS, const Module *) const {
 
 ScalarEvolution::LoopDisposition
 ScalarEvolution::getLoopDisposition(const SCEV *S, const Loop *L) {
-  std::map<const Loop *, LoopDisposition> &Values = LoopDispositions[S];
-  std::pair<std::map<const Loop *, LoopDisposition>::iterator, bool> Pair =
-    Values.insert(std::make_pair(L, LoopVariant));
-  if (!Pair.second)
-    return Pair.first->second;
+  SmallVectorImpl<std::pair<const Loop *, LoopDisposition> > &Values =
+    LoopDispositions[S];
+  for (unsigned i = 0, e = Values.size(); i != e; ++i)
+    if (Values[i].first == L) {
+      ++NumDispositionHits;
+      return Values[i].second;
+    }
+  ++NumDispositionMisses;
+  Values.push_back(std::make_pair(L, LoopVariant));
 
   LoopDisposition D = computeLoopDisposition(S, L);
-  return LoopDispositions[S][L] = D;
+  setMemoizedResult(LoopDispositions[S], L, D);
+  return D;
 }
 
 ScalarEvolution::LoopDisposition
@@ -6829,14 +7071,19 @@ bool ScalarEvolution::hasComputableLoopEvolution(const SCEV *S, const Loop *L) {
 
 ScalarEvolution::BlockDisposition
 ScalarEvolution::getBlockDisposition(const SCEV *S, const BasicBlock *BB) {
-  std::map<const BasicBlock *, BlockDisposition> &Values = BlockDispositions[S];
-  std::pair<std::map<const BasicBlock *, BlockDisposition>::iterator, bool>
-    Pair = Values.insert(std::make_pair(BB, DoesNotDominateBlock));
-  if (!Pair.second)
+  std::pair<SmallDenseMap<const BasicBlock *, BlockDisposition, 4>::iterator,
+            bool> Pair =
+    BlockDispositions[S].insert(std::make_pair(BB, DoesNotDominateBlock));
+  if (!Pair.second) {
+    ++NumDispositionHits;
     return Pair.first->second;
+  }
+  ++NumDispositionMisses;
 
+  // Computing D may add entries, or drop the placeholder, so look it up again.
   BlockDisposition D = computeBlockDisposition(S, BB);
-  return BlockDispositions[S][BB] = D;
+  BlockDispositions[S][BB] = D;
+  return D;
 }
 
 ScalarEvolution::BlockDisposition
@@ -818,9 +818,15 @@ bool BitcodeReader::ParseMetadata() {
     }
 
     bool IsFunctionLocal = false;
-    // Read a record.
+    // Read a record.  Strings may be stored as blobs, which are referenced in
+    // place unless the bitcode is streamed.
     Record.clear();
-    Code = Stream.ReadRecord(Code, Record);
+    const char *BlobStart = 0;
+    unsigned BlobLen = 0;
+    if (LazyStreamer)
+      Code = Stream.ReadRecord(Code, Record);
+    else
+      Code = Stream.ReadRecord(Code, Record, BlobStart, BlobLen);
     switch (Code) {
     default:  // Default behavior: ignore.
       break;
@@ -870,8 +876,15 @@ bool BitcodeReader::ParseMetadata() {
       break;
     }
     case bitc::METADATA_STRING: {
-      SmallString<8> String(Record.begin(), Record.end());
-      Value *V = MDString::get(Context, String);
+      // MDString::get doesn't copy blobs living in a buffer that is owned by
+      // the context, see ParseMappedBitcodeFile.
+      Value *V;
+      if (BlobStart) {
+        V = MDString::get(Context, StringRef(BlobStart, BlobLen));
+      } else {
+        SmallString<8> String(Record.begin(), Record.end());
+        V = MDString::get(Context, String);
+      }
       MDValueList.AssignValue(V, NextMDValueNo++);
       break;
     }
@@ -978,7 +991,13 @@ bool BitcodeReader::ParseConstants() {
     // Read a record.
     Record.clear();
     Value *V = 0;
-    unsigned BitCode = Stream.ReadRecord(Code, Record);
+    const char *BlobStart = 0;
+    unsigned BlobLen = 0;
+    unsigned BitCode;
+    if (LazyStreamer)
+      BitCode = Stream.ReadRecord(Code, Record);
+    else
+      BitCode = Stream.ReadRecord(Code, Record, BlobStart, BlobLen);
     switch (BitCode) {
     default:  // Default behavior: unknown constant
     case bitc::CST_CODE_UNDEF:     // UNDEF
@@ -1062,6 +1081,15 @@ bool BitcodeReader::ParseConstants() {
     }
     case bitc::CST_CODE_STRING:    // STRING: [values]
     case bitc::CST_CODE_CSTRING: { // CSTRING: [values]
+      if (BlobStart && BitCode == bitc::CST_CODE_STRING) {
+        // Like MDStrings, blobs in a buffer owned by the context aren't
+        // copied.
+        if (BlobLen == 0)
+          return Error("Invalid CST_STRING record");
+        V = ConstantDataArray::getString(Context, StringRef(BlobStart, BlobLen),
+                                         false);
+        break;
+      }
       if (Record.empty())
         return Error("Invalid CST_STRING record");
 
@@ -1411,6 +1439,49 @@ bool BitcodeReader::RememberAndSkipFunctionBody() {
   return false;
 }
 
+/// ParseFunctionIndex - Read the offsets of a MODULE_CODE_FNINDEX record.
+bool BitcodeReader::ParseFunctionIndex(const char *BlobStart,
+                                       unsigned BlobLen) {
+  if (BlobLen < 8 || BlobLen % 8 != 0)
+    return Error("Invalid MODULE_CODE_FNINDEX record");
+
+  FunctionIndex.clear();
+  const unsigned char *Bytes = (const unsigned char*)BlobStart;
+  for (unsigned i = 0; i != BlobLen; i += 8) {
+    uint64_t Offset = 0;
+    for (unsigned Byte = 0; Byte != 8; ++Byte)
+      Offset |= uint64_t(Bytes[i + Byte]) << (Byte * 8);
+    if (!Stream.canSkipToPos(Offset / 8))
+      return Error("Invalid MODULE_CODE_FNINDEX record");
+    FunctionIndex.push_back(Offset);
+  }
+  return false;
+}
+
+/// RememberFunctionBodiesFromIndex - When we see the block for the first
+/// function body and the module has a function index, remember where every
+/// function body is and jump to the end of the module block, instead of
+/// skipping the bodies one at a time.
+bool BitcodeReader::RememberFunctionBodiesFromIndex() {
+  unsigned NumBodies = FunctionsWithBodies.size();
+  if (FunctionIndex.size() != NumBodies + 1)
+    return Error("Function index doesn't match the function bodies");
+
+  // The index points at the ENTER_SUBBLOCK of each body, but materialization
+  // resumes after the block ID, which takes a single vbr8 chunk.
+  unsigned HeaderBits = Stream.GetAbbrevIDWidth() + 8;
+
+  // FunctionsWithBodies has been reversed, so the first body is at the back.
+  for (unsigned i = 0; i != NumBodies; ++i)
+    DeferredFunctionInfo[FunctionsWithBodies[NumBodies - 1 - i]] =
+      FunctionIndex[i + 1] + HeaderBits;
+  FunctionsWithBodies.clear();
+
+  // Continue with the END_BLOCK of the module.
+  Stream.JumpToBit(FunctionIndex[0]);
+  return false;
+}
+
 bool BitcodeReader::GlobalCleanup() {
   // Patch the initializers for globals and aliases up.
   ResolveGlobalAndAliasInits();
@@ -1496,6 +1567,12 @@ bool BitcodeReader::ParseModule(bool Resume) {
           if (GlobalCleanup())
             return true;
           SeenFirstFunctionBody = true;
+
+          if (!FunctionIndex.empty()) {
+            if (RememberFunctionBodiesFromIndex())
+              return true;
+            break;
+          }
         }
 
         if (RememberAndSkipFunctionBody())
@@ -1524,9 +1601,21 @@ bool BitcodeReader::ParseModule(bool Resume) {
       continue;
     }
 
-    // Read a record.
-    switch (Stream.ReadRecord(Code, Record)) {
+    // Read a record.  The function index is a blob, which is only used if
+    // the bitcode isn't streamed.
+    const char *BlobStart = 0;
+    unsigned BlobLen = 0;
+    unsigned BitCode;
+    if (LazyStreamer)
+      BitCode = Stream.ReadRecord(Code, Record);
+    else
+      BitCode = Stream.ReadRecord(Code, Record, BlobStart, BlobLen);
+    switch (BitCode) {
     default: break;  // Default behavior, ignore unknown content.
+    case bitc::MODULE_CODE_FNINDEX:
+      if (BlobStart && ParseFunctionIndex(BlobStart, BlobLen))
+        return true;
+      break;
     case bitc::MODULE_CODE_VERSION: {  // VERSION: [version#]
       if (Record.size() < 1)
         return Error("Malformed MODULE_CODE_VERSION");
@@ -3025,6 +3114,15 @@ Module *llvm::ParseBitcodeFile(MemoryBuffer *Buffer, LLVMContext& Context,
   return M;
 }
 
+/// ParseMappedBitcodeFile - Read the specified bitcode file, handing the
+/// buffer over to the context so that the module may refer to it.
+Module *llvm::ParseMappedBitcodeFile(MemoryBuffer *Buffer,
+                                     LLVMContext &Context,
+                                     std::string *ErrMsg) {
+  Context.adoptMemoryBuffer(Buffer);
+  return ParseBitcodeFile(Buffer, Context, ErrMsg);
+}
+
 std::string llvm::getBitcodeTargetTriple(MemoryBuffer *Buffer,
                                          LLVMContext& Context,
                                          std::string *ErrMsg) {
@@ -174,6 +174,11 @@ class BitcodeReader : public GVMaterializer {
   /// stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
 
+  /// FunctionIndex - The offsets from the MODULE_CODE_FNINDEX record, if the
+  /// module has one and isn't streamed.  Entry 0 is the end of the function
+  /// bodies, followed by the function bodies.
+  SmallVector<uint64_t, 64> FunctionIndex;
+
   /// BlockAddrFwdRefs - These are blockaddr references to basic blocks.  These
   /// are resolved lazily when functions are loaded.
   typedef std::pair<unsigned, GlobalVariable*> BlockAddrRefTy;
@@ -326,6 +331,8 @@ private:
   bool ParseValueSymbolTable();
   bool ParseConstants();
   bool RememberAndSkipFunctionBody();
+  bool ParseFunctionIndex(const char *BlobStart, unsigned BlobLen);
+  bool RememberFunctionBodiesFromIndex();
   bool ParseFunctionBody(Function *F);
   bool GlobalCleanup();
   bool ResolveGlobalAndAliasInits();
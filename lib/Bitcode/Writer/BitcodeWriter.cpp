@@ -38,6 +38,12 @@ EnablePreserveUseListOrdering("enable-bc-uselist-preserve",
                                        "use-list order preservation."),
                               cl::init(false), cl::Hidden);
 
+static cl::opt<bool>
+EmitFunctionIndex("bitcode-function-index",
+                  cl::desc("Emit an index of the function bodies that lets "
+                           "readers find them without scanning the module"),
+                  cl::init(true), cl::Hidden);
+
 /// These are manifest constants used by the bitcode writer. They do not need to
 /// be kept in sync with the reader, but need to be consistent within this file.
 enum {
@@ -605,21 +611,23 @@ static void WriteModuleMetadata(const Module *M,
     } else if (const MDString *MDS = dyn_cast<MDString>(Vals[i].first)) {
       if (!StartedMetadataBlock)  {
         Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
+        StartedMetadataBlock = true;
+      }
 
-        // Abbrev for METADATA_STRING.
+      // The block may have been started by an MDNode, so the abbreviation is
+      // emitted along with the first string.
+      if (!MDSAbbrev) {
+        // Abbrev for METADATA_STRING.  Use a blob so that the reader can
+        // refer to the string in place.
         BitCodeAbbrev *Abbv = new BitCodeAbbrev();
         Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_STRING));
-        Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
-        Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 8));
+        Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob));
         MDSAbbrev = Stream.EmitAbbrev(Abbv);
-        StartedMetadataBlock = true;
       }
 
       // Code: [strchar x N]
-      Record.append(MDS->begin(), MDS->end());
-
-      // Emit the finished record.
-      Stream.EmitRecord(bitc::METADATA_STRING, Record, MDSAbbrev);
+      Record.push_back(bitc::METADATA_STRING);
+      Stream.EmitRecordWithBlob(MDSAbbrev, Record, MDS->getString());
       Record.clear();
     }
   }
@@ -783,11 +791,11 @@ static void WriteConstants(unsigned FirstVal, unsigned LastVal,
     Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, Log2_32_Ceil(LastVal+1)));
     AggregateAbbrev = Stream.EmitAbbrev(Abbv);
 
-    // Abbrev for CST_CODE_STRING.
+    // Abbrev for CST_CODE_STRING.  Use a blob so that the reader can refer to
+    // the string in place.
     Abbv = new BitCodeAbbrev();
     Abbv->Add(BitCodeAbbrevOp(bitc::CST_CODE_STRING));
-    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
-    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 8));
+    Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob));
     String8Abbrev = Stream.EmitAbbrev(Abbv);
     // Abbrev for CST_CODE_CSTRING.
     Abbv = new BitCodeAbbrev();
@@ -890,10 +898,16 @@ static void WriteConstants(unsigned FirstVal, unsigned LastVal,
           isCStrChar6 = BitCodeAbbrevOp::isChar6(V);
       }
 
-      if (isCStrChar6)
+      if (isCStrChar6) {
         AbbrevToUse = CString6Abbrev;
-      else if (isCStr7)
+      } else if (isCStr7) {
         AbbrevToUse = CString7Abbrev;
+      } else if (Code == bitc::CST_CODE_CSTRING && String8Abbrev) {
+        // Other C strings are denser as a blob including the null.
+        Code = bitc::CST_CODE_STRING;
+        AbbrevToUse = String8Abbrev;
+        Record.push_back(0);
+      }
     } else if (const ConstantDataSequential *CDS =
                   dyn_cast<ConstantDataSequential>(C)) {
       Code = bitc::CST_CODE_DATA;
@@ -1814,8 +1828,41 @@ static void WriteModuleUseLists(const Module *M, ValueEnumerator &VE,
   Stream.ExitBlock();
 }
 
-/// WriteModule - Emit the specified module to the bitstream.
-static void WriteModule(const Module *M, BitstreamWriter &Stream) {
+/// WriteFunctionIndex - Emit a MODULE_CODE_FNINDEX record with room for
+/// NumEntries offsets and return the byte offset of its blob.  The offsets are
+/// filled in by PatchFunctionIndex once the function bodies are written.
+static unsigned WriteFunctionIndex(unsigned NumEntries,
+                                   BitstreamWriter &Stream) {
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::MODULE_CODE_FNINDEX));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob));
+  unsigned FnIndexAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<unsigned, 1> Vals;
+  Vals.push_back(bitc::MODULE_CODE_FNINDEX);
+  std::string Blob(NumEntries * 8, '\0');
+  Stream.EmitRecordWithBlob(FnIndexAbbrev, Vals, Blob);
+
+  // The blob is a multiple of 4 bytes, so it ends without padding.
+  return Stream.GetCurrentBitNo() / 8 - Blob.size();
+}
+
+/// PatchFunctionIndex - Fill in the offsets of the MODULE_CODE_FNINDEX record
+/// emitted by WriteFunctionIndex.
+static void PatchFunctionIndex(unsigned IndexStart,
+                               const SmallVectorImpl<uint64_t> &Offsets,
+                               BitstreamWriter &Stream) {
+  for (unsigned i = 0, e = Offsets.size(); i != e; ++i) {
+    Stream.BackpatchWord(IndexStart + i * 8, unsigned(Offsets[i]));
+    Stream.BackpatchWord(IndexStart + i * 8 + 4, unsigned(Offsets[i] >> 32));
+  }
+}
+
+/// WriteModule - Emit the specified module to the bitstream.  \p BitcodeStart
+/// is the bit position of the start of the bitcode, which the offsets in the
+/// function index are relative to.
+static void WriteModule(const Module *M, uint64_t BitcodeStart,
+                        BitstreamWriter &Stream) {
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
 
   SmallVector<unsigned, 1> Vals;
@@ -1855,10 +1902,28 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   if (EnablePreserveUseListOrdering)
     WriteModuleUseLists(M, VE, Stream);
 
+  // Emit the index of the function bodies, which have to come last.
+  SmallVector<uint64_t, 64> IndexOffsets;
+  IndexOffsets.push_back(0); // End of the function bodies, set below.
+  unsigned NumBodies = 0;
+  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
+    NumBodies += !F->isDeclaration();
+  unsigned IndexStart = 0;
+  bool HasIndex = EmitFunctionIndex && NumBodies != 0;
+  if (HasIndex)
+    IndexStart = WriteFunctionIndex(NumBodies + 1, Stream);
+
   // Emit function bodies.
   for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
-    if (!F->isDeclaration())
+    if (!F->isDeclaration()) {
+      IndexOffsets.push_back(Stream.GetCurrentBitNo() - BitcodeStart);
       WriteFunction(*F, VE, Stream);
+    }
+
+  if (HasIndex) {
+    IndexOffsets[0] = Stream.GetCurrentBitNo() - BitcodeStart;
+    PatchFunctionIndex(IndexStart, IndexOffsets, Stream);
+  }
 
   Stream.ExitBlock();
 }
@@ -1951,6 +2016,7 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
   // Emit the module into the buffer.
   {
     BitstreamWriter Stream(Buffer);
+    uint64_t BitcodeStart = Stream.GetCurrentBitNo();
 
     // Emit the file header.
     Stream.Emit((unsigned)'B', 8);
@@ -1961,7 +2027,7 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out) {
     Stream.Emit(0xD, 4);
 
     // Emit the module.
-    WriteModule(M, Stream);
+    WriteModule(M, BitcodeStart, Stream);
   }
 
   if (TT.isOSDarwin())
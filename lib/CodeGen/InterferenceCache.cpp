@@ -23,25 +23,24 @@ using namespace llvm;
 InterferenceCache::BlockInterference InterferenceCache::Cursor::NoInterference;
 
 void InterferenceCache::init(MachineFunction *mf,
-                             LiveIntervalUnion *liuarray,
+                             LiveRegMatrix *matrix,
                              SlotIndexes *indexes,
                              LiveIntervals *lis,
                              const TargetRegisterInfo *tri) {
   MF = mf;
-  LIUArray = liuarray;
+  LIUArray = matrix->getLiveUnions();
   TRI = tri;
   PhysRegEntries.assign(TRI->getNumRegs(), 0);
   for (unsigned i = 0; i != CacheEntries; ++i)
-    Entries[i].clear(mf, indexes, lis);
+    Entries[i].clear(mf, indexes, lis, matrix);
 }
 
 InterferenceCache::Entry *InterferenceCache::get(unsigned PhysReg) {
+  // An existing entry stays valid when the LIUs change. The blocks that were
+  // affected are recomputed on demand.
   unsigned E = PhysRegEntries[PhysReg];
-  if (E < CacheEntries && Entries[E].getPhysReg() == PhysReg) {
-    if (!Entries[E].valid(LIUArray, TRI))
-      Entries[E].revalidate(LIUArray, TRI);
+  if (E < CacheEntries && Entries[E].getPhysReg() == PhysReg)
     return &Entries[E];
-  }
   // No valid entry exists, pick the next round-robin entry.
   E = RoundRobin;
   if (++RoundRobin == CacheEntries)
@@ -53,27 +52,38 @@ InterferenceCache::Entry *InterferenceCache::get(unsigned PhysReg) {
         E = 0;
       continue;
     }
-    Entries[E].reset(PhysReg, LIUArray, TRI, MF);
+    Entries[E].reset(PhysReg, TRI, MF);
     PhysRegEntries[PhysReg] = E;
     return &Entries[E];
   }
   llvm_unreachable("Ran out of interference cache entries.");
 }
 
-/// revalidate - LIU contents have changed, update tags.
-void InterferenceCache::Entry::revalidate(LiveIntervalUnion *LIUArray,
-                                          const TargetRegisterInfo *TRI) {
-  // Invalidate all block entries.
-  ++Tag;
-  // Invalidate all iterators.
-  PrevPos = SlotIndex();
-  unsigned i = 0;
-  for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units, ++i)
-    RegUnits[i].VirtTag = LIUArray[*Units].getTag();
+void InterferenceCache::Entry::clear(MachineFunction *mf,
+                                     SlotIndexes *indexes,
+                                     LiveIntervals *lis,
+                                     LiveRegMatrix *matrix) {
+  assert(!hasRefs() && "Cannot clear cache entry with references");
+  PhysReg = 0;
+  MF = mf;
+  Indexes = indexes;
+  LIS = lis;
+  Matrix = matrix;
+  LIUArray = matrix->getLiveUnions();
+}
+
+/// revalidate - Invalidate the iterators into LIUs that have changed.
+void InterferenceCache::Entry::revalidate() {
+  for (unsigned i = 0, e = RegUnits.size(); i != e; ++i) {
+    LiveIntervalUnion &LIU = LIUArray[RegUnits[i].Unit];
+    if (LIU.changedSince(RegUnits[i].VirtTag)) {
+      RegUnits[i].VirtTag = LIU.getTag();
+      PrevPos = SlotIndex();
+    }
+  }
 }
 
 void InterferenceCache::Entry::reset(unsigned physReg,
-                                     LiveIntervalUnion *LIUArray,
                                      const TargetRegisterInfo *TRI,
                                      const MachineFunction *MF) {
   assert(!hasRefs() && "Cannot reset cache entry with references");
@@ -86,26 +96,15 @@ void InterferenceCache::Entry::reset(unsigned physReg,
   PrevPos = SlotIndex();
   RegUnits.clear();
   for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units) {
-    RegUnits.push_back(LIUArray[*Units]);
+    RegUnits.push_back(RegUnitInfo(*Units, LIUArray[*Units]));
     RegUnits.back().Fixed = &LIS->getRegUnit(*Units);
   }
 }
 
-bool InterferenceCache::Entry::valid(LiveIntervalUnion *LIUArray,
-                                     const TargetRegisterInfo *TRI) {
-  unsigned i = 0, e = RegUnits.size();
-  for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units, ++i) {
-    if (i == e)
-      return false;
-    if (LIUArray[*Units].changedSince(RegUnits[i].VirtTag))
-      return false;
-  }
-  return i == e;
-}
-
 void InterferenceCache::Entry::update(unsigned MBBNum) {
   SlotIndex Start, Stop;
   tie(Start, Stop) = Indexes->getMBBRange(MBBNum);
+  revalidate();
 
   // Use advanceTo only when possible.
   if (PrevPos != Start) {
@@ -130,8 +129,10 @@ void InterferenceCache::Entry::update(unsigned MBBNum) {
   BlockInterference *BI = &Blocks[MBBNum];
   ArrayRef<SlotIndex> RegMaskSlots;
   ArrayRef<const uint32_t*> RegMaskBits;
+  unsigned AssignTag = Matrix->getAssignTag();
   for (;;) {
     BI->Tag = Tag;
+    BI->AssignTag = AssignTag;
     BI->First = BI->Last = SlotIndex();
 
     // Check for first interference from virtregs.
@@ -180,7 +181,7 @@ void InterferenceCache::Entry::update(unsigned MBBNum) {
       return;
     MBBNum = MFI->getNumber();
     BI = &Blocks[MBBNum];
-    if (BI->Tag == Tag)
+    if (isBlockValid(MBBNum))
       return;
     tie(Start, Stop) = Indexes->getMBBRange(MBBNum);
   }
@@ -16,6 +16,7 @@
 #define LLVM_CODEGEN_INTERFERENCECACHE
 
 #include "llvm/CodeGen/LiveIntervalUnion.h"
+#include "llvm/CodeGen/LiveRegMatrix.h"
 
 namespace llvm {
 
@@ -29,8 +30,10 @@ class InterferenceCache {
   /// BlockInterference - information about the interference in a single basic
   /// block.
   struct BlockInterference {
-    BlockInterference() : Tag(0) {}
+    BlockInterference() : Tag(0), AssignTag(0) {}
     unsigned Tag;
+    /// AssignTag - LiveRegMatrix::getAssignTag() when this was computed.
+    unsigned AssignTag;
     SlotIndex First;
     SlotIndex Last;
   };
@@ -41,8 +44,9 @@ class InterferenceCache {
     /// PhysReg - The register currently represented.
     unsigned PhysReg;
 
-    /// Tag - Cache tag is changed when any of the underlying LiveIntervalUnions
-    /// change.
+    /// Tag - Cache tag is changed when the entry is reset for another PhysReg.
+    /// Changes to the underlying LiveIntervalUnions are tracked per block by
+    /// the LiveRegMatrix.
     unsigned Tag;
 
     /// RefCount - The total number of Cursor instances referring to this Entry.
@@ -57,6 +61,12 @@ class InterferenceCache {
     /// LIS - Used for accessing register mask interference maps.
     LiveIntervals *LIS;
 
+    /// Matrix - Provides the per-block tags of the LiveIntervalUnions.
+    LiveRegMatrix *Matrix;
+
+    /// LIUArray - The LiveIntervalUnions of all register units.
+    LiveIntervalUnion *LIUArray;
+
     /// PrevPos - The previous position the iterators were moved to.
     SlotIndex PrevPos;
 
@@ -64,6 +74,9 @@ class InterferenceCache {
     /// When PrevPos is set, the iterators are valid as if advanceTo(PrevPos)
     /// had just been called.
     struct RegUnitInfo {
+      /// The register unit.
+      unsigned Unit;
+
       /// Iterator pointing into the LiveIntervalUnion containing virtual
       /// register interference.
       LiveIntervalUnion::SegmentIter VirtI;
@@ -77,7 +90,8 @@ class InterferenceCache {
       /// Iterator pointing into the fixed RegUnit interference.
       LiveInterval::iterator FixedI;
 
-      RegUnitInfo(LiveIntervalUnion &LIU) : VirtTag(LIU.getTag()), Fixed(0) {
+      RegUnitInfo(unsigned Unit, LiveIntervalUnion &LIU)
+        : Unit(Unit), VirtTag(LIU.getTag()), Fixed(0) {
         VirtI.setMap(LIU.getMap());
       }
     };
@@ -92,37 +106,43 @@ class InterferenceCache {
     /// update - Recompute Blocks[MBBNum]
     void update(unsigned MBBNum);
 
-  public:
-    Entry() : PhysReg(0), Tag(0), RefCount(0), Indexes(0), LIS(0) {}
-
-    void clear(MachineFunction *mf, SlotIndexes *indexes, LiveIntervals *lis) {
-      assert(!hasRefs() && "Cannot clear cache entry with references");
-      PhysReg = 0;
-      MF = mf;
-      Indexes = indexes;
-      LIS = lis;
+    /// isBlockValid - Return true if Blocks[MBBNum] was computed for PhysReg,
+    /// and no virtual register has been assigned to or unassigned from PhysReg
+    /// in the block since.
+    bool isBlockValid(unsigned MBBNum) const {
+      const BlockInterference &BI = Blocks[MBBNum];
+      if (BI.Tag != Tag)
+        return false;
+      for (unsigned i = 0, e = RegUnits.size(); i != e; ++i)
+        if (Matrix->getBlockTag(RegUnits[i].Unit, MBBNum) > BI.AssignTag)
+          return false;
+      return true;
     }
 
+    /// revalidate - Reposition the iterators if the LIUs have changed.
+    void revalidate();
+
+  public:
+    Entry() : PhysReg(0), Tag(0), RefCount(0), Indexes(0), LIS(0), Matrix(0),
+              LIUArray(0) {}
+
+    void clear(MachineFunction *mf, SlotIndexes *indexes, LiveIntervals *lis,
+               LiveRegMatrix *matrix);
+
     unsigned getPhysReg() const { return PhysReg; }
 
     void addRef(int Delta) { RefCount += Delta; }
 
     bool hasRefs() const { return RefCount > 0; }
 
-    void revalidate(LiveIntervalUnion *LIUArray, const TargetRegisterInfo *TRI);
-
-    /// valid - Return true if this is a valid entry for physReg.
-    bool valid(LiveIntervalUnion *LIUArray, const TargetRegisterInfo *TRI);
-
     /// reset - Initialize entry to represent physReg's aliases.
     void reset(unsigned physReg,
-               LiveIntervalUnion *LIUArray,
                const TargetRegisterInfo *TRI,
                const MachineFunction *MF);
 
     /// get - Return an up to date BlockInterference.
     BlockInterference *get(unsigned MBBNum) {
-      if (Blocks[MBBNum].Tag != Tag)
+      if (!isBlockValid(MBBNum))
         update(MBBNum);
       return &Blocks[MBBNum];
     }
@@ -150,7 +170,7 @@ public:
   InterferenceCache() : TRI(0), LIUArray(0), MF(0), RoundRobin(0) {}
 
   /// init - Prepare cache for a new function.
-  void init(MachineFunction*, LiveIntervalUnion*, SlotIndexes*, LiveIntervals*,
+  void init(MachineFunction*, LiveRegMatrix*, SlotIndexes*, LiveIntervals*,
             const TargetRegisterInfo *);
 
   /// getMaxCursors - Return the maximum number of concurrent cursors that can
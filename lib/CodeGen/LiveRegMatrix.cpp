@@ -37,7 +37,7 @@ INITIALIZE_PASS_END(LiveRegMatrix, "liveregmatrix",
                     "Live Register Matrix", false, false)
 
 LiveRegMatrix::LiveRegMatrix() : MachineFunctionPass(ID),
-  UserTag(0), RegMaskTag(0), RegMaskVirtReg(0) {}
+  UserTag(0), RegMaskTag(0), RegMaskVirtReg(0), AssignTag(0) {}
 
 void LiveRegMatrix::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.setPreservesAll();
@@ -56,6 +56,8 @@ bool LiveRegMatrix::runOnMachineFunction(MachineFunction &MF) {
   if (NumRegUnits != Matrix.size())
     Queries.reset(new LiveIntervalUnion::Query[NumRegUnits]);
   Matrix.init(LIUAlloc, NumRegUnits);
+  BlockTags.clear();
+  BlockTags.resize(NumRegUnits);
 
   // Make sure no stale queries get reused.
   invalidateVirtRegs();
@@ -67,6 +69,33 @@ void LiveRegMatrix::releaseMemory() {
     Matrix[i].clear();
     Queries[i].clear();
   }
+  BlockTags.clear();
+}
+
+void LiveRegMatrix::tagBlocks(LiveInterval &VirtReg, unsigned PhysReg) {
+  ++AssignTag;
+  MachineFunction &MF = VRM->getMachineFunction();
+  SlotIndexes *Indexes = LIS->getSlotIndexes();
+  SmallVector<unsigned *, 8> Tags;
+  for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units) {
+    SmallVector<unsigned, 0> &UnitTags = BlockTags[*Units];
+    if (UnitTags.empty())
+      UnitTags.resize(MF.getNumBlockIDs());
+    assert(UnitTags.size() == MF.getNumBlockIDs() && "Block numbers changed");
+    Tags.push_back(UnitTags.data());
+  }
+
+  // Slot indexes increase in layout order, so the blocks covered by a segment
+  // follow the block containing its start.
+  for (LiveInterval::iterator I = VirtReg.begin(), E = VirtReg.end();
+       I != E; ++I) {
+    MachineFunction::iterator MFI = Indexes->getMBBFromIndex(I->start);
+    for (; MFI != MF.end() && Indexes->getMBBStartIdx(MFI) < I->end; ++MFI) {
+      unsigned MBBNum = MFI->getNumber();
+      for (unsigned i = 0, e = Tags.size(); i != e; ++i)
+        Tags[i][MBBNum] = AssignTag;
+    }
+  }
 }
 
 void LiveRegMatrix::assign(LiveInterval &VirtReg, unsigned PhysReg) {
@@ -75,6 +104,7 @@ void LiveRegMatrix::assign(LiveInterval &VirtReg, unsigned PhysReg) {
   assert(!VRM->hasPhys(VirtReg.reg) && "Duplicate VirtReg assignment");
   VRM->assignVirt2Phys(VirtReg.reg, PhysReg);
   MRI->setPhysRegUsed(PhysReg);
+  tagBlocks(VirtReg, PhysReg);
   for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units) {
     DEBUG(dbgs() << ' ' << PrintRegUnit(*Units, TRI));
     Matrix[*Units].unify(VirtReg);
@@ -88,6 +118,7 @@ void LiveRegMatrix::unassign(LiveInterval &VirtReg) {
   DEBUG(dbgs() << "unassigning " << PrintReg(VirtReg.reg, TRI)
                << " from " << PrintReg(PhysReg, TRI) << ':');
   VRM->clearVirt(VirtReg.reg);
+  tagBlocks(VirtReg, PhysReg);
   for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units) {
     DEBUG(dbgs() << ' ' << PrintRegUnit(*Units, TRI));
     Matrix[*Units].extract(VirtReg);
@@ -39,6 +39,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetOptions.h"
@@ -59,6 +60,11 @@ SplitSpillMode("split-spill-mode", cl::Hidden,
              clEnumValEnd),
   cl::init(SplitEditor::SM_Partition));
 
+static cl::opt<bool>
+TimeFunctions("regalloc-time-functions", cl::Hidden,
+              cl::desc("Print the time spent allocating registers for each "
+                       "function"));
+
 static RegisterRegAlloc greedyRegAlloc("greedy", "greedy register allocator",
                                        createGreedyRegisterAllocator);
 
@@ -1750,6 +1756,10 @@ bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   if (VerifyEnabled)
     MF->verify(this, "Before greedy register allocator");
 
+  TimeRecord Elapsed;
+  if (TimeFunctions)
+    Elapsed -= TimeRecord::getCurrentTime(true);
+
   RegAllocBase::init(getAnalysis<VirtRegMap>(),
                      getAnalysis<LiveIntervals>(),
                      getAnalysis<LiveRegMatrix>());
@@ -1766,10 +1776,20 @@ bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   ExtraRegInfo.clear();
   ExtraRegInfo.resize(MRI->getNumVirtRegs());
   NextCascade = 1;
-  IntfCache.init(MF, Matrix->getLiveUnions(), Indexes, LIS, TRI);
+  IntfCache.init(MF, Matrix, Indexes, LIS, TRI);
   GlobalCand.resize(32);  // This will grow as needed.
 
   allocatePhysRegs();
+
+  if (TimeFunctions) {
+    Elapsed += TimeRecord::getCurrentTime(false);
+    errs() << "regalloc: " << format("%8.4f", Elapsed.getUserTime())
+           << "s user " << format("%8.4f", Elapsed.getWallTime())
+           << "s wall " << format("%6u", MF->getNumBlockIDs()) << " blocks "
+           << format("%7u", MRI->getNumVirtRegs()) << " vregs  "
+           << MF->getName() << '\n';
+  }
+
   releaseMemory();
   return true;
 }
@@ -117,8 +117,8 @@ void ScheduleDAGFast::Schedule() {
   DEBUG(dbgs() << "********** List Scheduling **********\n");
 
   NumLiveRegs = 0;
-  LiveRegDefs.resize(TRI->getNumRegs(), NULL);
-  LiveRegCycles.resize(TRI->getNumRegs(), 0);
+  LiveRegDefs.assign(TRI->getNumRegs(), NULL);
+  LiveRegCycles.assign(TRI->getNumRegs(), 0);
 
   // Build the scheduling graph.
   BuildSchedGraph(NULL);
@@ -309,8 +309,8 @@ void ScheduleDAGRRList::Schedule() {
   NumLiveRegs = 0;
   // Allocate slots for each physical register, plus one for a special register
   // to track the virtual resource of a calling sequence.
-  LiveRegDefs.resize(TRI->getNumRegs() + 1, NULL);
-  LiveRegGens.resize(TRI->getNumRegs() + 1, NULL);
+  LiveRegDefs.assign(TRI->getNumRegs() + 1, NULL);
+  LiveRegGens.assign(TRI->getNumRegs() + 1, NULL);
   CallSeqEndForStart.clear();
 
   // Build the scheduling graph.
@@ -656,6 +656,18 @@ void SelectionDAG::DeallocateNode(SDNode *N) {
     DbgVals[i]->setIsInvalidated();
 }
 
+/// newSDNode - Create a generic node with the given operands, taking its
+/// operand list from OperandAllocator if ArenaOperands is set.
+SDNode *SelectionDAG::newSDNode(unsigned Opcode, DebugLoc DL, SDVTList VTs,
+                                const SDValue *Ops, unsigned NumOps) {
+  if (!ArenaOperands)
+    return new (NodeAllocator) SDNode(Opcode, DL, VTs, Ops, NumOps);
+
+  SDNode *N = new (NodeAllocator) SDNode(Opcode, DL, VTs);
+  N->InitOperands(OperandAllocator.Allocate<SDUse>(NumOps), Ops, NumOps);
+  return N;
+}
+
 /// RemoveNodeFromCSEMaps - Take the specified node out of the CSE map that
 /// correspond to it.  This is useful when we're about to delete or repurpose
 /// the node.  We don't want future request for structurally identical nodes
@@ -887,7 +899,8 @@ SelectionDAG::SelectionDAG(const TargetMachine &tm, CodeGenOpt::Level OL)
   : TM(tm), TLI(*tm.getTargetLowering()), TSI(*tm.getSelectionDAGInfo()),
     TTI(0), OptLevel(OL), EntryNode(ISD::EntryToken, DebugLoc(),
                                     getVTList(MVT::Other)),
-    Root(getEntryNode()), Ordering(0), UpdateListeners(0) {
+    Root(getEntryNode()), ArenaOperands(false), Ordering(0),
+    UpdateListeners(0) {
   AllNodes.push_back(&EntryNode);
   Ordering = new SDNodeOrdering();
   DbgInfo = new SDDbgInfo();
@@ -909,8 +922,18 @@ SelectionDAG::~SelectionDAG() {
 void SelectionDAG::allnodes_clear() {
   assert(&*AllNodes.begin() == &EntryNode);
   AllNodes.remove(AllNodes.begin());
-  while (!AllNodes.empty())
-    DeallocateNode(AllNodes.begin());
+
+  // All nodes go away at once, so skip the per-node bookkeeping that
+  // DeallocateNode does in the ordering and debug value maps; both are
+  // cleared or deleted by our callers.
+  for (allnodes_iterator I = AllNodes.begin(), E = AllNodes.end(); I != E; ) {
+    SDNode *N = I++;
+    if (N->OperandsNeedDelete)
+      delete[] N->OperandList;
+    N->NodeType = ISD::DELETED_NODE;
+    NodeAllocator.Deallocate(N);
+  }
+  AllNodes.clearAndLeakNodesUnsafely();
 }
 
 void SelectionDAG::clear() {
@@ -4624,10 +4647,10 @@ SDValue SelectionDAG::getNode(unsigned Opcode, DebugLoc DL, EVT VT,
     if (SDNode *E = CSEMap.FindNodeOrInsertPos(ID, IP))
       return SDValue(E, 0);
 
-    N = new (NodeAllocator) SDNode(Opcode, DL, VTs, Ops, NumOps);
+    N = newSDNode(Opcode, DL, VTs, Ops, NumOps);
     CSEMap.InsertNode(N, IP);
   } else {
-    N = new (NodeAllocator) SDNode(Opcode, DL, VTs, Ops, NumOps);
+    N = newSDNode(Opcode, DL, VTs, Ops, NumOps);
   }
 
   AllNodes.push_back(N);
@@ -4697,7 +4720,7 @@ SDValue SelectionDAG::getNode(unsigned Opcode, DebugLoc DL, SDVTList VTList,
       N = new (NodeAllocator) TernarySDNode(Opcode, DL, VTList, Ops[0], Ops[1],
                                             Ops[2]);
     } else {
-      N = new (NodeAllocator) SDNode(Opcode, DL, VTList, Ops, NumOps);
+      N = newSDNode(Opcode, DL, VTList, Ops, NumOps);
     }
     CSEMap.InsertNode(N, IP);
   } else {
@@ -4709,7 +4732,7 @@ SDValue SelectionDAG::getNode(unsigned Opcode, DebugLoc DL, SDVTList VTList,
       N = new (NodeAllocator) TernarySDNode(Opcode, DL, VTList, Ops[0], Ops[1],
                                             Ops[2]);
     } else {
-      N = new (NodeAllocator) SDNode(Opcode, DL, VTList, Ops, NumOps);
+      N = newSDNode(Opcode, DL, VTList, Ops, NumOps);
     }
   }
   AllNodes.push_back(N);
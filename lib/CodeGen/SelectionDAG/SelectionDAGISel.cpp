@@ -44,6 +44,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Timer.h"
+#include "llvm/Support/YAMLTraits.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetInstrInfo.h"
 #include "llvm/Target/TargetIntrinsicInfo.h"
@@ -145,6 +146,20 @@ EnableFastISelVerbose("fast-isel-verbose", cl::Hidden,
 static cl::opt<bool>
 EnableFastISelAbort("fast-isel-abort", cl::Hidden,
           cl::desc("Enable abort calls when \"fast\" instruction fails"));
+static cl::opt<bool>
+EnableFastISelNoFallback("fast-isel-no-fallback", cl::Hidden,
+          cl::desc("Report a fatal error when the \"fast\" instruction "
+                   "selector fails on any instruction, including calls and "
+                   "terminators"));
+static cl::opt<bool>
+ReportFastISelFallbacks("fast-isel-report-fallbacks", cl::Hidden,
+          cl::desc("Print a YAML summary of the instructions the \"fast\" "
+                   "instruction selector left to SelectionDAG"));
+
+static cl::opt<bool>
+ReuseDAGStorage("isel-reuse-dag-storage", cl::Hidden,
+          cl::desc("Reuse the SelectionDAG operand pool and the scheduler "
+                   "across the blocks of a function (experimental)"));
 
 static cl::opt<bool>
 UseMBPI("use-mbpi",
@@ -274,7 +289,8 @@ SelectionDAGISel::SelectionDAGISel(const TargetMachine &tm,
   SDB(new SelectionDAGBuilder(*CurDAG, *FuncInfo, OL)),
   GFI(),
   OptLevel(OL),
-  DAGSize(0) {
+  DAGSize(0),
+  FunctionScheduler(0) {
     initializeGCModuleInfoPass(*PassRegistry::getPassRegistry());
     initializeAliasAnalysisAnalysisGroup(*PassRegistry::getPassRegistry());
     initializeBranchProbabilityInfoPass(*PassRegistry::getPassRegistry());
@@ -342,6 +358,10 @@ bool SelectionDAGISel::runOnMachineFunction(MachineFunction &mf) {
          "-fast-isel-verbose requires -fast-isel");
   assert((!EnableFastISelAbort || TM.Options.EnableFastISel) &&
          "-fast-isel-abort requires -fast-isel");
+  // Tests rely on this mode failing loudly, so don't let it pass vacuously
+  // in release builds.
+  if (EnableFastISelNoFallback && !TM.Options.EnableFastISel)
+    report_fatal_error("-fast-isel-no-fallback requires -fast-isel");
 
   const Function &Fn = *mf.getFunction();
   const TargetInstrInfo &TII = *TM.getInstrInfo();
@@ -359,6 +379,7 @@ bool SelectionDAGISel::runOnMachineFunction(MachineFunction &mf) {
   SplitCriticalSideEffectEdges(const_cast<Function&>(Fn), this);
 
   CurDAG->init(*MF, TTI);
+  CurDAG->setArenaOperands(ReuseDAGStorage);
   FuncInfo->set(Fn, *MF);
 
   if (UseMBPI && OptLevel != CodeGenOpt::None)
@@ -370,6 +391,9 @@ bool SelectionDAGISel::runOnMachineFunction(MachineFunction &mf) {
 
   SelectAllBasicBlocks(Fn);
 
+  delete FunctionScheduler;
+  FunctionScheduler = 0;
+
   // If the first basic block in the function has live ins that need to be
   // copied into vregs, emit the copies into the top of the block before
   // emitting the code for the block.
@@ -490,6 +514,70 @@ bool SelectionDAGISel::runOnMachineFunction(MachineFunction &mf) {
   return true;
 }
 
+namespace {
+/// FastISelFallback - One line of the -fast-isel-report-fallbacks report.
+struct FastISelFallback {
+  StringRef Opcode;
+  StringRef Type;
+  StringRef Callee;
+  unsigned Count;
+};
+
+/// FastISelFallbackReport - The document printed by
+/// -fast-isel-report-fallbacks.
+struct FastISelFallbackReport {
+  std::vector<FastISelFallback> Fallbacks;
+};
+}
+
+LLVM_YAML_IS_SEQUENCE_VECTOR(FastISelFallback)
+
+namespace llvm {
+namespace yaml {
+
+template <>
+struct MappingTraits<FastISelFallback> {
+  static void mapping(IO &io, FastISelFallback &F) {
+    io.mapRequired("opcode", F.Opcode);
+    io.mapRequired("type", F.Type);
+    io.mapOptional("callee", F.Callee, StringRef());
+    io.mapRequired("count", F.Count);
+  }
+};
+
+template <>
+struct MappingTraits<FastISelFallbackReport> {
+  static void mapping(IO &io, FastISelFallbackReport &R) {
+    io.mapRequired("fast-isel-fallbacks", R.Fallbacks);
+  }
+};
+
+} // End yaml namespace
+} // End llvm namespace
+
+bool SelectionDAGISel::doFinalization(Module &M) {
+  if (ReportFastISelFallbacks) {
+    FastISelFallbackReport Report;
+    for (std::map<std::string, unsigned>::const_iterator
+         I = FastISelFallbacks.begin(), E = FastISelFallbacks.end();
+         I != E; ++I) {
+      SmallVector<StringRef, 3> Fields;
+      StringRef(I->first).split(Fields, StringRef("\0", 1));
+      FastISelFallback F;
+      F.Opcode = Fields[0];
+      F.Type = Fields[1];
+      F.Callee = Fields[2];
+      F.Count = I->second;
+      Report.Fallbacks.push_back(F);
+    }
+
+    yaml::Output YOut(dbgs());
+    YOut << Report;
+    FastISelFallbacks.clear();
+  }
+  return false;
+}
+
 void SelectionDAGISel::SelectBasicBlock(BasicBlock::const_iterator Begin,
                                         BasicBlock::const_iterator End,
                                         bool &HadTailCall) {
@@ -673,7 +761,9 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   if (ViewSchedDAGs) CurDAG->viewGraph("scheduler input for " + BlockName);
 
   // Schedule machine code.
-  ScheduleDAGSDNodes *Scheduler = CreateScheduler();
+  ScheduleDAGSDNodes *Scheduler = FunctionScheduler;
+  if (!Scheduler)
+    Scheduler = CreateScheduler();
   {
     NamedRegionTimer T("Instruction Scheduling", GroupName,
                        TimePassesIsEnabled);
@@ -698,8 +788,11 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   if (FirstMBB != LastMBB)
     SDB->UpdateSplitBlock(FirstMBB, LastMBB);
 
-  // Free the scheduler state.
-  {
+  // Free the scheduler state, unless it is kept for the remaining blocks of
+  // the function.
+  if (ReuseDAGStorage) {
+    FunctionScheduler = Scheduler;
+  } else {
     NamedRegionTimer T("Instruction Scheduling Cleanup", GroupName,
                        TimePassesIsEnabled);
     delete Scheduler;
@@ -984,6 +1077,38 @@ static void collectFailStats(const Instruction *I) {
 }
 #endif
 
+/// recordFastISelMiss - Account for an instruction that FastISel failed on and
+/// left to SelectionDAG, along with the rest of its block unless it is a call.
+void SelectionDAGISel::recordFastISelMiss(const Instruction *I) {
+#ifndef NDEBUG
+  if (EnableFastISelVerbose2)
+    collectFailStats(I);
+#endif
+
+  if (ReportFastISelFallbacks) {
+    // Instructions without a value are keyed by the type of their first
+    // operand, e.g. the stored value or the switch condition.
+    Type *Ty = I->getType();
+    if (Ty->isVoidTy() && !isa<CallInst>(I) && I->getNumOperands() != 0)
+      Ty = I->getOperand(0)->getType();
+
+    std::string Key;
+    raw_string_ostream OS(Key);
+    OS << I->getOpcodeName() << '\0' << *Ty << '\0';
+    if (const CallInst *CI = dyn_cast<CallInst>(I))
+      if (const Function *Callee = CI->getCalledFunction())
+        OS << Callee->getName();
+    ++FastISelFallbacks[OS.str()];
+  }
+
+  if (EnableFastISelNoFallback) {
+    std::string Msg;
+    raw_string_ostream OS(Msg);
+    OS << "FastISel didn't select:" << *I;
+    report_fatal_error(OS.str());
+  }
+}
+
 void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
   // Initialize the Fast-ISel state, if needed.
   FastISel *FastIS = 0;
@@ -1095,10 +1220,7 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
           continue;
         }
 
-#ifndef NDEBUG
-        if (EnableFastISelVerbose2)
-          collectFailStats(Inst);
-#endif
+        recordFastISelMiss(Inst);
 
         // Then handle certain instructions as single-LLVM-Instruction blocks.
         if (isa<CallInst>(Inst)) {
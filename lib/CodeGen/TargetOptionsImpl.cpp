@@ -14,8 +14,23 @@
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/MachineFrameInfo.h"
 #include "llvm/Target/TargetOptions.h"
+#include "llvm/Support/raw_ostream.h"
 using namespace llvm;
 
+/// serialize - Write the fields in the order they are declared.  Flags are a
+/// digit each, and everything else is followed by a separator.
+void TargetOptions::serialize(raw_ostream &OS) const {
+  OS << PrintMachineCode << NoFramePointerElim << NoFramePointerElimNonLeaf
+     << LessPreciseFPMADOption << UnsafeFPMath << NoInfsFPMath << NoNaNsFPMath
+     << HonorSignDependentRoundingFPMathOption << UseSoftFloat << NoZerosInBSS
+     << JITExceptionHandling << JITEmitDebugInfo << JITEmitDebugInfoToDisk
+     << GuaranteedTailCallOpt << DisableTailCalls << ' '
+     << StackAlignmentOverride << ' ' << RealignStack << SSPBufferSize << ' '
+     << EnableFastISel << PositionIndependentExecutable
+     << EnableSegmentedStacks << UseInitArray << TrapFuncName << '\0'
+     << unsigned(FloatABIType) << ' ' << unsigned(AllowFPOpFusion) << ' ';
+}
+
 /// DisableFramePointerElim - This returns true if frame pointer elimination
 /// optimization should be disabled for the given machine function.
 bool TargetOptions::DisableFramePointerElim(const MachineFunction &MF) const {
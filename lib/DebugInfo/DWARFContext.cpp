@@ -8,10 +8,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "DWARFContext.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 using namespace llvm;
@@ -19,6 +22,14 @@ using namespace dwarf;
 
 typedef DWARFDebugLine::LineTable DWARFLineTable;
 
+static cl::opt<bool>
+ParallelDWARFParsing("dwarf-parallel-parse", cl::init(false),
+                     cl::desc("Build the abbreviations, address ranges and "
+                              "line tables of all DWARF compile units in "
+                              "parallel (see -threads)"));
+
+DWARFContext::DWARFContext() : ParallelParsing(ParallelDWARFParsing) {}
+
 void DWARFContext::dump(raw_ostream &OS) {
   OS << ".debug_abbrev contents:\n";
   getDebugAbbrev()->dump(OS);
@@ -126,8 +137,11 @@ const DWARFDebugAranges *DWARFContext::getDebugAranges() {
 
 const DWARFLineTable *
 DWARFContext::getLineTableForCompileUnit(DWARFCompileUnit *cu) {
-  if (!Line)
+  if (!Line) {
     Line.reset(new DWARFDebugLine());
+    if (ParallelParsing)
+      parseLineTablesInParallel();
+  }
 
   unsigned stmtOffset =
     cu->getCompileUnitDIE()->getAttributeValueAsUnsigned(cu, DW_AT_stmt_list,
@@ -149,6 +163,26 @@ void DWARFContext::parseCompileUnits() {
   uint32_t offset = 0;
   const DataExtractor &DIData = DataExtractor(getInfoSection(),
                                               isLittleEndian(), 0);
+  if (ParallelParsing && !Abbrev) {
+    // Finding the abbreviation sets used by the compile units only takes a
+    // quick scan of the unit headers, and lets the sets be extracted in
+    // parallel.
+    std::vector<uint32_t> AbbrOffsets;
+    while (DIData.isValidOffset(offset)) {
+      uint32_t Length = DIData.getU32(&offset);
+      uint32_t NextOffset = offset + Length;
+      DIData.getU16(&offset);
+      AbbrOffsets.push_back(DIData.getU32(&offset));
+      if (NextOffset <= offset)
+        break;
+      offset = NextOffset;
+    }
+    DataExtractor abbrData(getAbbrevSection(), isLittleEndian(), 0);
+    Abbrev.reset(new DWARFDebugAbbrev());
+    Abbrev->parseInParallel(abbrData, AbbrOffsets);
+    offset = 0;
+  }
+
   while (DIData.isValidOffset(offset)) {
     CUs.push_back(DWARFCompileUnit(getDebugAbbrev(), getInfoSection(),
                                    getAbbrevSection(), getRangeSection(),
@@ -163,6 +197,67 @@ void DWARFContext::parseCompileUnits() {
   }
 }
 
+namespace {
+  /// LineTableTask - A line table parsed by parseLineTablesInParallel.
+  struct LineTableTask {
+    LineTableTask(uint32_t Offset, DataExtractor Data)
+      : Offset(Offset), Data(Data), Valid(false) {}
+
+    uint32_t Offset;
+    DataExtractor Data;
+    bool Valid;
+    DWARFLineTable Table;
+  };
+
+  struct ParseLineTable {
+    void operator()(LineTableTask &Task) const {
+      DWARFDebugLine::State State;
+      uint32_t Offset = Task.Offset;
+      Task.Valid = DWARFDebugLine::parseStatementTable(Task.Data, &Offset,
+                                                       State);
+      Task.Table.Prologue = State.Prologue;
+      Task.Table.Rows.swap(State.Rows);
+      Task.Table.Sequences.swap(State.Sequences);
+    }
+  };
+
+  struct ExtractCompileUnitDIE {
+    void operator()(DWARFCompileUnit &CU) const { CU.getCompileUnitDIE(); }
+  };
+}
+
+void DWARFContext::parseLineTablesInParallel() {
+  // The line table offsets are attributes of the compile unit DIEs, so these
+  // are extracted first.
+  const unsigned NumCUs = getNumCompileUnits();
+  parallel_for_each(CUs.begin(), CUs.end(), ExtractCompileUnitDIE());
+
+  // Several compile units may share a line table; parse it only once.
+  std::vector<LineTableTask> Tasks;
+  DenseSet<uint32_t> Offsets;
+  for (unsigned i = 0; i != NumCUs; ++i) {
+    DWARFCompileUnit *cu = &CUs[i];
+    const DWARFDebugInfoEntryMinimal *CUDIE = cu->getCompileUnitDIE();
+    if (!CUDIE)
+      continue;
+    unsigned stmtOffset =
+      CUDIE->getAttributeValueAsUnsigned(cu, DW_AT_stmt_list, -1U);
+    if (stmtOffset == -1U || !Offsets.insert(stmtOffset).second)
+      continue;
+    Tasks.push_back(LineTableTask(stmtOffset,
+                                  DataExtractor(getLineSection(),
+                                                isLittleEndian(),
+                                                cu->getAddressByteSize())));
+  }
+  parallel_for_each(Tasks.begin(), Tasks.end(), ParseLineTable());
+
+  // Tables that fail to parse are left to getLineTableForCompileUnit, so
+  // that the lookup behaves as it does without parallel parsing.
+  for (unsigned i = 0, e = Tasks.size(); i != e; ++i)
+    if (Tasks[i].Valid)
+      Line->addLineTable(Tasks[i].Offset, Tasks[i].Table);
+}
+
 void DWARFContext::parseDWOCompileUnits() {
   uint32_t offset = 0;
   const DataExtractor &DIData = DataExtractor(getInfoDWOSection(),
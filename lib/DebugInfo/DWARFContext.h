@@ -33,6 +33,10 @@ class DWARFContext : public DIContext {
   SmallVector<DWARFCompileUnit, 1> DWOCUs;
   OwningPtr<DWARFDebugAbbrev> AbbrevDWO;
 
+  /// ParallelParsing - Whether abbreviations, address ranges and line tables
+  /// are built for all compile units at once, in parallel.
+  bool ParallelParsing;
+
   DWARFContext(DWARFContext &) LLVM_DELETED_FUNCTION;
   DWARFContext &operator=(DWARFContext &) LLVM_DELETED_FUNCTION;
 
@@ -43,10 +47,17 @@ class DWARFContext : public DIContext {
   /// DWOCUs.
   void parseDWOCompileUnits();
 
+  /// Parse the line tables of all compile units in parallel and cache them in
+  /// Line.
+  void parseLineTablesInParallel();
+
 public:
-  DWARFContext() {}
+  DWARFContext();
   virtual void dump(raw_ostream &OS);
 
+  bool getParallelParsing() const { return ParallelParsing; }
+  void setParallelParsing(bool Parallel) { ParallelParsing = Parallel; }
+
   /// Get the number of compile units in this context.
   unsigned getNumCompileUnits() {
     if (CUs.empty())
@@ -9,7 +9,9 @@
 
 #include "DWARFDebugAbbrev.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 using namespace llvm;
 
 bool DWARFAbbreviationDeclarationSet::extract(DataExtractor data,
@@ -75,6 +77,72 @@ void DWARFDebugAbbrev::parse(DataExtractor data) {
   PrevAbbrOffsetPos = AbbrevCollMap.end();
 }
 
+namespace {
+  /// AbbrevSetTask - One abbreviation set extracted by parseInParallel.
+  struct AbbrevSetTask {
+    uint32_t Offset;
+    uint32_t EndOffset;
+    bool Valid;
+    DWARFAbbreviationDeclarationSet *Set;
+  };
+
+  class ExtractAbbrevSet {
+    DataExtractor Data;
+  public:
+    ExtractAbbrevSet(DataExtractor Data) : Data(Data) {}
+    void operator()(AbbrevSetTask &Task) const {
+      Task.EndOffset = Task.Offset;
+      Task.Valid = Task.Set->extract(Data, &Task.EndOffset);
+    }
+  };
+}
+
+void DWARFDebugAbbrev::parseInParallel(DataExtractor data,
+                                       ArrayRef<uint32_t> SetOffsets) {
+  std::vector<uint32_t> Offsets(SetOffsets.begin(), SetOffsets.end());
+  std::sort(Offsets.begin(), Offsets.end());
+  Offsets.erase(std::unique(Offsets.begin(), Offsets.end()), Offsets.end());
+
+  // The map nodes are created up front so that the tasks can fill them in
+  // without touching the map itself.
+  std::vector<AbbrevSetTask> Tasks(Offsets.size());
+  for (unsigned i = 0, e = Offsets.size(); i != e; ++i) {
+    Tasks[i].Offset = Offsets[i];
+    Tasks[i].Set = &AbbrevCollMap[Offsets[i]];
+  }
+  parallel_for_each(Tasks.begin(), Tasks.end(), ExtractAbbrevSet(data));
+
+  // Now walk the chain of sets like parse() does, extracting only the sets
+  // that no compile unit pointed at, and drop the results for offsets that
+  // turned out not to start a set.
+  std::vector<AbbrevSetTask>::iterator I = Tasks.begin(), E = Tasks.end();
+  uint32_t offset = 0;
+  while (data.isValidOffset(offset)) {
+    uint32_t initial_cu_offset = offset;
+    for (; I != E && I->Offset < offset; ++I)
+      AbbrevCollMap.erase(I->Offset);
+
+    if (I != E && I->Offset == offset) {
+      bool Valid = I->Valid;
+      offset = I->EndOffset;
+      ++I;
+      if (Valid)
+        continue;
+      AbbrevCollMap.erase(initial_cu_offset);
+      break;
+    }
+
+    DWARFAbbreviationDeclarationSet abbrevDeclSet;
+    if (abbrevDeclSet.extract(data, &offset))
+      AbbrevCollMap[initial_cu_offset] = abbrevDeclSet;
+    else
+      break;
+  }
+  for (; I != E; ++I)
+    AbbrevCollMap.erase(I->Offset);
+  PrevAbbrOffsetPos = AbbrevCollMap.end();
+}
+
 void DWARFDebugAbbrev::dump(raw_ostream &OS) const {
   if (AbbrevCollMap.empty()) {
     OS << "< EMPTY >\n";
@@ -11,6 +11,7 @@
 #define LLVM_DEBUGINFO_DWARFDEBUGABBREV_H
 
 #include "DWARFAbbreviationDeclaration.h"
+#include "llvm/ADT/ArrayRef.h"
 #include <list>
 #include <map>
 #include <vector>
@@ -66,6 +67,10 @@ public:
     getAbbreviationDeclarationSet(uint64_t cu_abbr_offset) const;
   void dump(raw_ostream &OS) const;
   void parse(DataExtractor data);
+  /// parseInParallel - Same as parse, but first extracts the sets starting at
+  /// \p SetOffsets (typically the ones referenced by compile units) in
+  /// parallel. Offsets that are not on the chain of sets are ignored.
+  void parseInParallel(DataExtractor data, ArrayRef<uint32_t> SetOffsets);
 };
 
 }
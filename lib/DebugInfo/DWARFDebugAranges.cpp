@@ -11,6 +11,7 @@
 #include "DWARFCompileUnit.h"
 #include "DWARFContext.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
@@ -90,19 +91,56 @@ bool DWARFDebugAranges::extract(DataExtractor debug_aranges_data) {
 
 bool DWARFDebugAranges::generate(DWARFContext *ctx) {
   if (ctx) {
+    std::vector<DWARFCompileUnit *> CUs;
     const uint32_t num_compile_units = ctx->getNumCompileUnits();
     for (uint32_t cu_idx = 0; cu_idx < num_compile_units; ++cu_idx) {
       if (DWARFCompileUnit *cu = ctx->getCompileUnitAtIndex(cu_idx)) {
         uint32_t CUOffset = cu->getOffset();
         if (ParsedCUOffsets.insert(CUOffset).second)
-          cu->buildAddressRangeTable(this, true);
+          CUs.push_back(cu);
       }
     }
+    if (ctx->getParallelParsing())
+      generateInParallel(CUs);
+    else
+      for (unsigned i = 0, e = CUs.size(); i != e; ++i)
+        CUs[i]->buildAddressRangeTable(this, true);
   }
   sort(true, /* overlap size */ 0);
   return !isEmpty();
 }
 
+namespace {
+  typedef std::pair<DWARFCompileUnit *, DWARFDebugAranges *> CUArangesTask;
+
+  struct BuildCUAranges {
+    void operator()(const CUArangesTask &Task) const {
+      Task.first->buildAddressRangeTable(Task.second, true);
+    }
+  };
+}
+
+void DWARFDebugAranges::generateInParallel(ArrayRef<DWARFCompileUnit *> CUs) {
+  // Each compile unit only touches its own DIEs, so the only shared state is
+  // the range collection, which every task gets a private copy of.
+  std::vector<DWARFDebugAranges> CUAranges(CUs.size());
+  std::vector<CUArangesTask> Tasks;
+  Tasks.reserve(CUs.size());
+  for (unsigned i = 0, e = CUs.size(); i != e; ++i)
+    Tasks.push_back(CUArangesTask(CUs[i], &CUAranges[i]));
+  parallel_for_each(Tasks.begin(), Tasks.end(), BuildCUAranges());
+
+  // Ranges of different compile units are never merged by appendRange, so
+  // concatenating them is the same as appending them one by one.
+  size_t NumRanges = Aranges.size();
+  for (unsigned i = 0, e = CUAranges.size(); i != e; ++i)
+    NumRanges += CUAranges[i].Aranges.size();
+  Aranges.reserve(NumRanges);
+  for (unsigned i = 0, e = CUAranges.size(); i != e; ++i)
+    Aranges.insert(Aranges.end(), CUAranges[i].Aranges.begin(),
+                   CUAranges[i].Aranges.end());
+}
+
 void DWARFDebugAranges::dump(raw_ostream &OS) const {
   const uint32_t num_ranges = getNumRanges();
   for (uint32_t i = 0; i < num_ranges; ++i) {
@@ -11,11 +11,13 @@
 #define LLVM_DEBUGINFO_DWARFDEBUGARANGES_H
 
 #include "DWARFDebugArangeSet.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseSet.h"
 #include <list>
 
 namespace llvm {
 
+class DWARFCompileUnit;
 class DWARFContext;
 
 class DWARFDebugAranges {
@@ -95,6 +97,10 @@ public:
   typedef DenseSet<uint32_t>              ParsedCUOffsetColl;
 
 private:
+  /// Build the ranges of each compile unit in parallel and append them in
+  /// order, which gives the same result as building them one by one.
+  void generateInParallel(ArrayRef<DWARFCompileUnit *> CUs);
+
   RangeColl Aranges;
   ParsedCUOffsetColl ParsedCUOffsets;
 };
@@ -162,6 +162,17 @@ DWARFDebugLine::getOrParseLineTable(DataExtractor debug_line_data,
   return &pos.first->second;
 }
 
+void DWARFDebugLine::addLineTable(uint32_t offset, LineTable &table) {
+  std::pair<LineTableIter, bool> pos =
+    LineTableMap.insert(LineTableMapTy::value_type(offset, LineTable()));
+  if (pos.second) {
+    LineTable &cached = pos.first->second;
+    cached.Prologue = table.Prologue;
+    cached.Rows.swap(table.Rows);
+    cached.Sequences.swap(table.Sequences);
+  }
+}
+
 bool
 DWARFDebugLine::parsePrologue(DataExtractor debug_line_data,
                               uint32_t *offset_ptr, Prologue *prologue) {
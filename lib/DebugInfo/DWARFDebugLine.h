@@ -232,6 +232,9 @@ public:
   const LineTable *getLineTable(uint32_t offset) const;
   const LineTable *getOrParseLineTable(DataExtractor debug_line_data,
                                        uint32_t offset);
+  /// Cache a line table parsed by the caller, taking over its contents,
+  /// unless a table at this offset is cached already.
+  void addLineTable(uint32_t offset, LineTable &table);
 
 private:
   typedef std::map<uint32_t, LineTable> LineTableMapTy;
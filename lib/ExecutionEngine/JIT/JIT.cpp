@@ -12,8 +12,10 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "jit"
 #include "JIT.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/CodeGen/JITCodeEmitter.h"
 #include "llvm/CodeGen/MachineCodeInfo.h"
 #include "llvm/Config/config.h"
@@ -26,16 +28,29 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/ParallelIR.h"
+#include "llvm/Support/Debug.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Target/TargetJITInfo.h"
 #include "llvm/Target/TargetMachine.h"
 
 using namespace llvm;
 
+STATISTIC(NumBaselineCompiles, "Number of functions compiled at -O0 first");
+STATISTIC(NumTierUps, "Number of functions recompiled in the background");
+STATISTIC(NumTierUpsDropped,
+          "Number of functions not recompiled because the queue was full");
+STATISTIC(TierUpQueueTime,
+          "Total time functions waited for recompilation (us)");
+STATISTIC(MaxTierUpQueueTime,
+          "Longest time a function waited for recompilation (us)");
+
 #ifdef __APPLE__
 // Apple gcc defaults to -fuse-cxa-atexit (i.e. calls __cxa_atexit instead
 // of atexit). It passes the address of linker generated symbol __dso_handle
@@ -271,7 +286,8 @@ JIT::JIT(Module *M, TargetMachine &tm, TargetJITInfo &tji,
          JITMemoryManager *jmm, bool GVsWithCode)
   : ExecutionEngine(M), TM(tm), TJI(tji),
     JMM(jmm ? jmm : JITMemoryManager::CreateDefaultMemManager()),
-    AllocateGVsWithCode(GVsWithCode), isAlreadyCodeGenerating(false) {
+    AllocateGVsWithCode(GVsWithCode), isAlreadyCodeGenerating(false),
+    TierUpPool(0), MaxQueuedTierUps(0), NumQueuedTierUps(0), TierUpJCE(0) {
   setDataLayout(TM.getDataLayout());
 
   jitstate = new JITState(M);
@@ -318,11 +334,15 @@ JIT::JIT(Module *M, TargetMachine &tm, TargetJITInfo &tji,
 }
 
 JIT::~JIT() {
+  // Drop the pending recompilations.
+  EnableTieredCompilation(false);
+
   // Unregister all exception tables registered by this JIT.
   DeregisterAllTables();
   // Cleanup.
   AllJits->Remove(this);
   delete jitstate;
+  delete TierUpJCE;
   delete JCE;
   // JMM is a ownership of JCE, so we no need delete JMM here.
   delete &TM;
@@ -357,6 +377,9 @@ void JIT::addModule(Module *M) {
 /// removeModule - If we are removing the last Module, invalidate the jitstate
 /// since the PassManager it contains references a released Module.
 bool JIT::removeModule(Module *M) {
+  // The recompilations use the passes of jitstate.
+  waitForTieredCompilation();
+
   bool result = ExecutionEngine::removeModule(M);
 
   MutexGuard locked(lock);
@@ -622,7 +645,10 @@ void JIT::runJITOnFunctionUnlocked(Function *F, const MutexGuard &locked) {
   assert(!isAlreadyCodeGenerating && "Error: Recursive compilation detected!");
 
   jitTheFunction(F, locked);
+  jitPendingFunctions(locked);
+}
 
+void JIT::jitPendingFunctions(const MutexGuard &locked) {
   // If the function referred to another function that had not yet been
   // read from bitcode, and we are jitting non-lazily, emit it now.
   while (!jitstate->getPendingFunctions(locked).empty()) {
@@ -640,13 +666,205 @@ void JIT::runJITOnFunctionUnlocked(Function *F, const MutexGuard &locked) {
   }
 }
 
+/// getBaselinePM - Return the passes compiling functions for the baseline
+/// tier, which are the -O0 code generator of BaselineTM.
+FunctionPassManager &JIT::getBaselinePM(const MutexGuard &locked) {
+  OwningPtr<FunctionPassManager> &PM = jitstate->getBaselinePM(locked);
+  if (PM)
+    return *PM;
+
+  PM.reset(new FunctionPassManager(jitstate->getModule()));
+  PM->add(new DataLayout(*BaselineTM->getDataLayout()));
+  if (BaselineTM->addPassesToEmitMachineCode(*PM, *JCE))
+    report_fatal_error("Target does not support machine code emission!");
+
+  PM->doInitialization();
+  return *PM;
+}
+
+/// getTierUpPM - Return the passes recompiling functions on TierUpPool, which
+/// are the full code generator of TierUpTM.
+FunctionPassManager &JIT::getTierUpPM(const MutexGuard &locked) {
+  OwningPtr<FunctionPassManager> &PM = jitstate->getTierUpPM(locked);
+  if (PM)
+    return *PM;
+
+  PM.reset(new FunctionPassManager(jitstate->getModule()));
+  PM->add(new DataLayout(*TierUpTM->getDataLayout()));
+  if (TierUpTM->addPassesToEmitMachineCode(*PM, *TierUpJCE))
+    report_fatal_error("Target does not support machine code emission!");
+
+  PM->doInitialization();
+  return *PM;
+}
+
 void JIT::jitTheFunction(Function *F, const MutexGuard &locked) {
+  // Code that is going to be replaced anyway is compiled at -O0.
+  bool Baseline = isCompilingBaselineTier();
+  FunctionPassManager &PM = Baseline ? getBaselinePM(locked)
+                                     : jitstate->getPM(locked);
+  if (Baseline)
+    ++NumBaselineCompiles;
+
   isAlreadyCodeGenerating = true;
-  jitstate->getPM(locked).run(*F);
+  PM.run(*F);
   isAlreadyCodeGenerating = false;
 
   // clear basic block addresses after this function is done
   getBasicBlockAddressMap(locked).clear();
+
+  if (Baseline)
+    queueTierUp(F, locked);
+}
+
+namespace {
+/// TierUpRequest - A function waiting for recompilation on the TierUpPool.
+struct TierUpRequest {
+  JIT *TheJIT;
+  WeakVH F;
+  sys::TimeValue QueuedAt;
+
+  TierUpRequest(JIT *TheJIT, Function *F)
+    : TheJIT(TheJIT), F(F), QueuedAt(sys::TimeValue::now()) {}
+
+  static void run(void *Arg) {
+    TierUpRequest *R = static_cast<TierUpRequest*>(Arg);
+    R->TheJIT->tierUpFunction(R->F, R->QueuedAt);
+    // The value handle must only be touched with the lock held.
+    MutexGuard locked(R->TheJIT->lock);
+    delete R;
+  }
+};
+}
+
+void JIT::queueTierUp(Function *F, const MutexGuard &locked) {
+  // Rather than holding up the caller, keep the quick code if too many
+  // functions are waiting already.
+  if (NumQueuedTierUps >= MaxQueuedTierUps) {
+    ++NumTierUpsDropped;
+    return;
+  }
+
+  ++NumQueuedTierUps;
+  TierUpPool->async(&TierUpRequest::run, new TierUpRequest(this, F));
+}
+
+void JIT::tierUpFunction(WeakVH &FH, sys::TimeValue QueuedAt) {
+  MutexGuard TierUpLocked(TierUpLock);
+  Function *F;
+  void *OldAddr;
+  FunctionPassManager *PM;
+  OwningPtr<ParallelIR::Run> Parallel;
+  {
+    MutexGuard locked(lock);
+    --NumQueuedTierUps;
+
+    sys::TimeValue Waited = sys::TimeValue::now() - QueuedAt;
+    unsigned WaitedUS = Waited.seconds() * 1000000 + Waited.microseconds();
+    TierUpQueueTime += WaitedUS;
+    if (WaitedUS > MaxTierUpQueueTime)
+      MaxTierUpQueueTime = WaitedUS;
+
+    // Give up if tiered compilation was turned off, or if the function was
+    // deleted or freed, or its module removed, while it was queued.
+    F = dyn_cast_or_null<Function>(static_cast<Value*>(FH));
+    if (!TierUpPool || !F || !jitstate)
+      return;
+    OldAddr = getPointerToGlobalIfAvailable(F);
+    if (!OldAddr)
+      return;
+    PM = &getTierUpPM(locked);
+
+    DEBUG(dbgs() << "JIT: Recompiling '" << F->getName() << "' after waiting "
+                 << WaitedUS << "us\n");
+
+    // The baseline tier keeps compiling other functions meanwhile, which share
+    // constants and context tables with F.  Have the IR lock them, starting
+    // while nobody else generates code.
+    Parallel.reset(new ParallelIR::Run(1));
+  }
+
+  // TierUpJCE takes the lock while it writes out the code, which makes F's
+  // global mapping point to the new code.
+  {
+    ParallelIR::FunctionScope Scope(*Parallel, 0);
+    PM->run(*F);
+  }
+
+  MutexGuard locked(lock);
+  Parallel.reset();
+
+  // Threads may still be running the old code, which now starts with a jump
+  // to the new code.  It can't be freed.
+  void *Addr = getPointerToGlobalIfAvailable(F);
+  assert(Addr && "Code generation didn't add function to GlobalAddress table!");
+  TJI.replaceMachineCodeForFunction(OldAddr, Addr);
+  ++NumTierUps;
+
+  getBasicBlockAddressMap(locked).clear();
+
+  // The new code may refer to functions that aren't compiled yet.
+  jitPendingFunctions(locked);
+}
+
+void JIT::EnableTieredCompilation(bool Enabled, unsigned MaxQueued) {
+  ThreadPool *OldPool = 0;
+  {
+    MutexGuard locked(lock);
+    MaxQueuedTierUps = MaxQueued;
+    if (Enabled) {
+      // There is nothing to gain at -O0, and the quick code can only be
+      // replaced safely if the target supports patchable entries.
+      if (TierUpPool || TM.getOptLevel() == CodeGenOpt::None ||
+          !TJI.supportsPatchableEntry())
+        return;
+
+      // The tiers generate code with their own copies of TM, which are kept
+      // until the JIT is destroyed, along with the code they emitted.
+      if (!TierUpTM) {
+        const Target &T = TM.getTarget();
+        BaselineTM.reset(T.createTargetMachine(TM.getTargetTriple(),
+                                               TM.getTargetCPU(),
+                                               TM.getTargetFeatureString(),
+                                               TM.Options,
+                                               TM.getRelocationModel(),
+                                               TM.getCodeModel(),
+                                               CodeGenOpt::None));
+        TierUpTM.reset(T.createTargetMachine(TM.getTargetTriple(),
+                                             TM.getTargetCPU(),
+                                             TM.getTargetFeatureString(),
+                                             TM.Options,
+                                             TM.getRelocationModel(),
+                                             TM.getCodeModel(),
+                                             TM.getOptLevel()));
+        TierUpJCE = createTierUpEmitter(*this, *TierUpTM);
+      }
+
+      TierUpPool = new ThreadPool(1);
+      if (TierUpPool->getNumThreads() == 0) {
+        delete TierUpPool;
+        TierUpPool = 0;
+      }
+      return;
+    }
+    std::swap(OldPool, TierUpPool);
+  }
+
+  // Queued functions see that TierUpPool is gone and are dropped.  Wait for
+  // them without the lock, which they need.
+  delete OldPool;
+}
+
+void JIT::waitForTieredCompilation() {
+  ThreadPool *Pool;
+  {
+    MutexGuard locked(lock);
+    Pool = TierUpPool;
+  }
+
+  // Recompilations need the lock.
+  if (Pool)
+    Pool->wait();
 }
 
 /// getPointerToFunction - This method is used to get the address of the
@@ -15,7 +15,9 @@
 #define JIT_H
 
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/PassManager.h"
+#include "llvm/Support/TimeValue.h"
 #include "llvm/Support/ValueHandle.h"
 
 namespace llvm {
@@ -26,12 +28,21 @@ class MachineCodeEmitter;
 class MachineCodeInfo;
 class TargetJITInfo;
 class TargetMachine;
+class ThreadPool;
 
 class JITState {
 private:
   FunctionPassManager PM;  // Passes to compile a function
   Module *M;               // Module used to create the PM
 
+  /// BaselinePM - Passes to compile a function at -O0 while tiered compilation
+  /// is enabled, created on first use.
+  OwningPtr<FunctionPassManager> BaselinePM;
+
+  /// TierUpPM - Passes to recompile a function with the full code generator
+  /// on the tier-up thread, created on first use.
+  OwningPtr<FunctionPassManager> TierUpPM;
+
   /// PendingFunctions - Functions which have not been code generated yet, but
   /// were called from a function being code generated.
   std::vector<AssertingVH<Function> > PendingFunctions;
@@ -43,6 +54,14 @@ public:
     return PM;
   }
 
+  OwningPtr<FunctionPassManager> &getBaselinePM(const MutexGuard &L) {
+    return BaselinePM;
+  }
+
+  OwningPtr<FunctionPassManager> &getTierUpPM(const MutexGuard &L) {
+    return TierUpPM;
+  }
+
   Module *getModule() const { return M; }
   std::vector<AssertingVH<Function> > &getPendingFunctions(const MutexGuard &L){
     return PendingFunctions;
@@ -77,6 +96,29 @@ class JIT : public ExecutionEngine {
   /// taken.
   BasicBlockAddressMapTy BasicBlockAddressMap;
 
+  /// TierUpPool - The thread recompiling functions with the full code
+  /// generator if tiered compilation is enabled, null otherwise.
+  ThreadPool *TierUpPool;
+
+  /// MaxQueuedTierUps - The maximum number of functions waiting for TierUpPool.
+  unsigned MaxQueuedTierUps;
+
+  /// NumQueuedTierUps - The number of functions waiting for TierUpPool.
+  unsigned NumQueuedTierUps;
+
+  /// BaselineTM - A copy of TM generating code at -O0, for the baseline tier.
+  OwningPtr<TargetMachine> BaselineTM;
+
+  /// TierUpTM/TierUpJCE - A copy of TM and an emitter sharing JCE's memory
+  /// manager and stubs, used only by TierUpPool.  Generating code doesn't
+  /// need the JIT lock; TierUpJCE takes it while it writes out the code.
+  OwningPtr<TargetMachine> TierUpTM;
+  JITCodeEmitter *TierUpJCE;
+
+  /// TierUpLock - Held while a function is recompiled.  Threads waiting for
+  /// TierUpPool run its queued tasks too, but the passes are not reentrant.
+  sys::Mutex TierUpLock;
+
 
   JIT(Module *M, TargetMachine &tm, TargetJITInfo &tji,
       JITMemoryManager *JMM, bool AllocateGVsWithCode);
@@ -193,6 +235,22 @@ public:
 
   virtual void RegisterJITEventListener(JITEventListener *L);
   virtual void UnregisterJITEventListener(JITEventListener *L);
+
+  virtual void EnableTieredCompilation(bool Enabled = true,
+                                       unsigned MaxQueued = 64);
+  virtual void waitForTieredCompilation();
+
+  /// isCompilingBaselineTier - True if the functions JCE emits are compiled
+  /// quickly, to be recompiled in the background later.  Such functions start
+  /// with a patchable entry.
+  bool isCompilingBaselineTier() const {
+    return TierUpPool != 0;
+  }
+
+  /// tierUpFunction - Recompile the function FH refers to, which was queued
+  /// at QueuedAt, with the full code generator and redirect its quickly
+  /// compiled code to the result.  Called on TierUpPool without the lock.
+  void tierUpFunction(WeakVH &FH, sys::TimeValue QueuedAt);
   /// These functions correspond to the methods on JITEventListener.  They
   /// iterate over the registered listeners and call the corresponding method on
   /// each.
@@ -208,11 +266,19 @@ public:
 
 
 private:
+  /// createTierUpEmitter - Create an emitter for the code TM generates on
+  /// TierUpPool, sharing the memory manager and stubs of J's emitter.
+  static JITCodeEmitter *createTierUpEmitter(JIT &J, TargetMachine &TM);
+
   static JITCodeEmitter *createEmitter(JIT &J, JITMemoryManager *JMM,
                                        TargetMachine &tm);
   void runJITOnFunctionUnlocked(Function *F, const MutexGuard &locked);
   void updateFunctionStub(Function *F);
   void jitTheFunction(Function *F, const MutexGuard &locked);
+  void jitPendingFunctions(const MutexGuard &locked);
+  FunctionPassManager &getBaselinePM(const MutexGuard &locked);
+  FunctionPassManager &getTierUpPM(const MutexGuard &locked);
+  void queueTierUp(Function *F, const MutexGuard &locked);
 
 protected:
 
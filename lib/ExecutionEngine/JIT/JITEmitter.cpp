@@ -322,8 +322,12 @@ namespace {
     ///
     void *JumpTableBase;
 
+    /// OwnResolver - The resolver of the JIT's own emitter, null in emitters
+    /// sharing it.
+    OwningPtr<JITResolver> OwnResolver;
+
     /// Resolver - This contains info about the currently resolved functions.
-    JITResolver Resolver;
+    JITResolver &Resolver;
 
     /// DE - The dwarf emitter for the jit.
     OwningPtr<JITDwarfEmitter> DE;
@@ -363,17 +367,28 @@ namespace {
     /// Instance of the JIT
     JIT *TheJIT;
 
+    /// Primary - The emitter whose memory manager and stubs this one shares,
+    /// or null for the JIT's own emitter.  Such emitters write out the code
+    /// recompiled on the tier-up thread.
+    JITEmitter *Primary;
+
     bool JITExceptionHandling;
 
   public:
-    JITEmitter(JIT &jit, JITMemoryManager *JMM, TargetMachine &TM)
-      : SizeEstimate(0), Resolver(jit, *this), MMI(0), CurFn(0),
-        EmittedFunctions(this), TheJIT(&jit),
+    JITEmitter(JIT &jit, JITMemoryManager *JMM, TargetMachine &TM,
+               JITEmitter *primary = 0)
+      : SizeEstimate(0), OwnResolver(primary ? 0 : new JITResolver(jit, *this)),
+        Resolver(primary ? primary->Resolver : *OwnResolver), MMI(0),
+        CurFn(0), EmittedFunctions(this), TheJIT(&jit), Primary(primary),
         JITExceptionHandling(TM.Options.JITExceptionHandling) {
-      MemMgr = JMM ? JMM : JITMemoryManager::CreateDefaultMemManager();
-      if (jit.getJITInfo().needsGOT()) {
-        MemMgr->AllocateGOT();
-        DEBUG(dbgs() << "JIT is managing a GOT\n");
+      if (Primary) {
+        MemMgr = Primary->MemMgr;
+      } else {
+        MemMgr = JMM ? JMM : JITMemoryManager::CreateDefaultMemManager();
+        if (jit.getJITInfo().needsGOT()) {
+          MemMgr->AllocateGOT();
+          DEBUG(dbgs() << "JIT is managing a GOT\n");
+        }
       }
 
       if (JITExceptionHandling) {
@@ -381,7 +396,8 @@ namespace {
       }
     }
     ~JITEmitter() {
-      delete MemMgr;
+      if (!Primary)
+        delete MemMgr;
     }
 
     JITResolver &getJITResolver() { return Resolver; }
@@ -391,7 +407,7 @@ namespace {
 
     void emitConstantPool(MachineConstantPool *MCP);
     void initJumpTableInfo(MachineJumpTableInfo *MJTI);
-    void emitJumpTableInfo(MachineJumpTableInfo *MJTI);
+    void emitJumpTableInfo(MachineJumpTableInfo *MJTI, TargetJITInfo &TJI);
 
     void startGVStub(const GlobalValue* GV,
                      unsigned StubSize, unsigned Alignment = 1);
@@ -437,6 +453,7 @@ namespace {
     /// retryWithMoreMemory - Log a retry and deallocate all memory for the
     /// given function.  Increase the minimum allocation size so that we get
     /// more memory next time.
+    bool finishFunctionLocked(MachineFunction &F);
     void retryWithMoreMemory(MachineFunction &F);
 
     /// deallocateMemForFunction - Deallocate all memory for the specified
@@ -774,6 +791,10 @@ static unsigned GetConstantPoolSizeInBytes(MachineConstantPool *MCP,
 }
 
 void JITEmitter::startFunction(MachineFunction &F) {
+  // Code generated on the tier-up thread is written out under the lock, like
+  // all other code.  It is released by finishFunction.
+  TheJIT->lock.acquire();
+
   DEBUG(dbgs() << "JIT: Starting CodeGen of Function "
         << F.getName() << "\n");
 
@@ -803,6 +824,11 @@ void JITEmitter::startFunction(MachineFunction &F) {
   TheJIT->updateGlobalMapping(F.getFunction(), CurBufferPtr);
   EmittedFunctions[F.getFunction()].Code = CurBufferPtr;
 
+  // Code that will be replaced while it may be running needs an entry that
+  // can be patched atomically.
+  if (!Primary && TheJIT->isCompilingBaselineTier())
+    TheJIT->getJITInfo().emitPatchableEntry(*this);
+
   MBBLocations.clear();
 
   EmissionDetails.MF = &F;
@@ -810,6 +836,12 @@ void JITEmitter::startFunction(MachineFunction &F) {
 }
 
 bool JITEmitter::finishFunction(MachineFunction &F) {
+  bool Retry = finishFunctionLocked(F);
+  TheJIT->lock.release();
+  return Retry;
+}
+
+bool JITEmitter::finishFunctionLocked(MachineFunction &F) {
   if (CurBufferPtr == BufferEnd) {
     // We must call endFunctionBody before retrying, because
     // deallocateMemForFunction requires it.
@@ -818,8 +850,11 @@ bool JITEmitter::finishFunction(MachineFunction &F) {
     return true;
   }
 
+  // The jump tables depend on the state of the JITInfo that generated F,
+  // which isn't the JIT's own if F was compiled by one of the tiers.
   if (MachineJumpTableInfo *MJTI = F.getJumpTableInfo())
-    emitJumpTableInfo(MJTI);
+    emitJumpTableInfo(MJTI,
+        *const_cast<TargetMachine&>(F.getTarget()).getJITInfo());
 
   // FnStart is the start of the text, not the start of the constant pool and
   // other per-function data.
@@ -1109,8 +1144,9 @@ void JITEmitter::initJumpTableInfo(MachineJumpTableInfo *MJTI) {
                              MJTI->getEntryAlignment(*TheJIT->getDataLayout()));
 }
 
-void JITEmitter::emitJumpTableInfo(MachineJumpTableInfo *MJTI) {
-  if (TheJIT->getJITInfo().hasCustomJumpTables())
+void JITEmitter::emitJumpTableInfo(MachineJumpTableInfo *MJTI,
+                                   TargetJITInfo &TJI) {
+  if (TJI.hasCustomJumpTables())
     return;
 
   const std::vector<MachineJumpTableEntry> &JT = MJTI->getJumpTables();
@@ -1156,7 +1192,7 @@ void JITEmitter::emitJumpTableInfo(MachineJumpTableInfo *MJTI) {
       for (unsigned mi = 0, me = MBBs.size(); mi != me; ++mi) {
         uintptr_t MBBAddr = getMachineBasicBlockAddress(MBBs[mi]);
         /// FIXME: USe EntryKind instead of magic "getPICJumpTableEntry" hook.
-        *SlotPtr++ = TheJIT->getJITInfo().getPICJumpTableEntry(MBBAddr, Base);
+        *SlotPtr++ = TJI.getPICJumpTableEntry(MBBAddr, Base);
       }
     }
     break;
@@ -1250,6 +1286,11 @@ JITCodeEmitter *JIT::createEmitter(JIT &jit, JITMemoryManager *JMM,
   return new JITEmitter(jit, JMM, tm);
 }
 
+JITCodeEmitter *JIT::createTierUpEmitter(JIT &jit, TargetMachine &tm) {
+  return new JITEmitter(jit, 0, tm,
+                        static_cast<JITEmitter*>(jit.getCodeEmitter()));
+}
+
 // getPointerToFunctionOrStub - If the specified function has been
 // code-gen'd, return a pointer to the function.  If not, compile it, or use
 // a stub to implement lazy compilation if available.
@@ -1286,6 +1327,9 @@ void JIT::freeMachineCodeForFunction(Function *F) {
   // retranslated next time it is used.
   updateGlobalMapping(F, 0);
 
-  // Free the actual memory for the function body and related stuff.
+  // Free the actual memory for the function body and related stuff, of the
+  // recompiled code as well.
   static_cast<JITEmitter*>(JCE)->deallocateMemForFunction(F);
+  if (TierUpJCE)
+    static_cast<JITEmitter*>(TierUpJCE)->deallocateMemForFunction(F);
 }
@@ -8,11 +8,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "MCJIT.h"
+#include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/JITMemoryManager.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "llvm/ExecutionEngine/ObjectBuffer.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/ObjectImage.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -20,8 +22,10 @@
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
 
@@ -51,93 +55,166 @@ ExecutionEngine *MCJIT::createJIT(Module *M,
 
 MCJIT::MCJIT(Module *m, TargetMachine *tm, RTDyldMemoryManager *MM,
              bool AllocateGVsWithCode)
-  : ExecutionEngine(m), TM(tm), Ctx(0), MemMgr(MM), Dyld(MM),
-    isCompiled(false), M(m)  {
+  : ExecutionEngine(m), TM(tm), Ctx(0), MemMgr(MM), Dyld(MM), ObjCache(0) {
 
   setDataLayout(TM->getDataLayout());
 }
 
 MCJIT::~MCJIT() {
-  if (LoadedObject)
-    NotifyFreeingObject(*LoadedObject.get());
+  for (LoadedObjectMap::iterator I = LoadedObjects.begin(),
+       E = LoadedObjects.end(); I != E; ++I) {
+    NotifyFreeingObject(*I->second);
+    delete I->second;
+  }
   delete MemMgr;
   delete TM;
 }
 
-void MCJIT::emitObject(Module *m) {
-  /// Currently, MCJIT only supports a single module and the module passed to
-  /// this function call is expected to be the contained module.  The module
-  /// is passed as a parameter here to prepare for multiple module support in
-  /// the future.
-  assert(M == m);
+bool MCJIT::removeModule(Module *m) {
+  MutexGuard locked(lock);
+  if (!ExecutionEngine::removeModule(m))
+    return false;
+
+  LoadedObjectMap::iterator I = LoadedObjects.find(m);
+  if (I != LoadedObjects.end()) {
+    ObjectImage *Obj = I->second;
+    LoadedObjects.erase(I);
+    NotifyFreeingObject(*Obj);
+    // Give the sections back to the memory manager.
+    Dyld.unloadObject(Obj);
+    delete Obj;
+  }
+  return true;
+}
 
+void MCJIT::emitObject(Module *m) {
   // Get a thread lock to make sure we aren't trying to compile multiple times
   MutexGuard locked(lock);
 
-  // FIXME: Track compilation state on a per-module basis when multiple modules
-  //        are supported.
   // Re-compilation is not supported
-  if (isCompiled)
+  if (LoadedObjects.count(m))
     return;
 
-  PassManager PM;
+  // The RuntimeDyld will take ownership of this shortly
+  OwningPtr<ObjectBuffer> Buffer;
+
+  std::string CacheKey;
+  if (ObjCache) {
+    CacheKey = getObjectCacheKey(m);
+    OwningPtr<MemoryBuffer> CachedObj(ObjCache->getObject(CacheKey));
+    // The dynamic linker applies relocations in place, so give it a copy.
+    if (CachedObj)
+      Buffer.reset(new ObjectBuffer(
+        MemoryBuffer::getMemBufferCopy(CachedObj->getBuffer(),
+                                       CachedObj->getBufferIdentifier())));
+  }
 
-  PM.add(new DataLayout(*TM->getDataLayout()));
+  if (!Buffer) {
+    PassManager PM;
 
-  // The RuntimeDyld will take ownership of this shortly
-  OwningPtr<ObjectBufferStream> Buffer(new ObjectBufferStream());
+    PM.add(new DataLayout(*TM->getDataLayout()));
 
-  // Turn the machine code intermediate representation into bytes in memory
-  // that may be executed.
-  if (TM->addPassesToEmitMC(PM, Ctx, Buffer->getOStream(), false)) {
-    report_fatal_error("Target does not support MC emission!");
-  }
+    OwningPtr<ObjectBufferStream> CompiledObj(new ObjectBufferStream());
+
+    // Turn the machine code intermediate representation into bytes in memory
+    // that may be executed.
+    if (TM->addPassesToEmitMC(PM, Ctx, CompiledObj->getOStream(), false)) {
+      report_fatal_error("Target does not support MC emission!");
+    }
+
+    // Initialize passes.
+    PM.run(*m);
+    // Flush the output buffer to get the generated code into memory
+    CompiledObj->flush();
+
+    if (ObjCache) {
+      OwningPtr<MemoryBuffer> Obj(CompiledObj->getMemBuffer());
+      ObjCache->notifyObjectCompiled(CacheKey, Obj.get());
+    }
 
-  // Initialize passes.
-  PM.run(*m);
-  // Flush the output buffer to get the generated code into memory
-  Buffer->flush();
+    Buffer.reset(CompiledObj.take());
+  }
 
   // Load the object into the dynamic linker.
   // handing off ownership of the buffer
-  LoadedObject.reset(Dyld.loadObject(Buffer.take()));
+  ObjectImage *LoadedObject = Dyld.loadObject(Buffer.take());
   if (!LoadedObject)
     report_fatal_error(Dyld.getErrorString());
-
-  // Resolve any relocations.
-  Dyld.resolveRelocations();
+  LoadedObjects[m] = LoadedObject;
 
   // FIXME: Make this optional, maybe even move it to a JIT event listener
   LoadedObject->registerWithDebugger();
 
   NotifyObjectEmitted(*LoadedObject);
+}
+
+void MCJIT::generateCodeForModules() {
+  MutexGuard locked(lock);
 
-  // FIXME: Add support for per-module compilation state
-  isCompiled = true;
+  // Load all the new objects before resolving anything, so that they can
+  // refer to each other.
+  bool Emitted = false;
+  for (unsigned i = 0, e = Modules.size(); i != e; ++i) {
+    if (LoadedObjects.count(Modules[i]))
+      continue;
+    emitObject(Modules[i]);
+    Emitted = true;
+  }
+
+  // Resolve any relocations.
+  if (Emitted)
+    Dyld.resolveRelocations();
 }
 
-// FIXME: Add a parameter to identify which object is being finalized when
-// MCJIT supports multiple modules.
-// FIXME: Provide a way to separate code emission, relocations and page 
+std::string MCJIT::getObjectCacheKey(Module *m) {
+  MD5 Hash;
+
+  // The bitcode covers everything in the module, including its data layout
+  // and triple.
+  SmallString<4096> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(m, OS);
+  }
+  Hash.update(Bitcode.str());
+
+  // Add the target and all of the code generation options.  Strings are
+  // separated by NUL bytes so they can't run together.
+  std::string Options;
+  {
+    raw_string_ostream OS(Options);
+    OS << TM->getTargetTriple() << '\0' << TM->getTargetCPU() << '\0'
+       << TM->getTargetFeatureString() << '\0'
+       << unsigned(TM->getRelocationModel()) << ' '
+       << unsigned(TM->getCodeModel()) << ' '
+       << unsigned(TM->getOptLevel()) << ' ';
+    TM->Options.serialize(OS);
+  }
+  Hash.update(Options);
+
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Key;
+  MD5::stringifyResult(Result, Key);
+  return Key.str();
+}
+
+// FIXME: Provide a way to separate code emission, relocations and page
 // protection in the interface.
 void MCJIT::finalizeObject() {
-  // If the module hasn't been compiled, just do that.
-  if (!isCompiled) {
-    // If the call to Dyld.resolveRelocations() is removed from emitObject()
-    // we'll need to do that here.
-    emitObject(M);
-
-    // Set page permissions.
-    MemMgr->applyPermissions();
+  MutexGuard locked(lock);
 
-    return;
-  }
+  generateCodeForModules();
 
-  // Resolve any relocations.
+  // Resolve the relocations again, the client may have remapped sections
+  // since they were emitted.
   Dyld.resolveRelocations();
 
   // Set page permissions.
   MemMgr->applyPermissions();
+
+  // The code is final now, don't touch it when more modules are added.
+  Dyld.discardResolvedRelocations();
 }
 
 void *MCJIT::getPointerToBasicBlock(BasicBlock *BB) {
@@ -150,27 +227,30 @@ void *MCJIT::getPointerToFunction(Function *F) {
   // ExecutionEngine interface, though. Fix that when the old JIT finally
   // dies.
 
-  // FIXME: Add support for per-module compilation state
-  if (!isCompiled)
-    emitObject(M);
+  generateCodeForModules();
 
   if (F->isDeclaration() || F->hasAvailableExternallyLinkage()) {
+    // The function may be defined by another module.
+    if (uint64_t Addr = getSymbolLoadAddress(F->getName()))
+      return (void*)Addr;
     bool AbortOnFailure = !F->hasExternalWeakLinkage();
     void *Addr = getPointerToNamedFunction(F->getName(), AbortOnFailure);
     addGlobalMapping(F, Addr);
     return Addr;
   }
 
-  // FIXME: Should the Dyld be retaining module information? Probably not.
-  // FIXME: Should we be using the mangler for this? Probably.
-  //
   // This is the accessor for the target address, so make sure to check the
   // load address of the symbol, not the local address.
-  StringRef BaseName = F->getName();
+  return (void*)getSymbolLoadAddress(F->getName());
+}
+
+uint64_t MCJIT::getSymbolLoadAddress(StringRef BaseName) {
+  // FIXME: Should the Dyld be retaining module information? Probably not.
+  // FIXME: Should we be using the mangler for this? Probably.
   if (BaseName[0] == '\1')
-    return (void*)Dyld.getSymbolLoadAddress(BaseName.substr(1));
-  return (void*)Dyld.getSymbolLoadAddress((TM->getMCAsmInfo()->getGlobalPrefix()
-                                       + BaseName).str());
+    return Dyld.getSymbolLoadAddress(BaseName.substr(1));
+  return Dyld.getSymbolLoadAddress((TM->getMCAsmInfo()->getGlobalPrefix()
+                                    + BaseName).str());
 }
 
 void *MCJIT::recompileAndRelinkFunction(Function *F) {
@@ -283,9 +363,7 @@ GenericValue MCJIT::runFunction(Function *F,
 
 void *MCJIT::getPointerToNamedFunction(const std::string &Name,
                                        bool AbortOnFailure) {
-  // FIXME: Add support for per-module compilation state
-  if (!isCompiled)
-    emitObject(M);
+  generateCodeForModules();
 
   if (!isSymbolSearchingDisabled() && MemMgr) {
     void *ptr = MemMgr->getPointerToNamedFunction(Name, false);
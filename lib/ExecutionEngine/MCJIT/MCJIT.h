@@ -10,6 +10,7 @@
 #ifndef LLVM_LIB_EXECUTIONENGINE_MCJIT_H
 #define LLVM_LIB_EXECUTIONENGINE_MCJIT_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
@@ -17,11 +18,17 @@
 
 namespace llvm {
 
+class ObjectCache;
 class ObjectImage;
 
 // FIXME: This makes all kinds of horrible assumptions for the time being,
-// like only having one module, not needing to worry about multi-threading,
-// blah blah. Purely in get-it-up-and-limping mode for now.
+// like not needing to worry about multi-threading, blah blah. Purely in
+// get-it-up-and-limping mode for now.
+//
+// Every module is compiled into its own object, which is linked against the
+// objects loaded before it.  Modules may be added after the engine has been
+// finalized; they are compiled the next time code is requested or the engine
+// is finalized again.  Removing a module unloads its object.
 
 class MCJIT : public ExecutionEngine {
   MCJIT(Module *M, TargetMachine *tm, RTDyldMemoryManager *MemMgr,
@@ -32,11 +39,11 @@ class MCJIT : public ExecutionEngine {
   RTDyldMemoryManager *MemMgr;
   RuntimeDyld Dyld;
   SmallVector<JITEventListener*, 2> EventListeners;
+  ObjectCache *ObjCache;
 
-  // FIXME: Add support for multiple modules
-  bool isCompiled;
-  Module *M;
-  OwningPtr<ObjectImage> LoadedObject;
+  /// LoadedObjects - The object emitted for each module compiled so far.
+  typedef DenseMap<Module*, ObjectImage*> LoadedObjectMap;
+  LoadedObjectMap LoadedObjects;
 
 public:
   ~MCJIT();
@@ -44,6 +51,14 @@ public:
   /// @name ExecutionEngine interface implementation
   /// @{
 
+  /// removeModule - Remove \p M from the engine and unload its code.  Code of
+  /// the other modules must not refer to \p M anymore.
+  virtual bool removeModule(Module *M);
+
+  /// finalizeObject - Compile the modules added since the last call, resolve
+  /// their relocations and make their code executable.  The code finalized
+  /// before is left untouched, so its sections must not be remapped after
+  /// this call.
   virtual void finalizeObject();
 
   virtual void *getPointerToBasicBlock(BasicBlock *BB);
@@ -80,6 +95,8 @@ public:
   virtual void RegisterJITEventListener(JITEventListener *L);
   virtual void UnregisterJITEventListener(JITEventListener *L);
 
+  virtual void setObjectCache(ObjectCache *C) { ObjCache = C; }
+
   /// @}
   /// @name (Private) Registration Interfaces
   /// @{
@@ -98,12 +115,22 @@ public:
 
 protected:
   /// emitObject -- Generate a JITed object in memory from the specified module
-  /// Currently, MCJIT only supports a single module and the module passed to
-  /// this function call is expected to be the contained module.  The module
-  /// is passed as a parameter here to prepare for multiple module support in 
-  /// the future.
+  /// and load it into the dynamic linker.  Relocations are not resolved.
   void emitObject(Module *M);
 
+  /// generateCodeForModules - Emit an object for every module that hasn't been
+  /// compiled yet, and resolve the relocations if there were any.
+  void generateCodeForModules();
+
+  /// getSymbolLoadAddress - Return the target address of the global called
+  /// \p Name in one of the loaded objects, or zero if there is none.
+  uint64_t getSymbolLoadAddress(StringRef Name);
+
+  /// getObjectCacheKey - Return the key under which the object code for \p M
+  /// is cached: a digest of the module and everything that affects the code
+  /// generated for it.
+  std::string getObjectCacheKey(Module *M);
+
   void NotifyObjectEmitted(const ObjectImage& Obj);
   void NotifyFreeingObject(const ObjectImage& Obj);
 };
@@ -16,6 +16,9 @@
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 
 #ifdef __linux__
   // These includes used by SectionMemoryManager::getPointerToNamedFunction()
@@ -29,6 +32,11 @@
 
 namespace llvm {
 
+const uintptr_t SectionMemoryManager::DefaultSlabSize;
+
+SectionMemoryManager::SectionMemoryManager(uintptr_t SlabSize)
+  : SlabSize(SlabSize) {}
+
 uint8_t *SectionMemoryManager::allocateDataSection(uintptr_t Size,
                                                     unsigned Alignment,
                                                     unsigned SectionID,
@@ -44,6 +52,20 @@ uint8_t *SectionMemoryManager::allocateCodeSection(uintptr_t Size,
   return allocateSection(CodeMem, Size, Alignment);
 }
 
+/// Return the index of the slab containing \p Addr, or the number of slabs if
+/// there is none.
+template <typename SlabListTy>
+static unsigned findSlab(const SlabListTy &Slabs, const void *Addr) {
+  for (unsigned i = 0, e = Slabs.size(); i != e; ++i)
+    if (Slabs[i].contains(Addr))
+      return i;
+  return Slabs.size();
+}
+
+static uintptr_t alignAddr(uintptr_t Addr, unsigned Alignment) {
+  return (Addr + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+}
+
 uint8_t *SectionMemoryManager::allocateSection(MemoryGroup &MemGroup,
                                                uintptr_t Size,
                                                unsigned Alignment) {
@@ -52,40 +74,57 @@ uint8_t *SectionMemoryManager::allocateSection(MemoryGroup &MemGroup,
 
   assert(!(Alignment & (Alignment - 1)) && "Alignment must be a power of two.");
 
-  uintptr_t RequiredSize = Alignment * ((Size + Alignment - 1)/Alignment + 1);
-  uintptr_t Addr = 0;
+  // Even an empty section takes a byte, so that its address lies within its
+  // slab.  The end of a slab may be the start of the next one.
+  uintptr_t Reserved = std::max<uintptr_t>(Size, 1);
 
-  // Look in the list of free memory regions and use a block there if one
-  // is available.
-  for (int i = 0, e = MemGroup.FreeMem.size(); i != e; ++i) {
+  // Look in the list of deallocated sections and reuse one if it is large
+  // enough.
+  for (unsigned i = 0, e = MemGroup.FreeMem.size(); i != e; ++i) {
     sys::MemoryBlock &MB = MemGroup.FreeMem[i];
-    if (MB.size() >= RequiredSize) {
-      Addr = (uintptr_t)MB.base();
-      uintptr_t EndOfBlock = Addr + MB.size();
-      // Align the address.
-      Addr = (Addr + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
-      // Store cutted free memory block.
-      MemGroup.FreeMem[i] = sys::MemoryBlock((void*)(Addr + Size),
-                                             EndOfBlock - Addr - Size);
+    uintptr_t EndOfBlock = (uintptr_t)MB.base() + MB.size();
+    uintptr_t Addr = alignAddr((uintptr_t)MB.base(), Alignment);
+    if (Addr + Reserved > EndOfBlock)
+      continue;
+
+    // Store cutted free memory block.
+    if (Addr + Reserved == EndOfBlock)
+      MemGroup.FreeMem.erase(MemGroup.FreeMem.begin() + i);
+    else
+      MB = sys::MemoryBlock((void*)(Addr + Reserved),
+                            EndOfBlock - Addr - Reserved);
+
+    unsigned Index = findSlab(MemGroup.Slabs, (void*)Addr);
+    assert(Index != MemGroup.Slabs.size() && "Free memory outside the slabs!");
+    Slab &S = MemGroup.Slabs[Index];
+    ++S.NumSections;
+    S.SectionBytes += Size;
+    return (uint8_t*)Addr;
+  }
+
+  // Carve the section from the end of the current slab if it fits.
+  if (!MemGroup.Slabs.empty()) {
+    Slab &S = MemGroup.Slabs.back();
+    uintptr_t Addr = alignAddr((uintptr_t)S.base() + S.Used, Alignment);
+    if (Addr + Reserved <= (uintptr_t)S.base() + S.Block.size()) {
+      S.Used = Addr + Reserved - (uintptr_t)S.base();
+      ++S.NumSections;
+      S.SectionBytes += Size;
       return (uint8_t*)Addr;
     }
   }
 
-  // No pre-allocated free block was large enough. Allocate a new memory region.
-  // Note that all sections get allocated as read-write.  The permissions will
-  // be updated later based on memory group.
-  //
-  // FIXME: It would be useful to define a default allocation size (or add
-  // it as a constructor parameter) to minimize the number of allocations.
-  //
-  // FIXME: Initialize the Near member for each memory group to avoid
-  // interleaving.
+  // Map a new slab.  Note that all sections get allocated as read-write.  The
+  // permissions will be updated later based on memory group.  Mapping the
+  // slabs of a group next to each other lets applyPermissions protect them
+  // with a single call.
   error_code ec;
-  sys::MemoryBlock MB = sys::Memory::allocateMappedMemory(RequiredSize,
-                                                          &MemGroup.Near,
-                                                          sys::Memory::MF_READ |
-                                                            sys::Memory::MF_WRITE,
-                                                          ec);
+  sys::MemoryBlock MB =
+    sys::Memory::allocateMappedMemory(std::max(SlabSize, Reserved + Alignment),
+                                      &MemGroup.Near,
+                                      sys::Memory::MF_READ |
+                                        sys::Memory::MF_WRITE,
+                                      ec);
   if (ec) {
     // FIXME: Add error propogation to the interface.
     return NULL;
@@ -94,20 +133,20 @@ uint8_t *SectionMemoryManager::allocateSection(MemoryGroup &MemGroup,
   // Save this address as the basis for our next request
   MemGroup.Near = MB;
 
-  MemGroup.AllocatedMem.push_back(MB);
-  Addr = (uintptr_t)MB.base();
-  uintptr_t EndOfBlock = Addr + MB.size();
-
-  // Align the address.
-  Addr = (Addr + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+  Slab New(MB);
+  uintptr_t Addr = alignAddr((uintptr_t)New.base(), Alignment);
+  New.Used = Addr + Reserved - (uintptr_t)New.base();
+  New.NumSections = 1;
+  New.SectionBytes = Size;
 
-  // The allocateMappedMemory may allocate much more memory than we need. In
-  // this case, we store the unused memory as a free memory block.
-  unsigned FreeSize = EndOfBlock-Addr-Size;
-  if (FreeSize > 16)
-    MemGroup.FreeMem.push_back(sys::MemoryBlock((void*)(Addr + Size), FreeSize));
+  // Keep carving from the slab with the most room left.
+  if (!MemGroup.Slabs.empty() &&
+      MemGroup.Slabs.back().Block.size() - MemGroup.Slabs.back().Used >
+        New.Block.size() - New.Used)
+    MemGroup.Slabs.insert(MemGroup.Slabs.end() - 1, New);
+  else
+    MemGroup.Slabs.push_back(New);
 
-  // Return aligned address
   return (uint8_t*)Addr;
 }
 
@@ -143,23 +182,121 @@ bool SectionMemoryManager::applyPermissions(std::string *ErrMsg)
 
 error_code SectionMemoryManager::applyMemoryGroupPermissions(MemoryGroup &MemGroup,
                                                              unsigned Permissions) {
+  static const uintptr_t PageSize = sys::process::get_self()->page_size();
+
+  // Collect the pages filled since the last call.  Later sections must not
+  // share these pages, so they start on the next page of the slab.
+  SmallVector<std::pair<uint8_t*, uint8_t*>, 8> Ranges;
+  for (unsigned i = 0, e = MemGroup.Slabs.size(); i != e; ++i) {
+    Slab &S = MemGroup.Slabs[i];
+    uintptr_t End = std::min<uintptr_t>(RoundUpToAlignment(S.Used, PageSize),
+                                        S.Block.size());
+    if (End == S.Protected)
+      continue;
+    Ranges.push_back(std::make_pair(S.base() + S.Protected, S.base() + End));
+    S.Protected = S.Used = End;
+  }
 
-  for (int i = 0, e = MemGroup.AllocatedMem.size(); i != e; ++i) {
-      error_code ec;
-      ec = sys::Memory::protectMappedMemory(MemGroup.AllocatedMem[i],
-                                            Permissions);
-      if (ec) {
-        return ec;
-      }
+  // Protect runs of adjacent slabs at once.
+  std::sort(Ranges.begin(), Ranges.end());
+  for (unsigned i = 0, e = Ranges.size(); i != e; ) {
+    uint8_t *Start = Ranges[i].first, *End = Ranges[i].second;
+    for (++i; i != e && Ranges[i].first == End; ++i)
+      End = Ranges[i].second;
+
+    error_code ec;
+    sys::MemoryBlock MB(Start, End - Start);
+    ec = sys::Memory::protectMappedMemory(MB, Permissions);
+    if (ec) {
+      return ec;
+    }
   }
 
   return error_code::success();
 }
 
+void SectionMemoryManager::deallocateSection(uint8_t *Addr, uintptr_t Size,
+                                             unsigned SectionID) {
+  if (deallocateFromGroup(CodeMem, Addr, Size) ||
+      deallocateFromGroup(RODataMem, Addr, Size) ||
+      deallocateFromGroup(RWDataMem, Addr, Size))
+    return;
+  llvm_unreachable("Deallocating a section that wasn't allocated here!");
+}
+
+bool SectionMemoryManager::deallocateFromGroup(MemoryGroup &MemGroup,
+                                               uint8_t *Addr,
+                                               uintptr_t Size) {
+  unsigned Index = findSlab(MemGroup.Slabs, Addr);
+  if (Index == MemGroup.Slabs.size())
+    return false;
+
+  Slab &S = MemGroup.Slabs[Index];
+  assert(S.NumSections && S.SectionBytes >= Size && "Section freed twice?");
+  --S.NumSections;
+  S.SectionBytes -= Size;
+
+  if (S.NumSections == 0) {
+    // The slab is empty, give it back to the system along with the free
+    // pieces carved out of it.
+    for (unsigned i = 0; i != MemGroup.FreeMem.size(); ) {
+      if (S.contains(MemGroup.FreeMem[i].base()))
+        MemGroup.FreeMem.erase(MemGroup.FreeMem.begin() + i);
+      else
+        ++i;
+    }
+    if (MemGroup.Near.base() == S.Block.base())
+      MemGroup.Near = sys::MemoryBlock();
+    sys::MemoryBlock MB = S.Block;
+    MemGroup.Slabs.erase(MemGroup.Slabs.begin() + Index);
+    sys::Memory::releaseMappedMemory(MB);
+    return true;
+  }
+
+  // The most recent section of a slab can be handed out again as long as its
+  // pages are writable.  Read-write data can be reused anywhere.
+  uintptr_t Offset = Addr - S.base();
+  if (Offset >= S.Protected && Offset + std::max<uintptr_t>(Size, 1) == S.Used)
+    S.Used = Offset;
+  else if (&MemGroup == &RWDataMem && Size != 0)
+    MemGroup.FreeMem.push_back(sys::MemoryBlock(Addr, Size));
+  return true;
+}
+
 void SectionMemoryManager::invalidateInstructionCache() {
-  for (int i = 0, e = CodeMem.AllocatedMem.size(); i != e; ++i)
-    sys::Memory::InvalidateInstructionCache(CodeMem.AllocatedMem[i].base(),
-                                            CodeMem.AllocatedMem[i].size());
+  for (unsigned i = 0, e = CodeMem.Slabs.size(); i != e; ++i)
+    sys::Memory::InvalidateInstructionCache(CodeMem.Slabs[i].base(),
+                                            CodeMem.Slabs[i].Used);
+}
+
+SectionMemoryManager::MemoryStats
+SectionMemoryManager::getStats(const MemoryGroup &MemGroup) {
+  MemoryStats Stats = { 0, 0, 0, 0 };
+  for (unsigned i = 0, e = MemGroup.Slabs.size(); i != e; ++i) {
+    const Slab &S = MemGroup.Slabs[i];
+    ++Stats.NumSlabs;
+    Stats.SlabBytes += S.Block.size();
+    Stats.UsedBytes += S.Used;
+    Stats.SectionBytes += S.SectionBytes;
+  }
+  return Stats;
+}
+
+static void printGroupStats(raw_ostream &OS, const char *Name,
+                            const SectionMemoryManager::MemoryStats &Stats) {
+  uint64_t Wasted = Stats.UsedBytes - Stats.SectionBytes;
+  OS << "  " << Name << ": " << Stats.NumSlabs << " slabs, "
+     << Stats.SlabBytes << " bytes mapped, " << Stats.UsedBytes
+     << " used, " << Stats.SectionBytes << " in sections ("
+     << (Stats.UsedBytes ? Wasted * 100 / Stats.UsedBytes : 0)
+     << "% fragmentation)\n";
+}
+
+void SectionMemoryManager::printStats(raw_ostream &OS) const {
+  OS << "Section memory usage:\n";
+  printGroupStats(OS, "code", getCodeStats());
+  printGroupStats(OS, "rodata", getRODataStats());
+  printGroupStats(OS, "rwdata", getRWDataStats());
 }
 
 static int jit_noop() {
@@ -214,12 +351,12 @@ void *SectionMemoryManager::getPointerToNamedFunction(const std::string &Name,
 }
 
 SectionMemoryManager::~SectionMemoryManager() {
-  for (unsigned i = 0, e = CodeMem.AllocatedMem.size(); i != e; ++i)
-    sys::Memory::releaseMappedMemory(CodeMem.AllocatedMem[i]);
-  for (unsigned i = 0, e = RWDataMem.AllocatedMem.size(); i != e; ++i)
-    sys::Memory::releaseMappedMemory(RWDataMem.AllocatedMem[i]);
-  for (unsigned i = 0, e = RODataMem.AllocatedMem.size(); i != e; ++i)
-    sys::Memory::releaseMappedMemory(RODataMem.AllocatedMem[i]);
+  for (unsigned i = 0, e = CodeMem.Slabs.size(); i != e; ++i)
+    sys::Memory::releaseMappedMemory(CodeMem.Slabs[i].Block);
+  for (unsigned i = 0, e = RWDataMem.Slabs.size(); i != e; ++i)
+    sys::Memory::releaseMappedMemory(RWDataMem.Slabs[i].Block);
+  for (unsigned i = 0, e = RODataMem.Slabs.size(); i != e; ++i)
+    sys::Memory::releaseMappedMemory(RODataMem.Slabs[i].Block);
 }
 
 } // namespace llvm
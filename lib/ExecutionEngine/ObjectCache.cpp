@@ -0,0 +1,124 @@
+//===-- ObjectCache.cpp - Cache for JIT-compiled objects ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the ObjectCache interface and FileObjectCache.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+
+using namespace llvm;
+
+void ObjectCache::anchor() {}
+
+FileObjectCache::FileObjectCache(StringRef Directory)
+  : Directory(Directory) {}
+
+FileObjectCache::~FileObjectCache() {
+  // Release the locks of objects that were never stored.
+  DeleteContainerSeconds(PendingLocks);
+}
+
+std::string FileObjectCache::getObjectPath(StringRef Key) const {
+  SmallString<128> Path(Directory);
+  sys::path::append(Path, Key + ".o");
+  return Path.str();
+}
+
+static MemoryBuffer *readObject(StringRef Path) {
+  OwningPtr<MemoryBuffer> Buffer;
+  if (MemoryBuffer::getFile(Path, Buffer, -1,
+                            /*RequiresNullTerminator=*/false))
+    return 0;
+  return Buffer.take();
+}
+
+MemoryBuffer *FileObjectCache::getObject(StringRef Key) {
+  std::string Path = getObjectPath(Key);
+  if (MemoryBuffer *Obj = readObject(Path))
+    return Obj;
+
+  // The lock file lives next to the object.
+  bool Existed;
+  if (sys::fs::create_directories(Directory, Existed))
+    return 0;
+
+  // Either we get to compile the object, or wait for whoever is compiling it.
+  OwningPtr<LockFileManager> Locker(new LockFileManager(Path));
+  switch (Locker->getState()) {
+  case LockFileManager::LFS_Owned: {
+    // The object may have been stored after we first looked for it.
+    if (MemoryBuffer *Obj = readObject(Path))
+      return Obj;
+
+    // Hold on to the lock until notifyObjectCompiled.
+    MutexGuard Guard(Lock);
+    LockFileManager *&Pending = PendingLocks[Key];
+    delete Pending;
+    Pending = Locker.take();
+    return 0;
+  }
+  case LockFileManager::LFS_Shared:
+    // If the owner gave up, compile the object without holding the lock.
+    Locker->waitForUnlock();
+    return readObject(Path);
+  case LockFileManager::LFS_Error:
+    break;
+  }
+  return 0;
+}
+
+void FileObjectCache::notifyObjectCompiled(StringRef Key,
+                                           const MemoryBuffer *Obj) {
+  // Release the lock taken by getObject once the object is in place, or if
+  // storing it fails.
+  OwningPtr<LockFileManager> Locker;
+  {
+    MutexGuard Guard(Lock);
+    StringMap<LockFileManager*>::iterator I = PendingLocks.find(Key);
+    if (I != PendingLocks.end()) {
+      Locker.reset(I->second);
+      PendingLocks.erase(I);
+    }
+  }
+
+  bool Existed;
+  if (sys::fs::create_directories(Directory, Existed))
+    return;
+
+  // Write the object to a temporary file first, so that readers only ever
+  // see complete objects.
+  std::string Path = getObjectPath(Key);
+  SmallString<128> TempPath;
+  int FD;
+  if (sys::fs::unique_file(Path + "-%%%%%%%%.tmp", FD, TempPath))
+    return;
+
+  raw_fd_ostream OS(FD, /*shouldClose=*/true);
+  OS << Obj->getBuffer();
+  OS.close();
+  if (OS.has_error()) {
+    OS.clear_error();
+    sys::fs::remove(TempPath.str(), Existed);
+    return;
+  }
+
+  if (sys::fs::rename(TempPath.str(), Path))
+    sys::fs::remove(TempPath.str(), Existed);
+}
@@ -34,17 +34,77 @@ void RuntimeDyldImpl::resolveRelocations() {
   // First, resolve relocations associated with external symbols.
   resolveExternalSymbols();
 
-  // Just iterate over the sections we have and resolve all the relocations
-  // in them. Gross overkill, but it gets the job done.
-  for (int i = 0, e = Sections.size(); i != e; ++i) {
-    uint64_t Addr = Sections[i].LoadAddress;
-    DEBUG(dbgs() << "Resolving relocations Section #" << i
+  // Just iterate over the relocation lists we have and resolve all the
+  // relocations in them. Lists of finalized objects have been discarded, so
+  // this only touches the objects loaded since.
+  for (DenseMap<unsigned, RelocationList>::iterator I = Relocations.begin(),
+       E = Relocations.end(); I != E; ++I) {
+    uint64_t Addr = Sections[I->first].LoadAddress;
+    DEBUG(dbgs() << "Resolving relocations Section #" << I->first
             << "\t" << format("%p", (uint8_t *)Addr)
             << "\n");
-    resolveRelocationList(Relocations[i], Addr);
+    resolveRelocationList(I->second, Addr);
   }
 }
 
+void RuntimeDyldImpl::discardResolvedRelocations() {
+  Relocations.clear();
+  ExternalSymbolRelocations.clear();
+}
+
+void RuntimeDyldImpl::unloadObject(ObjectImage *Obj) {
+  DenseMap<const ObjectImage*, SectionIDRange>::iterator I =
+    LoadedObjects.find(Obj);
+  if (I == LoadedObjects.end())
+    return;
+  unsigned Begin = I->second.first, End = I->second.second;
+  LoadedObjects.erase(I);
+
+  // Forget the symbols defined by the object.
+  for (SymbolTableMap::iterator SI = GlobalSymbolTable.begin(),
+       SE = GlobalSymbolTable.end(); SI != SE; ) {
+    SymbolTableMap::iterator Cur = SI;
+    ++SI;
+    if (Cur->second.first >= Begin && Cur->second.first < End)
+      GlobalSymbolTable.erase(Cur);
+  }
+
+  // Forget the relocations sourced from the object, and those that still
+  // have to be applied to it.
+  for (DenseMap<unsigned, RelocationList>::iterator RI = Relocations.begin(),
+       RE = Relocations.end(); RI != RE; ++RI) {
+    if (RI->first >= Begin && RI->first < End)
+      RI->second.clear();
+    else
+      removeRelocationsTo(RI->second, Begin, End);
+  }
+  for (StringMap<RelocationList>::iterator RI =
+         ExternalSymbolRelocations.begin(),
+       RE = ExternalSymbolRelocations.end(); RI != RE; ++RI)
+    removeRelocationsTo(RI->second, Begin, End);
+
+  // Hand the memory back.  SectionIDs are never reused, the entries just
+  // stay around empty.
+  for (unsigned i = Begin; i != End; ++i) {
+    SectionEntry &Section = Sections[i];
+    if (Section.Address)
+      MemMgr->deallocateSection(Section.Address, Section.Size, i);
+    Section.Address = 0;
+    Section.Size = 0;
+    Section.LoadAddress = 0;
+  }
+}
+
+void RuntimeDyldImpl::removeRelocationsTo(RelocationList &Relocs,
+                                          unsigned Begin, unsigned End) {
+  RelocationList::iterator Kept = Relocs.begin();
+  for (RelocationList::iterator I = Relocs.begin(), E = Relocs.end();
+       I != E; ++I)
+    if (I->SectionID < Begin || I->SectionID >= End)
+      *Kept++ = *I;
+  Relocs.erase(Kept, Relocs.end());
+}
+
 void RuntimeDyldImpl::mapSectionAddress(const void *LocalAddress,
                                         uint64_t TargetAddress) {
   for (unsigned i = 0, e = Sections.size(); i != e; ++i) {
@@ -69,6 +129,9 @@ ObjectImage *RuntimeDyldImpl::loadObject(ObjectBuffer *InputBuffer) {
 
   Arch = (Triple::ArchType)obj->getArch();
 
+  // The sections of this object get consecutive SectionIDs starting here.
+  unsigned FirstSectionID = Sections.size();
+
   // Symbols found in this object
   StringMap<SymbolLoc> LocalSymbols;
   // Used sections from the object file
@@ -169,6 +232,7 @@ ObjectImage *RuntimeDyldImpl::loadObject(ObjectBuffer *InputBuffer) {
     }
   }
 
+  LoadedObjects[obj.get()] = SectionIDRange(FirstSectionID, Sections.size());
   return obj.take();
 }
 
@@ -427,9 +491,11 @@ void RuntimeDyldImpl::resolveRelocationList(const RelocationList &Relocs,
 void RuntimeDyldImpl::resolveExternalSymbols() {
   StringMap<RelocationList>::iterator i = ExternalSymbolRelocations.begin(),
                                       e = ExternalSymbolRelocations.end();
-  for (; i != e; i++) {
-    StringRef Name = i->first();
-    RelocationList &Relocs = i->second;
+  while (i != e) {
+    StringMap<RelocationList>::iterator Cur = i;
+    ++i;
+    StringRef Name = Cur->first();
+    RelocationList &Relocs = Cur->second;
     SymbolTableMap::const_iterator Loc = GlobalSymbolTable.find(Name);
     if (Loc == GlobalSymbolTable.end()) {
       // This is an external symbol, try to get it address from
@@ -441,7 +507,14 @@ void RuntimeDyldImpl::resolveExternalSymbols() {
               << "\n");
       resolveRelocationList(Relocs, (uintptr_t)Addr);
     } else {
-      report_fatal_error("Expected external symbol");
+      // The symbol is defined by an object loaded after the one referring to
+      // it.  Turn the relocations into section relocations.
+      for (unsigned r = 0, re = Relocs.size(); r != re; ++r) {
+        RelocationEntry RE = Relocs[r];
+        RE.Addend += Loc->second.second;
+        Relocations[Loc->second.first].push_back(RE);
+      }
+      ExternalSymbolRelocations.erase(Cur);
     }
   }
 }
@@ -507,11 +580,24 @@ void *RuntimeDyld::getSymbolAddress(StringRef Name) {
 }
 
 uint64_t RuntimeDyld::getSymbolLoadAddress(StringRef Name) {
+  if (!Dyld)
+    return 0;
   return Dyld->getSymbolLoadAddress(Name);
 }
 
+void RuntimeDyld::unloadObject(ObjectImage *Obj) {
+  if (Dyld)
+    Dyld->unloadObject(Obj);
+}
+
 void RuntimeDyld::resolveRelocations() {
-  Dyld->resolveRelocations();
+  if (Dyld)
+    Dyld->resolveRelocations();
+}
+
+void RuntimeDyld::discardResolvedRelocations() {
+  if (Dyld)
+    Dyld->discardResolvedRelocations();
 }
 
 void RuntimeDyld::reassignSectionAddress(unsigned SectionID,
@@ -161,6 +161,11 @@ protected:
   // modules.  This map is indexed by symbol name.
   StringMap<RelocationList> ExternalSymbolRelocations;
 
+  // The range of SectionIDs [first, second) used by each loaded object, so
+  // that objects can be unloaded.
+  typedef std::pair<unsigned, unsigned> SectionIDRange;
+  DenseMap<const ObjectImage*, SectionIDRange> LoadedObjects;
+
   typedef std::map<RelocationValueRef, uintptr_t> StubMap;
 
   Triple::ArchType Arch;
@@ -271,6 +276,11 @@ protected:
   void resolveRelocationList(const RelocationList &Relocs, uint64_t Value);
   void resolveRelocationEntry(const RelocationEntry &RE, uint64_t Value);
 
+  /// \brief Remove the relocations applied to sections in [Begin, End) from
+  /// Relocs.
+  void removeRelocationsTo(RelocationList &Relocs, unsigned Begin,
+                           unsigned End);
+
   /// \brief A object file specific relocation resolver
   /// \param Section The section where the relocation is being applied
   /// \param Offset The offset into the section for this relocation
@@ -320,8 +330,12 @@ public:
     return getSectionLoadAddress(Loc.first) + Loc.second;
   }
 
+  void unloadObject(ObjectImage *Obj);
+
   void resolveRelocations();
 
+  void discardResolvedRelocations();
+
   void reassignSectionAddress(unsigned SectionID, uint64_t Addr);
 
   void mapSectionAddress(const void *LocalAddress, uint64_t TargetAddress);
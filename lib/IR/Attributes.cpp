@@ -17,6 +17,7 @@
 #include "LLVMContextImpl.h"
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/IR/ParallelIR.h"
 #include "llvm/IR/Type.h"
 #include "llvm/Support/Atomic.h"
 #include "llvm/Support/Debug.h"
@@ -43,6 +44,7 @@ Attribute Attribute::get(LLVMContext &Context, AttrBuilder &B) {
     return Attribute();
 
   // Otherwise, build a key to look up the existing attributes.
+  ParallelIR::ContextGuard Guard;
   LLVMContextImpl *pImpl = Context.pImpl;
   FoldingSetNodeID ID;
   // FIXME: Don't look up ConstantInts here.
@@ -509,6 +511,7 @@ AttributeSet AttributeSet::get(LLVMContext &C,
 #endif
 
   // Otherwise, build a key to look up the existing attributes.
+  ParallelIR::ContextGuard Guard;
   LLVMContextImpl *pImpl = C.pImpl;
   FoldingSetNodeID ID;
   AttributeSetImpl::Profile(ID, Attrs);
@@ -38,10 +38,25 @@ LLVMContext &BasicBlock::getContext() const {
 // are not in the public header file...
 template class llvm::SymbolTableListTraits<Instruction, BasicBlock>;
 
+void ilist_traits<Instruction>::addNodeToList(Instruction *I) {
+  SymbolTableListTraits<Instruction, BasicBlock>::addNodeToList(I);
+  ++getListOwner()->InsertionEpoch;
+}
+
+void ilist_traits<Instruction>::
+transferNodesFromList(ilist_traits<Instruction> &L2,
+                      ilist_iterator<Instruction> first,
+                      ilist_iterator<Instruction> last) {
+  SymbolTableListTraits<Instruction, BasicBlock>::
+    transferNodesFromList(L2, first, last);
+  // This is also called for a move within the block, which changes the order.
+  ++getListOwner()->InsertionEpoch;
+}
 
 BasicBlock::BasicBlock(LLVMContext &C, const Twine &Name, Function *NewParent,
                        BasicBlock *InsertBefore)
-  : Value(Type::getLabelTy(C), Value::BasicBlockVal), Parent(0) {
+  : Value(Type::getLabelTy(C), Value::BasicBlockVal), Parent(0),
+    InsertionEpoch(0) {
 
   // Make sure that we get added to a function
   LeakDetector::addGarbageObject(this);
@@ -25,6 +25,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/IR/ParallelIR.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -404,6 +405,7 @@ ConstantInt::ConstantInt(IntegerType *Ty, const APInt& V)
 }
 
 ConstantInt *ConstantInt::getTrue(LLVMContext &Context) {
+  ParallelIR::ContextGuard Guard;
   LLVMContextImpl *pImpl = Context.pImpl;
   if (!pImpl->TheTrueVal)
     pImpl->TheTrueVal = ConstantInt::get(Type::getInt1Ty(Context), 1);
@@ -411,6 +413,7 @@ ConstantInt *ConstantInt::getTrue(LLVMContext &Context) {
 }
 
 ConstantInt *ConstantInt::getFalse(LLVMContext &Context) {
+  ParallelIR::ContextGuard Guard;
   LLVMContextImpl *pImpl = Context.pImpl;
   if (!pImpl->TheFalseVal)
     pImpl->TheFalseVal = ConstantInt::get(Type::getInt1Ty(Context), 0);
@@ -448,6 +451,7 @@ Constant *ConstantInt::getFalse(Type *Ty) {
 // compare APInt's of different widths, which would violate an APInt class
 // invariant which generates an assertion.
 ConstantInt *ConstantInt::get(LLVMContext &Context, const APInt &V) {
+  ParallelIR::ContextGuard Guard;
   // Get the corresponding integer type for the bit width of the value.
   IntegerType *ITy = IntegerType::get(Context, V.getBitWidth());
   // get an existing value or the insertion position
@@ -576,6 +580,7 @@ Constant *ConstantFP::getZeroValueForNegation(Type *Ty) {
 
 // ConstantFP accessors.
 ConstantFP* ConstantFP::get(LLVMContext &Context, const APFloat& V) {
+  ParallelIR::ContextGuard Guard;
   DenseMapAPFloatKeyInfo::KeyTy Key(V);
 
   LLVMContextImpl* pImpl = Context.pImpl;
@@ -1198,6 +1203,7 @@ bool ConstantFP::isValueValidForType(Type *Ty, const APFloat& Val) {
 //                      Factory Function Implementation
 
 ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
+  ParallelIR::ContextGuard Guard;
   assert((Ty->isStructTy() || Ty->isArrayTy() || Ty->isVectorTy()) &&
          "Cannot create an aggregate zero of non-aggregate type!");
   
@@ -1211,6 +1217,7 @@ ConstantAggregateZero *ConstantAggregateZero::get(Type *Ty) {
 /// destroyConstant - Remove the constant from the constant table.
 ///
 void ConstantAggregateZero::destroyConstant() {
+  ParallelIR::ContextGuard Guard;
   getContext().pImpl->CAZConstants.erase(getType());
   destroyConstantImpl();
 }
@@ -1218,6 +1225,7 @@ void ConstantAggregateZero::destroyConstant() {
 /// destroyConstant - Remove the constant from the constant table...
 ///
 void ConstantArray::destroyConstant() {
+  ParallelIR::ContextGuard Guard;
   getType()->getContext().pImpl->ArrayConstants.remove(this);
   destroyConstantImpl();
 }
@@ -1229,6 +1237,7 @@ void ConstantArray::destroyConstant() {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantStruct::destroyConstant() {
+  ParallelIR::ContextGuard Guard;
   getType()->getContext().pImpl->StructConstants.remove(this);
   destroyConstantImpl();
 }
@@ -1236,6 +1245,7 @@ void ConstantStruct::destroyConstant() {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantVector::destroyConstant() {
+  ParallelIR::ContextGuard Guard;
   getType()->getContext().pImpl->VectorConstants.remove(this);
   destroyConstantImpl();
 }
@@ -1281,6 +1291,7 @@ const APInt &Constant::getUniqueInteger() const {
 //
 
 ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
+  ParallelIR::ContextGuard Guard;
   ConstantPointerNull *&Entry = Ty->getContext().pImpl->CPNConstants[Ty];
   if (Entry == 0)
     Entry = new ConstantPointerNull(Ty);
@@ -1291,6 +1302,7 @@ ConstantPointerNull *ConstantPointerNull::get(PointerType *Ty) {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantPointerNull::destroyConstant() {
+  ParallelIR::ContextGuard Guard;
   getContext().pImpl->CPNConstants.erase(getType());
   // Free the constant and any dangling references to it.
   destroyConstantImpl();
@@ -1301,6 +1313,7 @@ void ConstantPointerNull::destroyConstant() {
 //
 
 UndefValue *UndefValue::get(Type *Ty) {
+  ParallelIR::ContextGuard Guard;
   UndefValue *&Entry = Ty->getContext().pImpl->UVConstants[Ty];
   if (Entry == 0)
     Entry = new UndefValue(Ty);
@@ -1311,6 +1324,7 @@ UndefValue *UndefValue::get(Type *Ty) {
 // destroyConstant - Remove the constant from the constant table.
 //
 void UndefValue::destroyConstant() {
+  ParallelIR::ContextGuard Guard;
   // Free the constant and any dangling references to it.
   getContext().pImpl->UVConstants.erase(getType());
   destroyConstantImpl();
@@ -1325,6 +1339,7 @@ BlockAddress *BlockAddress::get(BasicBlock *BB) {
 }
 
 BlockAddress *BlockAddress::get(Function *F, BasicBlock *BB) {
+  ParallelIR::ContextGuard Guard;
   BlockAddress *&BA =
     F->getContext().pImpl->BlockAddresses[std::make_pair(F, BB)];
   if (BA == 0)
@@ -1346,6 +1361,7 @@ BlockAddress::BlockAddress(Function *F, BasicBlock *BB)
 // destroyConstant - Remove the constant from the constant table.
 //
 void BlockAddress::destroyConstant() {
+  ParallelIR::ContextGuard Guard;
   getFunction()->getType()->getContext().pImpl
     ->BlockAddresses.erase(std::make_pair(getFunction(), getBasicBlock()));
   getBasicBlock()->AdjustBlockAddressRefCount(-1);
@@ -1353,6 +1369,7 @@ void BlockAddress::destroyConstant() {
 }
 
 void BlockAddress::replaceUsesOfWithOnConstant(Value *From, Value *To, Use *U) {
+  ParallelIR::ContextGuard Guard;
   // This could be replacing either the Basic Block or the Function.  In either
   // case, we have to remove the map entry.
   Function *NewF = getFunction();
@@ -2113,6 +2130,7 @@ Constant *ConstantExpr::getBinOpAbsorber(unsigned Opcode, Type *Ty) {
 // destroyConstant - Remove the constant from the constant table...
 //
 void ConstantExpr::destroyConstant() {
+  ParallelIR::ContextGuard Guard;
   getType()->getContext().pImpl->ExprConstants.remove(this);
   destroyConstantImpl();
 }
@@ -2208,14 +2226,29 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
     return ConstantAggregateZero::get(Ty);
 
   // Do a lookup to see if we have already formed one of these.
-  StringMap<ConstantDataSequential*>::MapEntryTy &Slot =
-    Ty->getContext().pImpl->CDSConstants.GetOrCreateValue(Elements);
+  ParallelIR::ContextGuard Guard;
+  LLVMContextImpl *pImpl = Ty->getContext().pImpl;
+  LLVMContextImpl::CDSMapTy::iterator Slot = pImpl->CDSConstants.find(Elements);
+  if (Slot == pImpl->CDSConstants.end()) {
+    // The bucket owns a copy of the elements, unless they live in a buffer
+    // owned by the context and are suitably aligned to be accessed in place.
+    unsigned EltSize =
+      Ty->getSequentialElementType()->getPrimitiveSizeInBits() / 8;
+    if (!pImpl->isRetained(Elements) ||
+        (reinterpret_cast<uintptr_t>(Elements.data()) & (EltSize-1)) != 0) {
+      char *Copy = new char[Elements.size()];
+      std::copy(Elements.begin(), Elements.end(), Copy);
+      Elements = StringRef(Copy, Elements.size());
+    }
+    Slot = pImpl->CDSConstants.insert(
+             std::make_pair(Elements, (ConstantDataSequential*)0)).first;
+  }
 
   // The bucket can point to a linked list of different CDS's that have the same
   // body but different types.  For example, 0,0,0,1 could be a 4 element array
   // of i8, or a 1-element array of i32.  They'll both end up in the same
-  /// StringMap bucket, linked up by their Next pointers.  Walk the list.
-  ConstantDataSequential **Entry = &Slot.getValue();
+  /// bucket, linked up by their Next pointers.  Walk the list.
+  ConstantDataSequential **Entry = &Slot->second;
   for (ConstantDataSequential *Node = *Entry; Node != 0;
        Entry = &Node->Next, Node = *Entry)
     if (Node->getType() == Ty)
@@ -2224,30 +2257,33 @@ Constant *ConstantDataSequential::getImpl(StringRef Elements, Type *Ty) {
   // Okay, we didn't get a hit.  Create a node of the right class, link it in,
   // and return it.
   if (isa<ArrayType>(Ty))
-    return *Entry = new ConstantDataArray(Ty, Slot.getKeyData());
+    return *Entry = new ConstantDataArray(Ty, Slot->first.data());
 
   assert(isa<VectorType>(Ty));
-  return *Entry = new ConstantDataVector(Ty, Slot.getKeyData());
+  return *Entry = new ConstantDataVector(Ty, Slot->first.data());
 }
 
 void ConstantDataSequential::destroyConstant() {
-  // Remove the constant from the StringMap.
-  StringMap<ConstantDataSequential*> &CDSConstants = 
-    getType()->getContext().pImpl->CDSConstants;
-
-  StringMap<ConstantDataSequential*>::iterator Slot =
-    CDSConstants.find(getRawDataValues());
+  ParallelIR::ContextGuard Guard;
+  // Remove the constant from the uniquing table.
+  LLVMContextImpl *pImpl = getContext().pImpl;
+  LLVMContextImpl::CDSMapTy::iterator Slot =
+    pImpl->CDSConstants.find(getRawDataValues());
 
-  assert(Slot != CDSConstants.end() && "CDS not found in uniquing table");
+  assert(Slot != pImpl->CDSConstants.end() &&
+         "CDS not found in uniquing table");
 
-  ConstantDataSequential **Entry = &Slot->getValue();
+  ConstantDataSequential **Entry = &Slot->second;
 
   // Remove the entry from the hash table.
   if ((*Entry)->Next == 0) {
     // If there is only one value in the bucket (common case) it must be this
     // entry, and removing the entry should remove the bucket completely.
     assert((*Entry) == this && "Hash mismatch in ConstantDataSequential");
-    getContext().pImpl->CDSConstants.erase(Slot);
+    StringRef Key = Slot->first;
+    pImpl->CDSConstants.erase(Slot);
+    if (!pImpl->isRetained(Key))
+      delete[] Key.data();
   } else {
     // Otherwise, there are multiple entries linked off the bucket, unlink the 
     // node we care about but keep the bucket around.
@@ -2514,6 +2550,7 @@ Constant *ConstantDataVector::getSplatValue() const {
 ///
 void ConstantArray::replaceUsesOfWithOnConstant(Value *From, Value *To,
                                                 Use *U) {
+  ParallelIR::ContextGuard Guard;
   assert(isa<Constant>(To) && "Cannot make Constant refer to non-constant!");
   Constant *ToC = cast<Constant>(To);
 
@@ -2589,6 +2626,7 @@ void ConstantArray::replaceUsesOfWithOnConstant(Value *From, Value *To,
 
 void ConstantStruct::replaceUsesOfWithOnConstant(Value *From, Value *To,
                                                  Use *U) {
+  ParallelIR::ContextGuard Guard;
   assert(isa<Constant>(To) && "Cannot make Constant refer to non-constant!");
   Constant *ToC = cast<Constant>(To);
 
@@ -2664,6 +2702,7 @@ void ConstantStruct::replaceUsesOfWithOnConstant(Value *From, Value *To,
 
 void ConstantVector::replaceUsesOfWithOnConstant(Value *From, Value *To,
                                                  Use *U) {
+  ParallelIR::ContextGuard Guard;
   assert(isa<Constant>(To) && "Cannot make Constant refer to non-constant!");
 
   SmallVector<Constant*, 8> Values;
@@ -2686,6 +2725,7 @@ void ConstantVector::replaceUsesOfWithOnConstant(Value *From, Value *To,
 
 void ConstantExpr::replaceUsesOfWithOnConstant(Value *From, Value *ToV,
                                                Use *U) {
+  ParallelIR::ContextGuard Guard;
   assert(isa<Constant>(ToV) && "Cannot make Constant refer to non-constant!");
   Constant *To = cast<Constant>(ToV);
 
@@ -20,6 +20,7 @@
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/IR/ParallelIR.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
@@ -540,6 +541,18 @@ public:
       delete I->second;
     }
   }
+
+  unsigned size() const { return Map.size(); }
+
+  /// getMemorySize - Return an estimate of the bytes used by the maps, not
+  /// counting the constants. A std::map node carries about four words of
+  /// bookkeeping besides its value.
+  size_t getMemorySize() const {
+    const size_t NodeOverhead = 4 * sizeof(void*);
+    return Map.size() * (sizeof(typename MapTy::value_type) + NodeOverhead) +
+      InverseMap.size() *
+        (sizeof(typename InverseMapTy::value_type) + NodeOverhead);
+  }
     
   /// InsertOrGetItem - Return an iterator for the specified element.
   /// If the element exists in the map, the returned iterator points to the
@@ -594,6 +607,7 @@ public:
   /// getOrCreate - Return the specified constant from the map, creating it if
   /// necessary.
   ConstantClass *getOrCreate(TypeClass *Ty, ValRefType V) {
+    ParallelIR::ContextGuard Guard;
     MapKey Lookup(Ty, V);
     ConstantClass* Result = 0;
     
@@ -711,6 +725,16 @@ public:
     }
   }
 
+  unsigned size() const { return Map.size(); }
+  size_t getMemorySize() const { return Map.getMemorySize(); }
+
+  /// shrink - Rehash the map into the smallest table that holds its entries.
+  void shrink() {
+    MapTy Shrunk(Map.begin(), Map.end());
+    if (Shrunk.getMemorySize() < Map.getMemorySize())
+      Map.swap(Shrunk);
+  }
+
 private:
   typename MapTy::iterator findExistingElement(ConstantClass *CP) {
     return Map.find(CP);
@@ -730,6 +754,7 @@ public:
   /// getOrCreate - Return the specified constant from the map, creating it if
   /// necessary.
   ConstantClass *getOrCreate(TypeClass *Ty, Operands V) {
+    ParallelIR::ContextGuard Guard;
     LookupKey Lookup(Ty, V);
     ConstantClass* Result = 0;
 
@@ -21,6 +21,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/ParallelIR.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/GetElementPtrTypeIterator.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -439,6 +440,7 @@ DataLayout::~DataLayout() {
 }
 
 const StructLayout *DataLayout::getStructLayout(StructType *Ty) const {
+  ParallelIR::ContextGuard Guard;
   if (!LayoutMap)
     LayoutMap = new StructLayoutMap();
 
@@ -11,6 +11,7 @@
 #include "LLVMContextImpl.h"
 #include "llvm/ADT/DenseMapInfo.h"
 #include "llvm/DebugInfo.h"
+#include "llvm/IR/ParallelIR.h"
 using namespace llvm;
 
 //===----------------------------------------------------------------------===//
@@ -18,6 +19,7 @@ using namespace llvm;
 //===----------------------------------------------------------------------===//
 
 MDNode *DebugLoc::getScope(const LLVMContext &Ctx) const {
+  ParallelIR::ContextGuard Guard;
   if (ScopeIdx == 0) return 0;
   
   if (ScopeIdx > 0) {
@@ -35,6 +37,7 @@ MDNode *DebugLoc::getScope(const LLVMContext &Ctx) const {
 }
 
 MDNode *DebugLoc::getInlinedAt(const LLVMContext &Ctx) const {
+  ParallelIR::ContextGuard Guard;
   // Positive ScopeIdx is an index into ScopeRecords, which has no inlined-at
   // position specified.  Zero is invalid.
   if (ScopeIdx >= 0) return 0;
@@ -48,6 +51,7 @@ MDNode *DebugLoc::getInlinedAt(const LLVMContext &Ctx) const {
 /// Return both the Scope and the InlinedAt values.
 void DebugLoc::getScopeAndInlinedAt(MDNode *&Scope, MDNode *&IA,
                                     const LLVMContext &Ctx) const {
+  ParallelIR::ContextGuard Guard;
   if (ScopeIdx == 0) {
     Scope = IA = 0;
     return;
@@ -73,6 +77,7 @@ void DebugLoc::getScopeAndInlinedAt(MDNode *&Scope, MDNode *&IA,
 
 DebugLoc DebugLoc::get(unsigned Line, unsigned Col,
                        MDNode *Scope, MDNode *InlinedAt) {
+  ParallelIR::ContextGuard Guard;
   DebugLoc Result;
   
   // If no scope is available, this is an unknown location.
@@ -39,6 +39,13 @@ static cl::opt<bool,true>
 VerifyDomInfoX("verify-dom-info", cl::location(VerifyDomInfo),
                cl::desc("Verify dominator info (time consuming)"));
 
+bool llvm::VerifyDomTreeUpdates = false;
+static cl::opt<bool,true>
+VerifyDomTreeUpdatesX("verify-dom-updates",
+                      cl::location(VerifyDomTreeUpdates),
+                      cl::desc("Verify incremental dominator tree updates "
+                               "(time consuming)"));
+
 bool BasicBlockEdge::isSingleEdge() const {
   const TerminatorInst *TI = Start->getTerminator();
   unsigned NumEdgesToEnd = 0;
@@ -20,6 +20,7 @@
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/ParallelIR.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/CallSite.h"
 #include "llvm/Support/InstIterator.h"
@@ -155,10 +156,12 @@ Type *Function::getReturnType() const {
 }
 
 void Function::removeFromParent() {
+  ParallelIR::waitForModuleAccess();
   getParent()->getFunctionList().remove(this);
 }
 
 void Function::eraseFromParent() {
+  ParallelIR::waitForModuleAccess();
   getParent()->getFunctionList().erase(this);
 }
 
@@ -181,8 +184,10 @@ Function::Function(FunctionType *Ty, LinkageTypes Linkage,
   // Make sure that we get added to a function
   LeakDetector::addGarbageObject(this);
 
-  if (ParentModule)
+  if (ParentModule) {
+    ParallelIR::waitForModuleAccess();
     ParentModule->getFunctionList().push_back(this);
+  }
 
   // Ensure intrinsics have the right parameter attributes.
   if (unsigned IID = getIntrinsicID())
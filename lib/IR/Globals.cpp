@@ -19,6 +19,7 @@
 #include "llvm/IR/GlobalAlias.h"
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/ParallelIR.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/LeakDetector.h"
 using namespace llvm;
@@ -116,6 +117,7 @@ GlobalVariable::GlobalVariable(Module &M, Type *Ty, bool constant,
   
   LeakDetector::addGarbageObject(this);
   
+  ParallelIR::waitForModuleAccess();
   if (Before)
     Before->getParent()->getGlobalList().insert(Before, this);
   else
@@ -131,10 +133,12 @@ void GlobalVariable::setParent(Module *parent) {
 }
 
 void GlobalVariable::removeFromParent() {
+  ParallelIR::waitForModuleAccess();
   getParent()->getGlobalList().remove(this);
 }
 
 void GlobalVariable::eraseFromParent() {
+  ParallelIR::waitForModuleAccess();
   getParent()->getGlobalList().erase(this);
 }
 
@@ -197,8 +201,10 @@ GlobalAlias::GlobalAlias(Type *Ty, LinkageTypes Link,
     assert(aliasee->getType() == Ty && "Alias and aliasee types should match!");
   Op<0>() = aliasee;
 
-  if (ParentModule)
+  if (ParentModule) {
+    ParallelIR::waitForModuleAccess();
     ParentModule->getAliasList().push_back(this);
+  }
 }
 
 void GlobalAlias::setParent(Module *parent) {
@@ -210,10 +216,12 @@ void GlobalAlias::setParent(Module *parent) {
 }
 
 void GlobalAlias::removeFromParent() {
+  ParallelIR::waitForModuleAccess();
   getParent()->getAliasList().remove(this);
 }
 
 void GlobalAlias::eraseFromParent() {
+  ParallelIR::waitForModuleAccess();
   getParent()->getAliasList().erase(this);
 }
 
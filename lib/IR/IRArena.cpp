@@ -0,0 +1,176 @@
+//===-- IRArena.cpp - Arena allocation of instructions --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements IRArena and IRArenaScope.
+//
+// Each arena bump allocates from 64KiB slabs. Every allocation is preceded by
+// a header holding the arena it came from and its size, so that freed memory
+// can be put on the free list of its size class. Users record whether they
+// came from an arena themselves, so memory from the heap has no header.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "ir-arena"
+#include "llvm/IR/IRArena.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/ThreadLocal.h"
+#include <cassert>
+#include <new>
+using namespace llvm;
+
+STATISTIC(NumArenaAllocs, "Number of IR objects allocated from arenas");
+STATISTIC(NumArenaReused, "Number of arena allocations that reused memory");
+STATISTIC(NumArenaFrees,  "Number of IR objects freed into arenas");
+STATISTIC(NumArenaSlabs,  "Number of slabs allocated for arenas");
+STATISTIC(NumArenaBytes,  "Number of bytes reserved for arenas");
+
+volatile sys::cas_flag IRArena::NumActiveScopes = 0;
+
+static sys::ThreadLocal<const IRArena> CurrentArena;
+
+namespace llvm {
+
+/// IRArenaSlabAllocator - Hands out slabs from malloc and counts them.
+class IRArenaSlabAllocator : public MallocSlabAllocator {
+public:
+  virtual MemSlab *Allocate(size_t Size) LLVM_OVERRIDE {
+    ++NumArenaSlabs;
+    NumArenaBytes += Size;
+    return MallocSlabAllocator::Allocate(Size);
+  }
+};
+
+class IRArenaImpl {
+public:
+  enum {
+    SlabSize = 64 * 1024,
+    // Allocations are rounded up to a multiple of this, and their header is
+    // this big, which keeps the objects 16 byte aligned.
+    Granule = 16,
+    // Allocations up to this size are recycled through free lists.
+    MaxRecycledSize = 1024,
+    NumSizeClasses = MaxRecycledSize / Granule
+  };
+
+  /// FreeBlock - A freed allocation on a free list.
+  struct FreeBlock {
+    FreeBlock *Next;
+  };
+
+  IRArenaSlabAllocator SlabAllocator;
+  BumpPtrAllocator Allocator;
+  FreeBlock *FreeLists[NumSizeClasses];
+  uint64_t NumAllocations;
+  uint64_t NumReused;
+  uint64_t NumFreed;
+
+  IRArenaImpl()
+    : Allocator(SlabSize, SlabSize, SlabAllocator),
+      NumAllocations(0), NumReused(0), NumFreed(0) {
+    for (unsigned I = 0; I != NumSizeClasses; ++I)
+      FreeLists[I] = 0;
+  }
+
+  /// ArenaHeader - Precedes every arena allocation, right before the object.
+  struct ArenaHeader {
+    IRArena *Owner;
+    size_t Size;
+  };
+
+  static ArenaHeader *getHeader(void *Ptr) {
+    return static_cast<ArenaHeader*>(Ptr) - 1;
+  }
+};
+
+}
+
+IRArena::IRArena() : Impl(new IRArenaImpl()) {
+}
+
+IRArena::~IRArena() {
+  assert(getNumLiveObjects() == 0 && "IR objects outlive their arena!");
+  delete Impl;
+}
+
+IRArena *IRArena::getCurrentImpl() {
+  return const_cast<IRArena*>(CurrentArena.get());
+}
+
+IRArena *IRArena::getOwner(const void *Ptr) {
+  return IRArenaImpl::getHeader(const_cast<void*>(Ptr))->Owner;
+}
+
+void *IRArena::Allocate(size_t Size) {
+  const size_t Granule = IRArenaImpl::Granule;
+  Size = (Size + Granule - 1) & ~(Granule - 1);
+  ++Impl->NumAllocations;
+  ++NumArenaAllocs;
+
+  char *Mem;
+  unsigned Class = Size / Granule - 1;
+  IRArenaImpl::FreeBlock *Block = 0;
+  if (Size <= IRArenaImpl::MaxRecycledSize && (Block = Impl->FreeLists[Class])) {
+    Impl->FreeLists[Class] = Block->Next;
+    ++Impl->NumReused;
+    ++NumArenaReused;
+    Mem = reinterpret_cast<char*>(Block);
+  } else {
+    Mem = static_cast<char*>(Impl->Allocator.Allocate(Size + Granule, Granule)) +
+          Granule;
+  }
+  IRArenaImpl::ArenaHeader *Header = IRArenaImpl::getHeader(Mem);
+  Header->Owner = this;
+  Header->Size = Size;
+  return Mem;
+}
+
+void IRArena::Deallocate(void *Ptr) {
+  ++Impl->NumFreed;
+  ++NumArenaFrees;
+
+  // Large allocations are not recycled, their memory comes back when the
+  // arena goes away.
+  IRArenaImpl::ArenaHeader *Header = IRArenaImpl::getHeader(Ptr);
+  assert(Header->Owner == this && "Memory freed into the wrong arena!");
+  size_t Size = Header->Size;
+  if (Size > IRArenaImpl::MaxRecycledSize)
+    return;
+
+  unsigned Class = Size / IRArenaImpl::Granule - 1;
+  IRArenaImpl::FreeBlock *Block = static_cast<IRArenaImpl::FreeBlock*>(Ptr);
+  Block->Next = Impl->FreeLists[Class];
+  Impl->FreeLists[Class] = Block;
+}
+
+uint64_t IRArena::getNumAllocations() const {
+  return Impl->NumAllocations;
+}
+
+uint64_t IRArena::getNumReused() const {
+  return Impl->NumReused;
+}
+
+uint64_t IRArena::getNumLiveObjects() const {
+  return Impl->NumAllocations - Impl->NumFreed;
+}
+
+uint64_t IRArena::getBytesReserved() const {
+  return Impl->Allocator.getTotalMemory();
+}
+
+IRArenaScope::IRArenaScope(IRArena &Arena) : Prev(IRArena::getCurrentImpl()) {
+  CurrentArena.set(&Arena);
+  sys::AtomicIncrement(&IRArena::NumActiveScopes);
+}
+
+IRArenaScope::~IRArenaScope() {
+  sys::AtomicDecrement(&IRArena::NumActiveScopes);
+  CurrentArena.set(Prev);
+}
@@ -15,6 +15,7 @@
 #include "ConstantsContext.h"
 #include "LLVMContextImpl.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/ParallelIR.h"
 #include <algorithm>
 #include <cctype>
 using namespace llvm;
@@ -48,6 +49,7 @@ InlineAsm::InlineAsm(PointerType *Ty, const std::string &asmString,
 }
 
 void InlineAsm::destroyConstant() {
+  ParallelIR::ContextGuard Guard;
   getType()->getContext().pImpl->InlineAsms.remove(this);
   delete this;
 }
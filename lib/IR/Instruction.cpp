@@ -13,6 +13,7 @@
 
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/IRArena.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Operator.h"
@@ -21,6 +22,13 @@
 #include "llvm/Support/LeakDetector.h"
 using namespace llvm;
 
+void *Instruction::operator new(size_t s, unsigned Us) {
+  IRArena *Arena = IRArena::getCurrent();
+  if (!Arena)
+    return User::operator new(s, Us);
+  return placeOperands(Arena->Allocate(s + sizeof(Use) * Us), Us, true);
+}
+
 Instruction::Instruction(Type *ty, unsigned it, Use *Ops, unsigned NumOps,
                          Instruction *InsertBefore)
   : User(ty, Value::InstructionVal + it, Ops, NumOps), Parent(0) {
@@ -103,7 +103,7 @@ Use *PHINode::allocHungoffUses(unsigned N) const {
   // the incoming basic blocks.
   size_t size = N * sizeof(Use) + sizeof(Use::UserRef)
     + N * sizeof(BasicBlock*);
-  Use *Begin = static_cast<Use*>(::operator new(size));
+  Use *Begin = static_cast<Use*>(allocHungoffStorage(size));
   Use *End = Begin + N;
   (void) new(End) Use::UserRef(const_cast<PHINode*>(this), 1);
   return Use::initTags(Begin, End);
@@ -153,7 +153,7 @@ void PHINode::growOperands() {
   std::copy(OldOps, OldOps + e, op_begin());
   std::copy(OldBlocks, OldBlocks + e, block_begin());
 
-  Use::zap(OldOps, OldOps + e, true);
+  zapHungoffUses(OldOps, OldOps + e);
 }
 
 /// hasConstantValue - If the specified PHI node always merges together the same
@@ -245,7 +245,7 @@ void LandingPadInst::growOperands(unsigned Size) {
       NewOps[i] = OldOps[i];
 
   OperandList = NewOps;
-  Use::zap(OldOps, OldOps + e, true);
+  zapHungoffUses(OldOps, OldOps + e);
 }
 
 void LandingPadInst::addClause(Value *Val) {
@@ -3250,7 +3250,7 @@ void SwitchInst::growOperands() {
       NewOps[i] = OldOps[i];
   }
   OperandList = NewOps;
-  Use::zap(OldOps, OldOps + e, true);
+  zapHungoffUses(OldOps, OldOps + e);
 }
 
 
@@ -3292,7 +3292,7 @@ void IndirectBrInst::growOperands() {
   for (unsigned i = 0; i != e; ++i)
     NewOps[i] = OldOps[i];
   OperandList = NewOps;
-  Use::zap(OldOps, OldOps + e, true);
+  zapHungoffUses(OldOps, OldOps + e);
 }
 
 IndirectBrInst::IndirectBrInst(Value *Address, unsigned NumCases,
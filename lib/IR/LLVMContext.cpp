@@ -17,8 +17,12 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Metadata.h"
+#include "llvm/IR/ParallelIR.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
 #include <cctype>
 using namespace llvm;
 
@@ -145,6 +149,41 @@ void LLVMContext::emitWarning(unsigned LocCookie, const Twine &ErrorStr) {
   pImpl->DiagHandler(Diag, pImpl->DiagContext, LocCookie);
 }
 
+void LLVMContext::adoptMemoryBuffer(MemoryBuffer *Buffer) {
+  // Index the buffers by their end so that isRetained can find the buffer
+  // containing a pointer with a single lookup.
+  pImpl->RetainedBuffers[Buffer->getBufferEnd()] = Buffer;
+}
+
+void LLVMContext::getUniquingTableInfo(
+    SmallVectorImpl<UniquingTableInfo> &Tables) const {
+  pImpl->getUniquingTableInfo(Tables);
+}
+
+void LLVMContext::printUniquingTableInfo(raw_ostream &OS) const {
+  SmallVector<UniquingTableInfo, 32> Tables;
+  getUniquingTableInfo(Tables);
+
+  size_t TotalSize = 0;
+  OS << "Table                 Entries   Buckets  Occupancy       Bytes\n";
+  for (unsigned i = 0, e = Tables.size(); i != e; ++i) {
+    const UniquingTableInfo &T = Tables[i];
+    OS << format("%-18s  %9u", T.Name, T.NumEntries);
+    if (T.NumBuckets)
+      OS << format("  %8u  %8.1f%%", T.NumBuckets,
+                   100.0 * T.NumEntries / T.NumBuckets);
+    else
+      OS << "         -          -";
+    OS << format("  %10lu\n", (unsigned long)T.MemorySize);
+    TotalSize += T.MemorySize;
+  }
+  OS << format("Total               %42lu\n", (unsigned long)TotalSize);
+}
+
+unsigned LLVMContext::compactUniquingTables() {
+  return pImpl->compactUniquingTables();
+}
+
 //===----------------------------------------------------------------------===//
 // Metadata Kind Uniquing
 //===----------------------------------------------------------------------===//
@@ -169,6 +208,7 @@ static bool isValidName(StringRef MDName) {
 
 /// getMDKindID - Return a unique non-zero ID for the specified metadata kind.
 unsigned LLVMContext::getMDKindID(StringRef Name) const {
+  ParallelIR::ContextGuard Guard;
   assert(isValidName(Name) && "Invalid MDNode name");
 
   // If this is new, assign it its ID.
@@ -180,6 +220,7 @@ unsigned LLVMContext::getMDKindID(StringRef Name) const {
 /// getHandlerNames - Populate client supplied smallvector using custome
 /// metadata name and ID.
 void LLVMContext::getMDKindNames(SmallVectorImpl<StringRef> &Names) const {
+  ParallelIR::ContextGuard Guard;
   Names.resize(pImpl->CustomMDKindNames.size());
   for (StringMap<unsigned>::const_iterator I = pImpl->CustomMDKindNames.begin(),
        E = pImpl->CustomMDKindNames.end(); I != E; ++I)
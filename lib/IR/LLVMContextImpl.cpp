@@ -90,9 +90,12 @@ LLVMContextImpl::~LLVMContextImpl() {
   DeleteContainerSeconds(IntConstants);
   DeleteContainerSeconds(FPConstants);
   
-  for (StringMap<ConstantDataSequential*>::iterator I = CDSConstants.begin(),
-       E = CDSConstants.end(); I != E; ++I)
+  for (CDSMapTy::iterator I = CDSConstants.begin(), E = CDSConstants.end();
+       I != E; ++I) {
     delete I->second;
+    if (!isRetained(I->first))
+      delete[] I->first.data();
+  }
   CDSConstants.clear();
 
   // Destroy attributes.
@@ -125,6 +128,198 @@ LLVMContextImpl::~LLVMContextImpl() {
 
   // Destroy MDStrings.
   DeleteContainerSeconds(MDStringCache);
+
+  // Nothing refers to the retained buffers anymore.
+  DeleteContainerSeconds(RetainedBuffers);
+}
+
+namespace {
+typedef LLVMContext::UniquingTableInfo TableInfo;
+
+void addTable(SmallVectorImpl<TableInfo> &Tables, const char *Name,
+              unsigned NumEntries, unsigned NumBuckets, size_t MemorySize) {
+  TableInfo T = { Name, NumEntries, NumBuckets, MemorySize };
+  Tables.push_back(T);
+}
+
+template<typename MapTy>
+void addDenseMap(SmallVectorImpl<TableInfo> &Tables, const char *Name,
+                 const MapTy &Map) {
+  size_t Size = Map.getMemorySize();
+  addTable(Tables, Name, Map.size(),
+           Size / sizeof(typename MapTy::value_type), Size);
+}
+
+template<typename MapTy>
+void addAggrMap(SmallVectorImpl<TableInfo> &Tables, const char *Name,
+                const MapTy &Map) {
+  size_t Size = Map.getMemorySize();
+  addTable(Tables, Name, Map.size(),
+           Size / sizeof(typename MapTy::MapTy::value_type), Size);
+}
+
+template<typename SetTy>
+void addFoldingSet(SmallVectorImpl<TableInfo> &Tables, const char *Name,
+                   const SetTy &Set) {
+  addTable(Tables, Name, Set.size(), Set.getNumBuckets(),
+           Set.getMemorySize());
+}
+
+template<typename MapTy>
+void addStringMap(SmallVectorImpl<TableInfo> &Tables, const char *Name,
+                  const MapTy &Map) {
+  // Each bucket holds an entry pointer and the full hash of its key, and
+  // there is one more bucket as a sentinel.
+  unsigned NumBuckets = Map.getNumBuckets();
+  addTable(Tables, Name, Map.size(), NumBuckets,
+           NumBuckets ? (NumBuckets + 1) * (sizeof(void*) + sizeof(unsigned))
+                      : 0);
+}
+
+/// shrinkDenseMap - Rehash Map into the smallest table that holds its
+/// entries, if that is smaller than the current one.
+template<typename MapTy>
+void shrinkDenseMap(MapTy &Map) {
+  MapTy Shrunk(Map.begin(), Map.end());
+  if (Shrunk.getMemorySize() < Map.getMemorySize())
+    Map.swap(Shrunk);
+}
+
+/// isDead - Return true if nothing refers to C through a use or a value
+/// handle, which includes the operands of metadata nodes.
+bool isDead(const Constant *C) {
+  return C->use_empty() && !C->hasValueHandle();
+}
+
+/// CollectDeadSeconds - Collects the dead constants of a uniquing table. Like
+/// DropReferences, it takes the value_type of the table, whose 'second' is a
+/// Constant*.
+struct CollectDeadSeconds {
+  SmallVectorImpl<Constant*> &Dead;
+  explicit CollectDeadSeconds(SmallVectorImpl<Constant*> &Dead) : Dead(Dead) {}
+  template<typename PairT>
+  void operator()(const PairT &P) {
+    if (isDead(P.second))
+      Dead.push_back(P.second);
+  }
+};
+
+/// CollectDeadFirsts - The same for tables whose 'first' is the Constant*.
+struct CollectDeadFirsts {
+  SmallVectorImpl<Constant*> &Dead;
+  explicit CollectDeadFirsts(SmallVectorImpl<Constant*> &Dead) : Dead(Dead) {}
+  template<typename PairT>
+  void operator()(const PairT &P) {
+    if (isDead(P.first))
+      Dead.push_back(P.first);
+  }
+};
+
+/// eraseDeadSimpleConstants - Delete the dead constants of the IntConstants
+/// or FPConstants table, which have no destroyConstant of their own.
+template<typename MapTy>
+unsigned eraseDeadSimpleConstants(MapTy &Map, const Constant *Keep1,
+                                  const Constant *Keep2) {
+  unsigned NumDeleted = 0;
+  for (typename MapTy::iterator I = Map.begin(), E = Map.end(); I != E; ) {
+    typename MapTy::iterator Cur = I++;
+    Constant *C = Cur->second;
+    if (!isDead(C) || C == Keep1 || C == Keep2)
+      continue;
+    // Erasing only leaves a tombstone, so I stays valid.
+    Map.erase(Cur);
+    delete C;
+    ++NumDeleted;
+  }
+  return NumDeleted;
+}
+}
+
+void LLVMContextImpl::getUniquingTableInfo(
+    SmallVectorImpl<TableInfo> &Tables) const {
+  addDenseMap(Tables, "IntConstants", IntConstants);
+  addDenseMap(Tables, "FPConstants", FPConstants);
+  addDenseMap(Tables, "CAZConstants", CAZConstants);
+  addAggrMap(Tables, "ArrayConstants", ArrayConstants);
+  addAggrMap(Tables, "StructConstants", StructConstants);
+  addAggrMap(Tables, "VectorConstants", VectorConstants);
+  addDenseMap(Tables, "CPNConstants", CPNConstants);
+  addDenseMap(Tables, "UVConstants", UVConstants);
+  addDenseMap(Tables, "CDSConstants", CDSConstants);
+  addDenseMap(Tables, "BlockAddresses", BlockAddresses);
+  addTable(Tables, "ExprConstants", ExprConstants.size(), 0,
+           ExprConstants.getMemorySize());
+  addTable(Tables, "InlineAsms", InlineAsms.size(), 0,
+           InlineAsms.getMemorySize());
+  addDenseMap(Tables, "MDStringCache", MDStringCache);
+  addFoldingSet(Tables, "MDNodeSet", MDNodeSet);
+  addFoldingSet(Tables, "AttrsSet", AttrsSet);
+  addFoldingSet(Tables, "AttrsLists", AttrsLists);
+  addDenseMap(Tables, "IntegerTypes", IntegerTypes);
+  addDenseMap(Tables, "FunctionTypes", FunctionTypes);
+  addDenseMap(Tables, "AnonStructTypes", AnonStructTypes);
+  addStringMap(Tables, "NamedStructTypes", NamedStructTypes);
+  addDenseMap(Tables, "ArrayTypes", ArrayTypes);
+  addDenseMap(Tables, "VectorTypes", VectorTypes);
+  addDenseMap(Tables, "PointerTypes", PointerTypes);
+  addDenseMap(Tables, "ASPointerTypes", ASPointerTypes);
+  addDenseMap(Tables, "ValueHandles", ValueHandles);
+  addDenseMap(Tables, "MetadataStore", MetadataStore);
+}
+
+unsigned LLVMContextImpl::compactUniquingTables() {
+  unsigned NumDeleted = 0;
+
+  // Destroying a constant drops its uses of its operands, which can leave the
+  // operands dead in turn, so keep going until nothing changes.
+  SmallVector<Constant*, 64> Dead;
+  while (true) {
+    Dead.clear();
+    CollectDeadSeconds Seconds(Dead);
+    CollectDeadFirsts Firsts(Dead);
+    std::for_each(ExprConstants.map_begin(), ExprConstants.map_end(), Seconds);
+    std::for_each(ArrayConstants.map_begin(), ArrayConstants.map_end(),
+                  Firsts);
+    std::for_each(StructConstants.map_begin(), StructConstants.map_end(),
+                  Firsts);
+    std::for_each(VectorConstants.map_begin(), VectorConstants.map_end(),
+                  Firsts);
+    std::for_each(CAZConstants.begin(), CAZConstants.end(), Seconds);
+    std::for_each(CPNConstants.begin(), CPNConstants.end(), Seconds);
+    std::for_each(UVConstants.begin(), UVConstants.end(), Seconds);
+    for (CDSMapTy::iterator I = CDSConstants.begin(), E = CDSConstants.end();
+         I != E; ++I)
+      for (ConstantDataSequential *C = I->second; C; C = C->Next)
+        if (isDead(C))
+          Dead.push_back(C);
+
+    // The constants collected have no users, so destroying one of them
+    // cannot destroy another.
+    for (unsigned i = 0, e = Dead.size(); i != e; ++i)
+      Dead[i]->destroyConstant();
+    NumDeleted += Dead.size();
+    if (Dead.empty())
+      break;
+  }
+
+  // Integers and floats have no operands, so they are done last.
+  NumDeleted += eraseDeadSimpleConstants(IntConstants, TheTrueVal,
+                                         TheFalseVal);
+  NumDeleted += eraseDeadSimpleConstants(FPConstants, 0, 0);
+
+  shrinkDenseMap(IntConstants);
+  shrinkDenseMap(FPConstants);
+  shrinkDenseMap(CAZConstants);
+  shrinkDenseMap(CPNConstants);
+  shrinkDenseMap(UVConstants);
+  shrinkDenseMap(CDSConstants);
+  ArrayConstants.shrink();
+  StructConstants.shrink();
+  VectorConstants.shrink();
+  MDNodeSet.ShrinkHashTable();
+  AttrsSet.ShrinkHashTable();
+  AttrsLists.ShrinkHashTable();
+  return NumDeleted;
 }
 
 // ConstantsContext anchors
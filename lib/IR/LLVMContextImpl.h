@@ -25,12 +25,15 @@
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/ValueHandle.h"
+#include <map>
 #include <vector>
 
 namespace llvm {
@@ -94,6 +97,32 @@ struct DenseMapAPFloatKeyInfo {
   }
 };
 
+/// DenseMapStringRefKeyInfo - Hashes and compares StringRefs by their
+/// contents. The map doesn't own the keys, so they must outlive their entries.
+struct DenseMapStringRefKeyInfo {
+  static inline StringRef getEmptyKey() {
+    return StringRef(reinterpret_cast<const char*>(~uintptr_t(0)), 0);
+  }
+  static inline StringRef getTombstoneKey() {
+    return StringRef(reinterpret_cast<const char*>(~uintptr_t(1)), 0);
+  }
+  static unsigned getHashValue(StringRef Key) {
+    return StringMapImpl::hashKey(Key);
+  }
+  static bool isEqual(StringRef LHS, StringRef RHS) {
+    // The empty and tombstone keys only compare equal to themselves, not to
+    // other empty strings.
+    if (isSpecialKey(LHS) || isSpecialKey(RHS))
+      return LHS.data() == RHS.data();
+    return LHS == RHS;
+  }
+private:
+  static bool isSpecialKey(StringRef Key) {
+    return Key.data() == getEmptyKey().data() ||
+           Key.data() == getTombstoneKey().data();
+  }
+};
+
 struct AnonStructTypeKeyInfo {
   struct KeyTy {
     ArrayRef<Type*> ETypes;
@@ -235,6 +264,22 @@ public:
   /// OwnedModules - The set of modules instantiated in this context, and which
   /// will be automatically deleted if this context is deleted.
   SmallPtrSet<Module*, 4> OwnedModules;
+
+  /// RetainedBuffers - The buffers adopted through
+  /// LLVMContext::adoptMemoryBuffer, indexed by their end pointer. They are
+  /// destroyed after everything else in the context.
+  std::map<const char*, MemoryBuffer*> RetainedBuffers;
+
+  /// isRetained - Return true if the bytes of \p Str lie within one of the
+  /// RetainedBuffers, so that they stay valid as long as the context does.
+  bool isRetained(StringRef Str) const {
+    if (RetainedBuffers.empty() || Str.empty())
+      return false;
+    std::map<const char*, MemoryBuffer*>::const_iterator I =
+      RetainedBuffers.lower_bound(Str.end());
+    return I != RetainedBuffers.end() &&
+           Str.begin() >= I->second->getBufferStart();
+  }
   
   LLVMContext::DiagHandlerTy DiagHandler;
   void *DiagContext;
@@ -250,7 +295,13 @@ public:
   FoldingSet<AttributeImpl> AttrsSet;
   FoldingSet<AttributeSetImpl> AttrsLists;
 
-  StringMap<Value*> MDStringCache;
+  /// MDStringCache - Uniques the MDStrings by contents. The keys point to the
+  /// bytes of the MDStrings, which either live in MDStringAllocator or in one
+  /// of the RetainedBuffers.
+  typedef DenseMap<StringRef, MDString*, DenseMapStringRefKeyInfo>
+    MDStringMapTy;
+  MDStringMapTy MDStringCache;
+  BumpPtrAllocator MDStringAllocator;
 
   FoldingSet<MDNode> MDNodeSet;
 
@@ -275,7 +326,13 @@ public:
 
   DenseMap<Type*, UndefValue*> UVConstants;
   
-  StringMap<ConstantDataSequential*> CDSConstants;
+  /// CDSConstants - Uniques the ConstantDataSequentials by contents. The
+  /// keys own their bytes unless they lie in one of the RetainedBuffers. The
+  /// constants of a bucket are linked through their Next pointers and all
+  /// refer to the bytes of the key.
+  typedef DenseMap<StringRef, ConstantDataSequential*,
+                   DenseMapStringRefKeyInfo> CDSMapTy;
+  CDSMapTy CDSConstants;
 
   
   DenseMap<std::pair<Function*, BasicBlock*> , BlockAddress*> BlockAddresses;
@@ -354,6 +411,10 @@ public:
   
   LLVMContextImpl(LLVMContext &C);
   ~LLVMContextImpl();
+
+  void getUniquingTableInfo(
+    SmallVectorImpl<LLVMContext::UniquingTableInfo> &Tables) const;
+  unsigned compactUniquingTables();
 };
 
 }
@@ -14,6 +14,7 @@
 #include "llvm/Support/LeakDetector.h"
 #include "LLVMContextImpl.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/ParallelIR.h"
 #include "llvm/IR/Value.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -35,6 +36,7 @@ void LeakDetector::addGarbageObjectImpl(void *Object) {
 }
 
 void LeakDetector::addGarbageObjectImpl(const Value *Object) {
+  ParallelIR::ContextGuard Guard;
   LLVMContextImpl *pImpl = Object->getContext().pImpl;
   pImpl->LLVMObjects.addGarbage(Object);
 }
@@ -45,6 +47,7 @@ void LeakDetector::removeGarbageObjectImpl(void *Object) {
 }
 
 void LeakDetector::removeGarbageObjectImpl(const Value *Object) {
+  ParallelIR::ContextGuard Guard;
   LLVMContextImpl *pImpl = Object->getContext().pImpl;
   pImpl->LLVMObjects.removeGarbage(Object);
 }
@@ -21,6 +21,7 @@
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/ParallelIR.h"
 #include "llvm/Support/ConstantRange.h"
 #include "llvm/Support/LeakDetector.h"
 #include "llvm/Support/ValueHandle.h"
@@ -32,17 +33,29 @@ using namespace llvm;
 
 void MDString::anchor() { }
 
-MDString::MDString(LLVMContext &C)
-  : Value(Type::getMetadataTy(C), Value::MDStringVal) {}
+MDString::MDString(LLVMContext &C, StringRef Str)
+  : Value(Type::getMetadataTy(C), Value::MDStringVal), Str(Str) {}
 
 MDString *MDString::get(LLVMContext &Context, StringRef Str) {
+  ParallelIR::ContextGuard Guard;
   LLVMContextImpl *pImpl = Context.pImpl;
-  StringMapEntry<Value*> &Entry =
-    pImpl->MDStringCache.GetOrCreateValue(Str);
-  Value *&S = Entry.getValue();
-  if (!S) S = new MDString(Context);
-  S->setValueName(&Entry);
-  return cast<MDString>(S);
+  LLVMContextImpl::MDStringMapTy::iterator I = pImpl->MDStringCache.find(Str);
+  if (I != pImpl->MDStringCache.end())
+    return I->second;
+
+  // Copy the string into the context unless it lives in a buffer owned by the
+  // context anyway.  Copies are null terminated for the benefit of clients
+  // that treat the data as a C string.
+  if (!pImpl->isRetained(Str)) {
+    char *Copy = pImpl->MDStringAllocator.Allocate<char>(Str.size() + 1);
+    std::copy(Str.begin(), Str.end(), Copy);
+    Copy[Str.size()] = 0;
+    Str = StringRef(Copy, Str.size());
+  }
+
+  MDString *S = new MDString(Context, Str);
+  pImpl->MDStringCache[Str] = S;
+  return S;
 }
 
 //===----------------------------------------------------------------------===//
@@ -129,6 +142,7 @@ MDNode::MDNode(LLVMContext &C, ArrayRef<Value*> Vals, bool isFunctionLocal)
 
 /// ~MDNode - Destroy MDNode.
 MDNode::~MDNode() {
+  ParallelIR::ContextGuard Guard;
   assert((getSubclassDataFromValue() & DestroyFlag) != 0 &&
          "Not being destroyed through destroy()?");
   LLVMContextImpl *pImpl = getType()->getContext().pImpl;
@@ -214,6 +228,7 @@ static bool isFunctionLocalValue(Value *V) {
 
 MDNode *MDNode::getMDNode(LLVMContext &Context, ArrayRef<Value*> Vals,
                           FunctionLocalness FL, bool Insert) {
+  ParallelIR::ContextGuard Guard;
   LLVMContextImpl *pImpl = Context.pImpl;
 
   // Add all the operand pointers. Note that we don't have to add the
@@ -288,6 +303,7 @@ MDNode *MDNode::getTemporary(LLVMContext &Context, ArrayRef<Value*> Vals) {
 }
 
 void MDNode::deleteTemporary(MDNode *N) {
+  ParallelIR::ContextGuard Guard;
   assert(N->use_empty() && "Temporary MDNode has uses!");
   assert(!N->getContext().pImpl->MDNodeSet.RemoveNode(N) &&
          "Deleting a non-temporary uniqued node!");
@@ -316,6 +332,7 @@ void MDNode::Profile(FoldingSetNodeID &ID) const {
 }
 
 void MDNode::setIsNotUniqued() {
+  ParallelIR::ContextGuard Guard;
   setValueSubclassData(getSubclassDataFromValue() | NotUniquedBit);
   LLVMContextImpl *pImpl = getType()->getContext().pImpl;
   pImpl->NonUniquedMDNodes.insert(this);
@@ -323,6 +340,7 @@ void MDNode::setIsNotUniqued() {
 
 // Replace value from this node's operand list.
 void MDNode::replaceOperand(MDNodeOperand *Op, Value *To) {
+  ParallelIR::ContextGuard Guard;
   Value *From = *Op;
 
   // If is possible that someone did GV->RAUW(inst), replacing a global variable
@@ -627,7 +645,9 @@ void Instruction::setMetadata(unsigned KindID, MDNode *Node) {
     DbgLoc = DebugLoc::getFromDILocation(Node);
     return;
   }
-  
+
+  ParallelIR::ContextGuard Guard;
+
   // Handle the case when we're adding/updating metadata on an instruction.
   if (Node) {
     LLVMContextImpl::MDMapTy &Info = getContext().pImpl->MetadataStore[this];
@@ -681,7 +701,8 @@ MDNode *Instruction::getMetadataImpl(unsigned KindID) const {
     return DbgLoc.getAsMDNode(getContext());
   
   if (!hasMetadataHashEntry()) return 0;
-  
+
+  ParallelIR::ContextGuard Guard;
   LLVMContextImpl::MDMapTy &Info = getContext().pImpl->MetadataStore[this];
   assert(!Info.empty() && "bit out of sync with hash table");
 
@@ -694,6 +715,7 @@ MDNode *Instruction::getMetadataImpl(unsigned KindID) const {
 
 void Instruction::getAllMetadataImpl(SmallVectorImpl<std::pair<unsigned,
                                        MDNode*> > &Result) const {
+  ParallelIR::ContextGuard Guard;
   Result.clear();
   
   // Handle 'dbg' as a special case since it is not stored in the hash table.
@@ -720,6 +742,7 @@ void Instruction::getAllMetadataImpl(SmallVectorImpl<std::pair<unsigned,
 void Instruction::
 getAllMetadataOtherThanDebugLocImpl(SmallVectorImpl<std::pair<unsigned,
                                     MDNode*> > &Result) const {
+  ParallelIR::ContextGuard Guard;
   Result.clear();
   assert(hasMetadataHashEntry() &&
          getContext().pImpl->MetadataStore.count(this) &&
@@ -737,6 +760,7 @@ getAllMetadataOtherThanDebugLocImpl(SmallVectorImpl<std::pair<unsigned,
 /// clearMetadataHashEntries - Clear all hashtable-based metadata from
 /// this instruction.
 void Instruction::clearMetadataHashEntries() {
+  ParallelIR::ContextGuard Guard;
   assert(hasMetadataHashEntry() && "Caller should check");
   getContext().pImpl->MetadataStore.erase(this);
   setHasMetadataHashEntry(false);
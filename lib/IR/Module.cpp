@@ -22,6 +22,7 @@
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/ParallelIR.h"
 #include "llvm/Support/LeakDetector.h"
 #include <algorithm>
 #include <cstdarg>
@@ -109,6 +110,7 @@ Module::PointerSize Module::getPointerSize() const {
 /// the specified name, of arbitrary type.  This method returns null
 /// if a global with the specified name is not found.
 GlobalValue *Module::getNamedValue(StringRef Name) const {
+  ParallelIR::waitForModuleAccess();
   return cast_or_null<GlobalValue>(getValueSymbolTable().lookup(Name));
 }
 
@@ -300,6 +302,7 @@ GlobalAlias *Module::getNamedAlias(StringRef Name) const {
 /// specified name. This method returns null if a NamedMDNode with the
 /// specified name is not found.
 NamedMDNode *Module::getNamedMetadata(const Twine &Name) const {
+  ParallelIR::waitForModuleAccess();
   SmallString<256> NameData;
   StringRef NameRef = Name.toStringRef(NameData);
   return static_cast<StringMap<NamedMDNode*> *>(NamedMDSymTab)->lookup(NameRef);
@@ -309,6 +312,7 @@ NamedMDNode *Module::getNamedMetadata(const Twine &Name) const {
 /// with the specified name. This method returns a new NamedMDNode if a
 /// NamedMDNode with the specified name is not found.
 NamedMDNode *Module::getOrInsertNamedMetadata(StringRef Name) {
+  ParallelIR::waitForModuleAccess();
   NamedMDNode *&NMD =
     (*static_cast<StringMap<NamedMDNode *> *>(NamedMDSymTab))[Name];
   if (!NMD) {
@@ -322,6 +326,7 @@ NamedMDNode *Module::getOrInsertNamedMetadata(StringRef Name) {
 /// eraseNamedMetadata - Remove the given NamedMDNode from this module and
 /// delete it.
 void Module::eraseNamedMetadata(NamedMDNode *NMD) {
+  ParallelIR::waitForModuleAccess();
   static_cast<StringMap<NamedMDNode *> *>(NamedMDSymTab)->erase(NMD->getName());
   NamedMDList.erase(NMD);
 }
@@ -0,0 +1,77 @@
+//===-- ParallelIR.cpp - Sharing IR between threads -----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the locks and the module access order of ParallelIR.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/ParallelIR.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadLocal.h"
+#include "llvm/Support/ThreadPool.h"
+using namespace llvm;
+
+volatile sys::cas_flag ParallelIR::NumActiveRuns = 0;
+
+namespace {
+/// UseListMutex - Use lists are only changed with the lock held, never
+/// calling out, so the lock doesn't need to be recursive.
+struct UseListMutex : public sys::Mutex {
+  UseListMutex() : sys::Mutex(false) {}
+};
+}
+
+static ManagedStatic<sys::Mutex> ContextLock;
+static ManagedStatic<UseListMutex> UseListLock;
+static sys::ThreadLocal<const ParallelIR::FunctionScope> CurrentScope;
+
+void ParallelIR::lockContext() {
+  ContextLock->acquire();
+}
+
+void ParallelIR::unlockContext() {
+  ContextLock->release();
+}
+
+void ParallelIR::lockUseLists() {
+  UseListLock->acquire();
+}
+
+void ParallelIR::unlockUseLists() {
+  UseListLock->release();
+}
+
+void ParallelIR::waitForModuleAccessSlow() {
+  FunctionScope *Scope = const_cast<FunctionScope*>(CurrentScope.get());
+  if (!Scope || Scope->HasModuleAccess)
+    return;
+  Scope->R.Sequencer->waitForPredecessors(Scope->Index);
+  Scope->HasModuleAccess = true;
+}
+
+ParallelIR::Run::Run(unsigned NumFunctions)
+  : Sequencer(new TaskSequencer(NumFunctions)) {
+  sys::AtomicIncrement(&NumActiveRuns);
+}
+
+ParallelIR::Run::~Run() {
+  sys::AtomicDecrement(&NumActiveRuns);
+  delete Sequencer;
+}
+
+ParallelIR::FunctionScope::FunctionScope(Run &R, unsigned Index)
+  : R(R), Index(Index), HasModuleAccess(false) {
+  CurrentScope.set(this);
+}
+
+ParallelIR::FunctionScope::~FunctionScope() {
+  CurrentScope.erase();
+  R.Sequencer->finish(Index);
+}
@@ -88,6 +88,10 @@ void *Pass::getAdjustedAnalysisPointer(AnalysisID AID) {
   return this;
 }
 
+Pass *Pass::createReplica() const {
+  return 0;
+}
+
 ImmutablePass *Pass::getAsImmutablePass() {
   return 0;
 }
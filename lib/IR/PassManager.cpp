@@ -16,17 +16,25 @@
 #include "llvm/Assembly/PrintModulePass.h"
 #include "llvm/Assembly/Writer.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/ParallelIR.h"
 #include "llvm/PassManager.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/PassNameParser.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/Timer.h"
+#include "llvm/Support/YAMLTraits.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <map>
+#include <vector>
 using namespace llvm;
 
 // See PassManagers.h for Pass Manager infrastructure overview.
@@ -488,11 +496,142 @@ public:
 
 static TimingInfo *TheTimeInfo;
 
+//===----------------------------------------------------------------------===//
+// PassProfile Class - This class accumulates the time, instruction count and
+// allocator traffic of every (pass, function) pair and writes them out as YAML
+// on exit.  This only happens when -pass-profile is given on the command line.
+//
+static cl::opt<std::string>
+PassProfileFile("pass-profile", cl::value_desc("filename"),
+                cl::desc("Write a YAML profile of each pass on each function "
+                         "to the given file on exit"));
+
+static cl::opt<unsigned>
+PassProfileSlowest("pass-profile-slowest", cl::init(0), cl::value_desc("N"),
+                   cl::desc("Only report the N slowest (pass, function) pairs "
+                            "in the -pass-profile output"));
+
+namespace {
+
+/// PassProfileEntry - Totals for one pass over one function.  Module passes
+/// are recorded with an empty function name.
+struct PassProfileEntry {
+  StringRef PassName;
+  StringRef Function;
+  uint64_t Runs;
+  double WallTime;
+  double UserTime;
+  uint64_t Instructions;
+  uint64_t MallocBytes;
+  uint64_t BumpPtrBytes;
+
+  PassProfileEntry()
+    : Runs(0), WallTime(0), UserTime(0), Instructions(0), MallocBytes(0),
+      BumpPtrBytes(0) {}
+};
+
+/// PassProfileReport - The document written to the -pass-profile file.
+struct PassProfileReport {
+  double TotalWallTime;
+  uint64_t NumEntries;
+  std::vector<PassProfileEntry> Entries;
+};
+
+/// isSlowerThan - Order entries by decreasing wall time, falling back to the
+/// names so that the report is stable.
+static bool isSlowerThan(const PassProfileEntry &A, const PassProfileEntry &B) {
+  if (A.WallTime != B.WallTime)
+    return A.WallTime > B.WallTime;
+  if (A.PassName != B.PassName)
+    return A.PassName < B.PassName;
+  return A.Function < B.Function;
+}
+
+} // End of anon namespace
+
+LLVM_YAML_IS_SEQUENCE_VECTOR(PassProfileEntry)
+
+namespace llvm {
+namespace yaml {
+
+template <>
+struct MappingTraits<PassProfileEntry> {
+  static void mapping(IO &io, PassProfileEntry &E) {
+    io.mapRequired("pass", E.PassName);
+    io.mapRequired("function", E.Function);
+    io.mapRequired("runs", E.Runs);
+    io.mapRequired("wall-time", E.WallTime);
+    io.mapRequired("user-time", E.UserTime);
+    io.mapRequired("instructions", E.Instructions);
+    io.mapRequired("malloc-bytes", E.MallocBytes);
+    io.mapRequired("bump-ptr-bytes", E.BumpPtrBytes);
+  }
+};
+
+template <>
+struct MappingTraits<PassProfileReport> {
+  static void mapping(IO &io, PassProfileReport &R) {
+    io.mapRequired("total-wall-time", R.TotalWallTime);
+    io.mapRequired("num-entries", R.NumEntries);
+    io.mapRequired("passes", R.Entries);
+  }
+};
+
+} // End yaml namespace
+} // End llvm namespace
+
+namespace {
+
+static ManagedStatic<sys::SmartMutex<true> > PassProfileMutex;
+
+class PassProfile {
+  /// Entries - Keyed by the pass name and function name separated by a nul.
+  /// The names in each entry refer into its key.
+  StringMap<PassProfileEntry> Entries;
+public:
+  ~PassProfile();
+
+  // createTheProfile - This method either initializes the ThePassProfile
+  // pointer to a non null value (if the -pass-profile option is given) or it
+  // leaves it null.  It may be called multiple times.
+  static void createTheProfile();
+
+  /// record - Add one run of P over Unit to the profile.
+  void record(Pass *P, StringRef Unit, unsigned NumInstructions,
+              double WallTime, double UserTime, uint64_t MallocBytes,
+              uint64_t BumpPtrBytes) {
+    SmallString<128> Key(P->getPassName());
+    Key.push_back('\0');
+    Key.append(Unit.begin(), Unit.end());
+
+    sys::SmartScopedLock<true> Lock(*PassProfileMutex);
+    StringMapEntry<PassProfileEntry> &KV = Entries.GetOrCreateValue(Key);
+    PassProfileEntry &E = KV.getValue();
+    if (E.Runs == 0) {
+      StringRef Name = KV.getKey();
+      size_t Sep = Name.find('\0');
+      E.PassName = Name.substr(0, Sep);
+      E.Function = Name.substr(Sep + 1);
+    }
+    ++E.Runs;
+    E.WallTime += WallTime;
+    E.UserTime += UserTime;
+    E.Instructions += NumInstructions;
+    E.MallocBytes += MallocBytes;
+    E.BumpPtrBytes += BumpPtrBytes;
+  }
+};
+
+} // End of anon namespace
+
+static PassProfile *ThePassProfile;
+
 //===----------------------------------------------------------------------===//
 // PMTopLevelManager implementation
 
 /// Initialize top level manager. Create first pass manager.
-PMTopLevelManager::PMTopLevelManager(PMDataManager *PMDM) {
+PMTopLevelManager::PMTopLevelManager(PMDataManager *PMDM)
+  : NumFunctionThreads(1) {
   PMDM->setTopLevelManager(this);
   addPassManager(PMDM);
   activeStack.push(PMDM);
@@ -581,6 +720,14 @@ AnalysisUsage *PMTopLevelManager::findAnalysisUsage(Pass *P) {
   return AnUsage;
 }
 
+void PMTopLevelManager::removeAnalysisUsage(Pass *P) {
+  DenseMap<Pass *, AnalysisUsage *>::iterator DMI = AnUsageMap.find(P);
+  if (DMI == AnUsageMap.end())
+    return;
+  delete DMI->second;
+  AnUsageMap.erase(DMI);
+}
+
 /// Schedule pass P for execution. Make sure that passes required by
 /// P are run before P is run. Update analysis info maintained by
 /// the manager. Remove dead passes. This is a recursive function.
@@ -953,6 +1100,10 @@ void PMDataManager::freePass(Pass *P, StringRef Msg,
     P->releaseMemory();
   }
 
+  removeAvailableAnalysis(P);
+}
+
+void PMDataManager::removeAvailableAnalysis(Pass *P) {
   AnalysisID PI = P->getPassID();
   if (const PassInfo *PInf = PassRegistry::getPassRegistry()->getPassInfo(PI)) {
     // Remove the pass itself (if it is not already removed).
@@ -1301,6 +1452,7 @@ bool BBPassManager::runOnFunction(Function &F) {
         // If the pass crashes, remember this.
         PassManagerPrettyStackEntry X(BP, *I);
         TimeRegion PassTimer(getPassTimer(BP));
+        PassProfileRegion Profile(BP, *I);
 
         LocalChanged |= BP->runOnBasicBlock(*I);
       }
@@ -1477,6 +1629,7 @@ void FunctionPassManagerImpl::releaseMemoryOnTheFly() {
 bool FunctionPassManagerImpl::run(Function &F) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  PassProfile::createTheProfile();
 
   initializeAllAnalysisInfo();
   for (unsigned Index = 0; Index < getNumContainedManagers(); ++Index)
@@ -1513,8 +1666,11 @@ bool FPPassManager::runOnFunction(Function &F) {
 
   bool Changed = false;
 
-  // Collect inherited analysis from Module level pass manager.
-  populateInheritedAnalysis(TPM->activeStack);
+  // Collect inherited analysis from Module level pass manager. Replicas run
+  // on worker threads and leave the analyses of the parents alone, the
+  // original manager updates them once all functions are done.
+  if (!Original)
+    populateInheritedAnalysis(TPM->activeStack);
 
   for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
     FunctionPass *FP = getContainedPass(Index);
@@ -1528,6 +1684,7 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      PassProfileRegion Profile(FP, F);
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1540,7 +1697,10 @@ bool FPPassManager::runOnFunction(Function &F) {
     verifyPreservedAnalysis(FP);
     removeNotPreservedAnalysis(FP);
     recordAvailableAnalysis(FP);
-    removeDeadPasses(FP, F.getName(), ON_FUNCTION_MSG);
+    if (Original)
+      removeDeadReplicas(FP, F.getName());
+    else
+      removeDeadPasses(FP, F.getName(), ON_FUNCTION_MSG);
   }
   return Changed;
 }
@@ -1548,12 +1708,201 @@ bool FPPassManager::runOnFunction(Function &F) {
 bool FPPassManager::runOnModule(Module &M) {
   bool Changed = false;
 
+  // The timers of -time-passes and the records of -pass-profile are kept per
+  // pass, so these stay on a single thread.
+  unsigned NumThreads = TPM->getNumFunctionThreads();
+  if (NumThreads > 1 && llvm_is_multithreaded() && !TimePassesIsEnabled &&
+      !PassProfileRegion::isEnabled() &&
+      runOnModuleInParallel(M, NumThreads, Changed))
+    return Changed;
+
   for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
     Changed |= runOnFunction(*I);
 
   return Changed;
 }
 
+namespace {
+/// ParallelFunctionRun - The functions processed by the replicas of a function
+/// pass manager. They are claimed in module order, as ParallelIR requires.
+struct ParallelFunctionRun {
+  const std::vector<Function *> &Functions;
+  ParallelIR::Run IRRun;
+  volatile sys::cas_flag NumClaimed;
+
+  explicit ParallelFunctionRun(const std::vector<Function *> &Functions)
+    : Functions(Functions), IRRun(Functions.size()), NumClaimed(0) {}
+};
+
+/// ReplicaTask - One replica of a function pass manager, running on
+/// functions until there are none left.
+struct ReplicaTask {
+  ParallelFunctionRun *Run;
+  FPPassManager *Rep;
+  bool Changed;
+
+  ReplicaTask() : Run(0), Rep(0), Changed(false) {}
+
+  static void run(void *Arg) {
+    ReplicaTask &T = *static_cast<ReplicaTask *>(Arg);
+    const std::vector<Function *> &Functions = T.Run->Functions;
+    for (;;) {
+      unsigned Index = sys::AtomicIncrement(&T.Run->NumClaimed) - 1;
+      if (Index >= Functions.size())
+        return;
+      ParallelIR::FunctionScope Scope(T.Run->IRRun, Index);
+      T.Changed |= T.Rep->runOnFunction(*Functions[Index]);
+    }
+  }
+};
+}
+
+bool FPPassManager::runOnModuleInParallel(Module &M, unsigned NumThreads,
+                                          bool &Changed) {
+  std::vector<Function *> Functions;
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+    if (!I->isDeclaration())
+      Functions.push_back(I);
+  if (Functions.size() < 2)
+    return false;
+  NumThreads = std::min<unsigned>(NumThreads, Functions.size());
+
+  // Every replica has the same passes, so only the first one can fail. The
+  // replicas are initialized here, one after the other, in addition to the
+  // original passes.
+  std::vector<ReplicaTask> Tasks(NumThreads);
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    Tasks[i].Rep = createReplicaManager();
+    if (!Tasks[i].Rep) {
+      assert(i == 0 && "Replicas differ!");
+      return false;
+    }
+    Changed |= Tasks[i].Rep->doInitialization(M);
+  }
+
+  {
+    ParallelFunctionRun Run(Functions);
+    // This thread runs the last replica.
+    ThreadPool Pool(NumThreads - 1);
+    for (unsigned i = 0; i != NumThreads; ++i) {
+      Tasks[i].Run = &Run;
+      if (i != NumThreads - 1)
+        Pool.async(ReplicaTask::run, &Tasks[i]);
+    }
+    ReplicaTask::run(&Tasks.back());
+    Pool.wait();
+  }
+
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    Changed |= Tasks[i].Changed;
+    Changed |= Tasks[i].Rep->doFinalization(M);
+    destroyReplicaManager(Tasks[i].Rep);
+  }
+
+  // Leave the analysis info of this manager and its parents the way the
+  // serial run would. The original passes never ran, so there is no memory
+  // to release.
+  populateInheritedAnalysis(TPM->activeStack);
+  for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
+    FunctionPass *FP = getContainedPass(Index);
+    removeNotPreservedAnalysis(FP);
+    recordAvailableAnalysis(FP);
+    SmallVector<Pass *, 12> DeadPasses;
+    TPM->collectLastUses(DeadPasses, FP);
+    for (SmallVectorImpl<Pass *>::iterator I = DeadPasses.begin(),
+           E = DeadPasses.end(); I != E; ++I)
+      removeAvailableAnalysis(*I);
+  }
+  return true;
+}
+
+FPPassManager *FPPassManager::createReplicaManager() {
+  FPPassManager *Rep = new FPPassManager();
+  Rep->Original = this;
+  Rep->setTopLevelManager(TPM);
+  Rep->setDepth(getDepth());
+
+  // Immutable passes that keep state, like the alias analyses with caches,
+  // get a replica of their own, the others are shared. A shared pass must not
+  // be chained to a replicated one, and the function passes must not see a
+  // module level implementation of a replicated interface instead.
+  PassRegistry *PR = PassRegistry::getPassRegistry();
+  SmallPtrSet<AnalysisID, 8> ReplicatedIDs;
+  SmallVectorImpl<ImmutablePass *> &IPV = TPM->getImmutablePasses();
+  for (unsigned i = 0, e = IPV.size(); i != e; ++i) {
+    ImmutablePass *IP = IPV[i];
+    SmallVector<AnalysisID, 4> IDs;
+    IDs.push_back(IP->getPassID());
+    if (const PassInfo *PI = PR->getPassInfo(IP->getPassID())) {
+      const std::vector<const PassInfo*> &II = PI->getInterfacesImplemented();
+      for (unsigned j = 0, je = II.size(); j != je; ++j)
+        IDs.push_back(II[j]->getTypeInfo());
+    }
+
+    Pass *R = IP->createReplica();
+    bool Replicable = true;
+    for (unsigned j = 0, je = IDs.size(); j != je && Replicable; ++j) {
+      if (R)
+        Replicable = TPM->findAnalysisPass(IDs[j])->getAsImmutablePass() != 0;
+      else
+        Replicable = !ReplicatedIDs.count(IDs[j]);
+    }
+    if (!Replicable) {
+      delete R;
+      destroyReplicaManager(Rep);
+      return 0;
+    }
+
+    if (!R) {
+      Rep->recordAvailableAnalysis(IP);
+      continue;
+    }
+
+    ReplicatedIDs.insert(IDs.begin(), IDs.end());
+    ImmutablePass *RI = R->getAsImmutablePass();
+    assert(RI && "Replica of an immutable pass is not immutable!");
+    Rep->ImmutableReplicas.push_back(RI);
+    RI->setResolver(new AnalysisResolver(*Rep));
+    Rep->initializeAnalysisImpl(RI);
+    RI->initializePass();
+    Rep->recordAvailableAnalysis(RI);
+  }
+
+  for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
+    Pass *P = PassVector[Index];
+    Pass *R = P->createReplica();
+    if (!R) {
+      destroyReplicaManager(Rep);
+      return 0;
+    }
+    Rep->add(R, false);
+    Rep->OriginalOf[R] = P;
+    Rep->ReplicaOf[P] = R;
+    // Compute the analysis usage now, worker threads only look it up.
+    TPM->findAnalysisUsage(R);
+  }
+  return Rep;
+}
+
+void FPPassManager::destroyReplicaManager(FPPassManager *Rep) {
+  for (unsigned Index = 0; Index < Rep->getNumContainedPasses(); ++Index)
+    TPM->removeAnalysisUsage(Rep->PassVector[Index]);
+  for (unsigned i = 0, e = Rep->ImmutableReplicas.size(); i != e; ++i) {
+    TPM->removeAnalysisUsage(Rep->ImmutableReplicas[i]);
+    delete Rep->ImmutableReplicas[i];
+  }
+  delete Rep;
+}
+
+void FPPassManager::removeDeadReplicas(Pass *P, StringRef Msg) {
+  SmallVector<Pass *, 12> DeadPasses;
+  TPM->collectLastUses(DeadPasses, OriginalOf.lookup(P));
+  for (SmallVectorImpl<Pass *>::iterator I = DeadPasses.begin(),
+         E = DeadPasses.end(); I != E; ++I)
+    if (Pass *Dead = ReplicaOf.lookup(*I))
+      freePass(Dead, Msg, ON_FUNCTION_MSG);
+}
+
 bool FPPassManager::doInitialization(Module &M) {
   bool Changed = false;
 
@@ -1606,6 +1955,7 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      PassProfileRegion Profile(MP, M);
 
       LocalChanged |= MP->runOnModule(M);
     }
@@ -1690,6 +2040,7 @@ Pass* MPPassManager::getOnTheFlyPass(Pass *MP, AnalysisID PI, Function &F){
 bool PassManagerImpl::run(Module &M) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  PassProfile::createTheProfile();
 
   dumpArguments();
   dumpPasses();
@@ -1740,6 +2091,10 @@ bool PassManager::run(Module &M) {
   return PM->run(M);
 }
 
+void PassManager::setNumFunctionThreads(unsigned N) {
+  PM->setNumFunctionThreads(N);
+}
+
 //===----------------------------------------------------------------------===//
 // TimingInfo Class - This class is used to calculate information about the
 // amount of time each pass takes to execute.  This only happens with
@@ -1770,6 +2125,108 @@ Timer *llvm::getPassTimer(Pass *P) {
   return 0;
 }
 
+//===----------------------------------------------------------------------===//
+// PassProfile and PassProfileRegion implementation
+//
+
+// ~PassProfile - Write out the report, slowest entries first.
+PassProfile::~PassProfile() {
+  PassProfileReport Report;
+  Report.TotalWallTime = 0;
+  Report.NumEntries = Entries.size();
+  Report.Entries.reserve(Entries.size());
+  for (StringMap<PassProfileEntry>::iterator I = Entries.begin(),
+       E = Entries.end(); I != E; ++I) {
+    Report.TotalWallTime += I->getValue().WallTime;
+    Report.Entries.push_back(I->getValue());
+  }
+
+  std::sort(Report.Entries.begin(), Report.Entries.end(), isSlowerThan);
+  if (PassProfileSlowest && PassProfileSlowest < Report.Entries.size())
+    Report.Entries.resize(PassProfileSlowest);
+
+  std::string ErrorInfo;
+  raw_fd_ostream OS(PassProfileFile.c_str(), ErrorInfo);
+  if (!ErrorInfo.empty()) {
+    errs() << "Error opening pass profile '" << PassProfileFile << "': "
+           << ErrorInfo << '\n';
+    return;
+  }
+  yaml::Output YOut(OS);
+  YOut << Report;
+}
+
+void PassProfile::createTheProfile() {
+  if (PassProfileFile.empty() || ThePassProfile) return;
+
+  // As with TimingInfo, constructing this on first use makes sure that it is
+  // destroyed, and the report written, before the command line options.
+  static ManagedStatic<PassProfile> PP;
+  ThePassProfile = &*PP;
+  CountAllocatorBytes = true;
+}
+
+static unsigned countInstructions(const Function &F) {
+  unsigned NumInsts = 0;
+  for (Function::const_iterator I = F.begin(), E = F.end(); I != E; ++I)
+    NumInsts += I->size();
+  return NumInsts;
+}
+
+PassProfileRegion::PassProfileRegion(Pass *P, Function &F) : RecordedPass(0) {
+  if (ThePassProfile && !P->getAsPMDataManager())
+    start(P, F.getName(), countInstructions(F));
+}
+
+PassProfileRegion::PassProfileRegion(Pass *P, BasicBlock &BB)
+  : RecordedPass(0) {
+  if (ThePassProfile && !P->getAsPMDataManager())
+    start(P, BB.getParent()->getName(), BB.size());
+}
+
+PassProfileRegion::PassProfileRegion(Pass *P, Module &M) : RecordedPass(0) {
+  if (!ThePassProfile || P->getAsPMDataManager())
+    return;
+  unsigned NumInsts = 0;
+  for (Module::const_iterator I = M.begin(), E = M.end(); I != E; ++I)
+    NumInsts += countInstructions(*I);
+  start(P, StringRef(), NumInsts);
+}
+
+PassProfileRegion::PassProfileRegion(Pass *P, StringRef UnitName,
+                                     unsigned NumInsts) : RecordedPass(0) {
+  if (ThePassProfile && !P->getAsPMDataManager())
+    start(P, UnitName, NumInsts);
+}
+
+void PassProfileRegion::start(Pass *P, StringRef UnitName, unsigned NumInsts) {
+  RecordedPass = P;
+  Unit = UnitName;
+  NumInstructions = NumInsts;
+  const AllocatorByteCounts &Counts = getAllocatorByteCounts();
+  StartMallocBytes = Counts.MallocBytes;
+  StartBumpPtrBytes = Counts.BumpPtrBytes;
+  TimeRecord Now = TimeRecord::getCurrentTime(true);
+  StartWallTime = Now.getWallTime();
+  StartUserTime = Now.getUserTime();
+}
+
+PassProfileRegion::~PassProfileRegion() {
+  if (!RecordedPass)
+    return;
+  TimeRecord Now = TimeRecord::getCurrentTime(false);
+  const AllocatorByteCounts &Counts = getAllocatorByteCounts();
+  ThePassProfile->record(RecordedPass, Unit, NumInstructions,
+                         Now.getWallTime() - StartWallTime,
+                         Now.getUserTime() - StartUserTime,
+                         Counts.MallocBytes - StartMallocBytes,
+                         Counts.BumpPtrBytes - StartBumpPtrBytes);
+}
+
+bool PassProfileRegion::isEnabled() {
+  return ThePassProfile != 0;
+}
+
 //===----------------------------------------------------------------------===//
 // PMStack implementation
 //
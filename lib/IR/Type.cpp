@@ -15,6 +15,7 @@
 #include "LLVMContextImpl.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/ParallelIR.h"
 #include <algorithm>
 #include <cstdarg>
 using namespace llvm;
@@ -303,6 +304,7 @@ PointerType *Type::getInt64PtrTy(LLVMContext &C, unsigned AS) {
 //===----------------------------------------------------------------------===//
 
 IntegerType *IntegerType::get(LLVMContext &C, unsigned NumBits) {
+  ParallelIR::ContextGuard Guard;
   assert(NumBits >= MIN_INT_BITS && "bitwidth too small");
   assert(NumBits <= MAX_INT_BITS && "bitwidth too large");
   
@@ -360,6 +362,7 @@ FunctionType::FunctionType(Type *Result, ArrayRef<Type*> Params,
 // FunctionType::get - The factory function for the FunctionType class.
 FunctionType *FunctionType::get(Type *ReturnType,
                                 ArrayRef<Type*> Params, bool isVarArg) {
+  ParallelIR::ContextGuard Guard;
   LLVMContextImpl *pImpl = ReturnType->getContext().pImpl;
   FunctionTypeKeyInfo::KeyTy Key(ReturnType, Params, isVarArg);
   LLVMContextImpl::FunctionTypeMap::iterator I =
@@ -404,6 +407,7 @@ bool FunctionType::isValidArgumentType(Type *ArgTy) {
 
 StructType *StructType::get(LLVMContext &Context, ArrayRef<Type*> ETypes, 
                             bool isPacked) {
+  ParallelIR::ContextGuard Guard;
   LLVMContextImpl *pImpl = Context.pImpl;
   AnonStructTypeKeyInfo::KeyTy Key(ETypes, isPacked);
   LLVMContextImpl::StructTypeMap::iterator I =
@@ -424,6 +428,7 @@ StructType *StructType::get(LLVMContext &Context, ArrayRef<Type*> ETypes,
 }
 
 void StructType::setBody(ArrayRef<Type*> Elements, bool isPacked) {
+  ParallelIR::ContextGuard Guard;
   assert(isOpaque() && "Struct body already set!");
   
   setSubclassData(getSubclassData() | SCDB_HasBody);
@@ -439,6 +444,10 @@ void StructType::setBody(ArrayRef<Type*> Elements, bool isPacked) {
 }
 
 void StructType::setName(StringRef Name) {
+  // Named types are uniqued by suffixing a counter, so name them in the same
+  // order as a serial run would.
+  ParallelIR::waitForModuleAccess();
+  ParallelIR::ContextGuard Guard;
   if (Name == getName()) return;
 
   StringMap<StructType *> &SymbolTable = getContext().pImpl->NamedStructTypes;
@@ -492,6 +501,9 @@ void StructType::setName(StringRef Name) {
 // StructType Helper functions.
 
 StructType *StructType::create(LLVMContext &Context, StringRef Name) {
+  if (!Name.empty())
+    ParallelIR::waitForModuleAccess();
+  ParallelIR::ContextGuard Guard;
   StructType *ST = new (Context.pImpl->TypeAllocator) StructType(Context);
   if (!Name.empty())
     ST->setName(Name);
@@ -616,6 +628,7 @@ bool StructType::isLayoutIdentical(StructType *Other) const {
 /// getTypeByName - Return the type with the specified name, or null if there
 /// is none by that name.
 StructType *Module::getTypeByName(StringRef Name) const {
+  ParallelIR::ContextGuard Guard;
   StringMap<StructType*>::iterator I =
     getContext().pImpl->NamedStructTypes.find(Name);
   if (I != getContext().pImpl->NamedStructTypes.end())
@@ -681,6 +694,7 @@ ArrayType::ArrayType(Type *ElType, uint64_t NumEl)
 }
 
 ArrayType *ArrayType::get(Type *elementType, uint64_t NumElements) {
+  ParallelIR::ContextGuard Guard;
   Type *ElementType = const_cast<Type*>(elementType);
   assert(isValidElementType(ElementType) && "Invalid type for array element!");
     
@@ -708,6 +722,7 @@ VectorType::VectorType(Type *ElType, unsigned NumEl)
 }
 
 VectorType *VectorType::get(Type *elementType, unsigned NumElements) {
+  ParallelIR::ContextGuard Guard;
   Type *ElementType = const_cast<Type*>(elementType);
   assert(NumElements > 0 && "#Elements of a VectorType must be greater than 0");
   assert(isValidElementType(ElementType) &&
@@ -732,6 +747,7 @@ bool VectorType::isValidElementType(Type *ElemTy) {
 //===----------------------------------------------------------------------===//
 
 PointerType *PointerType::get(Type *EltTy, unsigned AddressSpace) {
+  ParallelIR::ContextGuard Guard;
   assert(EltTy && "Can't get a pointer to <null> type!");
   assert(isValidElementType(EltTy) && "Invalid type for pointer element!");
   
@@ -11,6 +11,10 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/IR/Argument.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/ParallelIR.h"
 #include "llvm/IR/Value.h"
 #include <new>
 
@@ -45,6 +49,24 @@ void Use::swap(Use &RHS) {
   }
 }
 
+//===----------------------------------------------------------------------===//
+//                         Use list locking
+//===----------------------------------------------------------------------===//
+
+bool Use::isSharedValue(const Value *V) {
+  return !isa<Instruction>(V) && !isa<Argument>(V) && !isa<BasicBlock>(V);
+}
+
+void Use::removeFromList() {
+  if (LLVM_LIKELY(!ParallelIR::isActive()) || !isSharedValue(Val)) {
+    unlinkFromList();
+    return;
+  }
+  ParallelIR::lockUseLists();
+  unlinkFromList();
+  ParallelIR::unlockUseLists();
+}
+
 //===----------------------------------------------------------------------===//
 //                         Use getImpliedUser Implementation
 //===----------------------------------------------------------------------===//
@@ -10,6 +10,7 @@
 #include "llvm/IR/User.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/GlobalValue.h"
+#include "llvm/IR/IRArena.h"
 #include "llvm/IR/Operator.h"
 
 namespace llvm {
@@ -46,23 +47,44 @@ Use *User::allocHungoffUses(unsigned N) const {
   // Allocate the array of Uses, followed by a pointer (with bottom bit set) to
   // the User.
   size_t size = N * sizeof(Use) + sizeof(Use::UserRef);
-  Use *Begin = static_cast<Use*>(::operator new(size));
+  Use *Begin = static_cast<Use*>(allocHungoffStorage(size));
   Use *End = Begin + N;
   (void) new(End) Use::UserRef(const_cast<User*>(this), 1);
   return Use::initTags(Begin, End);
 }
 
+void *User::allocHungoffStorage(size_t Size) const {
+  // Users with hung-off uses have no operands in front of them.  This is also
+  // called while the User is being constructed, which is fine because operator
+  // new has set IsArenaAllocated already.
+  if (IsArenaAllocated)
+    return IRArena::getOwner(this)->Allocate(Size);
+  return ::operator new(Size);
+}
+
+void User::zapHungoffUses(Use *Start, const Use *Stop) const {
+  Use::zap(Start, Stop);
+  if (IsArenaAllocated)
+    IRArena::getOwner(Start)->Deallocate(Start);
+  else
+    ::operator delete(Start);
+}
+
 //===----------------------------------------------------------------------===//
 //                         User operator new Implementations
 //===----------------------------------------------------------------------===//
 
 void *User::operator new(size_t s, unsigned Us) {
-  void *Storage = ::operator new(s + sizeof(Use) * Us);
+  return placeOperands(::operator new(s + sizeof(Use) * Us), Us, false);
+}
+
+void *User::placeOperands(void *Storage, unsigned Us, bool InArena) {
   Use *Start = static_cast<Use*>(Storage);
   Use *End = Start + Us;
   User *Obj = reinterpret_cast<User*>(End);
   Obj->OperandList = Start;
   Obj->NumOperands = Us;
+  Obj->IsArenaAllocated = InArena;
   Use::initTags(Start, End);
   return Obj;
 }
@@ -76,7 +98,10 @@ void User::operator delete(void *Usr) {
   Use *Storage = static_cast<Use*>(Usr) - Start->NumOperands;
   // If there were hung-off uses, they will have been freed already and
   // NumOperands reset to 0, so here we just free the User itself.
-  ::operator delete(Storage);
+  if (Start->IsArenaAllocated)
+    IRArena::getOwner(Storage)->Deallocate(Storage);
+  else
+    ::operator delete(Storage);
 }
 
 //===----------------------------------------------------------------------===//
@@ -22,6 +22,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/IR/ParallelIR.h"
 #include "llvm/IR/ValueSymbolTable.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -141,6 +142,16 @@ unsigned Value::getNumUses() const {
   return (unsigned)std::distance(use_begin(), use_end());
 }
 
+void Value::addUse(Use &U) {
+  if (LLVM_LIKELY(!ParallelIR::isActive()) || !Use::isSharedValue(this)) {
+    U.addToList(&UseList);
+    return;
+  }
+  ParallelIR::lockUseLists();
+  U.addToList(&UseList);
+  ParallelIR::unlockUseLists();
+}
+
 static bool getSymTab(Value *V, ValueSymbolTable *&ST) {
   ST = 0;
   if (Instruction *I = dyn_cast<Instruction>(V)) {
@@ -151,8 +162,10 @@ static bool getSymTab(Value *V, ValueSymbolTable *&ST) {
     if (Function *P = BB->getParent())
       ST = &P->getValueSymbolTable();
   } else if (GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
-    if (Module *P = GV->getParent())
+    if (Module *P = GV->getParent()) {
+      ParallelIR::waitForModuleAccess();
       ST = &P->getValueSymbolTable();
+    }
   } else if (Argument *A = dyn_cast<Argument>(V)) {
     if (Function *P = A->getParent())
       ST = &P->getValueSymbolTable();
@@ -479,6 +492,7 @@ LLVMContext &Value::getContext() const { return VTy->getContext(); }
 /// List is known to point into the existing use list.
 void ValueHandleBase::AddToExistingUseList(ValueHandleBase **List) {
   assert(List && "Handle list is null?");
+  ParallelIR::ContextGuard Guard;
 
   // Splice ourselves into the list.
   Next = *List;
@@ -503,6 +517,7 @@ void ValueHandleBase::AddToExistingUseListAfter(ValueHandleBase *List) {
 /// AddToUseList - Add this ValueHandle to the use list for VP.
 void ValueHandleBase::AddToUseList() {
   assert(VP.getPointer() && "Null pointer doesn't have a use list!");
+  ParallelIR::ContextGuard Guard;
 
   LLVMContextImpl *pImpl = VP.getPointer()->getContext().pImpl;
 
@@ -548,6 +563,7 @@ void ValueHandleBase::AddToUseList() {
 void ValueHandleBase::RemoveFromUseList() {
   assert(VP.getPointer() && VP.getPointer()->HasValueHandle &&
          "Pointer doesn't have a use list!");
+  ParallelIR::ContextGuard Guard;
 
   // Unlink this from its use list.
   ValueHandleBase **PrevPtr = getPrevPtr();
@@ -574,6 +590,7 @@ void ValueHandleBase::RemoveFromUseList() {
 
 void ValueHandleBase::ValueIsDeleted(Value *V) {
   assert(V->HasValueHandle && "Should only be called if ValueHandles present");
+  ParallelIR::ContextGuard Guard;
 
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
@@ -632,6 +649,7 @@ void ValueHandleBase::ValueIsDeleted(Value *V) {
 void ValueHandleBase::ValueIsRAUWd(Value *Old, Value *New) {
   assert(Old->HasValueHandle &&"Should only be called if ValueHandles present");
   assert(Old != New && "Changing value into itself!");
+  ParallelIR::ContextGuard Guard;
 
   // Get the linked list base, which is guaranteed to exist since the
   // HasValueHandle flag is set.
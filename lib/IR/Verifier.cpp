@@ -86,6 +86,8 @@ namespace {  // Anonymous namespace for class
       AU.setPreservesAll();
     }
 
+    virtual Pass *createReplica() const { return new PreVerifier(); }
+
     // Check that the prerequisites for successful DominatorTree construction
     // are satisfied.
     bool runOnFunction(Function &F) {
@@ -210,6 +212,8 @@ namespace {
       AU.addRequired<DominatorTree>();
     }
 
+    virtual Pass *createReplica() const { return new Verifier(action); }
+
     /// abortIfBroken - If the module is broken and we are supposed to abort on
     /// this condition, do so.
     ///
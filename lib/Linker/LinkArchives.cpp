@@ -164,9 +164,8 @@ Linker::LinkInArchive(const sys::Path &Filename, bool &is_native) {
       std::string moduleErrorMsg;
       Module* aModule = *I;
       if (aModule != NULL) {
-        if (aModule->MaterializeAll(&moduleErrorMsg))
-          return error("Could not load a module: " + moduleErrorMsg);
-
+        // Function bodies are materialized by the module linker as they turn
+        // out to be needed.
         verbose("  Linking in module: " + aModule->getModuleIdentifier());
 
         // Link it in
@@ -13,6 +13,7 @@
 
 #include "llvm/Linker.h"
 #include "llvm-c/Linker.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SetVector.h"
@@ -375,6 +376,10 @@ namespace {
     
     // Vector of functions to lazily link in.
     std::vector<Function*> LazilyLinkFunctions;
+
+    // Map from the destination prototype of each lazily linked function that
+    // hasn't been found to be referenced yet to its source function.
+    DenseMap<const Function*, Function*> PendingLazyFunctions;
     
   public:
     std::string ErrorMsg;
@@ -438,6 +443,8 @@ namespace {
     void linkAppendingVarInit(const AppendingVarInfo &AVI);
     void linkGlobalInits();
     void linkFunctionBody(Function *Dst, Function *Src);
+    bool linkLazyFunctions();
+    void findLazyReferences(Function *F, std::vector<Function*> &Worklist);
     void linkAliasBodies();
     void linkNamedMDNodes();
   };
@@ -829,6 +836,8 @@ bool ModuleLinker::linkFunctionProto(Function *SF) {
   }
   
   ValueMap[SF] = NewDF;
+  if (DoNotLinkFromSource.count(SF))
+    PendingLazyFunctions[NewDF] = SF;
   return false;
 }
 
@@ -958,6 +967,91 @@ void ModuleLinker::linkFunctionBody(Function *Dst, Function *Src) {
   
 }
 
+/// findLazyReferences - Add the source function of every pending lazily linked
+/// function that F refers to to the worklist.
+void ModuleLinker::findLazyReferences(Function *F,
+                                      std::vector<Function*> &Worklist) {
+  SmallPtrSet<const Constant*, 16> Visited;
+  SmallVector<const Constant*, 16> Constants;
+  for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+    for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I)
+      for (User::op_iterator OI = I->op_begin(), OE = I->op_end();
+           OI != OE; ++OI)
+        if (const Constant *C = dyn_cast<Constant>(*OI))
+          if (Visited.insert(C))
+            Constants.push_back(C);
+
+  // Look through constant expressions and aggregates.
+  while (!Constants.empty()) {
+    const Constant *C = Constants.pop_back_val();
+    if (const Function *DF = dyn_cast<Function>(C)) {
+      DenseMap<const Function*, Function*>::iterator It =
+        PendingLazyFunctions.find(DF);
+      if (It != PendingLazyFunctions.end()) {
+        Worklist.push_back(It->second);
+        PendingLazyFunctions.erase(It);
+      }
+      continue;
+    }
+    if (isa<GlobalValue>(C))
+      continue;
+    for (User::const_op_iterator OI = C->op_begin(), OE = C->op_end();
+         OI != OE; ++OI) {
+      const Constant *Op = cast<Constant>(*OI);
+      if (Visited.insert(Op))
+        Constants.push_back(Op);
+    }
+  }
+}
+
+/// linkLazyFunctions - Link in the bodies of the local, linkonce and
+/// available_externally functions that are reachable from the rest of the
+/// linked module, and remove the prototypes of the others. A body is only
+/// materialized from the source module once the function is known to be
+/// referenced.
+bool ModuleLinker::linkLazyFunctions() {
+  // The roots are everything that refers to a lazily linked function at this
+  // point: global initializers, aliases and the eagerly linked bodies.
+  std::vector<Function*> Worklist;
+  for (std::vector<Function*>::iterator I = LazilyLinkFunctions.begin(),
+       E = LazilyLinkFunctions.end(); I != E; ++I) {
+    Function *DF = cast<Function>(ValueMap[*I]);
+    if (!DF->use_empty() && PendingLazyFunctions.erase(DF))
+      Worklist.push_back(*I);
+  }
+
+  for (unsigned i = 0; i != Worklist.size(); ++i) {
+    Function *SF = Worklist[i];
+    Function *DF = cast<Function>(ValueMap[SF]);
+
+    // Materialize if necessary.
+    if (SF->isDeclaration()) {
+      if (!SF->isMaterializable())
+        continue;
+      if (SF->Materialize(&ErrorMsg))
+        return true;
+    }
+
+    // Link in function body.
+    linkFunctionBody(DF, SF);
+    SF->Dematerialize();
+
+    // Whatever the new body refers to is reachable as well.
+    findLazyReferences(DF, Worklist);
+  }
+
+  // Remove any prototypes of functions that were not actually linked in.
+  for (std::vector<Function*>::iterator I = LazilyLinkFunctions.begin(),
+       E = LazilyLinkFunctions.end(); I != E; ++I) {
+    Function *DF = cast<Function>(ValueMap[*I]);
+    if (PendingLazyFunctions.count(DF) && DF->use_empty())
+      DF->eraseFromParent();
+  }
+  PendingLazyFunctions.clear();
+
+  return false;
+}
+
 /// linkAliasBodies - Insert all of the aliases in Src into the Dest module.
 void ModuleLinker::linkAliasBodies() {
   for (Module::alias_iterator I = SrcM->alias_begin(), E = SrcM->alias_end();
@@ -1249,54 +1343,10 @@ bool ModuleLinker::run() {
   if (linkModuleFlagsMetadata())
     return true;
 
-  // Process vector of lazily linked in functions.
-  bool LinkedInAnyFunctions;
-  do {
-    LinkedInAnyFunctions = false;
-    
-    for(std::vector<Function*>::iterator I = LazilyLinkFunctions.begin(),
-        E = LazilyLinkFunctions.end(); I != E; ++I) {
-      if (!*I)
-        continue;
-      
-      Function *SF = *I;
-      Function *DF = cast<Function>(ValueMap[SF]);
-      
-      if (!DF->use_empty()) {
-        
-        // Materialize if necessary.
-        if (SF->isDeclaration()) {
-          if (!SF->isMaterializable())
-            continue;
-          if (SF->Materialize(&ErrorMsg))
-            return true;
-        }
-        
-        // Link in function body.
-        linkFunctionBody(DF, SF);
-        SF->Dematerialize();
-
-        // "Remove" from vector by setting the element to 0.
-        *I = 0;
-        
-        // Set flag to indicate we may have more functions to lazily link in
-        // since we linked in a function.
-        LinkedInAnyFunctions = true;
-      }
-    }
-  } while (LinkedInAnyFunctions);
-  
-  // Remove any prototypes of functions that were not actually linked in.
-  for(std::vector<Function*>::iterator I = LazilyLinkFunctions.begin(),
-      E = LazilyLinkFunctions.end(); I != E; ++I) {
-    if (!*I)
-      continue;
-    
-    Function *SF = *I;
-    Function *DF = cast<Function>(ValueMap[SF]);
-    if (DF->use_empty())
-      DF->eraseFromParent();
-  }
+  // Link in the bodies of the lazily linked functions that are reachable from
+  // what has been linked so far, and drop the others.
+  if (linkLazyFunctions())
+    return true;
   
   // Now that all of the types from the source are used, resolve any structs
   // copied over to the dest that didn't exist there.
@@ -49,11 +49,11 @@ class ELFObjectWriter : public MCObjectWriter {
     static bool isLocal(const MCSymbolData &Data, bool isSignature,
                         bool isUsedInReloc);
     static bool IsELFMetaDataSection(const MCSectionData &SD);
-    static uint64_t DataSectionSize(const MCSectionData &SD);
-    static uint64_t GetSectionFileSize(const MCAsmLayout &Layout,
-                                       const MCSectionData &SD);
-    static uint64_t GetSectionAddressSize(const MCAsmLayout &Layout,
-                                          const MCSectionData &SD);
+    uint64_t DataSectionSize(const MCSectionData &SD);
+    uint64_t GetSectionFileSize(const MCAsmLayout &Layout,
+                                const MCSectionData &SD);
+    uint64_t GetSectionAddressSize(const MCAsmLayout &Layout,
+                                   const MCSectionData &SD);
 
     void WriteDataSectionData(MCAssembler &Asm,
                               const MCAsmLayout &Layout,
@@ -91,6 +91,9 @@ class ELFObjectWriter : public MCObjectWriter {
 
     llvm::DenseMap<const MCSectionData*,
                    std::vector<ELFRelocationEntry> > Relocations;
+    // Map from a relocation section to the section its relocations apply to.
+    // The entries are only encoded when the relocation section is written.
+    DenseMap<const MCSectionData*, const MCSectionData*> RelocatedSectionMap;
     DenseMap<const MCSection*, uint64_t> SectionStringTableIndex;
 
     /// @}
@@ -271,6 +274,8 @@ class ELFObjectWriter : public MCObjectWriter {
     typedef DenseMap<const MCSectionELF*, const MCSectionELF*> RelMapTy;
     // Map from a section to its offset
     typedef DenseMap<const MCSectionELF*, uint64_t> SectionOffsetMapTy;
+    // Map from a section to its size
+    typedef DenseMap<const MCSectionELF*, uint64_t> SectionSizeMapTy;
 
     /// ComputeSymbolTable - Compute the symbol table data
     ///
@@ -309,9 +314,9 @@ class ELFObjectWriter : public MCObjectWriter {
                                           const MCAsmLayout &Layout);
 
     void WriteSectionHeader(MCAssembler &Asm, const GroupMapTy &GroupMap,
-                            const MCAsmLayout &Layout,
                             const SectionIndexMapTy &SectionIndexMap,
-                            const SectionOffsetMapTy &SectionOffsetMap);
+                            const SectionOffsetMapTy &SectionOffsetMap,
+                            const SectionSizeMapTy &SectionSizeMap);
 
     void ComputeSectionOrder(MCAssembler &Asm,
                              std::vector<const MCSectionELF*> &Sections);
@@ -321,9 +326,8 @@ class ELFObjectWriter : public MCObjectWriter {
                           uint64_t Size, uint32_t Link, uint32_t Info,
                           uint64_t Alignment, uint64_t EntrySize);
 
-    void WriteRelocationsFragment(const MCAssembler &Asm,
-                                  MCDataFragment *F,
-                                  const MCSectionData *SD);
+    void WriteRelocationEntries(const MCAssembler &Asm,
+                                const MCSectionData *SD);
 
     virtual bool
     IsSymbolRefDifferenceFullyResolvedImpl(const MCAssembler &Asm,
@@ -1025,8 +1029,11 @@ void ELFObjectWriter::WriteRelocations(MCAssembler &Asm, MCAsmLayout &Layout,
     MCSectionData &RelaSD = Asm.getOrCreateSectionData(*RelaSection);
     RelaSD.setAlignment(is64Bit() ? 8 : 4);
 
-    MCDataFragment *F = new MCDataFragment(&RelaSD);
-    WriteRelocationsFragment(Asm, F, &*it);
+    // Sort the relocation entries. Most targets just sort by r_offset, but some
+    // (e.g., MIPS) have additional constraints. This has to happen now, while
+    // the fixups that the entries point to are still around.
+    TargetObjectWriter->sortRelocs(Asm, Relocations[&SD]);
+    RelocatedSectionMap[&RelaSD] = &SD;
   }
 }
 
@@ -1048,15 +1055,10 @@ void ELFObjectWriter::WriteSecHdrEntry(uint32_t Name, uint32_t Type,
   WriteWord(EntrySize); // sh_entsize
 }
 
-void ELFObjectWriter::WriteRelocationsFragment(const MCAssembler &Asm,
-                                               MCDataFragment *F,
-                                               const MCSectionData *SD) {
+void ELFObjectWriter::WriteRelocationEntries(const MCAssembler &Asm,
+                                             const MCSectionData *SD) {
   std::vector<ELFRelocationEntry> &Relocs = Relocations[SD];
 
-  // Sort the relocation entries. Most targets just sort by r_offset, but some
-  // (e.g., MIPS) have additional constraints.
-  TargetObjectWriter->sortRelocs(Asm, Relocs);
-
   for (unsigned i = 0, e = Relocs.size(); i != e; ++i) {
     ELFRelocationEntry entry = Relocs[e - i - 1];
 
@@ -1067,33 +1069,36 @@ void ELFObjectWriter::WriteRelocationsFragment(const MCAssembler &Asm,
     else
       entry.Index += LocalSymbolData.size();
     if (is64Bit()) {
-      String64(*F, entry.r_offset);
+      Write64(entry.r_offset);
       if (TargetObjectWriter->isN64()) {
-        String32(*F, entry.Index);
+        Write32(entry.Index);
 
-        String8(*F, TargetObjectWriter->getRSsym(entry.Type));
-        String8(*F, TargetObjectWriter->getRType3(entry.Type));
-        String8(*F, TargetObjectWriter->getRType2(entry.Type));
-        String8(*F, TargetObjectWriter->getRType(entry.Type));
+        Write8(TargetObjectWriter->getRSsym(entry.Type));
+        Write8(TargetObjectWriter->getRType3(entry.Type));
+        Write8(TargetObjectWriter->getRType2(entry.Type));
+        Write8(TargetObjectWriter->getRType(entry.Type));
       }
       else {
         struct ELF::Elf64_Rela ERE64;
         ERE64.setSymbolAndType(entry.Index, entry.Type);
-        String64(*F, ERE64.r_info);
+        Write64(ERE64.r_info);
       }
       if (hasRelocationAddend())
-        String64(*F, entry.r_addend);
+        Write64(entry.r_addend);
     } else {
-      String32(*F, entry.r_offset);
+      Write32(entry.r_offset);
 
       struct ELF::Elf32_Rela ERE32;
       ERE32.setSymbolAndType(entry.Index, entry.Type);
-      String32(*F, ERE32.r_info);
+      Write32(ERE32.r_info);
 
       if (hasRelocationAddend())
-        String32(*F, entry.r_addend);
+        Write32(entry.r_addend);
     }
   }
+
+  // The entries are not needed anymore.
+  std::vector<ELFRelocationEntry>().swap(Relocs);
 }
 
 static int compareBySuffix(const void *a, const void *b) {
@@ -1343,6 +1348,16 @@ bool ELFObjectWriter::IsELFMetaDataSection(const MCSectionData &SD) {
 }
 
 uint64_t ELFObjectWriter::DataSectionSize(const MCSectionData &SD) {
+  // Relocation sections are sized by their entries, which are written out
+  // directly instead of being encoded into fragments first.
+  DenseMap<const MCSectionData*, const MCSectionData*>::const_iterator RI =
+    RelocatedSectionMap.find(&SD);
+  if (RI != RelocatedSectionMap.end()) {
+    const MCSectionELF &Section =
+      static_cast<const MCSectionELF&>(SD.getSection());
+    return Relocations[RI->second].size() * Section.getEntrySize();
+  }
+
   uint64_t Ret = 0;
   for (MCSectionData::const_iterator i = SD.begin(), e = SD.end(); i != e;
        ++i) {
@@ -1375,7 +1390,11 @@ void ELFObjectWriter::WriteDataSectionData(MCAssembler &Asm,
   uint64_t Padding = OffsetToAlignment(OS.tell(), SD.getAlignment());
   WriteZeros(Padding);
 
-  if (IsELFMetaDataSection(SD)) {
+  DenseMap<const MCSectionData*, const MCSectionData*>::const_iterator RI =
+    RelocatedSectionMap.find(&SD);
+  if (RI != RelocatedSectionMap.end()) {
+    WriteRelocationEntries(Asm, RI->second);
+  } else if (IsELFMetaDataSection(SD)) {
     for (MCSectionData::const_iterator i = SD.begin(), e = SD.end(); i != e;
          ++i) {
       const MCFragment &F = *i;
@@ -1389,9 +1408,9 @@ void ELFObjectWriter::WriteDataSectionData(MCAssembler &Asm,
 
 void ELFObjectWriter::WriteSectionHeader(MCAssembler &Asm,
                                          const GroupMapTy &GroupMap,
-                                         const MCAsmLayout &Layout,
                                       const SectionIndexMapTy &SectionIndexMap,
-                                   const SectionOffsetMapTy &SectionOffsetMap) {
+                                    const SectionOffsetMapTy &SectionOffsetMap,
+                                        const SectionSizeMapTy &SectionSizeMap) {
   const unsigned NumSections = Asm.size() + 1;
 
   std::vector<const MCSectionELF*> Sections;
@@ -1420,11 +1439,9 @@ void ELFObjectWriter::WriteSectionHeader(MCAssembler &Asm,
       GroupSymbolIndex = getSymbolIndexInSymbolTable(Asm,
                                                      GroupMap.lookup(&Section));
 
-    uint64_t Size = GetSectionAddressSize(Layout, SD);
-
     WriteSection(Asm, SectionIndexMap, GroupSymbolIndex,
-                 SectionOffsetMap.lookup(&Section), Size,
-                 SD.getAlignment(), Section);
+                 SectionOffsetMap.lookup(&Section),
+                 SectionSizeMap.lookup(&Section), SD.getAlignment(), Section);
   }
 }
 
@@ -1497,14 +1514,17 @@ void ELFObjectWriter::WriteObject(MCAssembler &Asm,
   ComputeSectionOrder(Asm, Sections);
   unsigned NumSections = Sections.size();
   SectionOffsetMapTy SectionOffsetMap;
+  SectionSizeMapTy SectionSizeMap;
   for (unsigned i = 0; i < NumRegularSections + 1; ++i) {
     const MCSectionELF &Section = *Sections[i];
     const MCSectionData &SD = Asm.getOrCreateSectionData(Section);
 
     FileOff = RoundUpToAlignment(FileOff, SD.getAlignment());
 
-    // Remember the offset into the file for this section.
+    // Remember the offset into the file for this section, and its size for the
+    // section header: relocation entries are freed as they are written.
     SectionOffsetMap[&Section] = FileOff;
+    SectionSizeMap[&Section] = GetSectionAddressSize(Layout, SD);
 
     // Get the size of the section in the output file (including padding).
     FileOff += GetSectionFileSize(Layout, SD);
@@ -1526,6 +1546,7 @@ void ELFObjectWriter::WriteObject(MCAssembler &Asm,
 
     // Remember the offset into the file for this section.
     SectionOffsetMap[&Section] = FileOff;
+    SectionSizeMap[&Section] = GetSectionAddressSize(Layout, SD);
 
     // Get the size of the section in the output file (including padding).
     FileOff += GetSectionFileSize(Layout, SD);
@@ -1543,8 +1564,8 @@ void ELFObjectWriter::WriteObject(MCAssembler &Asm,
   WriteZeros(Padding);
 
   // ... then the section header table ...
-  WriteSectionHeader(Asm, GroupMap, Layout, SectionIndexMap,
-                     SectionOffsetMap);
+  WriteSectionHeader(Asm, GroupMap, SectionIndexMap, SectionOffsetMap,
+                     SectionSizeMap);
 
   // ... and then the remaining sections ...
   for (unsigned i = NumRegularSections + 1; i < NumSections; ++i)
@@ -48,6 +48,8 @@ STATISTIC(evaluateFixup, "Number of evaluated fixups");
 STATISTIC(FragmentLayouts, "Number of fragment layouts");
 STATISTIC(ObjectBytes, "Number of emitted object file bytes");
 STATISTIC(RelaxationSteps, "Number of assembler layout and relaxation steps");
+STATISTIC(RelaxationRounds, "Number of section relaxation rounds");
+STATISTIC(RelaxationChecks, "Number of fragments checked for relaxation");
 STATISTIC(RelaxedInstructions, "Number of relaxed instructions");
 }
 }
@@ -60,7 +62,7 @@ STATISTIC(RelaxedInstructions, "Number of relaxed instructions");
 /* *** */
 
 MCAsmLayout::MCAsmLayout(MCAssembler &Asm)
-  : Assembler(Asm), LastValidFragment()
+  : Assembler(Asm)
  {
   // Compute the section layout order. Virtual sections must go last.
   for (MCAssembler::iterator it = Asm.begin(), ie = Asm.end(); it != ie; ++it)
@@ -69,11 +71,15 @@ MCAsmLayout::MCAsmLayout(MCAssembler &Asm)
   for (MCAssembler::iterator it = Asm.begin(), ie = Asm.end(); it != ie; ++it)
     if (it->getSection().isVirtualSection())
       SectionOrder.push_back(&*it);
+
+  for (unsigned i = 0, e = SectionOrder.size(); i != e; ++i)
+    SectionOrder[i]->setLayoutOrder(i);
+  LastValidFragment.assign(SectionOrder.size(), 0);
 }
 
 bool MCAsmLayout::isFragmentValid(const MCFragment *F) const {
   const MCSectionData &SD = *F->getParent();
-  const MCFragment *LastValid = LastValidFragment.lookup(&SD);
+  const MCFragment *LastValid = LastValidFragment[SD.getLayoutOrder()];
   if (!LastValid)
     return false;
   assert(LastValid->getParent() == F->getParent());
@@ -87,13 +93,13 @@ void MCAsmLayout::invalidateFragmentsAfter(MCFragment *F) {
 
   // Otherwise, reset the last valid fragment to this fragment.
   const MCSectionData &SD = *F->getParent();
-  LastValidFragment[&SD] = F;
+  LastValidFragment[SD.getLayoutOrder()] = F;
 }
 
 void MCAsmLayout::ensureValid(const MCFragment *F) const {
   MCSectionData &SD = *F->getParent();
 
-  MCFragment *Cur = LastValidFragment[&SD];
+  MCFragment *Cur = LastValidFragment[SD.getLayoutOrder()];
   if (!Cur)
     Cur = &*SD.begin();
   else
@@ -428,7 +434,7 @@ void MCAsmLayout::layoutFragment(MCFragment *F) {
     F->Offset = Prev->Offset + getAssembler().computeFragmentSize(*this, *Prev);
   else
     F->Offset = 0;
-  LastValidFragment[F->getParent()] = F;
+  LastValidFragment[F->getParent()->getLayoutOrder()] = F;
 
   // If bundling is enabled and this fragment has instructions in it, it has to
   // obey the bundling restrictions. With padding, we'll have:
@@ -683,10 +689,10 @@ void MCAssembler::Finish() {
     it->setOrdinal(SectionIndex++);
   }
 
-  // Assign layout order indices to sections and fragments.
+  // Assign layout order indices to fragments. The layout has already numbered
+  // the sections.
   for (unsigned i = 0, e = Layout.getSectionOrder().size(); i != e; ++i) {
     MCSectionData *SD = Layout.getSectionOrder()[i];
-    SD->setLayoutOrder(i);
 
     unsigned FragmentIndex = 0;
     for (MCSectionData::iterator iFrag = SD->begin(), iFragEnd = SD->end();
@@ -848,59 +854,212 @@ bool MCAssembler::relaxDwarfCallFrameFragment(MCAsmLayout &Layout,
   return OldSize != Data.size();
 }
 
-bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSectionData &SD) {
-  // Holds the first fragment which needed relaxing during this layout. It will
-  // remain NULL if none were relaxed.
-  // When a fragment is relaxed, all the fragments following it should get
-  // invalidated because their offset is going to change.
-  MCFragment *FirstRelaxedFragment = NULL;
+bool MCAssembler::relaxFragment(MCAsmLayout &Layout, MCFragment &F) {
+  ++stats::RelaxationChecks;
+  switch(F.getKind()) {
+  default:
+    return false;
+  case MCFragment::FT_Inst:
+    assert(!getRelaxAll() &&
+           "Did not expect a MCInstFragment in RelaxAll mode");
+    return relaxInstruction(Layout, cast<MCInstFragment>(F));
+  case MCFragment::FT_Dwarf:
+    return relaxDwarfLineAddr(Layout, cast<MCDwarfLineAddrFragment>(F));
+  case MCFragment::FT_DwarfFrame:
+    return relaxDwarfCallFrameFragment(Layout,
+                                       cast<MCDwarfCallFrameFragment>(F));
+  case MCFragment::FT_LEB:
+    return relaxLEB(Layout, cast<MCLEBFragment>(F));
+  }
+}
+
+namespace {
+/// A fragment that may change size during relaxation, along with the range of
+/// fragments in its section that its size depends on.
+struct RelaxItem {
+  MCFragment *F;
+  /// Layout orders of the first and last fragment in the section referenced by
+  /// the fragment's expressions, including the fragment itself. The fragment
+  /// only needs to be checked again if a fragment in [Lo, Hi] changes size.
+  unsigned Lo, Hi;
+  /// Set when the dependencies can't be determined.
+  bool Unknown;
+  /// Set when the fragment refers to symbols in other sections.
+  bool External;
+  /// Set when the fragment changed size in the last round.
+  bool Changed;
+
+  RelaxItem(MCFragment *F) : F(F), Changed(false) {}
+};
+}
+
+/// addExprDeps - Extend Item's dependency range with the fragments that the
+/// symbols in \p Expr are defined in. Fragments in other sections don't move
+/// while this section is relaxed, they are only noted in Item.External.
+static void addExprDeps(const MCAssembler &Asm, const MCExpr *Expr,
+                        RelaxItem &Item) {
+  switch (Expr->getKind()) {
+  case MCExpr::Constant:
+    return;
+  case MCExpr::Binary: {
+    const MCBinaryExpr *BE = cast<MCBinaryExpr>(Expr);
+    addExprDeps(Asm, BE->getLHS(), Item);
+    addExprDeps(Asm, BE->getRHS(), Item);
+    return;
+  }
+  case MCExpr::Unary:
+    addExprDeps(Asm, cast<MCUnaryExpr>(Expr)->getSubExpr(), Item);
+    return;
+  case MCExpr::Target:
+    Item.Unknown = true;
+    return;
+  case MCExpr::SymbolRef: {
+    const MCSymbol &Sym = cast<MCSymbolRefExpr>(Expr)->getSymbol();
+    if (Sym.isVariable()) {
+      Item.Unknown = true;
+      return;
+    }
+    if (Sym.isUndefined())
+      return;
+    const MCFragment *F = Asm.getSymbolData(Sym).getFragment();
+    if (!F)
+      return;
+    if (F->getParent() != Item.F->getParent()) {
+      Item.External = true;
+      return;
+    }
+    Item.Lo = std::min(Item.Lo, F->getLayoutOrder());
+    Item.Hi = std::max(Item.Hi, F->getLayoutOrder());
+    return;
+  }
+  }
+  llvm_unreachable("Invalid expression kind!");
+}
+
+/// computeDeps - Compute the dependency range of Item from the expressions its
+/// size depends on.
+static void computeDeps(const MCAssembler &Asm, RelaxItem &Item) {
+  Item.Lo = Item.Hi = Item.F->getLayoutOrder();
+  Item.Unknown = Item.External = false;
+  switch (Item.F->getKind()) {
+  default:
+    llvm_unreachable("Unexpected fragment kind!");
+  case MCFragment::FT_Inst: {
+    MCInstFragment &IF = cast<MCInstFragment>(*Item.F);
+    for (MCInstFragment::const_fixup_iterator I = IF.fixup_begin(),
+         E = IF.fixup_end(); I != E; ++I)
+      addExprDeps(Asm, I->getValue(), Item);
+    return;
+  }
+  case MCFragment::FT_Dwarf:
+    addExprDeps(Asm, &cast<MCDwarfLineAddrFragment>(Item.F)->getAddrDelta(),
+                Item);
+    return;
+  case MCFragment::FT_DwarfFrame:
+    addExprDeps(Asm, &cast<MCDwarfCallFrameFragment>(Item.F)->getAddrDelta(),
+                Item);
+    return;
+  case MCFragment::FT_LEB:
+    addExprDeps(Asm, &cast<MCLEBFragment>(Item.F)->getValue(), Item);
+    return;
+  }
+}
 
-  // Attempt to relax all the fragments in the section.
+bool MCAssembler::layoutSection(MCAsmLayout &Layout, MCSectionData &SD,
+                                bool &HasExternalDeps) {
+  // Collect the fragments that may need relaxation, and the fragments whose
+  // size depends on their offset.
+  std::vector<RelaxItem> Items;
+  SmallVector<unsigned, 16> Padding;
   for (MCSectionData::iterator I = SD.begin(), IE = SD.end(); I != IE; ++I) {
-    // Check if this is a fragment that needs relaxation.
-    bool RelaxedFrag = false;
-    switch(I->getKind()) {
+    switch (I->getKind()) {
     default:
       break;
     case MCFragment::FT_Inst:
-      assert(!getRelaxAll() &&
-             "Did not expect a MCInstFragment in RelaxAll mode");
-      RelaxedFrag = relaxInstruction(Layout, *cast<MCInstFragment>(I));
-      break;
     case MCFragment::FT_Dwarf:
-      RelaxedFrag = relaxDwarfLineAddr(Layout,
-                                       *cast<MCDwarfLineAddrFragment>(I));
-      break;
     case MCFragment::FT_DwarfFrame:
-      RelaxedFrag =
-        relaxDwarfCallFrameFragment(Layout,
-                                    *cast<MCDwarfCallFrameFragment>(I));
-      break;
     case MCFragment::FT_LEB:
-      RelaxedFrag = relaxLEB(Layout, *cast<MCLEBFragment>(I));
+      Items.push_back(RelaxItem(I));
+      computeDeps(*this, Items.back());
+      HasExternalDeps |= Items.back().External || Items.back().Unknown;
+      break;
+    case MCFragment::FT_Align:
+    case MCFragment::FT_Org:
+      Padding.push_back(I->getLayoutOrder());
       break;
     }
-    if (RelaxedFrag && !FirstRelaxedFragment)
-      FirstRelaxedFragment = I;
   }
-  if (FirstRelaxedFragment) {
+
+  // The first round checks every fragment. When a fragment is relaxed, the
+  // fragments after it move, so the next round only needs to check the
+  // fragments whose dependency range contains a fragment that changed size.
+  // Alignment and .org padding may change size whenever the fragments before
+  // them move, and so may bundle padding when bundling is enabled.
+  SmallVector<unsigned, 16> Worklist;
+  for (unsigned i = 0, e = Items.size(); i != e; ++i)
+    Worklist.push_back(i);
+
+  bool WasRelaxed = false;
+  SmallVector<unsigned, 16> Changed;
+  while (!Worklist.empty()) {
+    ++stats::RelaxationRounds;
+    MCFragment *FirstRelaxedFragment = 0;
+    Changed.clear();
+    for (unsigned i = 0, e = Worklist.size(); i != e; ++i) {
+      RelaxItem &Item = Items[Worklist[i]];
+      Item.Changed = relaxFragment(Layout, *Item.F);
+      if (!Item.Changed)
+        continue;
+      // Relaxed instructions have new fixups.
+      computeDeps(*this, Item);
+      Changed.push_back(Item.F->getLayoutOrder());
+      if (!FirstRelaxedFragment)
+        FirstRelaxedFragment = Item.F;
+    }
+    Worklist.clear();
+    if (!FirstRelaxedFragment)
+      break;
+
+    // When a fragment is relaxed, all the fragments following it should get
+    // invalidated because their offset is going to change.
+    WasRelaxed = true;
     Layout.invalidateFragmentsAfter(FirstRelaxedFragment);
-    return true;
+
+    unsigned First = FirstRelaxedFragment->getLayoutOrder();
+    for (unsigned i = 0, e = Padding.size(); i != e; ++i)
+      if (Padding[i] > First)
+        Changed.push_back(Padding[i]);
+    std::sort(Changed.begin(), Changed.end());
+    bool PaddingMoves = isBundlingEnabled();
+
+    for (unsigned i = 0, e = Items.size(); i != e; ++i) {
+      RelaxItem &Item = Items[i];
+      bool Affected = Item.Changed || Item.Unknown;
+      Item.Changed = false;
+      if (!Affected && PaddingMoves)
+        Affected = Item.Lo < Item.Hi && Item.Hi >= First;
+      if (!Affected) {
+        SmallVectorImpl<unsigned>::iterator C =
+          std::lower_bound(Changed.begin(), Changed.end(), Item.Lo);
+        Affected = C != Changed.end() && *C <= Item.Hi;
+      }
+      if (Affected)
+        Worklist.push_back(i);
+    }
   }
-  return false;
+  return WasRelaxed;
 }
 
 bool MCAssembler::layoutOnce(MCAsmLayout &Layout) {
   ++stats::RelaxationSteps;
 
-  bool WasRelaxed = false;
-  for (iterator it = begin(), ie = end(); it != ie; ++it) {
-    MCSectionData &SD = *it;
-    while (layoutSectionOnce(Layout, SD))
-      WasRelaxed = true;
-  }
+  bool WasRelaxed = false, HasExternalDeps = false;
+  for (iterator it = begin(), ie = end(); it != ie; ++it)
+    WasRelaxed |= layoutSection(Layout, *it, HasExternalDeps);
 
-  return WasRelaxed;
+  // Every section has been relaxed until it stopped changing, so another
+  // iteration is only needed when fragments depend on other sections.
+  return WasRelaxed && HasExternalDeps;
 }
 
 void MCAssembler::finishLayout(MCAsmLayout &Layout) {
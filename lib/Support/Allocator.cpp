@@ -12,14 +12,47 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/Allocator.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/DataTypes.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Memory.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/Recycler.h"
+#include "llvm/Support/ThreadLocal.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstring>
+#include <vector>
 
 namespace llvm {
 
+bool CountAllocatorBytes = false;
+
+namespace {
+/// ByteCountRegistry - Hands each thread its own AllocatorByteCounts and
+/// owns them all, so that they are freed by llvm_shutdown.
+struct ByteCountRegistry {
+  sys::ThreadLocal<const AllocatorByteCounts> Current;
+  sys::SmartMutex<true> Lock;
+  std::vector<AllocatorByteCounts*> All;
+
+  ~ByteCountRegistry() { DeleteContainerPointers(All); }
+};
+}
+
+static ManagedStatic<ByteCountRegistry> ByteCounts;
+
+AllocatorByteCounts &getAllocatorByteCounts() {
+  if (const AllocatorByteCounts *Counts = ByteCounts->Current.get())
+    return const_cast<AllocatorByteCounts&>(*Counts);
+  AllocatorByteCounts *Counts = new AllocatorByteCounts();
+  {
+    sys::SmartScopedLock<true> Guard(ByteCounts->Lock);
+    ByteCounts->All.push_back(Counts);
+  }
+  ByteCounts->Current.set(Counts);
+  return *Counts;
+}
+
 BumpPtrAllocator::BumpPtrAllocator(size_t size, size_t threshold,
                                    SlabAllocator &allocator)
     : SlabSize(size), SizeThreshold(std::min(size, threshold)),
@@ -92,6 +125,8 @@ void *BumpPtrAllocator::Allocate(size_t Size, size_t Alignment) {
 
   // Keep track of how many bytes we've allocated.
   BytesAllocated += Size;
+  if (CountAllocatorBytes)
+    getAllocatorByteCounts().BumpPtrBytes += Size;
 
   // 0-byte alignment means 1-byte alignment.
   if (Alignment == 0) Alignment = 1;
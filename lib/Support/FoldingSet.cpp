@@ -246,9 +246,28 @@ void FoldingSetImpl::clear() {
 /// GrowHashTable - Double the size of the hash table and rehash everything.
 ///
 void FoldingSetImpl::GrowHashTable() {
+  RehashTo(NumBuckets << 1);
+}
+
+/// ShrinkHashTable - Rehash everything into the smallest table, of at least
+/// MinNumBuckets buckets, that the current nodes fit into without growing.
+///
+void FoldingSetImpl::ShrinkHashTable(unsigned MinNumBuckets) {
+  assert(isPowerOf2_32(MinNumBuckets) && "Bucket count must be a power of 2!");
+  // Keep at most one node per bucket, the load of a freshly grown table.
+  unsigned NewNumBuckets = MinNumBuckets;
+  while (NewNumBuckets < NumNodes)
+    NewNumBuckets <<= 1;
+  if (NewNumBuckets < NumBuckets)
+    RehashTo(NewNumBuckets);
+}
+
+/// RehashTo - Rehash everything into a new table of NewNumBuckets buckets.
+///
+void FoldingSetImpl::RehashTo(unsigned NewNumBuckets) {
   void **OldBuckets = Buckets;
   unsigned OldNumBuckets = NumBuckets;
-  NumBuckets <<= 1;
+  NumBuckets = NewNumBuckets;
   
   // Clear out new buckets.
   Buckets = AllocateBuckets(NumBuckets);
@@ -12,11 +12,47 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/StringMap.h"
-#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/Support/Compiler.h"
 #include <cassert>
 using namespace llvm;
 
+/// hashKey - This is MurmurHash64A with a fixed seed, folded to 32 bits. The
+/// words are read as little endian on every host.
+unsigned StringMapImpl::hashKey(StringRef Key) {
+  const uint64_t Mul = 0xc6a4a7935bd1e995ULL;
+  const unsigned Shift = 47;
+
+  const char *P = Key.data();
+  size_t Len = Key.size();
+  uint64_t Hash = 0x9ae16a3b2f90404fULL ^ (Len * Mul);
+
+  for (const char *End = P + (Len & ~size_t(7)); P != End; P += 8) {
+    uint64_t Word = hashing::detail::fetch64(P);
+    Word *= Mul;
+    Word ^= Word >> Shift;
+    Word *= Mul;
+    Hash ^= Word;
+    Hash *= Mul;
+  }
+
+  switch (Len & 7) {
+  case 7: Hash ^= uint64_t((unsigned char)P[6]) << 48;
+  case 6: Hash ^= uint64_t((unsigned char)P[5]) << 40;
+  case 5: Hash ^= uint64_t((unsigned char)P[4]) << 32;
+  case 4: Hash ^= uint64_t((unsigned char)P[3]) << 24;
+  case 3: Hash ^= uint64_t((unsigned char)P[2]) << 16;
+  case 2: Hash ^= uint64_t((unsigned char)P[1]) << 8;
+  case 1: Hash ^= uint64_t((unsigned char)P[0]);
+          Hash *= Mul;
+  }
+
+  Hash ^= Hash >> Shift;
+  Hash *= Mul;
+  Hash ^= Hash >> Shift;
+  return unsigned(Hash);
+}
+
 StringMapImpl::StringMapImpl(unsigned InitSize, unsigned itemSize) {
   ItemSize = itemSize;
   
@@ -61,7 +97,7 @@ unsigned StringMapImpl::LookupBucketFor(StringRef Name) {
     init(16);
     HTSize = NumBuckets;
   }
-  unsigned FullHashValue = HashString(Name);
+  unsigned FullHashValue = hashKey(Name);
   unsigned BucketNo = FullHashValue & (HTSize-1);
   unsigned *HashTable = (unsigned *)(TheTable + NumBuckets + 1);
 
@@ -116,7 +152,7 @@ unsigned StringMapImpl::LookupBucketFor(StringRef Name) {
 int StringMapImpl::FindKey(StringRef Key) const {
   unsigned HTSize = NumBuckets;
   if (HTSize == 0) return -1;  // Really empty table?
-  unsigned FullHashValue = HashString(Key);
+  unsigned FullHashValue = hashKey(Key);
   unsigned BucketNo = FullHashValue & (HTSize-1);
   unsigned *HashTable = (unsigned *)(TheTable + NumBuckets + 1);
 
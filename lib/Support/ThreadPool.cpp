@@ -0,0 +1,439 @@
+//===-- ThreadPool.cpp - Work-stealing thread pool ------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the ThreadPool, TaskGroup and TaskSequencer classes.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/ThreadLocal.h"
+#include <cassert>
+#include <deque>
+
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#define LLVM_THREAD_POOL_USES_PTHREADS 1
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+using namespace llvm;
+
+static cl::opt<unsigned>
+ThreadsOpt("threads",
+           cl::desc("Number of threads used for parallel work "
+                    "(default: one per hardware thread)"),
+           cl::init(0));
+
+namespace {
+struct Task {
+  ThreadPool::TaskFn Fn;
+  void *Arg;
+  TaskGroup *Group;
+};
+
+/// WorkQueue - The task deque owned by a single worker. The owner works on the
+/// back of the deque, thieves take from the front.
+struct WorkQueue {
+  ThreadPoolImpl *Pool;
+  unsigned Index;
+  sys::Mutex Lock;
+  std::deque<Task> Tasks;
+
+  WorkQueue(ThreadPoolImpl *Pool, unsigned Index)
+    : Pool(Pool), Index(Index), Lock(false) {}
+};
+}
+
+namespace llvm {
+class ThreadPoolImpl {
+  /// Queues - One deque per worker. Never changes once the workers run.
+  std::vector<WorkQueue*> Queues;
+
+  /// CurrentQueue - The queue of the worker running on this thread, or null if
+  /// this thread is not one of our workers.
+  sys::ThreadLocal<const WorkQueue> CurrentQueue;
+
+  WorkQueue *getCurrentQueue() {
+    return const_cast<WorkQueue*>(CurrentQueue.get());
+  }
+
+  /// NextQueue - Round-robin counter for tasks spawned outside of the pool.
+  volatile sys::cas_flag NextQueue;
+
+  /// Queued - The number of tasks sitting in one of the queues.
+  volatile sys::cas_flag Queued;
+
+#ifdef LLVM_THREAD_POOL_USES_PTHREADS
+  std::vector<pthread_t> Threads;
+
+  /// SleepLock and StateChanged are used by threads waiting for either new
+  /// tasks or some counter to drop to zero.
+  pthread_mutex_t SleepLock;
+  pthread_cond_t StateChanged;
+  unsigned NumSleepers;
+  bool ShuttingDown;
+
+  static void *workerMain(void *Arg);
+#endif
+
+  bool pop(WorkQueue *Own, Task &T);
+  void run(const Task &T);
+  void notify();
+
+public:
+  /// Outstanding - The number of queued or running tasks.
+  volatile sys::cas_flag Outstanding;
+
+  explicit ThreadPoolImpl(unsigned NumThreads);
+  ~ThreadPoolImpl();
+
+  unsigned getNumThreads() const { return Queues.size(); }
+
+  void push(ThreadPool::TaskFn Fn, void *Arg, TaskGroup *Group);
+
+  /// waitFor - Run tasks until *Counter drops to zero.
+  void waitFor(volatile sys::cas_flag *Counter);
+};
+}
+
+#ifdef LLVM_THREAD_POOL_USES_PTHREADS
+
+ThreadPoolImpl::ThreadPoolImpl(unsigned NumThreads)
+  : NextQueue(0), Queued(0), NumSleepers(0), ShuttingDown(false),
+    Outstanding(0) {
+  ::pthread_mutex_init(&SleepLock, 0);
+  ::pthread_cond_init(&StateChanged, 0);
+
+  for (unsigned i = 0; i != NumThreads; ++i)
+    Queues.push_back(new WorkQueue(this, i));
+
+  // If a worker fails to start, its queue is still drained by thieves and
+  // waiting threads.
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    pthread_t Thread;
+    if (::pthread_create(&Thread, 0, workerMain, Queues[i]) == 0)
+      Threads.push_back(Thread);
+  }
+}
+
+ThreadPoolImpl::~ThreadPoolImpl() {
+  waitFor(&Outstanding);
+
+  ::pthread_mutex_lock(&SleepLock);
+  ShuttingDown = true;
+  ::pthread_cond_broadcast(&StateChanged);
+  ::pthread_mutex_unlock(&SleepLock);
+
+  for (unsigned i = 0, e = Threads.size(); i != e; ++i)
+    ::pthread_join(Threads[i], 0);
+
+  ::pthread_cond_destroy(&StateChanged);
+  ::pthread_mutex_destroy(&SleepLock);
+
+  for (unsigned i = 0, e = Queues.size(); i != e; ++i)
+    delete Queues[i];
+}
+
+void *ThreadPoolImpl::workerMain(void *Arg) {
+  WorkQueue *Own = static_cast<WorkQueue*>(Arg);
+  ThreadPoolImpl *Pool = Own->Pool;
+  Pool->CurrentQueue.set(Own);
+
+  Task T;
+  for (;;) {
+    if (Pool->pop(Own, T)) {
+      Pool->run(T);
+      continue;
+    }
+
+    ::pthread_mutex_lock(&Pool->SleepLock);
+    while (Pool->Queued == 0 && !Pool->ShuttingDown) {
+      ++Pool->NumSleepers;
+      ::pthread_cond_wait(&Pool->StateChanged, &Pool->SleepLock);
+      --Pool->NumSleepers;
+    }
+    bool Exit = Pool->ShuttingDown && Pool->Queued == 0;
+    ::pthread_mutex_unlock(&Pool->SleepLock);
+
+    if (Exit)
+      return 0;
+  }
+}
+
+void ThreadPoolImpl::notify() {
+  // Counters are updated before taking the lock and checked by sleepers while
+  // holding it, so a sleeper either sees the update or gets woken up here.
+  ::pthread_mutex_lock(&SleepLock);
+  if (NumSleepers)
+    ::pthread_cond_broadcast(&StateChanged);
+  ::pthread_mutex_unlock(&SleepLock);
+}
+
+void ThreadPoolImpl::push(ThreadPool::TaskFn Fn, void *Arg,
+                          TaskGroup *Group) {
+  Task T = { Fn, Arg, Group };
+  if (Group)
+    sys::AtomicIncrement(&Group->Pending);
+  sys::AtomicIncrement(&Outstanding);
+
+  if (Queues.empty()) {
+    run(T);
+    return;
+  }
+
+  WorkQueue *Q = getCurrentQueue();
+  if (!Q)
+    Q = Queues[unsigned(sys::AtomicIncrement(&NextQueue)) % Queues.size()];
+
+  // Count the task first so that Queued never underestimates the queues.
+  sys::AtomicIncrement(&Queued);
+  {
+    MutexGuard Guard(Q->Lock);
+    Q->Tasks.push_back(T);
+  }
+  notify();
+}
+
+bool ThreadPoolImpl::pop(WorkQueue *Own, Task &T) {
+  if (Own) {
+    MutexGuard Guard(Own->Lock);
+    if (!Own->Tasks.empty()) {
+      T = Own->Tasks.back();
+      Own->Tasks.pop_back();
+      sys::AtomicDecrement(&Queued);
+      return true;
+    }
+  }
+
+  // Steal the oldest task of some other queue, starting with our neighbour.
+  unsigned NumQueues = Queues.size();
+  unsigned Start = Own ? Own->Index + 1 : 0;
+  for (unsigned i = 0; i != NumQueues; ++i) {
+    WorkQueue *Q = Queues[(Start + i) % NumQueues];
+    if (Q == Own)
+      continue;
+    MutexGuard Guard(Q->Lock);
+    if (!Q->Tasks.empty()) {
+      T = Q->Tasks.front();
+      Q->Tasks.pop_front();
+      sys::AtomicDecrement(&Queued);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPoolImpl::waitFor(volatile sys::cas_flag *Counter) {
+  WorkQueue *Own = getCurrentQueue();
+  Task T;
+  while (*Counter != 0) {
+    if (pop(Own, T)) {
+      run(T);
+      continue;
+    }
+
+    ::pthread_mutex_lock(&SleepLock);
+    while (*Counter != 0 && Queued == 0) {
+      ++NumSleepers;
+      ::pthread_cond_wait(&StateChanged, &SleepLock);
+      --NumSleepers;
+    }
+    ::pthread_mutex_unlock(&SleepLock);
+  }
+
+  // Make sure the effects of the finished tasks are visible to the caller.
+  sys::MemoryFence();
+}
+
+#else
+
+// Without thread support every task runs as soon as it is spawned.
+
+ThreadPoolImpl::ThreadPoolImpl(unsigned NumThreads)
+  : NextQueue(0), Queued(0), Outstanding(0) {
+  (void)NumThreads;
+}
+
+ThreadPoolImpl::~ThreadPoolImpl() {}
+
+void ThreadPoolImpl::notify() {}
+
+void ThreadPoolImpl::push(ThreadPool::TaskFn Fn, void *Arg,
+                          TaskGroup *Group) {
+  Task T = { Fn, Arg, Group };
+  if (Group)
+    sys::AtomicIncrement(&Group->Pending);
+  sys::AtomicIncrement(&Outstanding);
+  run(T);
+}
+
+bool ThreadPoolImpl::pop(WorkQueue *Own, Task &T) {
+  return false;
+}
+
+void ThreadPoolImpl::waitFor(volatile sys::cas_flag *Counter) {
+  (void)Counter;
+}
+
+#endif
+
+void ThreadPoolImpl::run(const Task &T) {
+  T.Fn(T.Arg);
+
+  // The group may be destroyed as soon as its counter drops to zero, so don't
+  // touch it afterwards.
+  if (T.Group && sys::AtomicDecrement(&T.Group->Pending) == 0)
+    notify();
+  if (sys::AtomicDecrement(&Outstanding) == 0)
+    notify();
+}
+
+//===----------------------------------------------------------------------===//
+// ThreadPool and TaskGroup
+//===----------------------------------------------------------------------===//
+
+ThreadPool::ThreadPool(unsigned NumThreads)
+  : Impl(new ThreadPoolImpl(NumThreads ? NumThreads
+                                       : getDefaultNumThreads())) {}
+
+ThreadPool::~ThreadPool() {
+  delete Impl;
+}
+
+unsigned ThreadPool::getNumThreads() const {
+  return Impl->getNumThreads();
+}
+
+void ThreadPool::async(TaskFn Fn, void *Arg) {
+  Impl->push(Fn, Arg, 0);
+}
+
+void ThreadPool::async(TaskFn Fn, void *Arg, TaskGroup *Group) {
+  Impl->push(Fn, Arg, Group);
+}
+
+void ThreadPool::wait() {
+  Impl->waitFor(&Impl->Outstanding);
+}
+
+unsigned ThreadPool::getDefaultNumThreads() {
+  if (ThreadsOpt)
+    return ThreadsOpt;
+#ifdef _SC_NPROCESSORS_ONLN
+  long NumCPUs = ::sysconf(_SC_NPROCESSORS_ONLN);
+  if (NumCPUs > 0)
+    return NumCPUs;
+#endif
+  return 1;
+}
+
+static ManagedStatic<ThreadPool> GlobalPool;
+
+ThreadPool &ThreadPool::getGlobal() {
+  return *GlobalPool;
+}
+
+void TaskGroup::wait() {
+  Pool.Impl->waitFor(&Pending);
+}
+
+//===----------------------------------------------------------------------===//
+// TaskSequencer
+//===----------------------------------------------------------------------===//
+
+namespace llvm {
+class TaskSequencerImpl {
+public:
+  /// Finished - Whether each task has finished.
+  std::vector<bool> Finished;
+
+  /// NumInOrder - The number of leading tasks that have all finished.
+  unsigned NumInOrder;
+
+#ifdef LLVM_THREAD_POOL_USES_PTHREADS
+  pthread_mutex_t Lock;
+  pthread_cond_t Advanced;
+#endif
+
+  explicit TaskSequencerImpl(unsigned NumTasks)
+    : Finished(NumTasks), NumInOrder(0) {
+#ifdef LLVM_THREAD_POOL_USES_PTHREADS
+    ::pthread_mutex_init(&Lock, 0);
+    ::pthread_cond_init(&Advanced, 0);
+#endif
+  }
+
+  ~TaskSequencerImpl() {
+#ifdef LLVM_THREAD_POOL_USES_PTHREADS
+    ::pthread_cond_destroy(&Advanced);
+    ::pthread_mutex_destroy(&Lock);
+#endif
+  }
+};
+}
+
+TaskSequencer::TaskSequencer(unsigned NumTasks)
+  : Impl(new TaskSequencerImpl(NumTasks)) {}
+
+TaskSequencer::~TaskSequencer() {
+  delete Impl;
+}
+
+void TaskSequencer::finish(unsigned Task) {
+  assert(Task < Impl->Finished.size() && "Task number out of range!");
+#ifdef LLVM_THREAD_POOL_USES_PTHREADS
+  ::pthread_mutex_lock(&Impl->Lock);
+#endif
+  assert(!Impl->Finished[Task] && "Task finished twice!");
+  Impl->Finished[Task] = true;
+  unsigned NumInOrder = Impl->NumInOrder;
+  while (NumInOrder != Impl->Finished.size() && Impl->Finished[NumInOrder])
+    ++NumInOrder;
+#ifdef LLVM_THREAD_POOL_USES_PTHREADS
+  if (NumInOrder != Impl->NumInOrder)
+    ::pthread_cond_broadcast(&Impl->Advanced);
+#endif
+  Impl->NumInOrder = NumInOrder;
+#ifdef LLVM_THREAD_POOL_USES_PTHREADS
+  ::pthread_mutex_unlock(&Impl->Lock);
+#endif
+}
+
+void TaskSequencer::waitForPredecessors(unsigned Task) {
+  assert(Task < Impl->Finished.size() && "Task number out of range!");
+#ifdef LLVM_THREAD_POOL_USES_PTHREADS
+  ::pthread_mutex_lock(&Impl->Lock);
+  while (Impl->NumInOrder < Task)
+    ::pthread_cond_wait(&Impl->Advanced, &Impl->Lock);
+  ::pthread_mutex_unlock(&Impl->Lock);
+#else
+  // Without thread support tasks run one after the other, so there is
+  // nothing to wait for.
+  assert(Impl->NumInOrder >= Task && "Waiting would deadlock!");
+#endif
+}
+
+unsigned TaskSequencer::getNumFinishedInOrder() const {
+#ifdef LLVM_THREAD_POOL_USES_PTHREADS
+  ::pthread_mutex_lock(&Impl->Lock);
+  unsigned NumInOrder = Impl->NumInOrder;
+  ::pthread_mutex_unlock(&Impl->Lock);
+  return NumInOrder;
+#else
+  return Impl->NumInOrder;
+#endif
+}
@@ -16,6 +16,7 @@
 #include "llvm/Support/Atomic.h"
 #include "llvm/Support/Mutex.h"
 #include <cassert>
+#include <vector>
 
 using namespace llvm;
 
@@ -102,6 +103,40 @@ void llvm::llvm_execute_on_thread(void (*Fn)(void*), void *UserData,
  error:
   ::pthread_attr_destroy(&Attr);
 }
+
+void llvm::llvm_execute_on_threads(void (*Fn)(void*), void **UserData,
+                                   unsigned NumThreads,
+                                   unsigned RequestedStackSize) {
+  std::vector<ThreadInfo> Infos(NumThreads);
+  std::vector<pthread_t> Threads;
+  Threads.reserve(NumThreads);
+
+  pthread_attr_t Attr;
+  bool HaveAttr = ::pthread_attr_init(&Attr) == 0;
+  if (HaveAttr && RequestedStackSize != 0)
+    HaveAttr = ::pthread_attr_setstacksize(&Attr, RequestedStackSize) == 0;
+
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    Infos[i].UserFn = Fn;
+    Infos[i].UserData = UserData[i];
+
+    // If we can't get a thread, run the job here rather than dropping it.
+    pthread_t Thread;
+    if (HaveAttr &&
+        ::pthread_create(&Thread, &Attr, ExecuteOnThread_Dispatch,
+                         &Infos[i]) == 0)
+      Threads.push_back(Thread);
+    else
+      Fn(UserData[i]);
+  }
+
+  // Wait for the threads and clean up.
+  for (unsigned i = 0, e = Threads.size(); i != e; ++i)
+    ::pthread_join(Threads[i], 0);
+
+  if (HaveAttr)
+    ::pthread_attr_destroy(&Attr);
+}
 #elif LLVM_ENABLE_THREADS!=0 && defined(LLVM_ON_WIN32)
 #include "Windows/Windows.h"
 #include <process.h>
@@ -136,6 +171,33 @@ void llvm::llvm_execute_on_thread(void (*Fn)(void*), void *UserData,
     ::CloseHandle(hThread);
   }
 }
+
+void llvm::llvm_execute_on_threads(void (*Fn)(void*), void **UserData,
+                                   unsigned NumThreads,
+                                   unsigned RequestedStackSize) {
+  std::vector<ThreadInfo> Infos(NumThreads);
+  std::vector<HANDLE> Threads;
+  Threads.reserve(NumThreads);
+
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    Infos[i].func = Fn;
+    Infos[i].param = UserData[i];
+
+    // If we can't get a thread, run the job here rather than dropping it.
+    HANDLE hThread = (HANDLE)::_beginthreadex(NULL, RequestedStackSize,
+                                              ThreadCallback, &Infos[i], 0,
+                                              NULL);
+    if (hThread)
+      Threads.push_back(hThread);
+    else
+      Fn(UserData[i]);
+  }
+
+  for (unsigned i = 0, e = Threads.size(); i != e; ++i) {
+    (void)::WaitForSingleObject(Threads[i], INFINITE);
+    ::CloseHandle(Threads[i]);
+  }
+}
 #else
 // Support for non-Win32, non-pthread implementation.
 void llvm::llvm_execute_on_thread(void (*Fn)(void*), void *UserData,
@@ -144,4 +206,12 @@ void llvm::llvm_execute_on_thread(void (*Fn)(void*), void *UserData,
   Fn(UserData);
 }
 
+void llvm::llvm_execute_on_threads(void (*Fn)(void*), void **UserData,
+                                   unsigned NumThreads,
+                                   unsigned RequestedStackSize) {
+  (void) RequestedStackSize;
+  for (unsigned i = 0; i != NumThreads; ++i)
+    Fn(UserData[i]);
+}
+
 #endif
@@ -481,10 +481,25 @@ void Output::endBitSetScalar() {
   this->outputUpToEndOfLine(" ]");
 }
 
+/// needsQuotes - Return true if S can't be written as a plain scalar, because
+/// it would be read back as something else.
+static bool needsQuotes(StringRef S) {
+  if (S.empty() || S.front() == ' ' || S.back() == ' ')
+    return true;
+  if (StringRef(",[]{}#&*!|>'\"%@`").find(S.front()) != StringRef::npos)
+    return true;
+  // These only start a structure when they are followed by a space.
+  if (StringRef("-?:").find(S.front()) != StringRef::npos &&
+      (S.size() == 1 || S[1] == ' '))
+    return true;
+  return S.find('\n') != StringRef::npos || S.find(": ") != StringRef::npos ||
+         S.find(" #") != StringRef::npos || S.back() == ':';
+}
+
 void Output::scalarString(StringRef &S) {
   this->newLineCheck();
-  if (S.find('\n') == StringRef::npos) {
-    // No embedded new-line chars, just print string.
+  if (!needsQuotes(S)) {
+    // Nothing that could be misread, just print string.
     this->outputUpToEndOfLine(S);
     return;
   }
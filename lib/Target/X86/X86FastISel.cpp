@@ -80,10 +80,13 @@ public:
 private:
   bool X86FastEmitCompare(const Value *LHS, const Value *RHS, EVT VT);
 
-  bool X86FastEmitLoad(EVT VT, const X86AddressMode &AM, unsigned &RR);
+  bool X86FastEmitLoad(EVT VT, const X86AddressMode &AM, unsigned &RR,
+                       bool Aligned = true);
 
-  bool X86FastEmitStore(EVT VT, const Value *Val, const X86AddressMode &AM);
-  bool X86FastEmitStore(EVT VT, unsigned Val, const X86AddressMode &AM);
+  bool X86FastEmitStore(EVT VT, const Value *Val, const X86AddressMode &AM,
+                        bool Aligned = true);
+  bool X86FastEmitStore(EVT VT, unsigned Val, const X86AddressMode &AM,
+                        bool Aligned = true);
 
   bool X86FastEmitExtend(ISD::NodeType Opc, EVT DstVT, unsigned Src, EVT SrcVT,
                          unsigned &ResultReg);
@@ -103,8 +106,12 @@ private:
 
   bool X86SelectBranch(const Instruction *I);
 
+  bool X86SelectSwitch(const Instruction *I);
+
   bool X86SelectShift(const Instruction *I);
 
+  bool X86SelectVectorLogicOp(const Instruction *I);
+
   bool X86SelectSelect(const Instruction *I);
 
   bool X86SelectTrunc(const Instruction *I);
@@ -174,9 +181,13 @@ bool X86FastISel::isTypeLegal(Type *Ty, MVT &VT, bool AllowI1) {
 
 /// X86FastEmitLoad - Emit a machine instruction to load a value of type VT.
 /// The address is either pre-computed, i.e. Ptr, or a GlobalAddress, i.e. GV.
-/// Return true and the result register by reference if it is possible.
+/// Vector loads from addresses that are not known to be aligned must pass
+/// Aligned = false. Return true and the result register by reference if it
+/// is possible.
 bool X86FastISel::X86FastEmitLoad(EVT VT, const X86AddressMode &AM,
-                                  unsigned &ResultReg) {
+                                  unsigned &ResultReg, bool Aligned) {
+  bool HasAVX = Subtarget->hasAVX();
+
   // Get opcode and regclass of the output for the given load instruction.
   unsigned Opc = 0;
   const TargetRegisterClass *RC = NULL;
@@ -221,6 +232,30 @@ bool X86FastISel::X86FastEmitLoad(EVT VT, const X86AddressMode &AM,
   case MVT::f80:
     // No f80 support yet.
     return false;
+  case MVT::v4f32:
+    if (Aligned)
+      Opc = HasAVX ? X86::VMOVAPSrm : X86::MOVAPSrm;
+    else
+      Opc = HasAVX ? X86::VMOVUPSrm : X86::MOVUPSrm;
+    RC  = &X86::VR128RegClass;
+    break;
+  case MVT::v2f64:
+    if (Aligned)
+      Opc = HasAVX ? X86::VMOVAPDrm : X86::MOVAPDrm;
+    else
+      Opc = HasAVX ? X86::VMOVUPDrm : X86::MOVUPDrm;
+    RC  = &X86::VR128RegClass;
+    break;
+  case MVT::v4i32:
+  case MVT::v2i64:
+  case MVT::v8i16:
+  case MVT::v16i8:
+    if (Aligned)
+      Opc = HasAVX ? X86::VMOVDQArm : X86::MOVDQArm;
+    else
+      Opc = HasAVX ? X86::VMOVDQUrm : X86::MOVDQUrm;
+    RC  = &X86::VR128RegClass;
+    break;
   }
 
   ResultReg = createResultReg(RC);
@@ -232,9 +267,13 @@ bool X86FastISel::X86FastEmitLoad(EVT VT, const X86AddressMode &AM,
 /// X86FastEmitStore - Emit a machine instruction to store a value Val of
 /// type VT. The address is either pre-computed, consisted of a base ptr, Ptr
 /// and a displacement offset, or a GlobalAddress,
-/// i.e. V. Return true if it is possible.
+/// i.e. V. Vector stores to addresses that are not known to be aligned must
+/// pass Aligned = false. Return true if it is possible.
 bool
-X86FastISel::X86FastEmitStore(EVT VT, unsigned Val, const X86AddressMode &AM) {
+X86FastISel::X86FastEmitStore(EVT VT, unsigned Val, const X86AddressMode &AM,
+                              bool Aligned) {
+  bool HasAVX = Subtarget->hasAVX();
+
   // Get opcode and regclass of the output for the given store instruction.
   unsigned Opc = 0;
   switch (VT.getSimpleVT().SimpleTy) {
@@ -261,16 +300,25 @@ X86FastISel::X86FastEmitStore(EVT VT, unsigned Val, const X86AddressMode &AM) {
           (Subtarget->hasAVX() ? X86::VMOVSDmr : X86::MOVSDmr) : X86::ST_Fp64m;
     break;
   case MVT::v4f32:
-    Opc = X86::MOVAPSmr;
+    if (Aligned)
+      Opc = HasAVX ? X86::VMOVAPSmr : X86::MOVAPSmr;
+    else
+      Opc = HasAVX ? X86::VMOVUPSmr : X86::MOVUPSmr;
     break;
   case MVT::v2f64:
-    Opc = X86::MOVAPDmr;
+    if (Aligned)
+      Opc = HasAVX ? X86::VMOVAPDmr : X86::MOVAPDmr;
+    else
+      Opc = HasAVX ? X86::VMOVUPDmr : X86::MOVUPDmr;
     break;
   case MVT::v4i32:
   case MVT::v2i64:
   case MVT::v8i16:
   case MVT::v16i8:
-    Opc = X86::MOVDQAmr;
+    if (Aligned)
+      Opc = HasAVX ? X86::VMOVDQAmr : X86::MOVDQAmr;
+    else
+      Opc = HasAVX ? X86::VMOVDQUmr : X86::MOVDQUmr;
     break;
   }
 
@@ -280,7 +328,7 @@ X86FastISel::X86FastEmitStore(EVT VT, unsigned Val, const X86AddressMode &AM) {
 }
 
 bool X86FastISel::X86FastEmitStore(EVT VT, const Value *Val,
-                                   const X86AddressMode &AM) {
+                                   const X86AddressMode &AM, bool Aligned) {
   // Handle 'null' like i32/i64 0.
   if (isa<ConstantPointerNull>(Val))
     Val = Constant::getNullValue(TD.getIntPtrType(Val->getContext()));
@@ -315,7 +363,7 @@ bool X86FastISel::X86FastEmitStore(EVT VT, const Value *Val,
   if (ValReg == 0)
     return false;
 
-  return X86FastEmitStore(VT, ValReg, AM);
+  return X86FastEmitStore(VT, ValReg, AM, Aligned);
 }
 
 /// X86FastEmitExtend - Emit a machine instruction to extend a value Src of
@@ -690,20 +738,23 @@ bool X86FastISel::X86SelectStore(const Instruction *I) {
   if (S->isAtomic())
     return false;
 
-  unsigned SABIAlignment =
-    TD.getABITypeAlignment(S->getValueOperand()->getType());
-  if (S->getAlignment() != 0 && S->getAlignment() < SABIAlignment)
-    return false;
-
   MVT VT;
   if (!isTypeLegal(I->getOperand(0)->getType(), VT, /*AllowI1=*/true))
     return false;
 
+  // Underaligned vector stores use the unaligned moves; other types are left
+  // to SelectionDAG.
+  unsigned SABIAlignment =
+    TD.getABITypeAlignment(S->getValueOperand()->getType());
+  bool Aligned = S->getAlignment() == 0 || S->getAlignment() >= SABIAlignment;
+  if (!Aligned && !VT.isVector())
+    return false;
+
   X86AddressMode AM;
   if (!X86SelectAddress(I->getOperand(1), AM))
     return false;
 
-  return X86FastEmitStore(VT, I->getOperand(0), AM);
+  return X86FastEmitStore(VT, I->getOperand(0), AM, Aligned);
 }
 
 /// X86SelectRet - Select and emit code to implement ret instructions.
@@ -779,21 +830,26 @@ bool X86FastISel::X86SelectRet(const Instruction *I) {
       if (SrcVT != MVT::i1 && SrcVT != MVT::i8 && SrcVT != MVT::i16)
         return false;
 
-      if (!Outs[0].Flags.isZExt() && !Outs[0].Flags.isSExt())
-        return false;
-
-      assert(DstVT == MVT::i32 && "X86 should always ext to i32");
-
-      if (SrcVT == MVT::i1) {
-        if (Outs[0].Flags.isSExt())
+      if (!Outs[0].Flags.isZExt() && !Outs[0].Flags.isSExt()) {
+        // An i1 without extension attributes is returned in an 8-bit
+        // register whose upper bits are undefined, which is exactly how it
+        // is kept in a virtual register.
+        if (SrcVT != MVT::i1 || DstVT != MVT::i8)
           return false;
-        SrcReg = FastEmitZExtFromI1(MVT::i8, SrcReg, /*TODO: Kill=*/false);
-        SrcVT = MVT::i8;
+      } else {
+        assert(DstVT == MVT::i32 && "X86 should always ext to i32");
+
+        if (SrcVT == MVT::i1) {
+          if (Outs[0].Flags.isSExt())
+            return false;
+          SrcReg = FastEmitZExtFromI1(MVT::i8, SrcReg, /*TODO: Kill=*/false);
+          SrcVT = MVT::i8;
+        }
+        unsigned Op = Outs[0].Flags.isZExt() ? ISD::ZERO_EXTEND :
+                                               ISD::SIGN_EXTEND;
+        SrcReg = FastEmit_r(SrcVT.getSimpleVT(), DstVT.getSimpleVT(), Op,
+                            SrcReg, /*TODO: Kill=*/false);
       }
-      unsigned Op = Outs[0].Flags.isZExt() ? ISD::ZERO_EXTEND :
-                                             ISD::SIGN_EXTEND;
-      SrcReg = FastEmit_r(SrcVT.getSimpleVT(), DstVT.getSimpleVT(), Op,
-                          SrcReg, /*TODO: Kill=*/false);
     }
 
     // Make the copy.
@@ -830,8 +886,10 @@ bool X86FastISel::X86SelectRet(const Instruction *I) {
 /// X86SelectLoad - Select and emit code to implement load instructions.
 ///
 bool X86FastISel::X86SelectLoad(const Instruction *I)  {
+  const LoadInst *LI = cast<LoadInst>(I);
+
   // Atomic loads need special handling.
-  if (cast<LoadInst>(I)->isAtomic())
+  if (LI->isAtomic())
     return false;
 
   MVT VT;
@@ -842,8 +900,12 @@ bool X86FastISel::X86SelectLoad(const Instruction *I)  {
   if (!X86SelectAddress(I->getOperand(0), AM))
     return false;
 
+  unsigned ABIAlignment = TD.getABITypeAlignment(I->getType());
+  bool Aligned = LI->getAlignment() == 0 ||
+                 LI->getAlignment() >= ABIAlignment;
+
   unsigned ResultReg = 0;
-  if (X86FastEmitLoad(VT, AM, ResultReg)) {
+  if (X86FastEmitLoad(VT, AM, ResultReg, Aligned)) {
     UpdateValueMap(I, ResultReg);
     return true;
   }
@@ -924,9 +986,34 @@ bool X86FastISel::X86SelectCmp(const Instruction *I) {
   const CmpInst *CI = cast<CmpInst>(I);
 
   MVT VT;
-  if (!isTypeLegal(I->getOperand(0)->getType(), VT))
+  if (!isTypeLegal(I->getOperand(0)->getType(), VT, /*AllowI1=*/true))
     return false;
 
+  if (VT == MVT::i1) {
+    // Only the lowest bit of an i1 register is defined, so compare the
+    // operands with a xor. Orderings of i1 values are left to SelectionDAG.
+    CmpInst::Predicate Predicate = CI->getPredicate();
+    if (Predicate != CmpInst::ICMP_EQ && Predicate != CmpInst::ICMP_NE)
+      return false;
+
+    unsigned Op0Reg = getRegForValue(CI->getOperand(0));
+    if (Op0Reg == 0) return false;
+    unsigned Op1Reg = getRegForValue(CI->getOperand(1));
+    if (Op1Reg == 0) return false;
+
+    unsigned XorReg = createResultReg(&X86::GR8RegClass);
+    BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(X86::XOR8rr),
+            XorReg).addReg(Op0Reg).addReg(Op1Reg);
+    unsigned ResultReg = XorReg;
+    if (Predicate == CmpInst::ICMP_EQ) {
+      ResultReg = createResultReg(&X86::GR8RegClass);
+      BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(X86::XOR8ri),
+              ResultReg).addReg(XorReg).addImm(1);
+    }
+    UpdateValueMap(I, ResultReg);
+    return true;
+  }
+
   unsigned ResultReg = createResultReg(&X86::GR8RegClass);
   unsigned SetCCOpc;
   bool SwapArgs;  // false -> compare Op0, Op1.  true -> compare Op1, Op0.
@@ -1157,6 +1244,80 @@ bool X86FastISel::X86SelectBranch(const Instruction *I) {
   return true;
 }
 
+/// X86SelectSwitch - Select a switch whose cases all lead to the same block,
+/// which takes a single conditional branch. Other switches are left to
+/// SelectionDAG, which builds jump tables and bit tests for them.
+bool X86FastISel::X86SelectSwitch(const Instruction *I) {
+  const SwitchInst *SI = cast<SwitchInst>(I);
+  const BasicBlock *DefaultBB = SI->getDefaultDest();
+
+  // Collect the case values, skipping the ones that lead to the default.
+  const BasicBlock *CaseBB = 0;
+  SmallVector<const ConstantInt *, 8> CaseValues;
+  for (SwitchInst::ConstCaseIt i = SI->case_begin(), e = SI->case_end();
+       i != e; ++i) {
+    const BasicBlock *Succ = i.getCaseSuccessor();
+    if (Succ == DefaultBB)
+      continue;
+    if (CaseBB && Succ != CaseBB)
+      return false;
+    CaseBB = Succ;
+
+    IntegersSubset CaseRanges = i.getCaseValueEx();
+    if (!CaseRanges.isSingleNumbersOnly())
+      return false;
+    for (unsigned j = 0, je = CaseRanges.getNumItems(); j != je; ++j)
+      CaseValues.push_back(CaseRanges.getSingleNumber(j).toConstantInt());
+  }
+
+  MachineBasicBlock *DefaultMBB = FuncInfo.MBBMap[DefaultBB];
+  if (!CaseBB) {
+    FastEmitBranch(DefaultMBB, DL);
+    return true;
+  }
+
+  // A long chain of compares is worse than what SelectionDAG does.
+  if (CaseValues.size() > 8)
+    return false;
+
+  const Value *Cond = SI->getCondition();
+  MVT VT;
+  if (!isTypeLegal(Cond->getType(), VT))
+    return false;
+
+  unsigned BranchOpc = X86::JE_4;
+  if (CaseValues.size() == 1) {
+    if (!X86FastEmitCompare(Cond, CaseValues[0], VT))
+      return false;
+  } else {
+    // Or together the results of comparing with each value.
+    unsigned ResultReg = 0;
+    for (unsigned i = 0, e = CaseValues.size(); i != e; ++i) {
+      if (!X86FastEmitCompare(Cond, CaseValues[i], VT))
+        return false;
+      unsigned EReg = createResultReg(&X86::GR8RegClass);
+      BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(X86::SETEr), EReg);
+      if (ResultReg) {
+        unsigned OrReg = createResultReg(&X86::GR8RegClass);
+        BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(X86::OR8rr),
+                OrReg).addReg(ResultReg).addReg(EReg);
+        EReg = OrReg;
+      }
+      ResultReg = EReg;
+    }
+    BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(X86::TEST8rr))
+      .addReg(ResultReg).addReg(ResultReg);
+    BranchOpc = X86::JNE_4;
+  }
+
+  MachineBasicBlock *CaseMBB = FuncInfo.MBBMap[CaseBB];
+  BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(BranchOpc))
+    .addMBB(CaseMBB);
+  FastEmitBranch(DefaultMBB, DL);
+  FuncInfo.MBB->addSuccessor(CaseMBB);
+  return true;
+}
+
 bool X86FastISel::X86SelectShift(const Instruction *I) {
   unsigned CReg = 0, OpReg = 0;
   const TargetRegisterClass *RC = NULL;
@@ -1226,17 +1387,53 @@ bool X86FastISel::X86SelectShift(const Instruction *I) {
   return true;
 }
 
-bool X86FastISel::X86SelectSelect(const Instruction *I) {
+/// X86SelectVectorLogicOp - Select and, or and xor of 128-bit integer
+/// vectors. Only the v2i64 forms have patterns, so the generic selection
+/// misses the other element types.
+bool X86FastISel::X86SelectVectorLogicOp(const Instruction *I) {
   MVT VT;
   if (!isTypeLegal(I->getType(), VT))
     return false;
+  if (VT != MVT::v4i32 && VT != MVT::v2i64 && VT != MVT::v8i16 &&
+      VT != MVT::v16i8)
+    return false;
+
+  bool HasAVX = Subtarget->hasAVX();
+  unsigned Opc;
+  switch (I->getOpcode()) {
+  default: llvm_unreachable("Unexpected vector logic operation!");
+  case Instruction::And: Opc = HasAVX ? X86::VPANDrr : X86::PANDrr; break;
+  case Instruction::Or:  Opc = HasAVX ? X86::VPORrr : X86::PORrr;   break;
+  case Instruction::Xor: Opc = HasAVX ? X86::VPXORrr : X86::PXORrr; break;
+  }
+
+  unsigned Op0Reg = getRegForValue(I->getOperand(0));
+  if (Op0Reg == 0) return false;
+  unsigned Op1Reg = getRegForValue(I->getOperand(1));
+  if (Op1Reg == 0) return false;
+
+  unsigned ResultReg = createResultReg(&X86::VR128RegClass);
+  BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(Opc), ResultReg)
+    .addReg(Op0Reg).addReg(Op1Reg);
+  UpdateValueMap(I, ResultReg);
+  return true;
+}
+
+bool X86FastISel::X86SelectSelect(const Instruction *I) {
+  MVT VT;
+  if (!isTypeLegal(I->getType(), VT, /*AllowI1=*/true))
+    return false;
 
   // We only use cmov here, if we don't have a cmov instruction bail.
   if (!Subtarget->hasCMov()) return false;
 
   unsigned Opc = 0;
   const TargetRegisterClass *RC = NULL;
-  if (VT == MVT::i16) {
+  if (VT == MVT::i1 || VT == MVT::i8) {
+    // There is no 8-bit cmov, so select between the zero extended operands.
+    Opc = X86::CMOVE32rr;
+    RC = &X86::GR32RegClass;
+  } else if (VT == MVT::i16) {
     Opc = X86::CMOVE16rr;
     RC = &X86::GR16RegClass;
   } else if (VT == MVT::i32) {
@@ -1256,11 +1453,39 @@ bool X86FastISel::X86SelectSelect(const Instruction *I) {
   unsigned Op2Reg = getRegForValue(I->getOperand(2));
   if (Op2Reg == 0) return false;
 
-  BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(X86::TEST8rr))
-    .addReg(Op0Reg).addReg(Op0Reg);
+  if (VT == MVT::i1 || VT == MVT::i8) {
+    unsigned Ext1Reg = createResultReg(RC);
+    BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(X86::MOVZX32rr8),
+            Ext1Reg).addReg(Op1Reg);
+    unsigned Ext2Reg = createResultReg(RC);
+    BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(X86::MOVZX32rr8),
+            Ext2Reg).addReg(Op2Reg);
+    Op1Reg = Ext1Reg;
+    Op2Reg = Ext2Reg;
+  }
+
+  // Only the lowest bit of the condition register is defined.
+  BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(X86::TEST8ri))
+    .addReg(Op0Reg).addImm(1);
   unsigned ResultReg = createResultReg(RC);
   BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(Opc), ResultReg)
     .addReg(Op1Reg).addReg(Op2Reg);
+
+  if (VT == MVT::i1 || VT == MVT::i8) {
+    if (!Subtarget->is64Bit()) {
+      // If we're on x86-32; we can't extract an i8 from a general register.
+      // First issue a copy to GR32_ABCD.
+      unsigned CopyReg = createResultReg(&X86::GR32_ABCDRegClass);
+      BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL,
+              TII.get(TargetOpcode::COPY), CopyReg).addReg(ResultReg);
+      ResultReg = CopyReg;
+    }
+    ResultReg = FastEmitInst_extractsubreg(MVT::i8, ResultReg, /*Kill=*/true,
+                                           X86::sub_8bit);
+    if (!ResultReg)
+      return false;
+  }
+
   UpdateValueMap(I, ResultReg);
   return true;
 }
@@ -1423,6 +1648,21 @@ bool X86FastISel::X86VisitIntrinsicCall(const IntrinsicInst &I) {
 
     return DoSelectCall(&I, "memcpy");
   }
+  case Intrinsic::memmove: {
+    const MemMoveInst &MMI = cast<MemMoveInst>(I);
+
+    if (MMI.isVolatile())
+      return false;
+
+    unsigned SizeWidth = Subtarget->is64Bit() ? 64 : 32;
+    if (!MMI.getLength()->getType()->isIntegerTy(SizeWidth))
+      return false;
+
+    if (MMI.getSourceAddressSpace() > 255 || MMI.getDestAddressSpace() > 255)
+      return false;
+
+    return DoSelectCall(&I, "memmove");
+  }
   case Intrinsic::memset: {
     const MemSetInst &MSI = cast<MemSetInst>(I);
 
@@ -1995,12 +2235,18 @@ X86FastISel::TargetSelectInstruction(const Instruction *I)  {
     return X86SelectZExt(I);
   case Instruction::Br:
     return X86SelectBranch(I);
+  case Instruction::Switch:
+    return X86SelectSwitch(I);
   case Instruction::Call:
     return X86SelectCall(I);
   case Instruction::LShr:
   case Instruction::AShr:
   case Instruction::Shl:
     return X86SelectShift(I);
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor:
+    return X86SelectVectorLogicOp(I);
   case Instruction::Select:
     return X86SelectSelect(I);
   case Instruction::Trunc:
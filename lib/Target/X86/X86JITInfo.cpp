@@ -32,6 +32,20 @@ using namespace llvm;
 #endif
 
 void X86JITInfo::replaceMachineCodeForFunction(void *Old, void *New) {
+#if defined (X86_64_JIT)
+  // If the first 8 bytes are naturally aligned, write the jump together with
+  // the 3 bytes following it in one store, so that a thread concurrently
+  // executing the function sees either the old or the new instruction.
+  if (((uintptr_t)Old & 7) == 0) {
+    volatile uint64_t *OldWord = (volatile uint64_t *)Old;
+    uint64_t Rel = (uint32_t)((intptr_t)New - (intptr_t)Old - 5);
+    uint64_t Word = (*OldWord & ~UINT64_C(0xFFFFFFFFFF)) | (Rel << 8) | 0xE9;
+    *OldWord = Word;
+    sys::ValgrindDiscardTranslations(Old, 8);
+    return;
+  }
+#endif
+
   unsigned char *OldByte = (unsigned char *)Old;
   *OldByte++ = 0xE9;                // Emit JMP opcode.
   unsigned *OldWord = (unsigned *)OldByte;
@@ -45,6 +59,25 @@ void X86JITInfo::replaceMachineCodeForFunction(void *Old, void *New) {
 }
 
 
+bool X86JITInfo::supportsPatchableEntry() const {
+#if defined (X86_64_JIT)
+  return true;
+#else
+  return false;
+#endif
+}
+
+void X86JITInfo::emitPatchableEntry(JITCodeEmitter &JCE) {
+  assert((JCE.getCurrentPCValue() & 7) == 0 &&
+         "Patchable entry must be 8-byte aligned!");
+  // nopl 0x0(%rax,%rax,1)
+  JCE.emitByte(0x0F);
+  JCE.emitByte(0x1F);
+  JCE.emitByte(0x84);
+  JCE.emitByte(0x00);
+  JCE.emitWordLE(0);
+}
+
 /// JITCompilerFunction - This contains the address of the JIT function used to
 /// compile a function lazily.
 static TargetJITInfo::JITCompilerFn JITCompilerFunction;
@@ -37,6 +37,11 @@ namespace llvm {
     ///
     virtual void replaceMachineCodeForFunction(void *Old, void *New);
 
+    /// supportsPatchableEntry / emitPatchableEntry - On X86-64, functions can
+    /// start with an 8-byte NOP that is replaced by a jump with a single store.
+    virtual bool supportsPatchableEntry() const;
+    virtual void emitPatchableEntry(JITCodeEmitter &JCE);
+
     /// emitGlobalValueIndirectSym - Use the specified JITCodeEmitter object
     /// to emit an indirect symbol which contains the address of the specified
     /// ptr.
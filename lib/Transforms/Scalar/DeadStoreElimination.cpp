@@ -33,6 +33,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Transforms/Utils/Local.h"
@@ -41,6 +42,11 @@ using namespace llvm;
 STATISTIC(NumFastStores, "Number of stores deleted");
 STATISTIC(NumFastOther , "Number of other instrs removed");
 
+static cl::opt<unsigned>
+MemDepScanLimit("dse-memdep-scan-limit", cl::Hidden, cl::init(0),
+  cl::desc("The -memdep-block-scan-limit to use during DSE "
+           "(0 = leave it alone)"));
+
 namespace {
   struct DSE : public FunctionPass {
     AliasAnalysis *AA;
@@ -59,6 +65,10 @@ namespace {
       DT = &getAnalysis<DominatorTree>();
       TLI = AA->getTargetLibraryInfo();
 
+      unsigned OldScanLimit = 0;
+      if (MemDepScanLimit)
+        OldScanLimit = MD->setBlockScanLimit(MemDepScanLimit);
+
       bool Changed = false;
       for (Function::iterator I = F.begin(), E = F.end(); I != E; ++I)
         // Only check non-dead blocks.  Dead blocks may have strange pointer
@@ -66,6 +76,8 @@ namespace {
         if (DT->isReachableFromEntry(I))
           Changed |= runOnBasicBlock(*I);
 
+      if (MemDepScanLimit)
+        MD->setBlockScanLimit(OldScanLimit);
       AA = 0; MD = 0; DT = 0;
       return Changed;
     }
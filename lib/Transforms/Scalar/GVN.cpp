@@ -60,6 +60,11 @@ static cl::opt<bool> EnablePRE("enable-pre",
                                cl::init(true), cl::Hidden);
 static cl::opt<bool> EnableLoadPRE("enable-load-pre", cl::init(true));
 
+static cl::opt<unsigned>
+MemDepScanLimit("gvn-memdep-scan-limit", cl::Hidden, cl::init(0),
+  cl::desc("The -memdep-block-scan-limit to use during GVN "
+           "(0 = leave it alone)"));
+
 // Maximum allowed recursion depth.
 static cl::opt<uint32_t>
 MaxRecurseDepth("max-recurse-depth", cl::Hidden, cl::init(1000), cl::ZeroOrMore,
@@ -2302,6 +2307,10 @@ bool GVN::runOnFunction(Function& F) {
   VN.setMemDep(MD);
   VN.setDomTree(DT);
 
+  unsigned OldScanLimit = 0;
+  if (MD && MemDepScanLimit)
+    OldScanLimit = MD->setBlockScanLimit(MemDepScanLimit);
+
   bool Changed = false;
   bool ShouldContinue = true;
 
@@ -2340,6 +2349,9 @@ bool GVN::runOnFunction(Function& F) {
 
   cleanupGlobalSets();
 
+  if (MD && MemDepScanLimit)
+    MD->setBlockScanLimit(OldScanLimit);
+
   return Changed;
 }
 
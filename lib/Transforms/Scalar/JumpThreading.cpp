@@ -20,6 +20,7 @@
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/Analysis/Dominators.h"
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/LazyValueInfo.h"
 #include "llvm/Analysis/Loads.h"
@@ -78,6 +79,7 @@ namespace {
     DataLayout *TD;
     TargetLibraryInfo *TLI;
     LazyValueInfo *LVI;
+    DominatorTree *DT;
 #ifdef NDEBUG
     SmallPtrSet<BasicBlock*, 16> LoopHeaders;
 #else
@@ -109,6 +111,7 @@ namespace {
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
       AU.addRequired<LazyValueInfo>();
       AU.addPreserved<LazyValueInfo>();
+      AU.addPreserved<DominatorTree>();
       AU.addRequired<TargetLibraryInfo>();
     }
 
@@ -150,6 +153,7 @@ bool JumpThreading::runOnFunction(Function &F) {
   TD = getAnalysisIfAvailable<DataLayout>();
   TLI = &getAnalysis<TargetLibraryInfo>();
   LVI = &getAnalysis<LazyValueInfo>();
+  DT = getAnalysisIfAvailable<DominatorTree>();
 
   FindLoopHeaders(F);
 
@@ -197,7 +201,20 @@ bool JumpThreading::runOnFunction(Function &F) {
         // awesome, but it allows us to use AssertingVH to prevent nasty
         // dangling pointer issues within LazyValueInfo.
         LVI->eraseBlock(BB);
+
+        // If BB goes away, its predecessors branch to Succ instead.
+        DomTreeUpdates Updates;
+        if (DT) {
+          for (pred_iterator PI = pred_begin(BB), PE = pred_end(BB); PI != PE;
+               ++PI)
+            Updates.insertEdge(*PI, Succ);
+          Updates.deleteEdge(BB, Succ);
+          Updates.deleteBlock(BB);
+        }
+
         if (TryToSimplifyUncondBranchFromEmptyBlock(BB)) {
+          if (DT)
+            DT->applyUpdates(Updates);
           Changed = true;
           // If we deleted BB and BB was the header of a loop, then the
           // successor is now the header of the loop.
@@ -657,10 +674,27 @@ bool JumpThreading::ProcessBlock(BasicBlock *BB) {
       // will need to move BB back to the entry position.
       bool isEntry = SinglePred == &SinglePred->getParent()->getEntryBlock();
       LVI->eraseBlock(SinglePred);
+
+      // The predecessors of SinglePred branch to BB instead.
+      DomTreeUpdates Updates;
+      if (DT && !isEntry) {
+        for (pred_iterator PI = pred_begin(SinglePred),
+             PE = pred_end(SinglePred); PI != PE; ++PI)
+          Updates.insertEdge(*PI, BB);
+        Updates.deleteEdge(SinglePred, BB);
+        Updates.deleteBlock(SinglePred);
+      }
+
       MergeBasicBlockIntoOnlyPred(BB);
 
       if (isEntry && BB != &BB->getParent()->getEntryBlock())
         BB->moveBefore(&BB->getParent()->getEntryBlock());
+
+      // A new entry block changes the root of the tree.
+      if (DT && isEntry)
+        DT->getBase().recalculate(*BB->getParent());
+      else if (DT)
+        DT->applyUpdates(Updates);
       return true;
     }
   }
@@ -704,16 +738,20 @@ bool JumpThreading::ProcessBlock(BasicBlock *BB) {
     unsigned BestSucc = GetBestDestForJumpOnUndef(BB);
 
     // Fold the branch/switch.
+    DomTreeUpdates Updates;
     TerminatorInst *BBTerm = BB->getTerminator();
     for (unsigned i = 0, e = BBTerm->getNumSuccessors(); i != e; ++i) {
       if (i == BestSucc) continue;
       BBTerm->getSuccessor(i)->removePredecessor(BB, true);
+      Updates.deleteEdge(BB, BBTerm->getSuccessor(i));
     }
 
     DEBUG(dbgs() << "  In block '" << BB->getName()
           << "' folding undef terminator: " << *BBTerm << '\n');
     BranchInst::Create(BBTerm->getSuccessor(BestSucc), BBTerm);
     BBTerm->eraseFromParent();
+    if (DT)
+      DT->applyUpdates(Updates);
     return true;
   }
 
@@ -724,7 +762,13 @@ bool JumpThreading::ProcessBlock(BasicBlock *BB) {
     DEBUG(dbgs() << "  In block '" << BB->getName()
           << "' folding terminator: " << *BB->getTerminator() << '\n');
     ++NumFolds;
+    DomTreeUpdates Updates;
+    if (DT)
+      for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE; ++SI)
+        Updates.deleteEdge(BB, *SI);
     ConstantFoldTerminator(BB, true);
+    if (DT)
+      DT->applyUpdates(Updates);
     return true;
   }
 
@@ -769,9 +813,12 @@ bool JumpThreading::ProcessBlock(BasicBlock *BB) {
         if (PI == PE) {
           unsigned ToRemove = Baseline == LazyValueInfo::True ? 1 : 0;
           unsigned ToKeep = Baseline == LazyValueInfo::True ? 0 : 1;
-          CondBr->getSuccessor(ToRemove)->removePredecessor(BB, true);
+          BasicBlock *RemovedSucc = CondBr->getSuccessor(ToRemove);
+          RemovedSucc->removePredecessor(BB, true);
           BranchInst::Create(CondBr->getSuccessor(ToKeep), CondBr);
           CondBr->eraseFromParent();
+          if (DT)
+            DT->deleteEdge(BB, RemovedSucc);
           return true;
         }
       }
@@ -1461,6 +1508,14 @@ bool JumpThreading::ThreadEdge(BasicBlock *BB,
       PredTerm->setSuccessor(i, NewBB);
     }
 
+  if (DT) {
+    DomTreeUpdates Updates;
+    Updates.insertEdge(PredBB, NewBB);
+    Updates.insertEdge(NewBB, SuccBB);
+    Updates.deleteEdge(PredBB, BB);
+    DT->applyUpdates(Updates);
+  }
+
   // At this point, the IR is fully up to date and consistent.  Do a quick scan
   // over the new instructions and zap any that are constants or dead.  This
   // frequently happens because of phi translation.
@@ -1611,6 +1666,14 @@ bool JumpThreading::DuplicateCondBranchOnPHIIntoPred(BasicBlock *BB,
   // Remove the unconditional branch at the end of the PredBB block.
   OldPredBranch->eraseFromParent();
 
+  if (DT) {
+    DomTreeUpdates Updates;
+    Updates.deleteEdge(PredBB, BB);
+    Updates.insertEdge(PredBB, BBBranch->getSuccessor(0));
+    Updates.insertEdge(PredBB, BBBranch->getSuccessor(1));
+    DT->applyUpdates(Updates);
+  }
+
   ++NumDupes;
   return true;
 }
@@ -1328,6 +1328,9 @@ public:
   }
   bool runOnFunction(Function &F);
   void getAnalysisUsage(AnalysisUsage &AU) const;
+  // Only the uses of allocas and of the instructions and function local
+  // metadata derived from them are inspected, so replicas are safe.
+  virtual Pass *createReplica() const { return new SROA(RequiresDomTree); }
 
   const char *getPassName() const { return "SROA"; }
   static char ID;
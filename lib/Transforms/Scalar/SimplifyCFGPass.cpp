@@ -23,9 +23,11 @@
 
 #define DEBUG_TYPE "simplifycfg"
 #include "llvm/Transforms/Scalar.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/Dominators.h"
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DataLayout.h"
@@ -48,6 +50,10 @@ namespace {
     }
 
     virtual bool runOnFunction(Function &F);
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+      AU.addPreserved<DominatorTree>();
+    }
   };
 }
 
@@ -313,13 +319,94 @@ static bool iterativelySimplifyCFG(Function &F, const DataLayout *TD,
   return Changed;
 }
 
-// It is possible that we may require multiple passes over the code to fully
-// simplify the CFG.
-//
-bool CFGSimplifyPass::runOnFunction(Function &F) {
-  const DataLayout *TD = getAnalysisIfAvailable<DataLayout>();
-  const TargetTransformInfo *TTI =
-      getAnalysisIfAvailable<TargetTransformInfo>();
+namespace {
+  /// CFGSnapshot - The successors of every block of a function at some point,
+  /// used to find the edges that were added and removed since then. The
+  /// simplifications are spread over too many places to record the changes
+  /// as they happen.
+  ///
+  /// Blocks are compared by address, so a block that was erased and a new one
+  /// allocated at its address are treated as one block whose edges changed.
+  /// That is fine for the dominator tree, which only depends on the edges.
+  class CFGSnapshot {
+    struct SuccRange {
+      unsigned Begin, End;
+      bool Seen;
+    };
+    DenseMap<BasicBlock*, SuccRange> Blocks;
+    SmallVector<BasicBlock*, 64> SuccList;
+    BasicBlock *Entry;
+
+  public:
+    explicit CFGSnapshot(Function &F) : Entry(&F.getEntryBlock()) {
+      for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+        SuccRange &R = Blocks[BB];
+        R.Begin = SuccList.size();
+        SuccList.append(succ_begin(BB), succ_end(BB));
+        R.End = SuccList.size();
+        R.Seen = false;
+      }
+    }
+
+    /// computeUpdates - Record the changes to the CFG of F since the snapshot
+    /// was taken in Updates. Return false if the entry block changed.
+    bool computeUpdates(Function &F, DomTreeUpdates &Updates);
+  };
+}
+
+bool CFGSnapshot::computeUpdates(Function &F, DomTreeUpdates &Updates) {
+  if (&F.getEntryBlock() != Entry)
+    return false;
+
+  SmallPtrSet<BasicBlock*, 8> OldSuccs, NewSuccs;
+  for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+    DenseMap<BasicBlock*, SuccRange>::iterator I = Blocks.find(BB);
+    if (I == Blocks.end()) {
+      for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE;
+           ++SI)
+        Updates.insertEdge(BB, *SI);
+      continue;
+    }
+    SuccRange &R = I->second;
+    R.Seen = true;
+
+    // Most blocks keep their successors in the same order.
+    unsigned Index = R.Begin;
+    succ_iterator SI = succ_begin(BB), SE = succ_end(BB);
+    for (; SI != SE && Index != R.End && *SI == SuccList[Index]; ++SI)
+      ++Index;
+    if (SI == SE && Index == R.End)
+      continue;
+
+    OldSuccs.clear();
+    NewSuccs.clear();
+    OldSuccs.insert(SuccList.begin() + R.Begin, SuccList.begin() + R.End);
+    NewSuccs.insert(succ_begin(BB), succ_end(BB));
+    for (SmallPtrSet<BasicBlock*, 8>::iterator SI = OldSuccs.begin(),
+         SE = OldSuccs.end(); SI != SE; ++SI)
+      if (!NewSuccs.count(*SI))
+        Updates.deleteEdge(BB, *SI);
+    for (SmallPtrSet<BasicBlock*, 8>::iterator SI = NewSuccs.begin(),
+         SE = NewSuccs.end(); SI != SE; ++SI)
+      if (!OldSuccs.count(*SI))
+        Updates.insertEdge(BB, *SI);
+  }
+
+  for (DenseMap<BasicBlock*, SuccRange>::iterator I = Blocks.begin(),
+       E = Blocks.end(); I != E; ++I) {
+    if (I->second.Seen)
+      continue;
+    for (unsigned Index = I->second.Begin; Index != I->second.End; ++Index)
+      Updates.deleteEdge(I->first, SuccList[Index]);
+    Updates.deleteBlock(I->first);
+  }
+  return true;
+}
+
+/// simplifyFunctionCFG - Simplify the CFG of F until nothing changes. Return
+/// true if anything changed.
+static bool simplifyFunctionCFG(Function &F, const DataLayout *TD,
+                                const TargetTransformInfo *TTI) {
   bool EverChanged = removeUnreachableBlocksFromFn(F);
   EverChanged |= mergeEmptyReturnBlocks(F);
   EverChanged |= iterativelySimplifyCFG(F, TD, TTI);
@@ -342,3 +429,27 @@ bool CFGSimplifyPass::runOnFunction(Function &F) {
 
   return true;
 }
+
+// It is possible that we may require multiple passes over the code to fully
+// simplify the CFG.
+//
+bool CFGSimplifyPass::runOnFunction(Function &F) {
+  const DataLayout *TD = getAnalysisIfAvailable<DataLayout>();
+  const TargetTransformInfo *TTI =
+      getAnalysisIfAvailable<TargetTransformInfo>();
+  DominatorTree *DT = getAnalysisIfAvailable<DominatorTree>();
+  if (!DT)
+    return simplifyFunctionCFG(F, TD, TTI);
+
+  // Update the dominator tree for the edges that changed, instead of letting
+  // the next user recalculate it.
+  CFGSnapshot Snapshot(F);
+  if (!simplifyFunctionCFG(F, TD, TTI))
+    return false;
+  DomTreeUpdates Updates;
+  if (Snapshot.computeUpdates(F, Updates))
+    DT->applyUpdates(Updates);
+  else
+    DT->getBase().recalculate(F);
+  return true;
+}
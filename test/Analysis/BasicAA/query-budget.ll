@@ -0,0 +1,51 @@
+; RUN: opt < %s -basicaa -aa-eval -print-all-alias-modref-info -disable-output 2>&1 | FileCheck %s
+; RUN: opt < %s -basicaa -basicaa-query-budget=2 -aa-eval -print-all-alias-modref-info -disable-output 2>&1 | FileCheck %s -check-prefix=BUDGET
+; RUN: opt < %s -basicaa -basicaa-query-budget=2 -aa-eval -instcombine -aa-eval -print-all-alias-modref-info -disable-output 2>&1 | FileCheck %s -check-prefix=TWICE
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+
+; The budget applies to each function, across all the passes that query about
+; it, and once it is used up, the remaining queries are answered MayAlias.
+
+
+; CHECK: Function: f
+; CHECK: NoAlias: i32* %a, i32* %b
+; CHECK: NoAlias: i32* %a, i32* %c
+; CHECK: NoAlias: i32* %b, i32* %c
+; BUDGET: Function: f
+; BUDGET: NoAlias: i32* %a, i32* %b
+; BUDGET: NoAlias: i32* %a, i32* %c
+; BUDGET: MayAlias: i32* %b, i32* %c
+define void @f() {
+  %a = alloca i32
+  %b = alloca i32
+  %c = alloca i32
+  store i32 0, i32* %a
+  store i32 0, i32* %b
+  store i32 0, i32* %c
+  ret void
+}
+
+; CHECK: Function: g
+; CHECK: MustAlias: [2 x i32]* %x, i32* %p
+; CHECK: PartialAlias: [2 x i32]* %x, i32* %q
+; CHECK: NoAlias: i32* %p, i32* %q
+; BUDGET: Function: g
+; BUDGET: MustAlias: [2 x i32]* %x, i32* %p
+; BUDGET: PartialAlias: [2 x i32]* %x, i32* %q
+; BUDGET: MayAlias: i32* %p, i32* %q
+; TWICE: Function: g
+; TWICE: MustAlias: [2 x i32]* %x, i32* %p
+; TWICE: PartialAlias: [2 x i32]* %x, i32* %q
+; TWICE: MayAlias: i32* %p, i32* %q
+; TWICE: Function: g
+; TWICE: MayAlias: [2 x i32]* %x, i32* %p
+; TWICE: MayAlias: [2 x i32]* %x, i32* %q
+; TWICE: MayAlias: i32* %p, i32* %q
+define void @g([2 x i32]* %x) {
+  %p = getelementptr [2 x i32]* %x, i64 0, i64 0
+  %q = getelementptr [2 x i32]* %x, i64 0, i64 1
+  store i32 0, i32* %p
+  store i32 0, i32* %q
+  ret void
+}
@@ -0,0 +1,57 @@
+; RUN: opt < %s -indvars -loop-reduce -S > %t1
+; RUN: opt < %s -indvars -loop-reduce -scev-release-loops=false -S > %t2
+; RUN: diff %t1 %t2
+; RUN: opt < %s -indvars -loop-reduce -stats -disable-output 2>&1 \
+; RUN:   | FileCheck %s
+; REQUIRES: asserts
+
+; Dropping ScalarEvolution's results for a loop nest once the loop passes are
+; done with it doesn't change the result, even though the second loop asks
+; about values defined in the first nest.
+
+target datalayout = "e-p:64:64:64-i32:32:32-i64:64:64"
+
+define void @f(double* %A, i32 %n, i32 %m) {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %row = mul nsw i32 %i, %m
+  br label %inner
+
+inner:
+  %j = phi i32 [ 0, %outer ], [ %j.next, %inner ]
+  %idx = add nsw i32 %row, %j
+  %idx.ext = sext i32 %idx to i64
+  %p = getelementptr inbounds double* %A, i64 %idx.ext
+  store double 0.0, double* %p
+  %j.next = add nsw i32 %j, 1
+  %inner.cond = icmp slt i32 %j.next, %m
+  br i1 %inner.cond, label %inner, label %outer.latch
+
+outer.latch:
+  %i.next = add nsw i32 %i, 1
+  %outer.cond = icmp slt i32 %i.next, %n
+  br i1 %outer.cond, label %outer, label %tail.ph
+
+tail.ph:
+  %start = phi i32 [ %i.next, %outer.latch ]
+  br label %tail
+
+tail:
+  %k = phi i32 [ %start, %tail.ph ], [ %k.next, %tail ]
+  %k.ext = sext i32 %k to i64
+  %q = getelementptr inbounds double* %A, i64 %k.ext
+  store double 1.0, double* %q
+  %k.next = add nsw i32 %k, 1
+  %tail.cond = icmp slt i32 %k.next, 1000
+  br i1 %tail.cond, label %tail, label %exit
+
+exit:
+  ret void
+}
+
+; CHECK: scalar-evolution - Number of getSCEV queries answered from cache
+; CHECK: scalar-evolution - Number of getSCEV queries not in cache
+; CHECK: 3 scalar-evolution - Number of loops whose cached results were released
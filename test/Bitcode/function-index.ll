@@ -0,0 +1,40 @@
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=INDEX
+; RUN: llvm-as -bitcode-function-index=false < %s | llvm-bcanalyzer -dump \
+; RUN:   | FileCheck %s -check-prefix=NOINDEX
+; RUN: llvm-as < %s > %t.bc
+; RUN: llvm-dis -mapped < %t.bc | FileCheck %s
+; RUN: llvm-extract -func=second -S %t.bc | FileCheck %s -check-prefix=EXTRACT
+
+; The function bodies of a module are listed in an index in front of them,
+; which lets the reader find them without walking over every body.
+
+; INDEX: <FNINDEX
+; INDEX: <FUNCTION_BLOCK
+; NOINDEX-NOT: <FNINDEX
+
+declare void @external()
+
+; CHECK: define i32 @first(i32 %x)
+; CHECK: add i32 %x, 1
+define i32 @first(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
+
+; CHECK: define i32 @second(i32 %x)
+; CHECK: mul i32 %x, 2
+; EXTRACT-NOT: define i32 @first
+; EXTRACT: define i32 @second(i32 %x)
+; EXTRACT: mul i32 %x, 2
+define i32 @second(i32 %x) {
+  %y = mul i32 %x, 2
+  call void @external()
+  ret i32 %y
+}
+
+; CHECK: define i32 @third(i32 %x)
+; CHECK: call i32 @first(i32 %x)
+define i32 @third(i32 %x) {
+  %y = call i32 @first(i32 %x)
+  ret i32 %y
+}
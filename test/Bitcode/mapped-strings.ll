@@ -0,0 +1,22 @@
+; RUN: llvm-as < %s | llvm-dis | FileCheck %s
+; RUN: llvm-as < %s > %t.bc
+; RUN: llvm-dis -mapped < %t.bc | FileCheck %s
+; RUN: llvm-dis -load-count=3 -mapped %t.bc | FileCheck %s -check-prefix=LOAD
+
+; Metadata strings and string constants are stored as blobs, which the reader
+; refers to in place when the context owns the buffer.
+
+; CHECK: @plain = constant [6 x i8] c"plain\00"
+@plain = constant [6 x i8] c"plain\00"
+; CHECK: @highbit = constant [4 x i8] c"\C3\A9x\00"
+@highbit = constant [4 x i8] c"\C3\A9x\00"
+; CHECK: @nonull = constant [5 x i8] c"a\00b\00c"
+@nonull = constant [5 x i8] c"a\00b\00c"
+; CHECK: @words = constant [2 x i32] [i32 1, i32 2]
+@words = constant [2 x i32] [i32 1, i32 2]
+
+; CHECK: !0 = metadata !{metadata !"first string", metadata !"\C3\A9", metadata !""}
+!named = !{!0}
+!0 = metadata !{metadata !"first string", metadata !"\C3\A9", metadata !""}
+
+; LOAD: loaded 3 copies of '{{.*}}' in {{.*}}s, heap {{[0-9]+}} KiB
@@ -0,0 +1,69 @@
+; RUN: llc < %s -O0 -mtriple=x86_64-linux -mattr=+sse2 -fast-isel-report-fallbacks -o /dev/null 2>&1 | FileCheck %s
+; RUN: not llc < %s -O0 -mtriple=x86_64-linux -mattr=+sse2 -fast-isel-no-fallback -o /dev/null 2>&1 | FileCheck %s --check-prefix=FAIL
+
+; FastISel leaves floating-point selects, switches with more than one
+; destination besides the default, tail calls and aggregate returns to
+; SelectionDAG.  Names and types that YAML would misread are quoted.
+
+; CHECK: ---
+; CHECK-NEXT: fast-isel-fallbacks:
+; CHECK-NEXT:   - opcode: call
+; CHECK-NEXT:     type: void
+; CHECK-NEXT:     callee: '''it''s'
+; CHECK-NEXT:     count: 1
+; CHECK-NEXT:   - opcode: call
+; CHECK-NEXT:     type: void
+; CHECK-NEXT:     callee: f
+; CHECK-NEXT:     count: 1
+; CHECK-NEXT:   - opcode: ret
+; CHECK-NEXT:     type: '{ i32, i32 }'
+; CHECK-NEXT:     count: 1
+; CHECK-NEXT:   - opcode: select
+; CHECK-NEXT:     type: float
+; CHECK-NEXT:     count: 2
+; CHECK-NEXT:   - opcode: switch
+; CHECK-NEXT:     type: i32
+; CHECK-NEXT:     count: 1
+; CHECK-NEXT: ...
+
+; FAIL: LLVM ERROR: FastISel didn't select: %r = select i1 %c, float %a, float %b
+
+declare void @f()
+declare void @"'it's"()
+
+define float @test1(i1 %c, float %a, float %b) nounwind {
+  %r = select i1 %c, float %a, float %b
+  ret float %r
+}
+
+define float @test2(i1 %c, float %a, float %b) nounwind {
+  %r = select i1 %c, float %a, float %b
+  ret float %r
+}
+
+define i32 @test3(i32 %x) nounwind {
+entry:
+  switch i32 %x, label %d [ i32 1, label %a
+                            i32 2, label %b ]
+a:
+  ret i32 1
+b:
+  ret i32 2
+d:
+  ret i32 0
+}
+
+define void @test4() nounwind {
+  tail call void @f()
+  ret void
+}
+
+define void @test5() nounwind {
+  tail call void @"'it's"()
+  ret void
+}
+
+define { i32, i32 } @test6(i32 %x) nounwind {
+  %r = insertvalue { i32, i32 } undef, i32 %x, 0
+  ret { i32, i32 } %r
+}
@@ -0,0 +1,106 @@
+; RUN: llc < %s -O0 -fast-isel-no-fallback -mtriple=x86_64-linux -mattr=+sse2,-avx | FileCheck %s
+; RUN: llc < %s -O0 -fast-isel-no-fallback -mtriple=x86_64-linux -mattr=+avx | FileCheck %s --check-prefix=AVX
+; RUN: not llc < %s -O2 -fast-isel-no-fallback -mtriple=x86_64-linux 2>&1 | FileCheck %s --check-prefix=NOFASTISEL
+
+; None of these functions may be left to SelectionDAG.
+
+; NOFASTISEL: LLVM ERROR: -fast-isel-no-fallback requires -fast-isel
+
+declare void @llvm.memmove.p0i8.p0i8.i64(i8*, i8*, i64, i32, i1)
+
+define <4 x float> @test1(<4 x float>* %p, <4 x float> %b) nounwind {
+  %a = load <4 x float>* %p, align 16
+  %c = fadd <4 x float> %a, %b
+  store <4 x float> %c, <4 x float>* %p, align 4
+  ret <4 x float> %c
+; CHECK: test1:
+; CHECK: movaps (%rdi), %xmm
+; CHECK: addps
+; CHECK: movups %xmm{{[0-9]+}}, (%rdi)
+; AVX: test1:
+; AVX: vmovaps (%rdi), %xmm
+; AVX: vmovups %xmm{{[0-9]+}}, (%rdi)
+}
+
+define <4 x i32> @test2(<4 x i32>* %p, <4 x i32> %b) nounwind {
+  %a = load <4 x i32>* %p, align 1
+  %c = xor <4 x i32> %a, %b
+  store <4 x i32> %c, <4 x i32>* %p, align 16
+  ret <4 x i32> %c
+; CHECK: test2:
+; CHECK: movdqu (%rdi), %xmm
+; CHECK: pxor
+; CHECK: movdqa %xmm{{[0-9]+}}, (%rdi)
+; AVX: test2:
+; AVX: vmovdqu (%rdi), %xmm
+; AVX: vpxor
+; AVX: vmovdqa %xmm{{[0-9]+}}, (%rdi)
+}
+
+define i32 @test3(i32 %x) nounwind {
+entry:
+  switch i32 %x, label %default [ i32 1, label %case
+                                  i32 5, label %case
+                                  i32 9, label %default ]
+case:
+  ret i32 1
+default:
+  ret i32 0
+; CHECK: test3:
+; CHECK: cmpl $1, %edi
+; CHECK-NEXT: sete
+; CHECK-NEXT: cmpl $5, %edi
+; CHECK-NEXT: sete
+; CHECK-NEXT: orb
+; CHECK-NEXT: testb
+; CHECK-NEXT: jne
+}
+
+define i32 @test4(i16 %x) nounwind {
+entry:
+  switch i16 %x, label %default [ i16 7, label %case ]
+case:
+  ret i32 1
+default:
+  ret i32 0
+; CHECK: test4:
+; CHECK: cmpw $7
+; CHECK-NEXT: je
+}
+
+define void @test5(i8* %a, i8* %b, i64 %n) nounwind {
+  call void @llvm.memmove.p0i8.p0i8.i64(i8* %a, i8* %b, i64 %n, i32 1, i1 false)
+  ret void
+; CHECK: test5:
+; CHECK: callq memmove
+}
+
+define i8 @test6(i1 %c, i8 %a, i8 %b) nounwind {
+  %r = select i1 %c, i8 %a, i8 %b
+  ret i8 %r
+; CHECK: test6:
+; CHECK: testb $1
+; CHECK-NEXT: cmovel
+}
+
+define i1 @test7(i1 %c, i1 %a, i1 %b) nounwind {
+  %r = select i1 %c, i1 %a, i1 %b
+  %s = icmp eq i1 %r, %a
+  ret i1 %s
+; CHECK: test7:
+; CHECK: cmovel
+; CHECK: xorb
+; CHECK-NEXT: xorb $1
+}
+
+define zeroext i1 @test8(i8 %a, i8 %b) nounwind {
+  %r = icmp ult i8 %a, %b
+  %s = icmp ne i1 %r, true
+  ret i1 %s
+; CHECK: test8:
+; CHECK: cmpb
+; CHECK-NEXT: setb
+; CHECK: xorb
+; CHECK: andb $1
+; CHECK: movzbl
+}
@@ -0,0 +1,179 @@
+; RUN: llc < %s -mtriple=x86_64-linux -regalloc=greedy -verify-regalloc | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-linux -regalloc=greedy -verify-regalloc -stats -o /dev/null 2>&1 | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+;
+; An interpreter loop with more live values than registers. The greedy
+; allocator assigns, evicts and splits the values around the calls in %c0 and
+; %c5 many times, which exercises the per-block interference summaries kept by
+; LiveRegMatrix and the InterferenceCache entries that are reused across those
+; assignments. The result must be the same as when every block is recomputed.
+;
+; Values live across the calls are split into callee-saved registers only
+; around the calls.
+; CHECK: interp0:
+; CHECK: %c0
+; CHECK: movl %r8d, %ebx
+; CHECK: movl %r9d, %ebp
+; CHECK: movl %r10d, %r14d
+; CHECK-NEXT: callq callout
+; CHECK-NEXT: movl %r14d, %r10d
+; CHECK-NEXT: movl %ebp, %r9d
+; CHECK-NEXT: movl %ebx, %r8d
+; CHECK: %c1
+; CHECK-NOT: {{%e(bx|bp)|%r1[45]d}}
+; CHECK: %c2
+; CHECK: %c5
+; CHECK: movl %r9d, %r14d
+; CHECK: movl %r10d, %r15d
+; CHECK-NEXT: callq callout
+; CHECK-NEXT: movl %r14d, %r9d
+; The loop counter is spilled in the latch.
+; CHECK: %latch
+; CHECK: movq 56(%rsp), %rax # 8-byte Reload
+; CHECK-NEXT: incq %rax
+; CHECK-NEXT: movq %rax, 56(%rsp) # 8-byte Spill
+; CHECK: ret
+;
+; STATS: 27 regalloc - Number of interferences evicted
+; STATS: 86 regalloc - Number of registers assigned
+; STATS: 31 regalloc - Number of registers unassigned
+; STATS: 23 regalloc - Number of reloads inserted
+; STATS: 15 regalloc - Number of spilled live ranges
+; STATS: 16 regalloc - Number of spills inserted
+; STATS: 8 regalloc - Number of split global live ranges
+
+declare i32 @callout(i32, i32)
+
+define void @interp0(i8* %code, i32* %regs, i32 %n) {
+entry:
+  %a0 = getelementptr i32* %regs, i32 0
+  %i0 = load i32* %a0
+  %a1 = getelementptr i32* %regs, i32 1
+  %i1 = load i32* %a1
+  %a2 = getelementptr i32* %regs, i32 2
+  %i2 = load i32* %a2
+  %a3 = getelementptr i32* %regs, i32 3
+  %i3 = load i32* %a3
+  %a4 = getelementptr i32* %regs, i32 4
+  %i4 = load i32* %a4
+  %a5 = getelementptr i32* %regs, i32 5
+  %i5 = load i32* %a5
+  %a6 = getelementptr i32* %regs, i32 6
+  %i6 = load i32* %a6
+  %a7 = getelementptr i32* %regs, i32 7
+  %i7 = load i32* %a7
+  %a8 = getelementptr i32* %regs, i32 8
+  %i8 = load i32* %a8
+  %a9 = getelementptr i32* %regs, i32 9
+  %i9 = load i32* %a9
+  %a10 = getelementptr i32* %regs, i32 10
+  %i10 = load i32* %a10
+  %a11 = getelementptr i32* %regs, i32 11
+  %i11 = load i32* %a11
+  %a12 = getelementptr i32* %regs, i32 12
+  %i12 = load i32* %a12
+  %a13 = getelementptr i32* %regs, i32 13
+  %i13 = load i32* %a13
+  %a14 = getelementptr i32* %regs, i32 14
+  %i14 = load i32* %a14
+  %a15 = getelementptr i32* %regs, i32 15
+  %i15 = load i32* %a15
+  br label %loop
+loop:
+  %pc = phi i32 [ 0, %entry ], [ %pc.next, %latch ]
+  %v0 = phi i32 [ %i0, %entry ], [ %n0, %latch ]
+  %v1 = phi i32 [ %i1, %entry ], [ %n1, %latch ]
+  %v2 = phi i32 [ %i2, %entry ], [ %n2, %latch ]
+  %v3 = phi i32 [ %i3, %entry ], [ %n3, %latch ]
+  %v4 = phi i32 [ %i4, %entry ], [ %n4, %latch ]
+  %v5 = phi i32 [ %i5, %entry ], [ %n5, %latch ]
+  %v6 = phi i32 [ %i6, %entry ], [ %n6, %latch ]
+  %v7 = phi i32 [ %i7, %entry ], [ %n7, %latch ]
+  %v8 = phi i32 [ %i8, %entry ], [ %n8, %latch ]
+  %v9 = phi i32 [ %i9, %entry ], [ %n9, %latch ]
+  %v10 = phi i32 [ %i10, %entry ], [ %n10, %latch ]
+  %v11 = phi i32 [ %i11, %entry ], [ %n11, %latch ]
+  %v12 = phi i32 [ %i12, %entry ], [ %n12, %latch ]
+  %v13 = phi i32 [ %i13, %entry ], [ %n13, %latch ]
+  %v14 = phi i32 [ %i14, %entry ], [ %n14, %latch ]
+  %v15 = phi i32 [ %i15, %entry ], [ %n15, %latch ]
+  %ip = getelementptr i8* %code, i32 %pc
+  %op = load i8* %ip
+  switch i8 %op, label %latch [
+    i8 -128, label %c0
+    i8 -127, label %c1
+    i8 -126, label %c2
+    i8 -125, label %c3
+    i8 -124, label %c4
+    i8 -123, label %c5
+  ]
+c0:
+  %r0.0 = call i32 @callout(i32 %v0, i32 %v2)
+  %r0.1 = sub i32 %v1, %v15
+  %r0.2 = xor i32 %v2, %v12
+  br label %latch
+c1:
+  %r1.0 = sub i32 %v3, %v9
+  %r1.1 = xor i32 %v4, %v6
+  %r1.2 = mul i32 %v5, %v3
+  br label %latch
+c2:
+  %r2.0 = xor i32 %v6, %v0
+  %r2.1 = mul i32 %v7, %v13
+  %r2.2 = and i32 %v8, %v10
+  br label %latch
+c3:
+  %r3.0 = mul i32 %v9, %v7
+  %r3.1 = and i32 %v10, %v4
+  %r3.2 = or i32 %v11, %v1
+  br label %latch
+c4:
+  %r4.0 = and i32 %v12, %v14
+  %r4.1 = or i32 %v13, %v11
+  %r4.2 = add i32 %v14, %v8
+  br label %latch
+c5:
+  %r5.0 = call i32 @callout(i32 %v15, i32 %v5)
+  %r5.1 = add i32 %v0, %v2
+  %r5.2 = sub i32 %v1, %v15
+  br label %latch
+latch:
+  %n0 = phi i32 [ %v0, %loop ], [ %v0, %c0 ], [ %v0, %c1 ], [ %v0, %c2 ], [ %r3.0, %c3 ], [ %r4.1, %c4 ], [ %r5.2, %c5 ]
+  %n1 = phi i32 [ %v1, %loop ], [ %r0.0, %c0 ], [ %r1.1, %c1 ], [ %r2.2, %c2 ], [ %v1, %c3 ], [ %v1, %c4 ], [ %v1, %c5 ]
+  %n2 = phi i32 [ %v2, %loop ], [ %v2, %c0 ], [ %v2, %c1 ], [ %v2, %c2 ], [ %v2, %c3 ], [ %v2, %c4 ], [ %v2, %c5 ]
+  %n3 = phi i32 [ %v3, %loop ], [ %v3, %c0 ], [ %v3, %c1 ], [ %v3, %c2 ], [ %v3, %c3 ], [ %v3, %c4 ], [ %v3, %c5 ]
+  %n4 = phi i32 [ %v4, %loop ], [ %v4, %c0 ], [ %v4, %c1 ], [ %v4, %c2 ], [ %v4, %c3 ], [ %v4, %c4 ], [ %v4, %c5 ]
+  %n5 = phi i32 [ %v5, %loop ], [ %v5, %c0 ], [ %v5, %c1 ], [ %v5, %c2 ], [ %v5, %c3 ], [ %r4.0, %c4 ], [ %r5.1, %c5 ]
+  %n6 = phi i32 [ %v6, %loop ], [ %v6, %c0 ], [ %r1.0, %c1 ], [ %r2.1, %c2 ], [ %r3.2, %c3 ], [ %v6, %c4 ], [ %v6, %c5 ]
+  %n7 = phi i32 [ %v7, %loop ], [ %r0.2, %c0 ], [ %v7, %c1 ], [ %v7, %c2 ], [ %v7, %c3 ], [ %v7, %c4 ], [ %v7, %c5 ]
+  %n8 = phi i32 [ %v8, %loop ], [ %v8, %c0 ], [ %v8, %c1 ], [ %v8, %c2 ], [ %v8, %c3 ], [ %v8, %c4 ], [ %v8, %c5 ]
+  %n9 = phi i32 [ %v9, %loop ], [ %v9, %c0 ], [ %v9, %c1 ], [ %v9, %c2 ], [ %v9, %c3 ], [ %v9, %c4 ], [ %v9, %c5 ]
+  %n10 = phi i32 [ %v10, %loop ], [ %v10, %c0 ], [ %v10, %c1 ], [ %v10, %c2 ], [ %v10, %c3 ], [ %v10, %c4 ], [ %r5.0, %c5 ]
+  %n11 = phi i32 [ %v11, %loop ], [ %v11, %c0 ], [ %v11, %c1 ], [ %r2.0, %c2 ], [ %r3.1, %c3 ], [ %r4.2, %c4 ], [ %v11, %c5 ]
+  %n12 = phi i32 [ %v12, %loop ], [ %r0.1, %c0 ], [ %r1.2, %c1 ], [ %v12, %c2 ], [ %v12, %c3 ], [ %v12, %c4 ], [ %v12, %c5 ]
+  %n13 = phi i32 [ %v13, %loop ], [ %v13, %c0 ], [ %v13, %c1 ], [ %v13, %c2 ], [ %v13, %c3 ], [ %v13, %c4 ], [ %v13, %c5 ]
+  %n14 = phi i32 [ %v14, %loop ], [ %v14, %c0 ], [ %v14, %c1 ], [ %v14, %c2 ], [ %v14, %c3 ], [ %v14, %c4 ], [ %v14, %c5 ]
+  %n15 = phi i32 [ %v15, %loop ], [ %v15, %c0 ], [ %v15, %c1 ], [ %v15, %c2 ], [ %v15, %c3 ], [ %v15, %c4 ], [ %v15, %c5 ]
+  %pc.next = add i32 %pc, 1
+  %cond = icmp slt i32 %pc.next, %n
+  br i1 %cond, label %loop, label %exit
+exit:
+  store i32 %n0, i32* %a0
+  store i32 %n1, i32* %a1
+  store i32 %n2, i32* %a2
+  store i32 %n3, i32* %a3
+  store i32 %n4, i32* %a4
+  store i32 %n5, i32* %a5
+  store i32 %n6, i32* %a6
+  store i32 %n7, i32* %a7
+  store i32 %n8, i32* %a8
+  store i32 %n9, i32* %a9
+  store i32 %n10, i32* %a10
+  store i32 %n11, i32* %a11
+  store i32 %n12, i32* %a12
+  store i32 %n13, i32* %a13
+  store i32 %n14, i32* %a14
+  store i32 %n15, i32* %a15
+  ret void
+}
+
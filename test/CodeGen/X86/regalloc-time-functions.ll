@@ -0,0 +1,24 @@
+; RUN: llc < %s -mtriple=x86_64-linux -regalloc=greedy -regalloc-time-functions -o /dev/null 2>&1 | FileCheck %s
+; The greedy allocator reports the time it spent on each function.
+
+; CHECK: regalloc: {{.*}}s user {{.*}}s wall {{ *[0-9]+}} blocks {{.*}} vregs  f
+; CHECK: regalloc: {{.*}}s user {{.*}}s wall {{ *[0-9]+}} blocks {{.*}} vregs  g
+
+define i32 @f(i32 %a, i32 %b) nounwind {
+  %c = add i32 %a, %b
+  ret i32 %c
+}
+
+define i32 @g(i32 %a, i32 %b) nounwind {
+entry:
+  %c = icmp slt i32 %a, %b
+  br i1 %c, label %then, label %exit
+
+then:
+  %d = mul i32 %a, %b
+  br label %exit
+
+exit:
+  %r = phi i32 [ %a, %entry ], [ %d, %then ]
+  ret i32 %r
+}
@@ -0,0 +1,27 @@
+; RUN: rm -rf %t.cache
+; RUN: %lli -mtriple=%mcjit_triple -use-mcjit -object-cache-dir=%t.cache %s | FileCheck %s
+; RUN: ls %t.cache | FileCheck %s -check-prefix=FILES
+; RUN: %lli -mtriple=%mcjit_triple -use-mcjit -object-cache-dir=%t.cache %s | FileCheck %s
+; RUN: ls %t.cache | FileCheck %s -check-prefix=FILES
+; RUN: %lli -mtriple=%mcjit_triple -use-mcjit -O0 -object-cache-dir=%t.cache %s | FileCheck %s
+; RUN: ls %t.cache | FileCheck %s -check-prefix=OPTS
+
+; The second run loads the object stored by the first one.  Changing the
+; code generation options adds another object.
+
+; CHECK: cached hello
+; FILES: {{^[0-9a-f]+\.o$}}
+; FILES-NOT: .o
+; OPTS: {{^[0-9a-f]+\.o$}}
+; OPTS-NEXT: {{^[0-9a-f]+\.o$}}
+; OPTS-NOT: .o
+
+@.str = private unnamed_addr constant [13 x i8] c"cached hello\00"
+
+declare i32 @puts(i8*)
+
+define i32 @main() {
+entry:
+  %call = call i32 @puts(i8* getelementptr inbounds ([13 x i8]* @.str, i32 0, i32 0))
+  ret i32 0
+}
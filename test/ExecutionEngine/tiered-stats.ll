@@ -0,0 +1,54 @@
+; RUN: %lli -jit-tiered -jit-wait-for-tier-ups -stats %s 2> %t.stats \
+; RUN:   | FileCheck %s
+; RUN: FileCheck -check-prefix=TIERED %s < %t.stats
+; RUN: %lli -jit-tiered -jit-tier-up-queue=0 -stats %s 2> %t.dropped \
+; RUN:   | FileCheck %s
+; RUN: FileCheck -check-prefix=DROPPED %s < %t.dropped
+; REQUIRES: asserts
+
+; Every function is compiled at -O0, using FastISel, before it's recompiled in
+; the background, unless the queue is full.
+
+; CHECK: sum = 4950
+
+; TIERED: {{[0-9]+}} isel - Number of blocks selected entirely by fast isel
+; TIERED: 3 jit - Number of functions compiled at -O0 first
+; TIERED: 3 jit - Number of functions recompiled in the background
+
+; DROPPED: {{[0-9]+}} isel - Number of blocks selected entirely by fast isel
+; DROPPED: 3 jit - Number of functions compiled at -O0 first
+; DROPPED: 3 jit - Number of functions not recompiled because the queue was full
+; DROPPED-NOT: recompiled in the background
+
+@.str = private unnamed_addr constant [10 x i8] c"sum = %d\0A\00"
+
+declare i32 @printf(i8*, ...)
+
+define internal i32 @add(i32 %a, i32 %b) {
+entry:
+  %r = add i32 %a, %b
+  ret i32 %r
+}
+
+define internal i32 @sum(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %acc.next = call i32 @add(i32 %acc, i32 %i)
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %acc.next
+}
+
+define i32 @main() {
+entry:
+  %s = call i32 @sum(i32 100)
+  %c = call i32 (i8*, ...)* @printf(i8* getelementptr inbounds ([10 x i8]* @.str, i32 0, i32 0), i32 %s)
+  ret i32 0
+}
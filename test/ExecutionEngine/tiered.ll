@@ -0,0 +1,42 @@
+; RUN: %lli -jit-tiered %s | FileCheck %s
+; RUN: %lli -jit-tiered -jit-tier-up-queue=0 %s | FileCheck %s
+; RUN: %lli -jit-tiered -disable-lazy-compilation %s | FileCheck %s
+; RUN: %lli -jit-tiered -jit-wait-for-tier-ups %s | FileCheck %s
+
+; The functions are compiled quickly first and may be replaced by their
+; recompiled versions while the loop is running.
+
+; CHECK: sum = 1999000
+
+@.str = private unnamed_addr constant [10 x i8] c"sum = %d\0A\00"
+
+declare i32 @printf(i8*, ...)
+
+define internal i32 @add(i32 %a, i32 %b) {
+entry:
+  %r = add i32 %a, %b
+  ret i32 %r
+}
+
+define internal i32 @sum(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %acc.next = call i32 @add(i32 %acc, i32 %i)
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %acc.next
+}
+
+define i32 @main() {
+entry:
+  %s = call i32 @sum(i32 2000)
+  %c = call i32 (i8*, ...)* @printf(i8* getelementptr inbounds ([10 x i8]* @.str, i32 0, i32 0), i32 %s)
+  ret i32 0
+}
@@ -0,0 +1,93 @@
+; Code generation in several partitions must not depend on how the threads
+; are scheduled, and must define the same symbols as a single partition.
+;
+; RUN: llvm-as < %s > %t.bc
+; RUN: llvm-lto -exported-symbol=main -exported-symbol=g -o %t.one %t.bc
+; RUN: llvm-lto -exported-symbol=main -exported-symbol=g -parallelism=3 \
+; RUN:   -o %t.a %t.bc
+; RUN: llvm-lto -exported-symbol=main -exported-symbol=g -parallelism=3 \
+; RUN:   -o %t.b %t.bc
+; RUN: cmp %t.a.0 %t.b.0
+; RUN: cmp %t.a.1 %t.b.1
+; RUN: cmp %t.a.2 %t.b.2
+; RUN: llvm-nm %t.one | FileCheck -check-prefix=ONE %s
+; RUN: llvm-nm %t.a.0 %t.a.1 %t.a.2 | FileCheck -check-prefix=PARTS %s
+; RUN: llvm-nm %t.a.0 %t.a.1 %t.a.2 | FileCheck -check-prefix=EACH %s
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; ONE: t f0
+; ONE: t f1
+; ONE: t f2
+; ONE: t f3
+; ONE: t f4
+; ONE: t f5
+; ONE: B g
+; ONE: T main
+
+; The partitions define the same symbols between them. Internal functions
+; that are referenced from another partition get a unique global name.
+; PARTS: .a.0:
+; PARTS-DAG: {{[tT]}} f0{{(\.lto_priv)?$}}
+; PARTS-DAG: {{[tT]}} f1{{(\.lto_priv)?$}}
+; PARTS-DAG: {{[tT]}} f2{{(\.lto_priv)?$}}
+; PARTS-DAG: {{[tT]}} f3{{(\.lto_priv)?$}}
+; PARTS-DAG: {{[tT]}} f4{{(\.lto_priv)?$}}
+; PARTS-DAG: {{[tT]}} f5{{(\.lto_priv)?$}}
+; PARTS-DAG: B g
+; PARTS-DAG: T main
+
+; Every partition defines something.
+; EACH: .a.0:
+; EACH: {{^[0-9a-f]+ [tTB] }}
+; EACH: .a.1:
+; EACH: {{^[0-9a-f]+ [tTB] }}
+; EACH: .a.2:
+; EACH: {{^[0-9a-f]+ [tTB] }}
+
+@g = global i32 0
+
+define i32 @f0(i32 %x) noinline {
+  %a = mul i32 %x, 7
+  %b = add i32 %a, 1
+  store i32 %b, i32* @g
+  ret i32 %b
+}
+
+define i32 @f1(i32 %x) noinline {
+  %a = call i32 @f0(i32 %x)
+  %b = xor i32 %a, %x
+  ret i32 %b
+}
+
+define i32 @f2(i32 %x) noinline {
+  %a = call i32 @f1(i32 %x)
+  %b = mul i32 %a, %a
+  ret i32 %b
+}
+
+define i32 @f3(i32 %x) noinline {
+  %a = call i32 @f2(i32 %x)
+  %b = sub i32 %a, 3
+  ret i32 %b
+}
+
+define i32 @f4(i32 %x) noinline {
+  %a = call i32 @f3(i32 %x)
+  %b = shl i32 %a, 2
+  ret i32 %b
+}
+
+define i32 @f5(i32 %x) noinline {
+  %a = call i32 @f4(i32 %x)
+  %b = call i32 @f0(i32 %a)
+  ret i32 %b
+}
+
+define i32 @main() {
+  %a = call i32 @f5(i32 3)
+  %b = load i32* @g
+  %c = add i32 %a, %b
+  ret i32 %c
+}
@@ -0,0 +1,55 @@
+; RUN: echo "declare void @root()" | llvm-as -o %t1.bc
+; RUN: llvm-as %s -o %t2.bc
+; RUN: llvm-link %t1.bc %t2.bc -S | FileCheck %s
+
+; Local and linkonce functions are only linked in if they are reachable from
+; the external definitions, global initializers or aliases.
+
+@fnptr = global void ()* bitcast (i32 ()* @from_initializer to void ()*)
+
+@alias = alias internal void ()* @from_alias
+
+define void @root() {
+  call void @internal_a()
+  ret void
+}
+
+define internal void @internal_a() {
+  call void @internal_b()
+  ret void
+}
+
+define internal void @internal_b() {
+  call void bitcast (void (i32)* @linkonce_c to void ()*)()
+  ret void
+}
+
+define linkonce void @linkonce_c(i32 %x) {
+  ret void
+}
+
+define internal i32 @from_initializer() {
+  ret i32 0
+}
+
+define internal void @from_alias() {
+  call void @alias()
+  ret void
+}
+
+define internal void @dead() {
+  call void @dead_too()
+  ret void
+}
+
+define linkonce_odr void @dead_too() {
+  ret void
+}
+
+; CHECK: define void @root()
+; CHECK: define internal void @internal_a()
+; CHECK: define internal void @internal_b()
+; CHECK: define linkonce void @linkonce_c(i32 %x)
+; CHECK: define internal i32 @from_initializer()
+; CHECK: define internal void @from_alias()
+; CHECK-NOT: @dead
@@ -0,0 +1,31 @@
+# RUN: llvm-mc -filetype=obj -triple x86_64-linux-gnu %s | llvm-objdump -d - | FileCheck %s
+
+# Jumps that only go out of range once other jumps have been relaxed must be
+# relaxed as well, while unaffected jumps keep their short form.
+
+# The first jump fits until the second one is relaxed.
+# CHECK:   0: e9 80 00 00 00 jmpq 128
+# CHECK:   5: e9 cb 00 00 00 jmpq 203
+	.text
+	jmp	a_target
+	jmp	b_target
+	.fill	123, 1, 0x90
+a_target:
+	.fill	80, 1, 0x90
+b_target:
+
+# CHECK:  d5: eb 01 jmp 1
+	jmp	e_target
+	nop
+e_target:
+
+# The backward jump fits until the forward jump after its target is relaxed.
+# CHECK:  d8: e9 01 01 00 00 jmpq 257
+# CHECK: 157: e9 7c ff ff ff jmpq -132
+c_target:
+	jmp	d_target
+	.fill	122, 1, 0x90
+	jmp	c_target
+	.fill	130, 1, 0x90
+d_target:
+	ret
@@ -0,0 +1,117 @@
+; Running function passes on several threads must give the same result as a
+; single thread. InstCombine, GVN and SimplifyCFG look at the users of shared
+; values, so a pipeline with them runs serially; SROA runs in parallel.
+; RUN: opt -S -basicaa -instcombine -gvn -sroa -simplifycfg %s > %t.serial
+; RUN: opt -S -function-threads=4 -basicaa -instcombine -gvn -sroa -simplifycfg \
+; RUN:   %s > %t.parallel
+; RUN: diff %t.serial %t.parallel
+; RUN: FileCheck %s < %t.parallel
+; RUN: opt -S -basicaa -sroa %s > %t.sroa.serial
+; RUN: opt -S -function-threads=4 -basicaa -sroa %s > %t.sroa.parallel
+; RUN: diff %t.sroa.serial %t.sroa.parallel
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+%pair = type { i32, i32 }
+
+@hello = private constant [7 x i8] c"hello\0A\00"
+@world = private constant [7 x i8] c"world\0A\00"
+@counter = global i32 0
+
+declare i32 @printf(i8*, ...)
+
+; CHECK: define i32 @sum
+define i32 @sum(i32 %a, i32 %b) {
+entry:
+  %p = alloca %pair
+  %pa = getelementptr %pair* %p, i32 0, i32 0
+  %pb = getelementptr %pair* %p, i32 0, i32 1
+  store i32 %a, i32* %pa
+  store i32 %b, i32* %pb
+  %x = load i32* %pa
+  %y = load i32* %pb
+  %s = add i32 %x, %y
+  %t = add i32 %s, 0
+  ret i32 %t
+}
+
+; CHECK: define void @greet
+; CHECK: call i32 @puts
+define void @greet() {
+entry:
+  %r = call i32 (i8*, ...)* @printf(i8* getelementptr ([7 x i8]* @hello, i32 0, i32 0))
+  ret void
+}
+
+; CHECK: define i32 @redundant
+define i32 @redundant(i32* %p, i1 %c) {
+entry:
+  %a = load i32* %p
+  br i1 %c, label %then, label %join
+
+then:
+  %b = load i32* %p
+  %m = mul i32 %b, 8
+  br label %join
+
+join:
+  %v = phi i32 [ %a, %entry ], [ %m, %then ]
+  %w = load i32* %p
+  %r = add i32 %v, %w
+  ret i32 %r
+}
+
+; CHECK: define void @greet_again
+; CHECK: call i32 @puts
+define void @greet_again() {
+entry:
+  %r = call i32 (i8*, ...)* @printf(i8* getelementptr ([7 x i8]* @world, i32 0, i32 0))
+  ret void
+}
+
+; CHECK: define i32 @count
+define i32 @count(i32 %n) {
+entry:
+  %old = load i32* @counter
+  %new = add i32 %old, %n
+  store i32 %new, i32* @counter
+  %again = load i32* @counter
+  %c = icmp eq i32 %n, 0
+  br i1 %c, label %zero, label %done
+
+zero:
+  br label %done
+
+done:
+  %r = phi i32 [ 0, %zero ], [ %again, %entry ]
+  ret i32 %r
+}
+
+; CHECK: define i64 @widen
+define i64 @widen(i32 %x) {
+entry:
+  %a = zext i32 %x to i64
+  %b = shl i64 %a, 32
+  %c = lshr i64 %b, 32
+  %d = and i64 %c, 4294967295
+  ret i64 %d
+}
+
+; CHECK: define float @fold_float
+define float @fold_float() {
+entry:
+  %a = fadd float 1.5, 2.5
+  %b = fmul float %a, 2.0
+  ret float %b
+}
+
+; CHECK: define void @fill
+define void @fill(i8* %dst) {
+entry:
+  call void @llvm.memset.p0i8.i64(i8* %dst, i8 0, i64 8, i32 8, i1 false)
+  ret void
+}
+
+; CHECK: declare i32 @puts
+declare void @llvm.memset.p0i8.i64(i8*, i8, i64, i32, i1)
@@ -0,0 +1,46 @@
+; RUN: opt < %s -instcombine -loop-rotate -inline -pass-profile=%t -disable-output
+; RUN: FileCheck %s < %t
+; RUN: opt < %s -instcombine -loop-rotate -inline -pass-profile=%t.2 \
+; RUN:   -pass-profile-slowest=1 -disable-output
+; RUN: FileCheck %s -check-prefix=SLOWEST < %t.2
+
+; CHECK: ---
+; CHECK: total-wall-time:
+; CHECK: num-entries:
+; CHECK: passes:
+; CHECK: - pass: {{.*}}
+; CHECK-NEXT: function: {{.*}}
+; CHECK-NEXT: runs: {{[0-9]+}}
+; CHECK-NEXT: wall-time:
+; CHECK-NEXT: user-time:
+; CHECK-NEXT: instructions: {{[0-9]+}}
+; CHECK-NEXT: malloc-bytes: {{[0-9]+}}
+; CHECK-NEXT: bump-ptr-bytes: {{[0-9]+}}
+
+; SLOWEST: passes:
+; SLOWEST: - pass:
+; SLOWEST-NOT: - pass:
+; SLOWEST: ...
+
+define i32 @square(i32 %x) {
+entry:
+  %m = mul i32 %x, %x
+  ret i32 %m
+}
+
+define i32 @sum(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %loop ]
+  %sq = call i32 @square(i32 %i)
+  %s.next = add i32 %s, %sq
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret i32 %s.next
+}
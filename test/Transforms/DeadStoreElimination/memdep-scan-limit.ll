@@ -0,0 +1,18 @@
+; RUN: opt < %s -basicaa -dse -S | FileCheck %s
+; RUN: opt < %s -basicaa -dse -dse-memdep-scan-limit=4 -S \
+; RUN:   | FileCheck %s -check-prefix=LIMIT
+
+define void @f(i32* %p, i32* noalias %a, i32* noalias %b, i32* noalias %c) {
+entry:
+  store i32 0, i32* %p
+  store i32 1, i32* %a
+  store i32 1, i32* %b
+  store i32 1, i32* %c
+  store i32 1, i32* %p
+  ret void
+; CHECK: @f
+; CHECK-NOT: store i32 0, i32* %p
+; CHECK: store i32 1, i32* %p
+; LIMIT: @f
+; LIMIT: store i32 0, i32* %p
+}
@@ -0,0 +1,51 @@
+; RUN: opt < %s -basicaa -gvn -S | FileCheck %s
+; RUN: opt < %s -basicaa -gvn -gvn-memdep-scan-limit=11 -S | FileCheck %s
+; RUN: opt < %s -basicaa -gvn -gvn-memdep-scan-limit=10 -S \
+; RUN:   | FileCheck %s -check-prefix=PARTIAL
+; RUN: opt < %s -basicaa -gvn -gvn-memdep-scan-limit=9 -S \
+; RUN:   | FileCheck %s -check-prefix=LIMIT
+; RUN: opt < %s -basicaa -gvn -memdep-block-scan-limit=9 -S \
+; RUN:   | FileCheck %s -check-prefix=LIMIT
+; RUN: opt < %s -basicaa -gvn -memdep-block-index-threshold=1 -S \
+; RUN:   | FileCheck %s
+; RUN: opt < %s -basicaa -gvn -memdep-block-index-threshold=1 \
+; RUN:   -gvn-memdep-scan-limit=11 -S | FileCheck %s
+; RUN: opt < %s -basicaa -gvn -memdep-block-index-threshold=1 \
+; RUN:   -gvn-memdep-scan-limit=10 -S | FileCheck %s -check-prefix=PARTIAL
+; RUN: opt < %s -basicaa -gvn -memdep-block-index-threshold=1 \
+; RUN:   -gvn-memdep-scan-limit=9 -S | FileCheck %s -check-prefix=LIMIT
+
+; The scan limit counts every instruction, including the adds, whether or not
+; the block has been indexed.  The scan for %v indexes the block.  When %w is
+; scanned, %v has been removed, so %w is 10 instructions after the store to %q
+; although the index recorded 11.
+
+define i32 @f(i32* %p, i32* noalias %q, i32* noalias %a, i32* noalias %b,
+              i32* noalias %c, i32 %x, i32 %y) {
+entry:
+  store i32 %y, i32* %q
+  store i32 %x, i32* %p
+  %x1 = add i32 %x, 1
+  %x2 = add i32 %x1, 1
+  %x3 = add i32 %x2, 1
+  %x4 = add i32 %x3, 1
+  %x5 = add i32 %x4, 1
+  store i32 %x5, i32* %a
+  store i32 %x5, i32* %b
+  store i32 %x5, i32* %c
+  %v = load i32* %p
+  %w = load i32* %q
+  %r = add i32 %v, %w
+  ret i32 %r
+; CHECK: @f
+; CHECK-NOT: load
+; CHECK: %r = add i32 %x, %y
+; PARTIAL: @f
+; PARTIAL-NOT: %v = load
+; PARTIAL: %w = load i32* %q
+; PARTIAL: %r = add i32 %x, %w
+; LIMIT: @f
+; LIMIT: %v = load i32* %p
+; LIMIT: %w = load i32* %q
+; LIMIT: %r = add i32 %v, %w
+}
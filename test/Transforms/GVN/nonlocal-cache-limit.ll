@@ -0,0 +1,33 @@
+; RUN: opt < %s -basicaa -gvn -memdep-nonlocal-cache-limit=1 -stats -S 2>&1 \
+; RUN:   | FileCheck %s
+; REQUIRES: asserts
+
+; Evicting non-local dependencies from the cache doesn't change the result.
+
+define i32 @f(i1 %cond, i32* noalias %p, i32* noalias %q) {
+entry:
+  br i1 %cond, label %left, label %right
+
+left:
+  store i32 1, i32* %p
+  store i32 2, i32* %q
+  br label %join
+
+right:
+  store i32 3, i32* %p
+  store i32 4, i32* %q
+  br label %join
+
+join:
+  %x = load i32* %p
+  %y = load i32* %q
+  %s = add i32 %x, %y
+  ret i32 %s
+; CHECK: join:
+; CHECK-NEXT: phi i32 [ 4, %right ], [ 2, %left ]
+; CHECK-NEXT: phi i32 [ 3, %right ], [ 1, %left ]
+; CHECK-NOT: load
+; CHECK: ret i32
+}
+
+; CHECK: 2 memdep {{.*}} Number of non-local ptr responses evicted
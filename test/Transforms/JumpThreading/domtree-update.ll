@@ -0,0 +1,56 @@
+; RUN: opt -domtree -jump-threading -verify-dom-info -verify-dom-updates -analyze -domtree < %s | FileCheck %s
+; Jump threading keeps the dominator tree up to date instead of discarding it.
+
+declare i32 @f1()
+declare i32 @f2()
+declare void @f3()
+
+; Threading the edges from %T1 and %F1 across %Merge leaves %T2 and %F2 with
+; a single predecessor each, and they are merged into it.
+; CHECK: Printing analysis 'Jump Threading' for function 'test1':
+; CHECK: Printing analysis 'Dominator Tree Construction' for function 'test1':
+; CHECK: [1] %entry
+; CHECK-NEXT: [2] %T2
+; CHECK-NEXT: [2] %F2
+; CHECK-NEXT: Printing analysis
+define i32 @test1(i1 %cond) {
+entry:
+	br i1 %cond, label %T1, label %F1
+
+T1:
+	%v1 = call i32 @f1()
+	br label %Merge
+
+F1:
+	%v2 = call i32 @f2()
+	br label %Merge
+
+Merge:
+	%A = phi i1 [true, %T1], [false, %F1]
+	%B = phi i32 [%v1, %T1], [%v2, %F1]
+	br i1 %A, label %T2, label %F2
+
+T2:
+	call void @f3()
+	ret i32 %B
+
+F2:
+	ret i32 %B
+}
+
+; A branch on a constant goes away, %dead becomes unreachable and %live is
+; merged into the entry block.
+; CHECK: Printing analysis 'Jump Threading' for function 'test2':
+; CHECK: Printing analysis 'Dominator Tree Construction' for function 'test2':
+; CHECK: [1] %live
+; CHECK-NOT: [
+define i32 @test2() {
+entry:
+	br i1 true, label %live, label %dead
+
+live:
+	ret i32 1
+
+dead:
+	ret i32 2
+}
@@ -0,0 +1,44 @@
+; RUN: opt -domtree -simplifycfg -verify-dom-info -verify-dom-updates -analyze -domtree < %s | FileCheck %s
+; SimplifyCFG keeps the dominator tree up to date instead of discarding it.
+
+declare void @f()
+declare i1 @g()
+
+; %empty is folded into its predecessors, %a and %b into %entry, %merge into
+; %join, and %dead is removed.
+; CHECK: Printing analysis 'Simplify the CFG' for function 'test1':
+; CHECK: Printing analysis 'Dominator Tree Construction' for function 'test1':
+; CHECK: [1] %entry
+; CHECK-NEXT: [2] %join
+; CHECK-NEXT: [2] %exit
+; CHECK-NOT: [
+define void @test1() {
+entry:
+  %x = call i1 @g()
+  br i1 %x, label %a, label %b
+
+a:
+  %y = call i1 @g()
+  br i1 %y, label %empty, label %join
+
+b:
+  %z = call i1 @g()
+  br i1 %z, label %empty, label %exit
+
+empty:
+  br label %join
+
+join:
+  call void @f()
+  br label %merge
+
+merge:
+  call void @f()
+  br label %exit
+
+exit:
+  ret void
+
+dead:
+  br label %join
+}
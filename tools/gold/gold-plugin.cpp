@@ -77,6 +77,7 @@ namespace options {
   static std::string extra_library_path;
   static std::string triple;
   static std::string mcpu;
+  static unsigned parallelism = 1;
   // Additional options to pass into the code generator.
   // Note: This array will contain all plugin options which are not claimed
   // as plugin exclusive to pass to the code generator.
@@ -98,6 +99,12 @@ namespace options {
       extra_library_path = opt.substr(strlen("extra_library_path="));
     } else if (opt.startswith("mtriple=")) {
       triple = opt.substr(strlen("mtriple="));
+    } else if (opt.startswith("parallelism=")) {
+      if (opt.substr(strlen("parallelism=")).getAsInteger(10, parallelism) ||
+          parallelism == 0) {
+        (*message)(LDPL_WARNING, "Invalid parallelism. Discarding %s", opt_);
+        parallelism = 1;
+      }
     } else if (opt.startswith("obj-path=")) {
       obj_path = opt.substr(strlen("obj-path="));
     } else if (opt == "emit-llvm") {
@@ -420,9 +427,16 @@ static ld_plugin_status all_symbols_read_hook(void) {
     if (options::generate_bc_file == options::BC_ONLY)
       exit(0);
   }
-  const char *objPath;
-  if (lto_codegen_compile_to_file(code_gen, &objPath)) {
+  lto_codegen_set_parallelism(code_gen, options::parallelism);
+
+  // The names are owned by code_gen, so copy them before disposing of it.
+  std::vector<std::string> objPaths;
+  const char *const *names;
+  unsigned numNames;
+  if (lto_codegen_compile_to_files(code_gen, &names, &numNames)) {
     (*message)(LDPL_ERROR, "Could not produce a combined object file\n");
+  } else {
+    objPaths.assign(names, names + numNames);
   }
 
   lto_codegen_dispose(code_gen);
@@ -434,10 +448,13 @@ static ld_plugin_status all_symbols_read_hook(void) {
     }
   }
 
-  if ((*add_input_file)(objPath) != LDPS_OK) {
-    (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
-    (*message)(LDPL_ERROR, "File left behind in: %s", objPath);
-    return LDPS_ERR;
+  for (unsigned i = 0, e = objPaths.size(); i != e; ++i) {
+    const char *objPath = objPaths[i].c_str();
+    if ((*add_input_file)(objPath) != LDPS_OK) {
+      (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
+      (*message)(LDPL_ERROR, "File left behind in: %s", objPath);
+      return LDPS_ERR;
+    }
   }
 
   if (!options::extra_library_path.empty() &&
@@ -447,7 +464,8 @@ static ld_plugin_status all_symbols_read_hook(void) {
   }
 
   if (options::obj_path.empty())
-    Cleanup.push_back(sys::Path(objPath));
+    for (unsigned i = 0, e = objPaths.size(); i != e; ++i)
+      Cleanup.push_back(sys::Path(objPaths[i]));
 
   return LDPS_OK;
 }
@@ -26,6 +26,7 @@
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/JITMemoryManager.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
@@ -77,6 +78,12 @@ namespace {
     cl::desc("Execute MCJIT'ed code in a separate process."),
     cl::init(false));
 
+  // Reuse the object code MCJIT generated for the same module and options in
+  // an earlier run.
+  cl::opt<std::string> ObjectCacheDir("object-cache-dir",
+    cl::desc("Cache MCJIT'ed objects in this directory"),
+    cl::value_desc("directory"));
+
   // Determine optimization level.
   cl::opt<char>
   OptLevel("O",
@@ -126,6 +133,24 @@ namespace {
                   cl::desc("Disable JIT lazy compilation"),
                   cl::init(false));
 
+  cl::opt<bool>
+  TieredCompilation("jit-tiered",
+                    cl::desc("Compile functions quickly first and recompile "
+                             "them in the background"),
+                    cl::init(false));
+
+  cl::opt<unsigned>
+  MaxQueuedTierUps("jit-tier-up-queue",
+                   cl::desc("Maximum number of functions waiting for "
+                            "background recompilation"),
+                   cl::init(64));
+
+  cl::opt<bool>
+  WaitForTierUps("jit-wait-for-tier-ups",
+                 cl::desc("Let the background recompilations finish after "
+                          "main returns"),
+                 cl::init(false));
+
   cl::opt<Reloc::Model>
   RelocModel("relocation-model",
              cl::desc("Choose relocation model"),
@@ -199,11 +224,13 @@ namespace {
 }
 
 static ExecutionEngine *EE = 0;
+static ObjectCache *ObjCache = 0;
 
 static void do_shutdown() {
   // Cygwin-1.5 invokes DLL's dtors before atexit handler.
 #ifndef DO_NOTHING_ATEXIT
   delete EE;
+  delete ObjCache;
   llvm_shutdown();
 #endif
 }
@@ -408,6 +435,13 @@ int main(int argc, char **argv, char * const *envp) {
     NoLazyCompilation = true;
   }
   EE->DisableLazyCompilation(NoLazyCompilation);
+  if (TieredCompilation)
+    EE->EnableTieredCompilation(true, MaxQueuedTierUps);
+
+  if (!ObjectCacheDir.empty()) {
+    ObjCache = new FileObjectCache(ObjectCacheDir);
+    EE->setObjectCache(ObjCache);
+  }
 
   // If the user specifically requested an argv[0] to pass into the program,
   // do it now.
@@ -507,6 +541,9 @@ int main(int argc, char **argv, char * const *envp) {
     Result = EE->runFunctionAsMain(EntryFn, InputArgv, envp);
   }
 
+  if (TieredCompilation && WaitForTierUps)
+    EE->waitForTieredCompilation();
+
   // Like static constructors, the remote target MCJIT support doesn't handle
   // this yet. It could. FIXME.
   if (!RemoteMCJIT) {
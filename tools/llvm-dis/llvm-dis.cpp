@@ -23,13 +23,17 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/DataStream.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/TimeValue.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/system_error.h"
 using namespace llvm;
@@ -51,6 +55,17 @@ static cl::opt<bool>
 ShowAnnotations("show-annotations",
                 cl::desc("Add informational comments to the .ll file"));
 
+static cl::opt<bool>
+Mapped("mapped",
+       cl::desc("Map the input into memory and let the module refer to it "
+                "instead of streaming it"));
+
+static cl::opt<unsigned>
+LoadCount("load-count",
+          cl::desc("Load the input this many times, each copy into a new "
+                   "context, and report the time and heap memory used"),
+          cl::init(0), cl::Hidden);
+
 namespace {
 
 static void printDebugLoc(const DebugLoc &DL, formatted_raw_ostream &OS) {
@@ -111,6 +126,47 @@ public:
 
 } // end anon namespace
 
+/// benchmarkLoading - Load the input LoadCount times, each copy into a new
+/// context that is kept alive until the end, like a JIT that loads the same
+/// runtime library into many contexts would do.
+static int benchmarkLoading(const char *ProgName) {
+  std::vector<LLVMContext*> Contexts;
+  size_t MallocBefore = sys::Process::GetMallocUsage();
+  sys::TimeValue Start = sys::TimeValue::now();
+
+  for (unsigned i = 0; i != LoadCount; ++i) {
+    LLVMContext *Context = new LLVMContext();
+    Contexts.push_back(Context);
+
+    std::string ErrorMessage;
+    OwningPtr<MemoryBuffer> Buffer;
+    Module *M = 0;
+    if (error_code ec = MemoryBuffer::getFile(InputFilename, Buffer, -1,
+                                              /*RequiresNullTerminator=*/false))
+      ErrorMessage = ec.message();
+    else if (Mapped)
+      M = ParseMappedBitcodeFile(Buffer.take(), *Context, &ErrorMessage);
+    else
+      M = ParseBitcodeFile(Buffer.get(), *Context, &ErrorMessage);
+
+    // The module is owned by its context.
+    if (M == 0) {
+      errs() << ProgName << ": " << ErrorMessage << "\n";
+      DeleteContainerPointers(Contexts);
+      return 1;
+    }
+  }
+
+  sys::TimeValue Elapsed = sys::TimeValue::now() - Start;
+  size_t MallocUsed = sys::Process::GetMallocUsage() - MallocBefore;
+  outs() << "loaded " << LoadCount << " copies of '" << InputFilename
+         << "' in " << format("%.3f", Elapsed.msec() / 1000.0) << "s, heap "
+         << (MallocUsed >> 10) << " KiB\n";
+
+  DeleteContainerPointers(Contexts);
+  return 0;
+}
+
 int main(int argc, char **argv) {
   // Print a stack trace if we signal out.
   sys::PrintStackTraceOnErrorSignal();
@@ -125,9 +181,19 @@ int main(int argc, char **argv) {
   std::string ErrorMessage;
   std::auto_ptr<Module> M;
 
-  // Use the bitcode streaming interface
-  DataStreamer *streamer = getDataFileStreamer(InputFilename, &ErrorMessage);
-  if (streamer) {
+  if (LoadCount)
+    return benchmarkLoading(argv[0]);
+
+  if (Mapped) {
+    // The context owns the buffer, so the module can refer to it.
+    OwningPtr<MemoryBuffer> Buffer;
+    if (error_code ec = MemoryBuffer::getFileOrSTDIN(InputFilename, Buffer))
+      ErrorMessage = ec.message();
+    else
+      M.reset(ParseMappedBitcodeFile(Buffer.take(), Context, &ErrorMessage));
+  } else if (DataStreamer *streamer =
+               getDataFileStreamer(InputFilename, &ErrorMessage)) {
+    // Use the bitcode streaming interface
     std::string DisplayFilename;
     if (InputFilename == "-")
       DisplayFilename = "<stdin>";
@@ -50,11 +50,13 @@ static cl::opt<bool>
 DumpAsm("d", cl::desc("Print assembly as linked"), cl::Hidden);
 
 // LoadFile - Read the specified bitcode file in and return it.  This routine
-// searches the link path for the specified file to try to find it...
+// searches the link path for the specified file to try to find it...  If Lazy
+// is set, function bodies are only read when the linker needs them.
 //
 static inline std::auto_ptr<Module> LoadFile(const char *argv0,
                                              const std::string &FN, 
-                                             LLVMContext& Context) {
+                                             LLVMContext& Context,
+                                             bool Lazy = false) {
   sys::Path Filename;
   if (!Filename.set(FN)) {
     errs() << "Invalid file name: '" << FN << "'\n";
@@ -66,7 +68,10 @@ static inline std::auto_ptr<Module> LoadFile(const char *argv0,
   Module* Result = 0;
   
   const std::string &FNStr = Filename.str();
-  Result = ParseIRFile(FNStr, Err, Context);
+  if (Lazy)
+    Result = getLazyIRFileModule(FNStr, Err, Context);
+  else
+    Result = ParseIRFile(FNStr, Err, Context);
   if (Result) return std::auto_ptr<Module>(Result);   // Load successful!
 
   Err.print(argv0, errs());
@@ -95,7 +100,7 @@ int main(int argc, char **argv) {
 
   for (unsigned i = BaseArg+1; i < InputFilenames.size(); ++i) {
     std::auto_ptr<Module> M(LoadFile(argv[0],
-                                     InputFilenames[i], Context));
+                                     InputFilenames[i], Context, true));
     if (M.get() == 0) {
       errs() << argv[0] << ": error loading file '" <<InputFilenames[i]<< "'\n";
       return 1;
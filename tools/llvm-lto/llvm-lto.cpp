@@ -0,0 +1,111 @@
+//===-- llvm-lto.cpp - Drive libLTO for testing ---------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program links bitcode files through the libLTO C interface, the way a
+// linker plugin does, and writes the resulting native object files. It exists
+// to test libLTO:
+//  llvm-lto [options] x.bc y.bc  - Link, optimize and generate code for x.bc
+//                                  and y.bc.
+//  Options:
+//      -o <file>             - With one object file, write it to <file>;
+//                              with several, write them to <file>.0,
+//                              <file>.1 and so on.
+//      -exported-symbol <s>  - Keep <s> visible, as a linker would for a
+//                              symbol referenced from outside of the bitcode.
+//      -parallelism <n>      - Generate code in <n> partitions.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm-c/lto.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include <string>
+#include <vector>
+using namespace llvm;
+
+static cl::list<std::string>
+InputFilenames(cl::Positional, cl::OneOrMore,
+               cl::desc("<input bitcode files>"));
+
+static cl::opt<std::string>
+OutputFilename("o", cl::Required, cl::desc("Output filename"),
+               cl::value_desc("filename"));
+
+static cl::list<std::string>
+ExportedSymbols("exported-symbol",
+                cl::desc("Symbol to keep visible outside of the bitcode"),
+                cl::value_desc("symbol"));
+
+static cl::opt<unsigned>
+Parallelism("parallelism", cl::init(1),
+            cl::desc("Number of partitions to generate code in"));
+
+int main(int argc, char **argv) {
+  // Print a stack trace if we signal out.
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+
+  llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+  cl::ParseCommandLineOptions(argc, argv, "llvm LTO linker\n");
+
+  lto_code_gen_t CodeGen = lto_codegen_create();
+  std::vector<lto_module_t> Modules;
+  int Ret = 0;
+
+  for (unsigned i = 0, e = InputFilenames.size(); i != e; ++i) {
+    lto_module_t Module = lto_module_create(InputFilenames[i].c_str());
+    if (!Module || lto_codegen_add_module(CodeGen, Module)) {
+      errs() << argv[0] << ": error loading file '" << InputFilenames[i]
+             << "': " << lto_get_error_message() << "\n";
+      Ret = 1;
+      break;
+    }
+    Modules.push_back(Module);
+  }
+
+  for (unsigned i = 0, e = ExportedSymbols.size(); i != e && !Ret; ++i)
+    lto_codegen_add_must_preserve_symbol(CodeGen, ExportedSymbols[i].c_str());
+  lto_codegen_set_parallelism(CodeGen, Parallelism);
+
+  // The object files are temporaries owned by the caller; copy them to where
+  // they were asked for and remove them.
+  const char *const *Names;
+  unsigned NumNames = 0;
+  if (!Ret && lto_codegen_compile_to_files(CodeGen, &Names, &NumNames)) {
+    errs() << argv[0] << ": error compiling the code: "
+           << lto_get_error_message() << "\n";
+    Ret = 1;
+  }
+
+  for (unsigned i = 0; i != NumNames; ++i) {
+    std::string Path = OutputFilename;
+    if (NumNames != 1)
+      Path += "." + Twine(i).str();
+    if (error_code EC =
+          sys::fs::copy_file(Names[i], Path,
+                             sys::fs::copy_option::overwrite_if_exists)) {
+      errs() << argv[0] << ": error writing '" << Path << "': "
+             << EC.message() << "\n";
+      Ret = 1;
+    }
+    bool Existed;
+    sys::fs::remove(Names[i], Existed);
+  }
+
+  lto_codegen_dispose(CodeGen);
+  for (unsigned i = 0, e = Modules.size(); i != e; ++i)
+    lto_module_dispose(Modules[i]);
+  return Ret;
+}
@@ -37,6 +37,9 @@ static cl::opt<unsigned> SeedCL("seed",
 static cl::opt<unsigned> SizeCL("size",
   cl::desc("The estimated size of the generated function (# of instrs)"),
   cl::init(100));
+static cl::opt<bool> StraightLine("straight-line",
+  cl::desc("Keep the generated function in a single basic block"),
+  cl::init(false));
 static cl::opt<std::string>
 OutputFilename("o", cl::desc("Override output filename"),
                cl::value_desc("filename"));
@@ -694,7 +697,8 @@ int main(int argc, char **argv) {
   // Generate lots of random instructions inside a single basic block.
   FillFunction(F, R);
   // Break the basic block into many loops.
-  IntroduceControlFlow(F, R);
+  if (!StraightLine)
+    IntroduceControlFlow(F, R);
 
   // Figure out what stream we are supposed to write to...
   OwningPtr<tool_output_file> Out;
@@ -14,6 +14,8 @@
 
 #include "LTOCodeGenerator.h"
 #include "LTOModule.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Analysis/Verifier.h"
@@ -36,6 +38,7 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/system_error.h"
 #include "llvm/Target/Mangler.h"
@@ -45,6 +48,7 @@
 #include "llvm/TargetTransformInfo.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include <algorithm>
 using namespace llvm;
 
 static cl::opt<bool>
@@ -68,7 +72,7 @@ LTOCodeGenerator::LTOCodeGenerator()
     _linker("LinkTimeOptimizer", "ld-temp.o", _context), _target(NULL),
     _emitDwarfDebugInfo(false), _scopeRestrictionsDone(false),
     _codeModel(LTO_CODEGEN_PIC_MODEL_DYNAMIC),
-    _nativeObjectFile(NULL) {
+    _nativeObjectFile(NULL), _parallelism(1) {
   InitializeAllTargets();
   InitializeAllTargetMCs();
   InitializeAllAsmPrinters();
@@ -215,6 +219,28 @@ const void* LTOCodeGenerator::compile(size_t* length, std::string& errMsg) {
   return _nativeObjectFile->getBufferStart();
 }
 
+bool LTOCodeGenerator::compile_to_files(const char* const** names,
+                                        unsigned *count,
+                                        std::string& errMsg) {
+  _nativeObjectPaths.clear();
+  _nativeObjectNames.clear();
+
+  if (_parallelism == 1) {
+    const char *name;
+    if (compile_to_file(&name, errMsg))
+      return true;
+    _nativeObjectPaths.push_back(name);
+  } else if (generatePartitionedObjectFiles(errMsg)) {
+    return true;
+  }
+
+  for (unsigned i = 0, e = _nativeObjectPaths.size(); i != e; ++i)
+    _nativeObjectNames.push_back(_nativeObjectPaths[i].c_str());
+  *names = &_nativeObjectNames[0];
+  *count = _nativeObjectNames.size();
+  return false;
+}
+
 bool LTOCodeGenerator::determineTarget(std::string& errMsg) {
   if (_target != NULL)
     return false;
@@ -349,8 +375,7 @@ void LTOCodeGenerator::applyScopeRestrictions() {
 }
 
 /// Optimize merged modules using various IPO passes
-bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
-                                          std::string &errMsg) {
+bool LTOCodeGenerator::optimizeMergedModule(std::string &errMsg) {
   if (this->determineTarget(errMsg))
     return true;
 
@@ -386,6 +411,19 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
   // Make sure everything is still good.
   passes.add(createVerifierPass());
 
+  // Run our queue of passes all at once now, efficiently.
+  passes.run(*mergedModule);
+
+  return false;
+}
+
+bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
+                                          std::string &errMsg) {
+  if (this->optimizeMergedModule(errMsg))
+    return true;
+
+  Module* mergedModule = _linker.getModule();
+
   FunctionPassManager *codeGenPasses = new FunctionPassManager(mergedModule);
 
   codeGenPasses->add(new DataLayout(*_target->getDataLayout()));
@@ -395,12 +433,10 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
   if (_target->addPassesToEmitFile(*codeGenPasses, Out,
                                    TargetMachine::CGFT_ObjectFile)) {
     errMsg = "target file type not supported";
+    delete codeGenPasses;
     return true;
   }
 
-  // Run our queue of passes all at once now, efficiently.
-  passes.run(*mergedModule);
-
   // Run the code generator, and write assembly file
   codeGenPasses->doInitialization();
 
@@ -415,6 +451,313 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
   return false; // success
 }
 
+/// getFunctionWeight - Estimate how expensive F is to code generate.
+static unsigned getFunctionWeight(const Function &F) {
+  unsigned Weight = 0;
+  for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    Weight += BB->size();
+  return Weight;
+}
+
+static bool compareByWeight(const std::pair<unsigned, unsigned> &LHS,
+                            const std::pair<unsigned, unsigned> &RHS) {
+  // Heaviest first, then in module order.
+  if (LHS.first != RHS.first)
+    return LHS.first > RHS.first;
+  return LHS.second < RHS.second;
+}
+
+/// partitionFunctions - Assign each function defined in M, by its position in
+/// the function list, to one of NumPartitions partitions so that the
+/// partitions have roughly the same weight. Declarations are assigned ~0U.
+/// The result only depends on M and NumPartitions, never on the number of
+/// threads that end up compiling the partitions.
+static void partitionFunctions(const Module &M, unsigned NumPartitions,
+                               std::vector<unsigned> &Assignment) {
+  // Aliases are emitted in partition 0, and so must their aliasees be.
+  SmallPtrSet<const GlobalValue*, 8> Aliasees;
+  for (Module::const_alias_iterator I = M.alias_begin(), E = M.alias_end();
+       I != E; ++I)
+    if (const GlobalValue *GV = I->getAliasedGlobal())
+      Aliasees.insert(GV);
+
+  std::vector<uint64_t> Load(NumPartitions);
+  std::vector<std::pair<unsigned, unsigned> > Worklist;
+  unsigned Idx = 0;
+  for (Module::const_iterator F = M.begin(), E = M.end(); F != E; ++F, ++Idx) {
+    if (F->isDeclaration()) {
+      Assignment.push_back(~0U);
+      continue;
+    }
+
+    Assignment.push_back(0);
+    unsigned Weight = getFunctionWeight(*F);
+    if (Aliasees.count(F))
+      Load[0] += Weight;
+    else
+      Worklist.push_back(std::make_pair(Weight, Idx));
+  }
+
+  // Greedily hand the heaviest remaining function to the lightest partition.
+  std::sort(Worklist.begin(), Worklist.end(), compareByWeight);
+  for (unsigned i = 0, e = Worklist.size(); i != e; ++i) {
+    unsigned Part = std::min_element(Load.begin(), Load.end()) - Load.begin();
+    Assignment[Worklist[i].second] = Part;
+    Load[Part] += Worklist[i].first;
+  }
+}
+
+/// isUsedOutsidePartition - Return true if V is referenced by anything that is
+/// not emitted in partition Part. Global variable initializers and aliases
+/// are always emitted in partition 0.
+static bool
+isUsedOutsidePartition(const Value *V, unsigned Part,
+                       const DenseMap<const Function*, unsigned> &FuncPart,
+                       SmallPtrSet<const Value*, 16> &Visited) {
+  for (Value::const_use_iterator UI = V->use_begin(), E = V->use_end();
+       UI != E; ++UI) {
+    const User *U = *UI;
+    if (const Instruction *I = dyn_cast<Instruction>(U)) {
+      if (FuncPart.lookup(I->getParent()->getParent()) != Part)
+        return true;
+    } else if (isa<GlobalValue>(U)) {
+      if (Part != 0)
+        return true;
+    } else if (Visited.insert(U) &&
+               isUsedOutsidePartition(U, Part, FuncPart, Visited)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// externalizeCrossPartitionLocals - Local symbols that are referenced from a
+/// partition other than the one defining them have to become visible to the
+/// final link. Give them hidden visibility and a name that can't clash with
+/// anything from the original sources.
+static void externalizeCrossPartitionLocals(Module &M,
+                                    const std::vector<unsigned> &Assignment) {
+  DenseMap<const Function*, unsigned> FuncPart;
+  std::vector<std::pair<GlobalValue*, unsigned> > Locals;
+  unsigned Idx = 0;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F, ++Idx) {
+    FuncPart[F] = Assignment[Idx];
+    if (F->hasLocalLinkage())
+      Locals.push_back(std::make_pair(F, Assignment[Idx]));
+  }
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ++I)
+    if (I->hasLocalLinkage())
+      Locals.push_back(std::make_pair(I, 0U));
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end();
+       I != E; ++I)
+    if (I->hasLocalLinkage())
+      Locals.push_back(std::make_pair(I, 0U));
+
+  for (unsigned i = 0, e = Locals.size(); i != e; ++i) {
+    GlobalValue *GV = Locals[i].first;
+    SmallPtrSet<const Value*, 16> Visited;
+    if (!isUsedOutsidePartition(GV, Locals[i].second, FuncPart, Visited))
+      continue;
+
+    if (GV->hasName())
+      GV->setName(GV->getName() + ".lto_priv");
+    else
+      GV->setName("lto_priv");
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+    GV->setVisibility(GlobalValue::HiddenVisibility);
+  }
+}
+
+/// stripPartition - Turn M, a copy of the merged module, into the module for
+/// partition Part by reducing everything emitted by other partitions to a
+/// declaration.
+static void stripPartition(Module &M, unsigned Part,
+                           const std::vector<unsigned> &Assignment) {
+  unsigned Idx = 0;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F, ++Idx)
+    if (!F->isDeclaration() && Assignment[Idx] != Part)
+      F->deleteBody();
+
+  if (Part == 0)
+    return;
+
+  // Global data, aliases and module level inline asm live in partition 0.
+  M.setModuleInlineAsm("");
+
+  for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end();
+       I != E; ) {
+    GlobalAlias *GA = I++;
+    PointerType *PTy = GA->getType();
+    GlobalValue *Decl;
+    if (FunctionType *FTy = dyn_cast<FunctionType>(PTy->getElementType()))
+      Decl = Function::Create(FTy, GlobalValue::ExternalLinkage, "", &M);
+    else
+      Decl = new GlobalVariable(M, PTy->getElementType(), false,
+                                GlobalValue::ExternalLinkage, 0, "", 0,
+                                GlobalVariable::NotThreadLocal,
+                                PTy->getAddressSpace());
+    Decl->takeName(GA);
+    Decl->setVisibility(GA->getVisibility());
+    GA->replaceAllUsesWith(Decl);
+    GA->eraseFromParent();
+  }
+
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E; ) {
+    GlobalVariable *GV = I++;
+    if (GV->isDeclaration())
+      continue;
+
+    GV->removeDeadConstantUsers();
+    if (GV->hasAppendingLinkage() || GV->use_empty()) {
+      GV->eraseFromParent();
+      continue;
+    }
+
+    GV->setInitializer(0);
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+  }
+}
+
+namespace {
+/// CodeGenPartition - Everything the thread compiling one partition of the
+/// merged module needs to know.
+struct CodeGenPartition {
+  const TargetMachine *ProtoTarget;
+  const MemoryBuffer *Bitcode;
+  const std::vector<unsigned> *Assignment;
+  unsigned Index;
+  std::string Path;
+  std::string ErrMsg;
+};
+}
+
+/// codegenPartition - Thread entry point compiling one partition. Nothing in
+/// here may touch state shared with the other partitions except for reading
+/// the bitcode and the prototype target machine.
+static void codegenPartition(void *Arg) {
+  CodeGenPartition &P = *static_cast<CodeGenPartition*>(Arg);
+
+  LLVMContext Context;
+  OwningPtr<Module> M(ParseBitcodeFile(const_cast<MemoryBuffer*>(P.Bitcode),
+                                       Context, &P.ErrMsg));
+  if (!M) {
+    if (P.ErrMsg.empty())
+      P.ErrMsg = "could not read merged module";
+    return;
+  }
+
+  stripPartition(*M, P.Index, *P.Assignment);
+
+  const TargetMachine &Proto = *P.ProtoTarget;
+  OwningPtr<TargetMachine> Target(
+    Proto.getTarget().createTargetMachine(Proto.getTargetTriple(),
+                                          Proto.getTargetCPU(),
+                                          Proto.getTargetFeatureString(),
+                                          Proto.Options,
+                                          Proto.getRelocationModel(),
+                                          Proto.getCodeModel(),
+                                          Proto.getOptLevel()));
+
+  PassManager codeGenPasses;
+  codeGenPasses.add(new DataLayout(*Target->getDataLayout()));
+
+  tool_output_file ObjFile(P.Path.c_str(), P.ErrMsg, raw_fd_ostream::F_Binary);
+  if (!P.ErrMsg.empty())
+    return;
+
+  {
+    formatted_raw_ostream Out(ObjFile.os());
+    if (Target->addPassesToEmitFile(codeGenPasses, Out,
+                                    TargetMachine::CGFT_ObjectFile)) {
+      P.ErrMsg = "target file type not supported";
+      return;
+    }
+    codeGenPasses.run(*M);
+  }
+
+  ObjFile.os().close();
+  if (ObjFile.os().has_error()) {
+    ObjFile.os().clear_error();
+    P.ErrMsg = "could not write object file: " + P.Path;
+    return;
+  }
+  ObjFile.keep();
+}
+
+/// generatePartitionedObjectFiles - Optimize the merged module as a whole,
+/// then split it into up to _parallelism partitions and code generate each of
+/// them on its own thread, with its own LLVMContext and TargetMachine.
+bool LTOCodeGenerator::generatePartitionedObjectFiles(std::string &errMsg) {
+  if (this->optimizeMergedModule(errMsg))
+    return true;
+
+  Module *mergedModule = _linker.getModule();
+
+  unsigned NumDefined = 0;
+  for (Module::iterator F = mergedModule->begin(), E = mergedModule->end();
+       F != E; ++F)
+    if (!F->isDeclaration())
+      ++NumDefined;
+  unsigned NumPartitions = std::max(1U, std::min(_parallelism, NumDefined));
+
+  std::vector<unsigned> Assignment;
+  partitionFunctions(*mergedModule, NumPartitions, Assignment);
+  externalizeCrossPartitionLocals(*mergedModule, Assignment);
+
+  // Every partition is materialized from its own copy of the merged module,
+  // so that no IR is shared between the threads.
+  SmallVector<char, 0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(mergedModule, OS);
+  }
+  OwningPtr<MemoryBuffer> BitcodeBuffer(
+    MemoryBuffer::getMemBuffer(StringRef(Bitcode.data(), Bitcode.size()),
+                               "ld-temp.o", false));
+
+  std::vector<CodeGenPartition> Partitions(NumPartitions);
+  std::vector<void*> Args(NumPartitions);
+  for (unsigned i = 0; i != NumPartitions; ++i) {
+    sys::PathWithStatus uniqueObjPath("lto-llvm.o");
+    if (uniqueObjPath.createTemporaryFileOnDisk(false, &errMsg)) {
+      uniqueObjPath.eraseFromDisk();
+      for (unsigned j = 0; j != i; ++j)
+        sys::Path(Partitions[j].Path).eraseFromDisk();
+      return true;
+    }
+    sys::RemoveFileOnSignal(uniqueObjPath);
+
+    CodeGenPartition &P = Partitions[i];
+    P.ProtoTarget = _target;
+    P.Bitcode = BitcodeBuffer.get();
+    P.Assignment = &Assignment;
+    P.Index = i;
+    P.Path = uniqueObjPath.str();
+    Args[i] = &P;
+  }
+
+  if (!llvm_is_multithreaded())
+    llvm_start_multithreaded();
+  llvm_execute_on_threads(codegenPartition, &Args[0], NumPartitions);
+
+  // Report the first failure in partition order so the diagnostic doesn't
+  // depend on thread scheduling.
+  for (unsigned i = 0; i != NumPartitions; ++i) {
+    if (Partitions[i].ErrMsg.empty())
+      continue;
+    errMsg = Partitions[i].ErrMsg;
+    for (unsigned j = 0; j != NumPartitions; ++j)
+      sys::Path(Partitions[j].Path).eraseFromDisk();
+    return true;
+  }
+
+  for (unsigned i = 0; i != NumPartitions; ++i)
+    _nativeObjectPaths.push_back(Partitions[i].Path);
+  return false;
+}
+
 /// setCodeGenDebugOptions - Set codegen debugging options to aid in debugging
 /// LTO problems.
 void LTOCodeGenerator::setCodeGenDebugOptions(const char *options) {
@@ -40,6 +40,8 @@
 #include "llvm/Support/SystemUtils.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Target/TargetMachine.h"
@@ -157,6 +159,11 @@ DefaultDataLayout("default-data-layout",
           cl::desc("data layout string to use if not specified by module"),
           cl::value_desc("layout-string"), cl::init(""));
 
+static cl::opt<unsigned>
+FunctionThreads("function-threads", cl::init(1), cl::value_desc("N"),
+                cl::desc("Run function passes on up to N functions at once "
+                         "(0 uses one thread per core)"));
+
 // ---------- Define Printers for module and function passes ------------
 namespace {
 
@@ -632,6 +639,12 @@ int main(int argc, char **argv) {
   //
   PassManager Passes;
 
+  if (FunctionThreads != 1) {
+    llvm_start_multithreaded();
+    Passes.setNumFunctionThreads(FunctionThreads ? FunctionThreads :
+                                 ThreadPool::getDefaultNumThreads());
+  }
+
   // Add an appropriate TargetLibraryInfo pass for the module's triple.
   TargetLibraryInfo *TLI = new TargetLibraryInfo(Triple(M->getTargetTriple()));
 
@@ -0,0 +1,196 @@
+//===- llvm/unittest/ADT/ConcurrentStringMapTest.cpp ----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/ConcurrentStringMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+TEST(ConcurrentStringMapTest, Basics) {
+  ConcurrentStringMap<int> Map(5);
+  EXPECT_EQ(8U, Map.getNumShards());
+  EXPECT_TRUE(Map.empty());
+
+  std::pair<StringMapEntry<int>*, bool> R = Map.insert("foo", 1);
+  EXPECT_TRUE(R.second);
+  EXPECT_EQ("foo", R.first->getKey());
+  EXPECT_EQ(1, R.first->getValue());
+
+  R = Map.insert("foo", 2);
+  EXPECT_FALSE(R.second);
+  EXPECT_EQ(1, R.first->getValue());
+
+  Map.GetOrCreateValue("bar").setValue(3);
+  EXPECT_EQ(2U, Map.size());
+  EXPECT_EQ(3, Map.lookup("bar"));
+  EXPECT_EQ(0, Map.lookup("baz"));
+  EXPECT_EQ(1U, Map.count("foo"));
+  EXPECT_EQ(0, Map.find("baz"));
+  EXPECT_EQ(R.first, Map.find("foo"));
+
+  EXPECT_TRUE(Map.erase("foo"));
+  EXPECT_FALSE(Map.erase("foo"));
+  EXPECT_EQ(1U, Map.size());
+
+  unsigned Seen = 0;
+  for (unsigned I = 0, E = Map.getNumShards(); I != E; ++I)
+    Seen += Map.getShardMap(I).size();
+  EXPECT_EQ(1U, Seen);
+
+  Map.clear();
+  EXPECT_TRUE(Map.empty());
+}
+
+TEST(ConcurrentStringMapTest, SingleShard) {
+  ConcurrentStringMap<int> Map(1);
+  EXPECT_EQ(1U, Map.getNumShards());
+  for (int I = 0; I != 100; ++I)
+    Map.insert(Twine(I).str(), I);
+  EXPECT_EQ(100U, Map.size());
+  EXPECT_EQ(42, Map.lookup("42"));
+}
+
+// Each task inserts the same range of keys, so every key has to be inserted
+// by exactly one of them.
+struct InsertTask {
+  ConcurrentStringMap<unsigned> *Map;
+  const std::vector<std::string> *Keys;
+  unsigned ID;
+  unsigned NumInserted;
+};
+
+void runInsertTask(void *Arg) {
+  InsertTask &T = *static_cast<InsertTask*>(Arg);
+  for (unsigned I = 0, E = T.Keys->size(); I != E; ++I) {
+    // Start at a different key in each task to mix up the order.
+    const std::string &Key = (*T.Keys)[(I + T.ID * 97) % E];
+    if (T.Map->insert(Key, T.ID).second)
+      ++T.NumInserted;
+  }
+}
+
+TEST(ConcurrentStringMapTest, ConcurrentInsert) {
+  std::vector<std::string> Keys;
+  for (unsigned I = 0; I != 2000; ++I)
+    Keys.push_back(("sym" + Twine(I)).str());
+
+  const unsigned NumTasks = 8;
+  ConcurrentStringMap<unsigned> Map;
+  std::vector<InsertTask> Tasks(NumTasks);
+  {
+    ThreadPool Pool(4);
+    for (unsigned I = 0; I != NumTasks; ++I) {
+      InsertTask T = { &Map, &Keys, I, 0 };
+      Tasks[I] = T;
+      Pool.async(runInsertTask, &Tasks[I]);
+    }
+    Pool.wait();
+  }
+
+  unsigned NumInserted = 0;
+  for (unsigned I = 0; I != NumTasks; ++I)
+    NumInserted += Tasks[I].NumInserted;
+  EXPECT_EQ(Keys.size(), NumInserted);
+  EXPECT_EQ(Keys.size(), Map.size());
+  for (unsigned I = 0, E = Keys.size(); I != E; ++I) {
+    StringMapEntry<unsigned> *Entry = Map.find(Keys[I]);
+    ASSERT_TRUE(Entry != 0);
+    EXPECT_LT(Entry->getValue(), NumTasks);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Contention benchmark. Run it with --gtest_also_run_disabled_tests.
+//
+
+/// GuardedStringMap - A StringMap behind a single lock, which is what clients
+/// had to use before ConcurrentStringMap.
+class GuardedStringMap {
+  sys::Mutex Lock;
+  StringMap<unsigned> Map;
+public:
+  GuardedStringMap() : Lock(false) {}
+
+  bool insert(StringRef Key, unsigned Val) {
+    sys::ScopedLock Guard(Lock);
+    unsigned Size = Map.size();
+    Map.GetOrCreateValue(Key, Val);
+    return Map.size() != Size;
+  }
+  unsigned lookup(StringRef Key) {
+    sys::ScopedLock Guard(Lock);
+    return Map.lookup(Key);
+  }
+};
+
+/// Each benchmark task looks up every key of the shared symbol table a few
+/// times and inserts the keys of its own slice, like threads resolving the
+/// symbols of different objects.
+template<typename MapTy>
+struct BenchTask {
+  MapTy *Map;
+  const std::vector<std::string> *Keys;
+  unsigned Begin, End;
+  unsigned Found;
+
+  static void run(void *Arg) {
+    BenchTask &T = *static_cast<BenchTask*>(Arg);
+    const std::vector<std::string> &Keys = *T.Keys;
+    for (unsigned I = T.Begin; I != T.End; ++I)
+      T.Map->insert(Keys[I], I);
+    for (unsigned Round = 0; Round != 4; ++Round)
+      for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+        T.Found += T.Map->lookup(Keys[(I + T.Begin) % E]) != 0;
+  }
+};
+
+template<typename MapTy>
+double runBenchmark(unsigned NumThreads,
+                    const std::vector<std::string> &Keys) {
+  MapTy Map;
+  std::vector<BenchTask<MapTy> > Tasks(NumThreads);
+  unsigned Slice = Keys.size() / NumThreads;
+  ThreadPool Pool(NumThreads);
+  TimeRecord Start = TimeRecord::getCurrentTime(true);
+  for (unsigned I = 0; I != NumThreads; ++I) {
+    BenchTask<MapTy> T = { &Map, &Keys, I * Slice, (I + 1) * Slice, 0 };
+    Tasks[I] = T;
+    Pool.async(BenchTask<MapTy>::run, &Tasks[I]);
+  }
+  Pool.wait();
+  TimeRecord End = TimeRecord::getCurrentTime(false);
+  return End.getWallTime() - Start.getWallTime();
+}
+
+TEST(ConcurrentStringMapTest, DISABLED_Contention) {
+  std::vector<std::string> Keys;
+  for (unsigned I = 0; I != 64 * 1024; ++I)
+    Keys.push_back(("_ZN4llvm6symbol" + Twine(I) + "Ev").str());
+
+  outs() << "threads  guarded(s)  concurrent(s)  speedup\n";
+  for (unsigned NumThreads = 1; NumThreads <= 64; NumThreads *= 2) {
+    double Concurrent =
+      runBenchmark<ConcurrentStringMap<unsigned> >(NumThreads, Keys);
+    double Guarded = runBenchmark<GuardedStringMap>(NumThreads, Keys);
+    outs() << format("%7u  %10.4f  %13.4f  %7.2f\n", NumThreads, Guarded,
+                     Concurrent, Guarded / Concurrent);
+  }
+}
+
+} // end anonymous namespace
@@ -13,7 +13,9 @@
 
 #include "gtest/gtest.h"
 #include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/STLExtras.h"
 #include <string>
+#include <vector>
 
 using namespace llvm;
 
@@ -35,5 +37,37 @@ TEST(FoldingSetTest, UnalignedStringTest) {
   EXPECT_EQ(a.ComputeHash(), b.ComputeHash());
 }
 
+struct TrivialPair : public FoldingSetNode {
+  unsigned Key;
+  explicit TrivialPair(unsigned K) : Key(K) {}
+  void Profile(FoldingSetNodeID &ID) const { ID.AddInteger(Key); }
+};
+
+TEST(FoldingSetTest, ShrinkHashTable) {
+  FoldingSet<TrivialPair> Set;
+  std::vector<TrivialPair*> Nodes;
+  for (unsigned i = 0; i != 1000; ++i) {
+    Nodes.push_back(new TrivialPair(i));
+    Set.InsertNode(Nodes.back());
+  }
+  unsigned Grown = Set.getNumBuckets();
+  EXPECT_LE(512U, Grown);
+
+  for (unsigned i = 10; i != 1000; ++i)
+    Set.RemoveNode(Nodes[i]);
+  Set.ShrinkHashTable();
+  EXPECT_EQ(64U, Set.getNumBuckets());
+  EXPECT_EQ(65 * sizeof(void*), Set.getMemorySize());
+
+  // The remaining nodes can still be found.
+  for (unsigned i = 0; i != 10; ++i) {
+    FoldingSetNodeID ID;
+    Nodes[i]->Profile(ID);
+    void *InsertPos;
+    EXPECT_EQ(Nodes[i], Set.FindNodeOrInsertPos(ID, InsertPos));
+  }
+  DeleteContainerPointers(Nodes);
+}
+
 }
 
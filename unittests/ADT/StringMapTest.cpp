@@ -9,7 +9,14 @@
 
 #include "gtest/gtest.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/Twine.h"
 #include "llvm/Support/DataTypes.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+#include <vector>
 using namespace llvm;
 
 namespace {
@@ -220,4 +227,58 @@ TEST_F(StringMapTest, InsertTest) {
   assertSingleItemMap();
 }
 
+// The hash decides the iteration order of a map, so it must not depend on the
+// host.
+TEST(StringMapHashTest, HashKeyIsStable) {
+  EXPECT_EQ(0x2ac2875cU, StringMapImpl::hashKey(""));
+  EXPECT_EQ(0x8affe439U, StringMapImpl::hashKey("a"));
+  EXPECT_EQ(0xed615ce2U, StringMapImpl::hashKey("abcdefg"));
+  EXPECT_EQ(0x3216f4abU, StringMapImpl::hashKey("abcdefgh"));
+  EXPECT_EQ(0xb33c3ab9U, StringMapImpl::hashKey(
+    "_ZN4llvm9StringMapIjNS_15MallocAllocatorEE16GetOrCreateValueENS_9StringRefE"));
+
+  // Only the bytes of the key are hashed, not what follows them.
+  EXPECT_EQ(StringMapImpl::hashKey("abc"),
+            StringMapImpl::hashKey(StringRef("abcdef", 3)));
+  EXPECT_NE(StringMapImpl::hashKey("abc"), StringMapImpl::hashKey("abd"));
+}
+
+// Microbenchmark of the hash on mangled names. Run it with
+// --gtest_also_run_disabled_tests.
+TEST(StringMapHashTest, DISABLED_HashBenchmark) {
+  std::vector<std::string> Keys;
+  for (unsigned I = 0; I != 64 * 1024; ++I)
+    Keys.push_back(("_ZNK4llvm12DenseMapBaseINS_8DenseMapIPKNS_5ValueE" +
+                    Twine(I) + "EE4findERKS4_").str());
+
+  const unsigned Rounds = 20;
+  unsigned Sink = 0;
+  TimeRecord Start = TimeRecord::getCurrentTime(true);
+  for (unsigned R = 0; R != Rounds; ++R)
+    for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+      Sink += HashString(Keys[I]);
+  TimeRecord Mid = TimeRecord::getCurrentTime(false);
+  for (unsigned R = 0; R != Rounds; ++R)
+    for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+      Sink += StringMapImpl::hashKey(Keys[I]);
+  TimeRecord End = TimeRecord::getCurrentTime(false);
+
+  StringMap<unsigned> Map;
+  for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+    Map[Keys[I]] = I;
+  TimeRecord LookupStart = TimeRecord::getCurrentTime(true);
+  for (unsigned R = 0; R != Rounds; ++R)
+    for (unsigned I = 0, E = Keys.size(); I != E; ++I)
+      Sink += Map.lookup(Keys[I]);
+  TimeRecord LookupEnd = TimeRecord::getCurrentTime(false);
+
+  outs() << format("HashString:        %.4fs\n",
+                   Mid.getWallTime() - Start.getWallTime())
+         << format("hashKey:           %.4fs\n",
+                   End.getWallTime() - Mid.getWallTime())
+         << format("StringMap lookups: %.4fs\n",
+                   LookupEnd.getWallTime() - LookupStart.getWallTime())
+         << "(checksum " << Sink << ")\n";
+}
+
 } // end anonymous namespace
@@ -0,0 +1,112 @@
+//===- BasicAliasAnalysisTest.cpp - BasicAliasAnalysis unit tests ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/Passes.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/PassManager.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace llvm {
+void initializeBasicAATestPassPass(PassRegistry&);
+
+namespace {
+
+/// BasicAATestPass - Changes the pointers of a function in place between
+/// alias queries, so the answers would be wrong if BasicAA's decomposition
+/// cache were not checked against the current operands.
+struct BasicAATestPass : public FunctionPass {
+  static char ID;
+  BasicAATestPass() : FunctionPass(ID) {
+    initializeBasicAATestPassPass(*PassRegistry::getPassRegistry());
+  }
+
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<AliasAnalysis>();
+  }
+
+  AliasAnalysis::AliasResult alias(Value *V1, Value *V2) {
+    return getAnalysis<AliasAnalysis>().alias(V1, 4, V2, 4);
+  }
+
+  virtual bool runOnFunction(Function &F) {
+    LLVMContext &C = F.getContext();
+    Type *I64 = Type::getInt64Ty(C);
+    IRBuilder<> B(F.getEntryBlock().getTerminator());
+    Value *Buf = B.CreateAlloca(ArrayType::get(Type::getInt32Ty(C), 8));
+    Value *Zero = ConstantInt::get(I64, 0);
+    Value *Arg = F.arg_begin();
+
+    // Constant indices.
+    Value *P = B.CreateConstInBoundsGEP2_64(Buf, 0, 1);
+    Instruction *Q =
+      cast<Instruction>(B.CreateConstInBoundsGEP2_64(Buf, 0, 2));
+    EXPECT_EQ(AliasAnalysis::NoAlias, alias(P, Q));
+    EXPECT_EQ(AliasAnalysis::NoAlias, alias(P, Q));
+    Q->setOperand(2, ConstantInt::get(I64, 1));
+    EXPECT_EQ(AliasAnalysis::MustAlias, alias(P, Q));
+
+    // A new pointer, possibly at the address of a deleted one.
+    Q->eraseFromParent();
+    Q = cast<Instruction>(B.CreateConstInBoundsGEP2_64(Buf, 0, 2));
+    EXPECT_EQ(AliasAnalysis::NoAlias, alias(P, Q));
+
+    // A variable index that is looked through.
+    Instruction *Next =
+      cast<Instruction>(B.CreateAdd(Arg, ConstantInt::get(I64, 1)));
+    Value *IdxS[] = { Zero, Arg };
+    Value *IdxT[] = { Zero, Next };
+    Value *S = B.CreateInBoundsGEP(Buf, IdxS);
+    Value *T = B.CreateInBoundsGEP(Buf, IdxT);
+    EXPECT_EQ(AliasAnalysis::NoAlias, alias(S, T));
+    Next->setOperand(1, Zero);
+    EXPECT_EQ(AliasAnalysis::MustAlias, alias(S, T));
+
+    // A replaced base pointer.
+    Value *Other = B.CreateAlloca(ArrayType::get(Type::getInt32Ty(C), 8));
+    Value *U = B.CreateConstInBoundsGEP2_64(Other, 0, 1);
+    EXPECT_EQ(AliasAnalysis::NoAlias, alias(P, U));
+    Other->replaceAllUsesWith(Buf);
+    EXPECT_EQ(AliasAnalysis::MustAlias, alias(P, U));
+    return true;
+  }
+};
+char BasicAATestPass::ID = 0;
+
+TEST(BasicAliasAnalysisTest, DecompositionCache) {
+  initializeAnalysis(*PassRegistry::getPassRegistry());
+  LLVMContext C;
+  Module M("m", C);
+  M.setDataLayout("e-p:64:64:64-i32:32:32-i64:64:64");
+  FunctionType *FTy = FunctionType::get(Type::getVoidTy(C),
+                                        Type::getInt64Ty(C), false);
+  Function *F = Function::Create(FTy, Function::ExternalLinkage, "f", &M);
+  ReturnInst::Create(C, BasicBlock::Create(C, "entry", F));
+
+  PassManager PM;
+  PM.add(new DataLayout(&M));
+  PM.add(createBasicAliasAnalysisPass());
+  PM.add(new BasicAATestPass());
+  PM.run(M);
+}
+
+} // end anonymous namespace
+} // end namespace llvm
+
+INITIALIZE_PASS_BEGIN(BasicAATestPass, "basicaa-test", "basicaa-test",
+                      false, false)
+INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
+INITIALIZE_PASS_END(BasicAATestPass, "basicaa-test", "basicaa-test",
+                    false, false)
@@ -0,0 +1,124 @@
+//===- MemoryDependenceAnalysisTest.cpp - MemDep unit tests ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/MemoryDependenceAnalysis.h"
+#include "llvm/Analysis/Passes.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/PassManager.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace llvm {
+void initializeMemDepTestPassPass(PassRegistry&);
+
+namespace {
+
+/// MemDepTestPass - Changes a long block between uncached dependence queries,
+/// so the answers would be wrong if the block's memory instruction index were
+/// not kept in sync with the instruction list.
+struct MemDepTestPass : public FunctionPass {
+  static char ID;
+  MemDepTestPass() : FunctionPass(ID) {
+    initializeMemDepTestPassPass(*PassRegistry::getPassRegistry());
+  }
+
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<AliasAnalysis>();
+    AU.addRequired<MemoryDependenceAnalysis>();
+    AU.setPreservesAll();
+  }
+
+  Instruction *getDep(LoadInst *LI) {
+    AliasAnalysis &AA = getAnalysis<AliasAnalysis>();
+    MemDepResult Dep = getAnalysis<MemoryDependenceAnalysis>().
+      getPointerDependencyFrom(AA.getLocation(LI), true, LI, LI->getParent());
+    return Dep.getInst();
+  }
+
+  virtual bool runOnFunction(Function &F) {
+    LLVMContext &C = F.getContext();
+    Type *I32 = Type::getInt32Ty(C);
+    BasicBlock *Entry = &F.getEntryBlock();
+    BasicBlock *Other = BasicBlock::Create(C, "other", &F);
+    ReturnInst::Create(C, Other);
+
+    // A store, a run of arithmetic long enough for the block to be indexed
+    // but within the scan limit, and a load of the stored value.
+    IRBuilder<> B(Entry->getTerminator());
+    Value *P = B.CreateAlloca(I32);
+    Value *Q = B.CreateAlloca(I32);
+    Value *Arg = F.arg_begin();
+    Instruction *First = B.CreateStore(Arg, P);
+    Value *X = Arg;
+    for (unsigned i = 0; i != 400; ++i)
+      X = B.CreateAdd(X, Arg);
+    Instruction *Sum = cast<Instruction>(X);
+    LoadInst *LI = B.CreateLoad(P);
+
+    // The first query walks the block and indexes it, the second one uses
+    // the index.
+    EXPECT_EQ(First, getDep(LI));
+    EXPECT_EQ(First, getDep(LI));
+
+    // A new store in the middle of the block.
+    Instruction *Second = new StoreInst(Sum, P, Sum);
+    EXPECT_EQ(Second, getDep(LI));
+    EXPECT_EQ(Second, getDep(LI));
+
+    // Deleting it.
+    Second->eraseFromParent();
+    EXPECT_EQ(First, getDep(LI));
+
+    // Moving a store to another location in front of the load.
+    Instruction *Third = new StoreInst(Arg, Q, First);
+    EXPECT_EQ(First, getDep(LI));
+    Third->moveBefore(LI);
+    EXPECT_EQ(First, getDep(LI));
+    cast<StoreInst>(Third)->setOperand(1, P);
+    EXPECT_EQ(Third, getDep(LI));
+
+    // Moving it to another block.
+    Third->removeFromParent();
+    EXPECT_EQ(First, getDep(LI));
+    Third->insertBefore(Other->getTerminator());
+    EXPECT_EQ(First, getDep(LI));
+    Third->eraseFromParent();
+    return false;
+  }
+};
+char MemDepTestPass::ID = 0;
+
+TEST(MemoryDependenceAnalysisTest, BlockIndex) {
+  initializeAnalysis(*PassRegistry::getPassRegistry());
+  LLVMContext C;
+  Module M("m", C);
+  FunctionType *FTy = FunctionType::get(Type::getVoidTy(C),
+                                        Type::getInt32Ty(C), false);
+  Function *F = Function::Create(FTy, Function::ExternalLinkage, "f", &M);
+  ReturnInst::Create(C, BasicBlock::Create(C, "entry", F));
+
+  PassManager PM;
+  PM.add(createBasicAliasAnalysisPass());
+  PM.add(new MemDepTestPass());
+  PM.run(M);
+}
+
+} // end anonymous namespace
+} // end namespace llvm
+
+INITIALIZE_PASS_BEGIN(MemDepTestPass, "memdep-test", "memdep-test",
+                      false, false)
+INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
+INITIALIZE_PASS_DEPENDENCY(MemoryDependenceAnalysis)
+INITIALIZE_PASS_END(MemDepTestPass, "memdep-test", "memdep-test",
+                    false, false)
@@ -14,6 +14,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
 #include "llvm/PassManager.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -61,5 +62,45 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddr) { // PR11677
   passes.run(*m);
 }
 
+TEST(BitReaderTest, MappedModuleRefersToBuffer) {
+  SmallString<1024> Mem;
+  {
+    LLVMContext Context;
+    Module Mod("test-mapped", Context);
+    Constant *Str = ConstantDataArray::getString(Context, "string constant",
+                                                 /*AddNull=*/false);
+    new GlobalVariable(Mod, Str->getType(), /*isConstant=*/true,
+                       GlobalValue::ExternalLinkage, Str, "str");
+    Value *MD = MDString::get(Context, "metadata string");
+    Mod.getOrInsertNamedMetadata("named")->addOperand(MDNode::get(Context, MD));
+    raw_svector_ostream OS(Mem);
+    WriteBitcodeToFile(&Mod, OS);
+  }
+
+  LLVMContext Context;
+  MemoryBuffer *Buffer = MemoryBuffer::getMemBufferCopy(Mem.str(), "test");
+  std::string ErrMsg;
+  Module *M = ParseMappedBitcodeFile(Buffer, Context, &ErrMsg);
+  ASSERT_TRUE(M != 0) << ErrMsg;
+
+  // Both strings point into the buffer now owned by the context.
+  const char *Start = Buffer->getBufferStart(), *End = Buffer->getBufferEnd();
+  ConstantDataSequential *Str =
+    cast<ConstantDataSequential>(M->getNamedGlobal("str")->getInitializer());
+  EXPECT_EQ("string constant", Str->getAsString());
+  EXPECT_TRUE(Str->getAsString().begin() >= Start &&
+              Str->getAsString().end() <= End);
+
+  MDString *MD =
+    cast<MDString>(M->getNamedMetadata("named")->getOperand(0)->getOperand(0));
+  EXPECT_EQ("metadata string", MD->getString());
+  EXPECT_TRUE(MD->begin() >= Start && MD->end() <= End);
+
+  // Uniquing still works for strings created elsewhere.
+  EXPECT_EQ(MD, MDString::get(Context, "metadata string"));
+  EXPECT_EQ(Str, ConstantDataArray::getString(Context, "string constant",
+                                              /*AddNull=*/false));
+}
+
 }
 }
@@ -10,6 +10,7 @@
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ExecutionEngine/JIT.h"
+#include "llvm/Support/Process.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -168,5 +169,96 @@ TEST(MCJITMemoryManagerTest, ManyVariedAllocations) {
   }
 }
 
+TEST(MCJITMemoryManagerTest, SlabPacking) {
+  OwningPtr<SectionMemoryManager> MemMgr(new SectionMemoryManager());
+  uintptr_t PageSize = sys::process::get_self()->page_size();
+
+  // Small sections share a slab.
+  for (unsigned i = 0; i < 100; ++i)
+    EXPECT_NE((uint8_t*)0, MemMgr->allocateCodeSection(64, 0, i));
+  SectionMemoryManager::MemoryStats Stats = MemMgr->getCodeStats();
+  EXPECT_EQ(1U, Stats.NumSlabs);
+  EXPECT_EQ(6400U, Stats.SectionBytes);
+  EXPECT_EQ(6400U, Stats.UsedBytes);
+
+  // Once the code is protected, new sections start on a fresh page of the
+  // same slab.
+  std::string Error;
+  EXPECT_FALSE(MemMgr->applyPermissions(&Error));
+  uint8_t *Code = MemMgr->allocateCodeSection(64, 0, 100);
+  EXPECT_EQ((uintptr_t)0, (uintptr_t)Code % PageSize);
+  Code[0] = 1;
+  EXPECT_EQ(1U, MemMgr->getCodeStats().NumSlabs);
+
+  // Sections larger than a slab get their own.
+  uint8_t *Large = MemMgr->allocateCodeSection(
+    SectionMemoryManager::DefaultSlabSize * 2, 0, 101);
+  EXPECT_NE((uint8_t*)0, Large);
+  EXPECT_EQ(2U, MemMgr->getCodeStats().NumSlabs);
+  EXPECT_EQ(Code + 64, MemMgr->allocateCodeSection(64, 0, 102));
+}
+
+TEST(MCJITMemoryManagerTest, Deallocation) {
+  OwningPtr<SectionMemoryManager> MemMgr(new SectionMemoryManager());
+
+  uint8_t *Data1 = MemMgr->allocateDataSection(256, 0, 1, false);
+  uint8_t *Data2 = MemMgr->allocateDataSection(256, 0, 2, false);
+  uint8_t *Code = MemMgr->allocateCodeSection(256, 0, 3);
+  std::string Error;
+  EXPECT_FALSE(MemMgr->applyPermissions(&Error));
+
+  // Read-write data is reused.
+  MemMgr->deallocateSection(Data1, 256, 1);
+  EXPECT_EQ(256U, MemMgr->getRWDataStats().SectionBytes);
+  uint8_t *Data3 = MemMgr->allocateDataSection(128, 0, 4, false);
+  EXPECT_EQ(Data1, Data3);
+
+  // Slabs are unmapped once they are empty.
+  MemMgr->deallocateSection(Data2, 256, 2);
+  MemMgr->deallocateSection(Data3, 128, 4);
+  MemMgr->deallocateSection(Code, 256, 3);
+  EXPECT_EQ(0U, MemMgr->getRWDataStats().NumSlabs);
+  EXPECT_EQ(0U, MemMgr->getCodeStats().NumSlabs);
+
+  // The memory manager keeps working afterwards.
+  Code = MemMgr->allocateCodeSection(256, 0, 5);
+  EXPECT_NE((uint8_t*)0, Code);
+  Code[255] = 1;
+  EXPECT_EQ(1U, MemMgr->getCodeStats().NumSlabs);
+}
+
+TEST(MCJITMemoryManagerTest, EmptySections) {
+  OwningPtr<SectionMemoryManager> MemMgr(new SectionMemoryManager());
+  uintptr_t SlabSize = SectionMemoryManager::DefaultSlabSize;
+
+  // Fill a slab up to its end.
+  uint8_t *Data1 = MemMgr->allocateDataSection(SlabSize - 16, 16, 1, false);
+  uint8_t *Data2 = MemMgr->allocateDataSection(16, 16, 2, false);
+  EXPECT_EQ(Data1 + SlabSize - 16, Data2);
+  EXPECT_EQ(1U, MemMgr->getRWDataStats().NumSlabs);
+
+  // An empty section doesn't get the address past the end of the slab, which
+  // may be the start of the next one.
+  uint8_t *Empty = MemMgr->allocateDataSection(0, 16, 3, false);
+  EXPECT_NE((uint8_t*)0, Empty);
+  EXPECT_EQ(2U, MemMgr->getRWDataStats().NumSlabs);
+  MemMgr->deallocateSection(Data1, SlabSize - 16, 1);
+  MemMgr->deallocateSection(Data2, 16, 2);
+  EXPECT_EQ(1U, MemMgr->getRWDataStats().NumSlabs);
+  MemMgr->deallocateSection(Empty, 0, 3);
+  EXPECT_EQ(0U, MemMgr->getRWDataStats().NumSlabs);
+
+  // Empty sections next to each other are told apart.
+  uint8_t *Code = MemMgr->allocateCodeSection(64, 0, 4);
+  uint8_t *Empty1 = MemMgr->allocateCodeSection(0, 1, 5);
+  uint8_t *Empty2 = MemMgr->allocateCodeSection(0, 1, 6);
+  EXPECT_NE(Empty1, Empty2);
+  MemMgr->deallocateSection(Empty2, 0, 6);
+  MemMgr->deallocateSection(Code, 64, 4);
+  EXPECT_EQ(1U, MemMgr->getCodeStats().NumSlabs);
+  MemMgr->deallocateSection(Empty1, 0, 5);
+  EXPECT_EQ(0U, MemMgr->getCodeStats().NumSlabs);
+}
+
 } // Namespace
 
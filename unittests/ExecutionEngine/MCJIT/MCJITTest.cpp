@@ -14,6 +14,8 @@
 
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "MCJITTestBase.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -201,35 +203,113 @@ TEST_F(MCJITTest, multiple_empty_modules) {
 }
 */
 
-// FIXME: MCJIT must support multiple modules
-/*
 TEST_F(MCJITTest, multiple_modules) {
   SKIP_UNSUPPORTED_PLATFORM;
 
   Function *Callee = insertAddFunction(M.get());
   createJIT(M.take());
 
+  // Finalize the first module before the second one is added.
+  void *CalleePtr = TheJIT->getPointerToFunction(Callee);
+  TheJIT->finalizeObject();
+  EXPECT_TRUE(0 != CalleePtr);
+
   // caller function is defined in a different module
   M.reset(createEmptyModule("<caller module>"));
 
-  Function *CalleeRef = insertExternalReferenceToFunction(M.get(), Callee);
-  Function *Caller = insertSimpleCallFunction(M.get(), CalleeRef);
+  Function *CalleeRef =
+    insertExternalReferenceToFunction(M.get(), Callee->getName(),
+                                      Callee->getFunctionType());
+  Function *Caller =
+    insertSimpleCallFunction<int32_t(int32_t, int32_t)>(M.get(), CalleeRef);
 
   TheJIT->addModule(M.take());
 
   // get a function pointer in a module that was not used in EE construction
   void *vPtr = TheJIT->getPointerToFunction(Caller);
-  EXPECT_NE(0, vPtr)
+  TheJIT->finalizeObject();
+  EXPECT_TRUE(0 != vPtr)
     << "Unable to get pointer to caller function from JIT";
+  EXPECT_EQ(CalleePtr, TheJIT->getPointerToFunction(CalleeRef));
 
   int(*FuncPtr)(int, int) = (int(*)(int, int))(intptr_t)vPtr;
   EXPECT_EQ(0, FuncPtr(0, 0));
   EXPECT_EQ(30, FuncPtr(10, 20));
   EXPECT_EQ(-30, FuncPtr(-10, -20));
+}
+
+TEST_F(MCJITTest, remove_module) {
+  SKIP_UNSUPPORTED_PLATFORM;
 
-  // ensure caller is destroyed before callee (free use before def)
-  M.reset();
+  insertAddFunction(M.get());
+  createJIT(M.take());
+  TheJIT->finalizeObject();
+
+  // Load a module, then unload it again.
+  Module *Removed = createEmptyModule("<removed module>");
+  Function *Old = insertMainFunction(Removed, 1);
+  TheJIT->addModule(Removed);
+  EXPECT_TRUE(0 != TheJIT->getPointerToFunction(Old));
+  TheJIT->finalizeObject();
+
+  EXPECT_TRUE(TheJIT->removeModule(Removed));
+  EXPECT_FALSE(TheJIT->removeModule(Removed));
+  delete Removed;
+
+  // Its symbols are gone, so a new module can define them again.
+  M.reset(createEmptyModule("<new module>"));
+  Function *New = insertMainFunction(M.get(), 2);
+  TheJIT->addModule(M.take());
+  void *vPtr = TheJIT->getPointerToFunction(New);
+  TheJIT->finalizeObject();
+  EXPECT_TRUE(0 != vPtr);
+
+  int (*FuncPtr)(void) = (int(*)(void))(intptr_t)vPtr;
+  EXPECT_EQ(2, FuncPtr());
+}
+
+/// KeyRecordingCache - An ObjectCache that never has the object, and records
+/// the keys it is asked for.
+class KeyRecordingCache : public ObjectCache {
+public:
+  std::vector<std::string> Keys;
+
+  virtual MemoryBuffer *getObject(StringRef Key) {
+    Keys.push_back(Key);
+    return 0;
+  }
+  virtual void notifyObjectCompiled(StringRef, const MemoryBuffer *) {}
+};
+
+// An object compiled with some target options must not be found in the cache
+// when the same module is compiled with different ones.
+TEST_F(MCJITTest, object_cache_key_covers_target_options) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  TargetOptions Variants[5];
+  Variants[1].NoFramePointerElim = true;
+  Variants[2].SSPBufferSize = 4;
+  Variants[3].TrapFuncName = "abort";
+  Variants[4].AllowFPOpFusion = FPOpFusion::Fast;
+
+  KeyRecordingCache Cache;
+  for (unsigned I = 0; I != array_lengthof(Variants) + 1; ++I) {
+    // Compile with the default options once more at the end.
+    Options = Variants[I % array_lengthof(Variants)];
+    if (TheJIT)
+      MM = new SectionMemoryManager();
+    M.reset(createEmptyModule("<main>"));
+    Function *F = insertAddFunction(M.get());
+    createJIT(M.take());
+    TheJIT->setObjectCache(&Cache);
+    EXPECT_TRUE(0 != TheJIT->getPointerToFunction(F));
+  }
+
+  ASSERT_EQ(array_lengthof(Variants) + 1, Cache.Keys.size());
+  for (unsigned I = 0; I != array_lengthof(Variants); ++I)
+    for (unsigned J = 0; J != I; ++J)
+      EXPECT_NE(Cache.Keys[J], Cache.Keys[I]);
+  EXPECT_EQ(Cache.Keys[0], Cache.Keys.back());
 }
-*/
 
 }
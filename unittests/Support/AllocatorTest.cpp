@@ -31,6 +31,34 @@ TEST(AllocatorTest, Basics) {
   EXPECT_EQ(1U, Alloc.GetNumSlabs());
 }
 
+// Check that the per-thread byte counters see both allocators.
+TEST(AllocatorTest, ByteCounters) {
+  bool SavedCountAllocatorBytes = CountAllocatorBytes;
+  const AllocatorByteCounts &Counts = getAllocatorByteCounts();
+
+  // Nothing is counted unless asked for.
+  CountAllocatorBytes = false;
+  uint64_t StartBumpPtr = Counts.BumpPtrBytes;
+  BumpPtrAllocator Alloc;
+  Alloc.Allocate(100, 0);
+  EXPECT_EQ(StartBumpPtr, Counts.BumpPtrBytes);
+
+  CountAllocatorBytes = true;
+  Alloc.Allocate(100, 0);
+  Alloc.Allocate<uint64_t>(4);
+  EXPECT_EQ(StartBumpPtr + 132, Counts.BumpPtrBytes);
+
+  uint64_t StartMalloc = Counts.MallocBytes;
+  MallocAllocator Malloc;
+  void *P = Malloc.Allocate(64, 0);
+  uint32_t *Q = Malloc.Allocate<uint32_t>(8);
+  EXPECT_EQ(StartMalloc + 96, Counts.MallocBytes);
+  Malloc.Deallocate(P);
+  Malloc.Deallocate(Q);
+
+  CountAllocatorBytes = SavedCountAllocatorBytes;
+}
+
 // Allocate enough bytes to create three slabs.
 TEST(AllocatorTest, ThreeSlabs) {
   BumpPtrAllocator Alloc(4096, 4096);
@@ -0,0 +1,164 @@
+//===- llvm/unittest/Support/ThreadPoolTest.cpp - ThreadPool tests --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+void increment(void *Arg) {
+  sys::AtomicIncrement(static_cast<volatile sys::cas_flag *>(Arg));
+}
+
+TEST(ThreadPoolTest, AsyncAndWait) {
+  sys::cas_flag Count = 0;
+  {
+    ThreadPool Pool(4);
+    for (unsigned i = 0; i != 1000; ++i)
+      Pool.async(increment, &Count);
+    Pool.wait();
+    EXPECT_EQ(1000, (int)Count);
+
+    // The pool can be reused after waiting.
+    for (unsigned i = 0; i != 1000; ++i)
+      Pool.async(increment, &Count);
+  }
+  // Destroying the pool waits for the outstanding tasks.
+  EXPECT_EQ(2000, (int)Count);
+}
+
+struct FibState {
+  ThreadPool *Pool;
+  unsigned N;
+  unsigned Result;
+};
+
+void fibTask(void *Arg) {
+  FibState *State = static_cast<FibState *>(Arg);
+  if (State->N < 2) {
+    State->Result = State->N;
+    return;
+  }
+
+  // Spawn the subproblems from within a task and wait for them there.
+  FibState A = { State->Pool, State->N - 1, 0 };
+  FibState B = { State->Pool, State->N - 2, 0 };
+  TaskGroup Group(*State->Pool);
+  Group.spawn(fibTask, &A);
+  Group.spawn(fibTask, &B);
+  Group.wait();
+  State->Result = A.Result + B.Result;
+}
+
+TEST(ThreadPoolTest, NestedTaskGroups) {
+  ThreadPool Pool(3);
+  FibState State = { &Pool, 15, 0 };
+  TaskGroup Group(Pool);
+  Group.spawn(fibTask, &State);
+  Group.wait();
+  EXPECT_EQ(610U, State.Result);
+}
+
+TEST(ThreadPoolTest, SingleThreadNestedWait) {
+  // Waiting inside the only worker must not deadlock.
+  ThreadPool Pool(1);
+  FibState State = { &Pool, 10, 0 };
+  Pool.async(fibTask, &State);
+  Pool.wait();
+  EXPECT_EQ(55U, State.Result);
+}
+
+TEST(ThreadPoolTest, IndependentGroups) {
+  ThreadPool Pool(2);
+  sys::cas_flag CountA = 0, CountB = 0;
+  TaskGroup A(Pool), B(Pool);
+  for (unsigned i = 0; i != 100; ++i) {
+    A.spawn(increment, &CountA);
+    B.spawn(increment, &CountB);
+  }
+  A.wait();
+  EXPECT_EQ(100, (int)CountA);
+  B.wait();
+  EXPECT_EQ(100, (int)CountB);
+}
+
+struct Square {
+  void operator()(unsigned &X) const { X = X * X; }
+};
+
+TEST(ThreadPoolTest, ParallelForEach) {
+  ThreadPool Pool(4);
+  std::vector<unsigned> V;
+  for (unsigned i = 0; i != 1001; ++i)
+    V.push_back(i);
+
+  parallel_for_each(Pool, V.begin(), V.end(), Square());
+  for (unsigned i = 0; i != 1001; ++i)
+    EXPECT_EQ(i * i, V[i]);
+
+  // Empty and tiny ranges.
+  parallel_for_each(Pool, V.begin(), V.begin(), Square());
+  parallel_for_each(Pool, V.begin(), V.begin() + 1, Square());
+  EXPECT_EQ(0U, V[0]);
+  EXPECT_EQ(1U, V[1]);
+}
+
+TEST(ThreadPoolTest, ParallelForEachGlobalPool) {
+  std::vector<unsigned> V(100, 3);
+  parallel_for_each(V.begin(), V.end(), Square());
+  for (unsigned i = 0; i != 100; ++i)
+    EXPECT_EQ(9U, V[i]);
+}
+
+/// SequencedWorker - Claims task numbers in increasing order and appends
+/// each of them to a shared vector after waiting for its predecessors.
+struct SequencedWorker {
+  TaskSequencer *Sequencer;
+  volatile sys::cas_flag *NextTask;
+  unsigned NumTasks;
+  std::vector<unsigned> *Order;
+
+  static void run(void *Arg) {
+    SequencedWorker *W = static_cast<SequencedWorker *>(Arg);
+    for (;;) {
+      unsigned Task = sys::AtomicIncrement(W->NextTask) - 1;
+      if (Task >= W->NumTasks)
+        return;
+      // Only every third task needs the order, the others just finish.
+      if (Task % 3 == 0) {
+        W->Sequencer->waitForPredecessors(Task);
+        W->Order->push_back(Task);
+      }
+      W->Sequencer->finish(Task);
+    }
+  }
+};
+
+TEST(ThreadPoolTest, TaskSequencer) {
+  const unsigned NumTasks = 300;
+  TaskSequencer Sequencer(NumTasks);
+  sys::cas_flag NextTask = 0;
+  std::vector<unsigned> Order;
+  SequencedWorker W = { &Sequencer, &NextTask, NumTasks, &Order };
+  {
+    ThreadPool Pool(4);
+    for (unsigned i = 0; i != 4; ++i)
+      Pool.async(SequencedWorker::run, &W);
+    Pool.wait();
+  }
+  EXPECT_EQ(NumTasks, Sequencer.getNumFinishedInOrder());
+  ASSERT_EQ(NumTasks / 3, Order.size());
+  for (unsigned i = 0, e = Order.size(); i != e; ++i)
+    EXPECT_EQ(i * 3, Order[i]);
+}
+
+} // anonymous namespace
@@ -8,11 +8,15 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/Constants.h"
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 namespace llvm {
@@ -224,5 +228,72 @@ TEST(ConstantsTest, AsInstructionsTest) {
 
 #undef CHECK
 
+static unsigned getNumEntries(LLVMContext &Context, StringRef Table) {
+  SmallVector<LLVMContext::UniquingTableInfo, 32> Tables;
+  Context.getUniquingTableInfo(Tables);
+  for (unsigned i = 0, e = Tables.size(); i != e; ++i)
+    if (Table == Tables[i].Name)
+      return Tables[i].NumEntries;
+  ADD_FAILURE() << "No table " << Table.str();
+  return 0;
+}
+
+TEST(ConstantsTest, CompactUniquingTables) {
+  LLVMContext Context;
+  OwningPtr<Module> M(new Module("MyModule", Context));
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  Type *Int32PtrTy = Type::getInt32PtrTy(Context);
+  GlobalVariable *Global =
+    new GlobalVariable(*M, Int32Ty, true, GlobalValue::ExternalLinkage, 0,
+                       "dummy");
+
+  // Kept alive by a use from the initializer of G.
+  Constant *Used = ConstantExpr::getAdd(ConstantExpr::getPtrToInt(Global,
+                                                                 Int32Ty),
+                                        ConstantInt::get(Int32Ty, 2));
+  new GlobalVariable(*M, Int32Ty, true, GlobalValue::ExternalLinkage, Used,
+                     "G");
+  // Kept alive by the value handle of a metadata operand.
+  Constant *InMetadata = ConstantInt::get(Int32Ty, 3);
+  Value *Ops[] = { InMetadata };
+  MDNode *N = MDNode::get(Context, Ops);
+  M->getOrInsertNamedMetadata("md")->addOperand(N);
+
+  // Nothing refers to these.
+  ConstantInt::get(Int32Ty, 100);
+  ConstantExpr::getPtrToInt(Global, Type::getInt64Ty(Context));
+  Constant *Elts[] = { ConstantExpr::getBitCast(Global,
+                                                Type::getInt8PtrTy(Context)),
+                       ConstantPointerNull::get(cast<PointerType>(Int32PtrTy))
+                     };
+  ConstantStruct::getAnon(Elts);
+  UndefValue::get(Int32PtrTy);
+
+  EXPECT_EQ(4U, getNumEntries(Context, "ExprConstants"));
+  EXPECT_EQ(1U, getNumEntries(Context, "StructConstants"));
+
+  // The struct goes in the first round, and the bitcast and null pointer only
+  // after it. All integers but 2 and 3 are unused.
+  unsigned NumInts = getNumEntries(Context, "IntConstants");
+  EXPECT_EQ(5U + NumInts - 2, Context.compactUniquingTables());
+  EXPECT_EQ(0U, Context.compactUniquingTables());
+
+  EXPECT_EQ(2U, getNumEntries(Context, "IntConstants"));
+  EXPECT_EQ(2U, getNumEntries(Context, "ExprConstants"));
+  EXPECT_EQ(0U, getNumEntries(Context, "StructConstants"));
+  EXPECT_EQ(0U, getNumEntries(Context, "CPNConstants"));
+  EXPECT_EQ(0U, getNumEntries(Context, "UVConstants"));
+  EXPECT_EQ(Used, ConstantExpr::getAdd(ConstantExpr::getPtrToInt(Global,
+                                                                Int32Ty),
+                                       ConstantInt::get(Int32Ty, 2)));
+  EXPECT_EQ(InMetadata, N->getOperand(0));
+  EXPECT_EQ(InMetadata, ConstantInt::get(Int32Ty, 3));
+
+  std::string Output;
+  raw_string_ostream OS(Output);
+  Context.printUniquingTableInfo(OS);
+  EXPECT_NE(std::string::npos, OS.str().find("IntConstants"));
+}
+
 }  // end anonymous namespace
 }  // end namespace llvm
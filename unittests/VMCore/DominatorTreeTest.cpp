@@ -1,5 +1,9 @@
 #include "llvm/Analysis/Dominators.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Assembly/Parser.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -187,6 +191,253 @@ namespace llvm {
       Passes.add(P);
       Passes.run(*M);
     }
+
+    /// DomTreeUpdateTest - Changes the CFG of a function with no values but
+    /// the arguments, and checks that an incrementally updated tree matches
+    /// a recalculated one.
+    class DomTreeUpdateTest : public testing::Test {
+    protected:
+      virtual void SetUp() {
+        M.reset(new Module("updates", Ctx));
+        Type *Params[] = { Type::getInt1Ty(Ctx), Type::getInt32Ty(Ctx) };
+        FunctionType *FTy = FunctionType::get(Type::getVoidTy(Ctx), Params,
+                                              /*isVarArg=*/false);
+        F = Function::Create(FTy, Function::ExternalLinkage, "f", M.get());
+        Function::arg_iterator AI = F->arg_begin();
+        Cond = AI++;
+        Sel = AI;
+        Seed = 1;
+      }
+
+      unsigned random(unsigned N) {
+        Seed = Seed * 1103515245 + 12345;
+        return (Seed >> 16) % N;
+      }
+
+      BasicBlock *addBlock() {
+        BasicBlock *BB = BasicBlock::Create(Ctx, "", F);
+        ReturnInst::Create(Ctx, BB);
+        return BB;
+      }
+
+      /// setSuccessors - Replace the terminator of BB with one branching to
+      /// Succs, and record the changed edges in Updates.
+      void setSuccessors(BasicBlock *BB, ArrayRef<BasicBlock*> Succs,
+                         DomTreeUpdates &Updates) {
+        SmallPtrSet<BasicBlock*, 4> Old(succ_begin(BB), succ_end(BB));
+        SmallPtrSet<BasicBlock*, 4> New(Succs.begin(), Succs.end());
+        for (SmallPtrSet<BasicBlock*, 4>::iterator I = Old.begin(),
+             E = Old.end(); I != E; ++I)
+          if (!New.count(*I))
+            Updates.deleteEdge(BB, *I);
+        for (SmallPtrSet<BasicBlock*, 4>::iterator I = New.begin(),
+             E = New.end(); I != E; ++I)
+          if (!Old.count(*I))
+            Updates.insertEdge(BB, *I);
+
+        BB->getTerminator()->eraseFromParent();
+        IRBuilder<> Builder(BB);
+        if (Succs.empty()) {
+          Builder.CreateRetVoid();
+        } else if (Succs.size() == 1) {
+          Builder.CreateBr(Succs[0]);
+        } else if (Succs.size() == 2) {
+          Builder.CreateCondBr(Cond, Succs[0], Succs[1]);
+        } else {
+          SwitchInst *SI = Builder.CreateSwitch(Sel, Succs[0],
+                                                Succs.size() - 1);
+          for (unsigned i = 1, e = Succs.size(); i != e; ++i)
+            SI->addCase(Builder.getInt32(i), Succs[i]);
+        }
+      }
+
+      void expectUpToDate(DominatorTreeBase<BasicBlock> &DT) {
+        DominatorTreeBase<BasicBlock> Fresh(false);
+        Fresh.recalculate(*F);
+        EXPECT_FALSE(DT.compare(Fresh));
+      }
+
+      LLVMContext Ctx;
+      OwningPtr<Module> M;
+      Function *F;
+      Value *Cond, *Sel;
+      unsigned Seed;
+    };
+
+    TEST_F(DomTreeUpdateTest, InsertAndDeleteEdges) {
+      // entry -> a -> b -> c, entry -> d -> c
+      BasicBlock *Entry = addBlock(), *A = addBlock(), *B = addBlock();
+      BasicBlock *C = addBlock(), *D = addBlock();
+      DomTreeUpdates Updates;
+      BasicBlock *EntrySuccs[] = { A, D };
+      setSuccessors(Entry, EntrySuccs, Updates);
+      setSuccessors(A, B, Updates);
+      setSuccessors(B, C, Updates);
+      setSuccessors(D, C, Updates);
+      DominatorTreeBase<BasicBlock> DT(false);
+      DT.recalculate(*F);
+      EXPECT_EQ(A, DT.getNode(B)->getIDom()->getBlock());
+      EXPECT_EQ(Entry, DT.getNode(C)->getIDom()->getBlock());
+
+      // a -> c makes a the idom of nothing new, but d -> b moves b up.
+      Updates.clear();
+      BasicBlock *DSuccs[] = { C, B };
+      setSuccessors(D, DSuccs, Updates);
+      DT.applyUpdates(Updates);
+      EXPECT_EQ(Entry, DT.getNode(B)->getIDom()->getBlock());
+      expectUpToDate(DT);
+
+      // Without entry -> d, d becomes unreachable and a dominates b and c.
+      Updates.clear();
+      setSuccessors(Entry, A, Updates);
+      DT.applyUpdates(Updates);
+      EXPECT_FALSE(DT.isReachableFromEntry(D));
+      EXPECT_EQ(A, DT.getNode(B)->getIDom()->getBlock());
+      EXPECT_EQ(B, DT.getNode(C)->getIDom()->getBlock());
+      expectUpToDate(DT);
+
+      // Reaching d again brings back its node.
+      DT.insertEdge(Entry, D);
+      EXPECT_FALSE(DT.isReachableFromEntry(D));
+      Updates.clear();
+      setSuccessors(Entry, EntrySuccs, Updates);
+      DT.applyUpdates(Updates);
+      EXPECT_TRUE(DT.isReachableFromEntry(D));
+      EXPECT_EQ(Entry, DT.getNode(C)->getIDom()->getBlock());
+      expectUpToDate(DT);
+    }
+
+    TEST_F(DomTreeUpdateTest, UnreachableRegionWithExit) {
+      // entry -> a -> b -> c -> d -> e, a -> x -> e. Cutting b -> c makes
+      // c and d unreachable, and x becomes the idom of e although e is not
+      // below the nearest common dominator of b and c.
+      BasicBlock *Entry = addBlock(), *A = addBlock(), *B = addBlock();
+      BasicBlock *C = addBlock(), *D = addBlock(), *E = addBlock();
+      BasicBlock *X = addBlock();
+      DomTreeUpdates Updates;
+      setSuccessors(Entry, A, Updates);
+      BasicBlock *ASuccs[] = { B, X };
+      setSuccessors(A, ASuccs, Updates);
+      setSuccessors(B, C, Updates);
+      setSuccessors(C, D, Updates);
+      setSuccessors(D, E, Updates);
+      setSuccessors(X, E, Updates);
+      DominatorTreeBase<BasicBlock> DT(false);
+      DT.recalculate(*F);
+      EXPECT_EQ(A, DT.getNode(E)->getIDom()->getBlock());
+
+      DT.deleteEdge(B, C);
+      EXPECT_EQ(A, DT.getNode(E)->getIDom()->getBlock());
+      Updates.clear();
+      setSuccessors(B, ArrayRef<BasicBlock*>(), Updates);
+      DT.applyUpdates(Updates);
+      EXPECT_FALSE(DT.isReachableFromEntry(C));
+      EXPECT_FALSE(DT.isReachableFromEntry(D));
+      EXPECT_EQ(X, DT.getNode(E)->getIDom()->getBlock());
+      expectUpToDate(DT);
+    }
+
+    TEST_F(DomTreeUpdateTest, NewAndErasedBlocks) {
+      // entry -> a -> b -> c, a -> c
+      BasicBlock *Entry = addBlock(), *A = addBlock(), *B = addBlock();
+      BasicBlock *C = addBlock();
+      DomTreeUpdates Updates;
+      setSuccessors(Entry, A, Updates);
+      BasicBlock *ASuccs[] = { B, C };
+      setSuccessors(A, ASuccs, Updates);
+      setSuccessors(B, C, Updates);
+      DominatorTreeBase<BasicBlock> DT(false);
+      DT.recalculate(*F);
+
+      // Split a -> c with a new block.
+      Updates.clear();
+      BasicBlock *N = addBlock();
+      setSuccessors(N, C, Updates);
+      BasicBlock *NewASuccs[] = { B, N };
+      setSuccessors(A, NewASuccs, Updates);
+      DT.applyUpdates(Updates);
+      EXPECT_EQ(A, DT.getNode(N)->getIDom()->getBlock());
+      expectUpToDate(DT);
+
+      // Fold b into its only predecessor by branching to c directly, and
+      // erase it.
+      Updates.clear();
+      BasicBlock *FoldedASuccs[] = { C, N };
+      setSuccessors(A, FoldedASuccs, Updates);
+      Updates.deleteEdge(B, C);
+      Updates.deleteBlock(B);
+      B->eraseFromParent();
+      DT.applyUpdates(Updates);
+      EXPECT_EQ(0, DT.getNode(B));
+      EXPECT_EQ(A, DT.getNode(C)->getIDom()->getBlock());
+      expectUpToDate(DT);
+    }
+
+    TEST_F(DomTreeUpdateTest, RandomBatches) {
+      SmallVector<BasicBlock*, 32> Blocks;
+      for (unsigned i = 0; i != 24; ++i)
+        Blocks.push_back(addBlock());
+
+      DomTreeUpdates Updates;
+      SmallVector<BasicBlock*, 4> Succs;
+      for (unsigned i = 0, e = Blocks.size(); i != e; ++i) {
+        Succs.clear();
+        for (unsigned j = 0, n = random(4); j != n; ++j)
+          Succs.push_back(Blocks[random(Blocks.size())]);
+        setSuccessors(Blocks[i], Succs, Updates);
+      }
+      DominatorTreeBase<BasicBlock> DT(false);
+      DT.recalculate(*F);
+
+      for (unsigned Round = 0; Round != 200; ++Round) {
+        Updates.clear();
+        for (unsigned Change = 0, n = 1 + random(3); Change != n; ++Change) {
+          unsigned Kind = random(8);
+          if (Kind == 0) {
+            // Add a block on a new edge.
+            BasicBlock *From = Blocks[random(Blocks.size())];
+            BasicBlock *NewBB = addBlock();
+            Succs.clear();
+            Succs.append(succ_begin(From), succ_end(From));
+            Succs.push_back(NewBB);
+            setSuccessors(From, Succs, Updates);
+            Succs.assign(1, Blocks[random(Blocks.size())]);
+            setSuccessors(NewBB, Succs, Updates);
+            Blocks.push_back(NewBB);
+          } else if (Kind == 1 && Blocks.size() > 8) {
+            // Erase a block after removing the edges to it.
+            unsigned Index = 1 + random(Blocks.size() - 1);
+            BasicBlock *BB = Blocks[Index];
+            Blocks.erase(Blocks.begin() + Index);
+            SmallVector<BasicBlock*, 8> Preds(pred_begin(BB), pred_end(BB));
+            SmallPtrSet<BasicBlock*, 8> Visited;
+            for (unsigned i = 0, e = Preds.size(); i != e; ++i) {
+              if (Preds[i] == BB || !Visited.insert(Preds[i]))
+                continue;
+              Succs.clear();
+              for (succ_iterator SI = succ_begin(Preds[i]),
+                   SE = succ_end(Preds[i]); SI != SE; ++SI)
+                if (*SI != BB)
+                  Succs.push_back(*SI);
+              setSuccessors(Preds[i], Succs, Updates);
+            }
+            for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB);
+                 SI != SE; ++SI)
+              Updates.deleteEdge(BB, *SI);
+            Updates.deleteBlock(BB);
+            BB->eraseFromParent();
+          } else {
+            // Retarget the terminator of a block.
+            Succs.clear();
+            for (unsigned j = 0, n = random(4); j != n; ++j)
+              Succs.push_back(Blocks[random(Blocks.size())]);
+            setSuccessors(Blocks[random(Blocks.size())], Succs, Updates);
+          }
+        }
+        DT.applyUpdates(Updates);
+        expectUpToDate(DT);
+      }
+    }
   }
 }
 
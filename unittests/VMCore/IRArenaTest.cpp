@@ -0,0 +1,179 @@
+//===- llvm/unittest/VMCore/IRArenaTest.cpp - IRArena tests ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/IRArena.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+class IRArenaTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    M.reset(new Module("MyModule", Ctx));
+    Type *I32 = Type::getInt32Ty(Ctx);
+    Type *Params[] = { I32, I32 };
+    FTy = FunctionType::get(I32, Params, /*isVarArg=*/false);
+  }
+
+  /// buildFunction - Create a function with a loop, which needs a PHI node
+  /// with hung-off operands, and a switch.
+  Function *buildFunction(const char *Name) {
+    Function *F = Function::Create(FTy, Function::ExternalLinkage, Name,
+                                   M.get());
+    Function::arg_iterator AI = F->arg_begin();
+    Value *A = AI++, *B = AI;
+    BasicBlock *Entry = BasicBlock::Create(Ctx, "entry", F);
+    BasicBlock *Loop = BasicBlock::Create(Ctx, "loop", F);
+    BasicBlock *Exit = BasicBlock::Create(Ctx, "exit", F);
+
+    IRBuilder<> Builder(Entry);
+    Builder.CreateBr(Loop);
+    Builder.SetInsertPoint(Loop);
+    PHINode *Phi = Builder.CreatePHI(A->getType(), 2);
+    Phi->addIncoming(A, Entry);
+    Value *Next = Builder.CreateAdd(Phi, Builder.CreateMul(B, B));
+    Phi->addIncoming(Next, Loop);
+    SwitchInst *SI = Builder.CreateSwitch(Next, Loop, 1);
+    SI->addCase(Builder.getInt32(42), Exit);
+    Builder.SetInsertPoint(Exit);
+    Builder.CreateRet(Next);
+    return F;
+  }
+
+  LLVMContext Ctx;
+  OwningPtr<Module> M;
+  FunctionType *FTy;
+};
+
+TEST_F(IRArenaTest, NoScope) {
+  IRArena Arena;
+  EXPECT_EQ(0, IRArena::getCurrent());
+  buildFunction("f");
+  EXPECT_EQ(0U, Arena.getNumAllocations());
+  EXPECT_EQ(0U, Arena.getBytesReserved());
+}
+
+TEST_F(IRArenaTest, Scopes) {
+  IRArena Outer, Inner;
+  {
+    IRArenaScope OuterScope(Outer);
+    EXPECT_EQ(&Outer, IRArena::getCurrent());
+    {
+      IRArenaScope InnerScope(Inner);
+      EXPECT_EQ(&Inner, IRArena::getCurrent());
+    }
+    EXPECT_EQ(&Outer, IRArena::getCurrent());
+  }
+  EXPECT_EQ(0, IRArena::getCurrent());
+}
+
+TEST_F(IRArenaTest, FunctionLifetime) {
+  IRArena Arena;
+  Function *F;
+  {
+    IRArenaScope Scope(Arena);
+    F = buildFunction("f");
+  }
+  EXPECT_LT(0U, Arena.getNumAllocations());
+  EXPECT_EQ(Arena.getNumAllocations(), Arena.getNumLiveObjects());
+  EXPECT_LT(0U, Arena.getBytesReserved());
+
+  // Constants are owned by the context and must survive the arena.
+  ConstantInt *C = ConstantInt::get(Type::getInt32Ty(Ctx), 42);
+
+  // Instructions may be erased outside of the scope.
+  Instruction *Ret = F->back().getTerminator();
+  Ret->eraseFromParent();
+  EXPECT_EQ(Arena.getNumAllocations() - 1, Arena.getNumLiveObjects());
+
+  F->eraseFromParent();
+  EXPECT_EQ(0U, Arena.getNumLiveObjects());
+  EXPECT_EQ(C, ConstantInt::get(Type::getInt32Ty(Ctx), 42));
+}
+
+TEST_F(IRArenaTest, Reuse) {
+  IRArena Arena;
+  IRArenaScope Scope(Arena);
+  Function *F = buildFunction("f");
+  uint64_t Reserved = Arena.getBytesReserved();
+  F->eraseFromParent();
+  EXPECT_EQ(0U, Arena.getNumReused());
+
+  // A second function of the same shape fits into the memory of the first.
+  F = buildFunction("g");
+  EXPECT_LT(0U, Arena.getNumReused());
+  EXPECT_EQ(Reserved, Arena.getBytesReserved());
+  F->eraseFromParent();
+  EXPECT_EQ(0U, Arena.getNumLiveObjects());
+}
+
+TEST_F(IRArenaTest, MixedOwners) {
+  // Instructions from the heap and from two arenas, freed in any scope, each
+  // go back to where they came from.
+  Function *Heap = buildFunction("heap");
+  IRArena First, Second;
+  Function *F;
+  {
+    IRArenaScope Scope(First);
+    F = buildFunction("f");
+  }
+  IRArenaScope Scope(Second);
+  Function *G = buildFunction("g");
+  Heap->eraseFromParent();
+  F->eraseFromParent();
+  EXPECT_EQ(0U, First.getNumLiveObjects());
+  EXPECT_EQ(0U, Second.getNumReused());
+  EXPECT_LT(0U, Second.getNumLiveObjects());
+  G->eraseFromParent();
+  EXPECT_EQ(0U, Second.getNumLiveObjects());
+}
+
+TEST_F(IRArenaTest, GrowHungoffUses) {
+  IRArena Arena;
+  IRArenaScope Scope(Arena);
+  Function *F = buildFunction("f");
+  SwitchInst *SI = cast<SwitchInst>(F->getEntryBlock().getNextNode()
+                                      ->getTerminator());
+  // Growing the switch reallocates its operands from the arena.
+  for (unsigned I = 0; I != 100; ++I)
+    SI->addCase(ConstantInt::get(Type::getInt32Ty(Ctx), I), &F->back());
+  EXPECT_EQ(101U, SI->getNumCases());
+  F->eraseFromParent();
+  EXPECT_EQ(0U, Arena.getNumLiveObjects());
+}
+
+TEST_F(IRArenaTest, GrowOutsideScope) {
+  IRArena Arena;
+  Function *F;
+  {
+    IRArenaScope Scope(Arena);
+    F = buildFunction("f");
+  }
+  // The operands of an arena instruction come from its arena even when it
+  // grows after the scope is gone, and go back there when it is deleted.
+  SwitchInst *SI = cast<SwitchInst>(F->getEntryBlock().getNextNode()
+                                      ->getTerminator());
+  uint64_t Allocations = Arena.getNumAllocations();
+  for (unsigned I = 0; I != 100; ++I)
+    SI->addCase(ConstantInt::get(Type::getInt32Ty(Ctx), I), &F->back());
+  EXPECT_LT(Allocations, Arena.getNumAllocations());
+  F->eraseFromParent();
+  EXPECT_EQ(0U, Arena.getNumLiveObjects());
+}
+
+} // end anonymous namespace
@@ -0,0 +1,266 @@
+//===- llvm/unittest/VMCore/ParallelIRTest.cpp - Parallel pass tests ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/ParallelIR.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Analysis/Dominators.h"
+#include "llvm/Analysis/Verifier.h"
+#include "llvm/Assembly/Parser.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/PassManager.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Scalar.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace llvm {
+  void initializeRewriteConstantsPass(PassRegistry&);
+
+  namespace {
+    /// RewriteConstants - A replicable function pass that touches everything
+    /// ParallelIR synchronizes: it creates constants, types and metadata,
+    /// and optionally declares functions in the module.
+    struct RewriteConstants : public FunctionPass {
+      static char ID;
+      static volatile sys::cas_flag NumRuns;
+      bool DeclareHelpers;
+      unsigned NumOwnRuns;
+
+      explicit RewriteConstants(bool DeclareHelpers = true)
+        : FunctionPass(ID), DeclareHelpers(DeclareHelpers), NumOwnRuns(0) {
+        initializeRewriteConstantsPass(*PassRegistry::getPassRegistry());
+      }
+
+      virtual bool runOnFunction(Function &F) {
+        sys::AtomicIncrement(&NumRuns);
+        ++NumOwnRuns;
+        LLVMContext &Ctx = F.getContext();
+        DominatorTree &DT = getAnalysis<DominatorTree>();
+
+        // Call a helper chosen by the number of blocks, so that the order of
+        // the declarations depends on the order of the functions.
+        if (DeclareHelpers) {
+          unsigned Key = F.size() % 5;
+          Type *ArgTy = VectorType::get(Type::getInt32Ty(Ctx), Key + 2);
+          Constant *Helper = F.getParent()->getOrInsertFunction(
+            "helper" + utostr(Key), Type::getVoidTy(Ctx), ArgTy, (Type *)0);
+          IRBuilder<> Builder(&*F.getEntryBlock().getFirstInsertionPt());
+          Builder.CreateCall(Helper, ConstantAggregateZero::get(ArgTy));
+        }
+
+        MDNode *Tag = MDNode::get(Ctx, MDString::get(Ctx, "rewritten"));
+        for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+          if (!DT.isReachableFromEntry(BB))
+            continue;
+          for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE;
+               ++I) {
+            BinaryOperator *BO = dyn_cast<BinaryOperator>(I);
+            if (!BO)
+              continue;
+            ConstantInt *C = dyn_cast<ConstantInt>(BO->getOperand(1));
+            if (!C)
+              continue;
+            BO->setOperand(1, ConstantInt::get(C->getType(),
+                                              C->getZExtValue() * 3 + 1));
+            BO->setMetadata("test", Tag);
+          }
+        }
+        return true;
+      }
+
+      virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+        AU.addRequired<DominatorTree>();
+        AU.setPreservesCFG();
+      }
+
+      virtual Pass *createReplica() const {
+        return new RewriteConstants(DeclareHelpers);
+      }
+    };
+    char RewriteConstants::ID = 0;
+    volatile sys::cas_flag RewriteConstants::NumRuns = 0;
+
+    /// buildModule - Create a module with NumFunctions functions, each with a
+    /// chain of blocks doing arithmetic on constants shared between functions.
+    Module *buildModule(LLVMContext &Ctx, unsigned NumFunctions,
+                        unsigned NumBlocks) {
+      Module *M = new Module("parallel", Ctx);
+      Type *I32 = Type::getInt32Ty(Ctx);
+      FunctionType *FTy = FunctionType::get(I32, I32, /*isVarArg=*/false);
+      for (unsigned FI = 0; FI != NumFunctions; ++FI) {
+        Function *F = Function::Create(FTy, Function::ExternalLinkage,
+                                       "f" + utostr(FI), M);
+        Value *X = F->arg_begin();
+        IRBuilder<> Builder(BasicBlock::Create(Ctx, "entry", F));
+        unsigned Blocks = 1 + (FI * 7 + 3) % NumBlocks;
+        for (unsigned BI = 0; BI != Blocks; ++BI) {
+          X = Builder.CreateAdd(X, Builder.getInt32((FI + BI) % 17));
+          X = Builder.CreateMul(X, Builder.getInt32(BI + 2));
+          BasicBlock *Next = BasicBlock::Create(Ctx, "bb", F);
+          Builder.CreateBr(Next);
+          Builder.SetInsertPoint(Next);
+        }
+        Builder.CreateRet(X);
+      }
+      return M;
+    }
+
+    /// runPasses - Run RewriteConstants and the verifier on a fresh module,
+    /// and return the result as text. The wall time of the run is stored in
+    /// RunTime if it is given.
+    std::string runPasses(unsigned NumThreads, unsigned NumFunctions,
+                          bool DeclareHelpers = true, double *RunTime = 0) {
+      LLVMContext Ctx;
+      OwningPtr<Module> M(buildModule(Ctx, NumFunctions, 10));
+      PassManager Passes;
+      Passes.setNumFunctionThreads(NumThreads);
+      Passes.add(new RewriteConstants(DeclareHelpers));
+      Passes.add(createVerifierPass(ReturnStatusAction));
+      double Start = TimeRecord::getCurrentTime(true).getWallTime();
+      Passes.run(*M);
+      if (RunTime)
+        *RunTime = TimeRecord::getCurrentTime(false).getWallTime() - Start;
+
+      std::string Text;
+      raw_string_ostream OS(Text);
+      M->print(OS, 0);
+      return OS.str();
+    }
+
+    /// runSROA - Run SROA and RewriteConstants on a module whose functions
+    /// keep globals and constant expressions in allocas, and return the
+    /// result as text. Promoting the allocas adds and removes uses of the
+    /// shared values on all threads. NumOwnRuns is set to the number of
+    /// functions the original RewriteConstants pass ran on.
+    std::string runSROA(unsigned NumThreads, unsigned NumFunctions,
+                        unsigned &NumOwnRuns) {
+      std::string Text =
+        "target datalayout = \"e-p:64:64:64-i32:32:32\"\n"
+        "@g = global i32 0\n"
+        "@h = global [4 x i32] zeroinitializer\n";
+      for (unsigned FI = 0; FI != NumFunctions; ++FI) {
+        std::string Elt = utostr(FI % 4);
+        Text += "define i32 @f" + utostr(FI) + "(i32 %x) {\n"
+          "entry:\n"
+          "  %a = alloca i32*\n"
+          "  %b = alloca i32\n"
+          "  store i32* getelementptr ([4 x i32]* @h, i32 0, i32 " + Elt +
+          "), i32** %a\n"
+          "  store i32 %x, i32* %b\n"
+          "  %p = load i32** %a\n"
+          "  %v = load i32* %p\n"
+          "  %w = load i32* %b\n"
+          "  %s = add i32 %v, %w\n"
+          "  %t = mul i32 %s, " + utostr(FI % 7) + "\n"
+          "  store i32 %t, i32* @g\n"
+          "  ret i32 %t\n"
+          "}\n";
+      }
+
+      LLVMContext Ctx;
+      SMDiagnostic Err;
+      OwningPtr<Module> M(ParseAssemblyString(Text.c_str(), 0, Err, Ctx));
+      if (!M)
+        return "";
+      PassManager Passes;
+      Passes.setNumFunctionThreads(NumThreads);
+      Passes.add(new DataLayout(M.get()));
+      Passes.add(createSROAPass());
+      RewriteConstants *P = new RewriteConstants(/*DeclareHelpers=*/false);
+      Passes.add(P);
+      Passes.add(createVerifierPass(ReturnStatusAction));
+      Passes.run(*M);
+      NumOwnRuns = P->NumOwnRuns;
+
+      std::string Result;
+      raw_string_ostream OS(Result);
+      M->print(OS, 0);
+      return OS.str();
+    }
+
+    TEST(ParallelIRTest, SameResultAsSerial) {
+      if (!llvm_is_multithreaded())
+        llvm_start_multithreaded();
+      std::string Serial = runPasses(1, 100);
+
+      RewriteConstants::NumRuns = 0;
+      std::string Parallel = runPasses(4, 100);
+      EXPECT_EQ(100U, RewriteConstants::NumRuns);
+      EXPECT_EQ(Serial, Parallel);
+      EXPECT_FALSE(ParallelIR::isActive());
+    }
+
+    TEST(ParallelIRTest, SharedGlobalsAndConstants) {
+      if (!llvm_is_multithreaded())
+        llvm_start_multithreaded();
+      unsigned NumOwnRuns;
+      std::string Serial = runSROA(1, 100, NumOwnRuns);
+      ASSERT_NE("", Serial);
+      EXPECT_EQ(std::string::npos, Serial.find("alloca"));
+
+      std::string Parallel = runSROA(4, 100, NumOwnRuns);
+      EXPECT_EQ(Serial, Parallel);
+      // The replicas did the work.
+      if (llvm_is_multithreaded())
+        EXPECT_EQ(0U, NumOwnRuns);
+    }
+
+    TEST(ParallelIRTest, OriginalPassesDontRun) {
+      if (!llvm_is_multithreaded())
+        llvm_start_multithreaded();
+      LLVMContext Ctx;
+      OwningPtr<Module> M(buildModule(Ctx, 20, 4));
+      PassManager Passes;
+      Passes.setNumFunctionThreads(3);
+      RewriteConstants *P = new RewriteConstants();
+      Passes.add(P);
+      RewriteConstants::NumRuns = 0;
+      Passes.run(*M);
+      EXPECT_EQ(20U, RewriteConstants::NumRuns);
+      if (llvm_is_multithreaded())
+        EXPECT_EQ(0U, P->NumOwnRuns);
+      else
+        EXPECT_EQ(20U, P->NumOwnRuns);
+    }
+
+    // Prints the wall time of a run on a large module for several thread
+    // counts. Declaring functions would order the functions, so the pass
+    // sticks to the context. Run it with --gtest_also_run_disabled_tests.
+    TEST(ParallelIRTest, DISABLED_Scaling) {
+      if (!llvm_is_multithreaded())
+        llvm_start_multithreaded();
+      const unsigned ThreadCounts[] = { 1, 2, 4, 8 };
+      for (unsigned i = 0; i != array_lengthof(ThreadCounts); ++i) {
+        double Time;
+        runPasses(ThreadCounts[i], 20000, /*DeclareHelpers=*/false, &Time);
+        errs() << format("%u thread(s): %.3fs\n", ThreadCounts[i], Time);
+      }
+    }
+  }
+}
+
+INITIALIZE_PASS_BEGIN(RewriteConstants, "rewrite-constants",
+                      "rewrite-constants", false, false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTree)
+INITIALIZE_PASS_END(RewriteConstants, "rewrite-constants",
+                    "rewrite-constants", false, false)
@@ -0,0 +1,115 @@
+#!/usr/bin/python
+
+# Generates a large synthetic DWARF input for benchmarking the DebugInfo
+# library, e.g. -dwarf-parallel-parse in llvm-symbolizer and llvm-dwarfdump.
+# Writes one module with debug info per compile unit into the output directory;
+# each of them has the given number of functions with one line per instruction.
+# Build an object with many compile units from them like this:
+#
+#   dwarf-many-cus-gen.py -o cus -u 1500 -f 80 -l 16
+#   for f in cus/*.ll; do
+#     llc -mtriple=x86_64-linux-gnu -relocation-model=pic -filetype=obj $f
+#   done
+#   cc -shared -o many-cus.so cus/*.o
+#
+# and symbolize some of its functions:
+#
+#   nm many-cus.so | awk '$2 == "T" { print "many-cus.so 0x" $1 }' \
+#     | head -50 | llvm-symbolizer -dwarf-parallel-parse
+
+# This script runs with Python 2.6+ (including 3.x)
+
+from __future__ import print_function
+
+import optparse
+import os
+
+OPS = ['add', 'mul', 'xor', 'sub']
+
+class Module(object):
+  def __init__(self):
+    self.code = []
+    self.metadata = []
+
+  def node(self, text):
+    self.metadata.append(text)
+    return len(self.metadata) - 1
+
+  def write(self, path, cu):
+    f = open(path, 'w')
+    f.write('\n'.join(self.code))
+    f.write('\n!llvm.dbg.cu = !{{!{0}}}\n'.format(cu))
+    for i, text in enumerate(self.metadata):
+      f.write('!{0} = metadata !{{{1}}}\n'.format(i, text))
+    f.close()
+
+def generate_cu(path, cu, num_functions, num_lines):
+  m = Module()
+  file_name = 'cu{0}.c'.format(cu)
+  cu_node = m.node(None)
+  empty = m.node('i32 0')
+  empty_list = m.node('metadata !{0}'.format(empty))
+  file_node = m.node('i32 786473, metadata !"{0}", metadata !"/tmp", null'
+                     .format(file_name))
+  int_type = m.node('i32 786468, null, metadata !"int", null, i32 0, i64 32, '
+                    'i64 32, i64 0, i32 0, i32 5')
+  arg_types = m.node('metadata !{0}, metadata !{0}'.format(int_type))
+  fn_type = m.node('i32 786453, i32 0, metadata !"", i32 0, i32 0, i64 0, '
+                   'i64 0, i64 0, i32 0, null, metadata !{0}, i32 0, i32 0'
+                   .format(arg_types))
+
+  subprograms = []
+  for f in range(num_functions):
+    name = 'f{0}_{1}'.format(cu, f)
+    first_line = f * (num_lines + 3) + 1
+    sp = m.node('i32 786478, i32 0, metadata !{0}, metadata !"{1}", '
+                'metadata !"{1}", metadata !"", metadata !{0}, i32 {2}, '
+                'metadata !{3}, i1 false, i1 true, i32 0, i32 0, null, '
+                'i32 256, i1 true, i32 (i32)* @{1}, null, null, '
+                'metadata !{4}, i32 {2}'
+                .format(file_node, name, first_line, fn_type, empty_list))
+    subprograms.append(sp)
+
+    m.code.append('define i32 @{0}(i32 %x) nounwind {{'.format(name))
+    m.code.append('entry:')
+    prev = '%x'
+    for l in range(num_lines):
+      loc = m.node('i32 {0}, i32 3, metadata !{1}, null'
+                   .format(first_line + l + 1, sp))
+      m.code.append('  %v{0} = {1} i32 {2}, {3}, !dbg !{4}'
+                    .format(l, OPS[l % len(OPS)], prev, l * 7 + f + 3, loc))
+      prev = '%v{0}'.format(l)
+    loc = m.node('i32 {0}, i32 1, metadata !{1}, null'
+                 .format(first_line + num_lines + 1, sp))
+    m.code.append('  ret i32 {0}, !dbg !{1}'.format(prev, loc))
+    m.code.append('}\n')
+
+  sp_list = m.node(', '.join('metadata !{0}'.format(sp) for sp in subprograms))
+  sp_lists = m.node('metadata !{0}'.format(sp_list))
+  m.metadata[cu_node] = (
+      'i32 786449, i32 0, i32 12, metadata !"{0}", metadata !"/tmp", '
+      'metadata !"dwarf-many-cus-gen", i1 true, i1 true, metadata !"", i32 0, '
+      'metadata !{1}, metadata !{1}, metadata !{2}, metadata !{1}'
+      .format(file_name, empty_list, sp_lists))
+  m.write(path, cu_node)
+
+def main():
+  parser = optparse.OptionParser()
+  parser.add_option('-o', dest='dir', default='.',
+                    help='directory to write the modules to')
+  parser.add_option('-u', dest='cus', type='int', default=1000,
+                    help='number of compile units')
+  parser.add_option('-f', dest='functions', type='int', default=50,
+                    help='number of functions per compile unit')
+  parser.add_option('-l', dest='lines', type='int', default=16,
+                    help='number of lines per function')
+  opts, args = parser.parse_args()
+
+  if not os.path.isdir(opts.dir):
+    os.makedirs(opts.dir)
+  for cu in range(opts.cus):
+    generate_cu(os.path.join(opts.dir, 'cu{0}.ll'.format(cu)), cu,
+                opts.functions, opts.lines)
+
+if __name__ == '__main__':
+  main()
@@ -0,0 +1,50 @@
+#!/usr/bin/python
+
+# Generates a function with many small basic blocks for benchmarking the
+# per-block cost of SelectionDAG instruction selection, e.g. with and without
+# -isel-reuse-dag-storage:
+#
+#   isel-many-blocks-gen.py -b 2000 > blocks.ll
+#   llc -O2 -time-passes blocks.ll -o /dev/null 2>&1 | grep DAG-\>DAG
+#   llc -O2 -time-passes -isel-reuse-dag-storage blocks.ll -o /dev/null \
+#     2>&1 | grep DAG-\>DAG
+#
+# Every block loads, updates and stores an element of an array and branches
+# on the result; every third block also branches back to an earlier block.
+
+# This script runs with Python 2.6+ (including 3.x)
+
+from __future__ import print_function
+
+import optparse
+
+def generate(num_blocks, num_functions):
+  for f in range(num_functions):
+    print('define i32 @f{0}(i32* %p, i32 %n) nounwind {{'.format(f))
+    print('entry:')
+    print('  br label %b0')
+    for i in range(num_blocks):
+      succ = 'b{0}'.format(i + 1) if i + 1 < num_blocks else 'exit'
+      other = 'b{0}'.format((i * 7 + 3) % num_blocks) if i % 3 == 0 else 'exit'
+      print('b{0}:'.format(i))
+      print('  %a{0} = getelementptr i32* %p, i32 {1}'.format(i, i % 64))
+      print('  %l{0} = load i32* %a{0}'.format(i))
+      print('  %s{0} = add i32 %l{0}, {0}'.format(i))
+      print('  store i32 %s{0}, i32* %a{0}'.format(i))
+      print('  %c{0} = icmp slt i32 %s{0}, %n'.format(i))
+      print('  br i1 %c{0}, label %{1}, label %{2}'.format(i, succ, other))
+    print('exit:')
+    print('  ret i32 0')
+    print('}\n')
+
+def main():
+  parser = optparse.OptionParser()
+  parser.add_option('-b', dest='blocks', type='int', default=2000,
+                    help='number of basic blocks per function')
+  parser.add_option('-f', dest='functions', type='int', default=1,
+                    help='number of functions')
+  opts, args = parser.parse_args()
+  generate(opts.blocks, opts.functions)
+
+if __name__ == '__main__':
+  main()
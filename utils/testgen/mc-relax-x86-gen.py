@@ -0,0 +1,54 @@
+#!/usr/bin/python
+
+# Generates a large x86-64 assembly file for benchmarking relaxation in the MC
+# assembler. Every function is a run of blocks of filler instructions that end
+# in conditional and unconditional jumps to nearby blocks. The distances are
+# chosen so that some jumps only need the long encoding once others have been
+# relaxed, which takes several relaxation rounds to settle:
+#
+#   mc-relax-x86-gen.py -f 2000 -b 100 > relax.s
+#   llvm-mc -filetype=obj -triple x86_64-linux-gnu -stats relax.s -o relax.o
+
+# This script runs with Python 2.6+ (including 3.x)
+
+from __future__ import print_function
+
+import optparse
+import random
+
+FILLER = ['  addl %eax, %ecx',
+          '  movl $1234567, %edx',
+          '  leaq 16(%rsp,%rcx,4), %rsi',
+          '  imull $100, %esi, %edi',
+          '  movq %rax, 24(%rsp)']
+
+def generate(num_functions, num_blocks, seed):
+  rng = random.Random(seed)
+  print('  .text')
+  for f in range(num_functions):
+    print('  .globl f{0}'.format(f))
+    print('  .align 16, 0x90')
+    print('f{0}:'.format(f))
+    for b in range(num_blocks):
+      print('.Lf{0}_{1}:'.format(f, b))
+      for i in range(rng.randint(2, 8)):
+        print(rng.choice(FILLER))
+      target = min(max(b + rng.randint(-4, 6), 0), num_blocks)
+      jump = 'jmp' if rng.random() < 0.3 else 'jne'
+      print('  {0} .Lf{1}_{2}'.format(jump, f, target))
+    print('.Lf{0}_{1}:'.format(f, num_blocks))
+    print('  ret')
+
+def main():
+  parser = optparse.OptionParser()
+  parser.add_option('-f', dest='functions', type='int', default=1000,
+                    help='number of functions')
+  parser.add_option('-b', dest='blocks', type='int', default=100,
+                    help='number of blocks per function')
+  parser.add_option('-s', dest='seed', type='int', default=1,
+                    help='random seed')
+  opts, args = parser.parse_args()
+  generate(opts.functions, opts.blocks, opts.seed)
+
+if __name__ == '__main__':
+  main()
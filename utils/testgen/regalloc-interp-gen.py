@@ -0,0 +1,89 @@
+#!/usr/bin/python
+
+# Generates interpreter-style functions for benchmarking the greedy register
+# allocator: a dispatch loop with a large switch whose cases update a set of
+# values that are live around the whole loop, so that there are more of them
+# than registers. Some cases call out, which adds register mask interference.
+#
+#   regalloc-interp-gen.py -c 400 -v 24 -f 4 > interp.ll
+#   llc -O2 -regalloc-time-functions interp.ll -o /dev/null
+#
+# -regalloc-time-functions prints the time spent in register allocation for
+# each function; -time-passes gives the totals.
+
+# This script runs with Python 2.6+ (including 3.x)
+
+from __future__ import print_function
+
+import optparse
+
+OPS = ['add', 'sub', 'xor', 'mul', 'and', 'or']
+
+def generate(num_cases, num_values, num_functions):
+  print('declare i32 @callout(i32, i32)\n')
+  for f in range(num_functions):
+    print('define void @interp{0}(i8* %code, i32* %regs, i32 %n) {{'.format(f))
+    print('entry:')
+    for v in range(num_values):
+      print('  %a{0} = getelementptr i32* %regs, i32 {0}'.format(v))
+      print('  %i{0} = load i32* %a{0}'.format(v))
+    print('  br label %loop')
+
+    print('loop:')
+    print('  %pc = phi i32 [ 0, %entry ], [ %pc.next, %latch ]')
+    for v in range(num_values):
+      print('  %v{0} = phi i32 [ %i{0}, %entry ], [ %n{0}, %latch ]'
+            .format(v))
+    print('  %ip = getelementptr i8* %code, i32 %pc')
+    print('  %op = load i8* %ip')
+    print('  switch i8 %op, label %latch [')
+    for c in range(num_cases):
+      print('    i8 {0}, label %c{1}'.format(c - 128, c))
+    print('  ]')
+
+    updates = {}
+    for c in range(num_cases):
+      print('c{0}:'.format(c))
+      for u in range(3):
+        dst = (c * 5 + u * 11 + 1) % num_values
+        src1 = (c * 3 + u) % num_values
+        src2 = (c * 7 + u * 13 + 2) % num_values
+        if c % 5 == 0 and u == 0:
+          print('  %r{0}.{1} = call i32 @callout(i32 %v{2}, i32 %v{3})'
+                .format(c, u, src1, src2))
+        else:
+          print('  %r{0}.{1} = {2} i32 %v{3}, %v{4}'
+                .format(c, u, OPS[(c + u) % len(OPS)], src1, src2))
+        updates[(c, dst)] = '%r{0}.{1}'.format(c, u)
+      print('  br label %latch')
+
+    print('latch:')
+    for v in range(num_values):
+      incoming = ['[ %v{0}, %loop ]'.format(v)]
+      for c in range(num_cases):
+        value = updates.get((c, v), '%v{0}'.format(v))
+        incoming.append('[ {0}, %c{1} ]'.format(value, c))
+      print('  %n{0} = phi i32 {1}'.format(v, ', '.join(incoming)))
+    print('  %pc.next = add i32 %pc, 1')
+    print('  %cond = icmp slt i32 %pc.next, %n')
+    print('  br i1 %cond, label %loop, label %exit')
+
+    print('exit:')
+    for v in range(num_values):
+      print('  store i32 %n{0}, i32* %a{0}'.format(v))
+    print('  ret void')
+    print('}\n')
+
+def main():
+  parser = optparse.OptionParser()
+  parser.add_option('-c', dest='cases', type='int', default=200,
+                    help='number of switch cases (at most 256)')
+  parser.add_option('-v', dest='values', type='int', default=24,
+                    help='number of values live around the loop')
+  parser.add_option('-f', dest='functions', type='int', default=1,
+                    help='number of functions')
+  opts, args = parser.parse_args()
+  generate(min(opts.cases, 256), opts.values, opts.functions)
+
+if __name__ == '__main__':
+  main()